@@ -0,0 +1,48 @@
+#pragma once
+#include <QVector>
+
+/**
+ * 平面音频块
+ * 不拥有内存的视图：每个声道一段连续的 float，帧数不超过 prepare() 时给定的上限
+ */
+struct AudioBlock {
+    float *const *channels = nullptr;
+    int channelCount = 0;
+    int frameCount = 0;
+
+    float *channel(int ch) const { return channels[ch]; }
+};
+
+/**
+ * 平面音频缓冲区
+ * 一次性分配固定容量，音频线程只做读写与格式转换，不再分配内存
+ */
+class AudioBuffer {
+public:
+    AudioBuffer() = default;
+    AudioBuffer(int channels, int frames);
+
+    // 分配内存，不可在音频线程调用
+    void setSize(int channels, int frames);
+    void clear();
+
+    int channelCount() const { return m_channels; }
+    int capacity() const { return m_frames; }
+    float *channel(int ch) { return m_pointers[ch]; }
+    const float *channel(int ch) const { return m_pointers[ch]; }
+
+    AudioBlock block(int frames) const;
+
+    // 交错/平面转换，frames 不得超过 capacity()
+    void deinterleave(const float *interleaved, int frames);
+    void interleave(float *interleaved, int frames) const;
+
+private:
+    AudioBuffer(const AudioBuffer &) = delete;
+    AudioBuffer &operator=(const AudioBuffer &) = delete;
+
+    QVector<float> m_data;
+    QVector<float*> m_pointers;
+    int m_channels = 0;
+    int m_frames = 0;
+};
@@ -5,9 +5,51 @@
 #include <QString>
 #include <QMutex>
 #include <QThread>
-#include <QAudioFormat>
+#include <QTimer>
 #include <QJsonObject>
 #include <complex>
+#include <atomic>
+#include "audio_buffer.h"
+#include "biquad_cascade.h"
+#include "impulse_response.h"
+#include "partitioned_convolver.h"
+#include "reverb_tank.h"
+#include "oversampler.h"
+#include "hrtf.h"
+#include "spsc_queue.h"
+
+class AudioEffectChain;
+
+/**
+ * 线性平滑参数
+ * 目标值变化时在固定样本数内逐样本过渡，避免参数阶跃带来的拉链噪声
+ */
+class SmoothedValue {
+public:
+    void setRampLength(int samples) { m_rampLength = samples > 0 ? samples : 0; }
+    void reset(float value) { m_current = m_target = value; m_remaining = 0; }
+    void setTarget(float value);
+
+    float next() {
+        if (m_remaining > 0) {
+            m_current += m_step;
+            if (--m_remaining == 0) m_current = m_target;
+        }
+        return m_current;
+    }
+    void skip(int samples);
+
+    bool isSmoothing() const { return m_remaining > 0; }
+    float current() const { return m_current; }
+    float target() const { return m_target; }
+
+private:
+    float m_current = 0.0f;
+    float m_target = 0.0f;
+    float m_step = 0.0f;
+    int m_remaining = 0;
+    int m_rampLength = 0;
+};
 
 /**
  * 音频效果处理器基类
@@ -41,18 +83,45 @@ public:
 
     explicit AudioEffect(EffectType type, QObject *parent = nullptr);
     virtual ~AudioEffect() = default;
+    
+    // 按类型创建效果器，尚未实现的类型返回 nullptr
+    static AudioEffect *create(EffectType type, QObject *parent = nullptr);
 
-    // 基本接口
-    virtual void process(QVector<float> &audioData, int channels, int sampleRate) = 0;
+    // 基本接口（兼容接口：交错数据，内部拆成平面块后交给 processBlock）
+    virtual void process(QVector<float> &audioData, int channels, int sampleRate);
     virtual void reset() = 0;
     
+    // 实时处理接口
+    // prepare() 在非音频线程调用，固定采样率与声道数并完成全部内存分配；
+    // processBlock() 在音频线程调用，不分配内存、不加锁
+    virtual void prepare(int sampleRate, int channels, int maxBlockFrames);
+    virtual void processBlock(const AudioBlock &block) = 0;
+    bool isPrepared() const { return m_preparedChannels > 0; }
+    int preparedSampleRate() const { return m_preparedSampleRate; }
+    int preparedChannels() const { return m_preparedChannels; }
+    int maxBlockFrames() const { return m_maxBlockFrames; }
+    // 效果器对整个信号引入的处理延迟（原采样率下的样本数），任意线程可读；
+    // 只延迟湿信号的部分（如混响预延迟、卷积块延迟）属于效果本身，不计入
+    int latency() const { return m_latency.load(std::memory_order_relaxed); }
+    
     // 效果控制
     virtual void setEnabled(bool enabled);
-    bool isEnabled() const { return m_enabled; }
-    
-    virtual void setParameter(const QString &name, float value);
-    virtual float getParameter(const QString &name) const;
-    virtual QStringList getParameterNames() const;
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    
+    // 参数：整数 id 即注册顺序，各效果器以枚举给出
+    // setParameter() 在 UI 线程调用：更新界面侧数值后交给音频线程；
+    // 效果器位于效果链中时经由无锁队列投递，在下一个块边界生效，调用方不会被阻塞
+    void setParameter(int id, float value);
+    void setParameter(const QString &name, float value);
+    float getParameter(int id) const;
+    float getParameter(const QString &name) const;
+    int parameterId(const QString &name) const;
+    int parameterCount() const { return m_parameterInfo.size(); }
+    QString parameterName(int id) const;
+    QStringList getParameterNames() const;
+    
+    // 音频线程：应用一次参数更新，不分配内存、不加锁
+    virtual void applyParameter(int id, float value) = 0;
     
     // 预设管理
     virtual void loadPreset(const QString &presetName);
@@ -72,26 +141,75 @@ signals:
     void enabledChanged(bool enabled);
 
 protected:
-    void setParameterInternal(const QString &name, float value);
+    struct ParameterInfo {
+        QString name;
+        float minValue;
+        float maxValue;
+    };
+    
+    // 注册参数，返回其 id；只在构造或结构变化（如均衡器增删频段）时调用
+    int addParameter(const QString &name, float defaultValue, float minValue, float maxValue);
+    void removeLastParameters(int count);
+    // prepare() 中调用：把界面侧数值全部应用到处理状态，并跳过平滑
+    void syncParameters();
+    // 平滑参数的过渡时长（样本数）；同步期间直接跳到目标值
+    int smoothingSamples() const;
+    void setSmoothed(SmoothedValue &value, float target) const;
+    // 音频线程或 prepare() 中调用：延迟随参数变化时更新，效果链在下一个块汇总
+    void setLatency(int samples) { m_latency.store(samples, std::memory_order_relaxed); }
     
     EffectType m_effectType;
-    bool m_enabled;
-    QMap<QString, float> m_parameters;
+    std::atomic<bool> m_enabled;
+    std::atomic<int> m_latency;
+    QVector<ParameterInfo> m_parameterInfo;
+    QVector<float> m_parameterValues;   // 界面侧数值，仅 UI 线程访问
     QMap<QString, QJsonObject> m_presets;
+    
+    // prepare() 固定的处理格式
+    int m_preparedSampleRate;
+    int m_preparedChannels;
+    int m_maxBlockFrames;
+    bool m_syncing;   // syncParameters() 进行中
+
+private:
+    friend class AudioEffectChain;
+    
+    AudioBuffer m_interleavedScratch; // 兼容接口使用的平面缓冲
+    AudioEffectChain *m_chain;        // 所属效果链，参数经其队列投递
+    int m_effectId;                   // 在所属效果链中的标识
 };
 
 /**
  * 混响效果器
- * 实现高质量的混响效果
+ * 两种引擎：Freeverb 风格的梳状/全通网络，或基于脉冲响应的分区卷积。
+ * 卷积引擎的湿信号相对干信号固定延迟一个卷积块（相当于附加的预延迟）
  */
 class ReverbEffect : public AudioEffect {
     Q_OBJECT
 
 public:
+    enum ReverbEngine {
+        Freeverb,       // 算法混响
+        Convolution     // 脉冲响应卷积
+    };
+
+    enum Parameter {
+        RoomSize,
+        Damping,
+        WetLevel,
+        DryLevel,
+        PreDelay,
+        DecayTime,
+        Engine
+    };
+
     explicit ReverbEffect(QObject *parent = nullptr);
+    ~ReverbEffect();
     
-    void process(QVector<float> &audioData, int channels, int sampleRate) override;
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
     void reset() override;
+    void applyParameter(int id, float value) override;
     
     // 混响参数
     void setRoomSize(float size);        // 房间大小 0-1
@@ -100,36 +218,61 @@ public:
     void setDryLevel(float level);       // 干信号电平 0-1
     void setPreDelay(float delay);       // 预延迟 ms
     void setDecayTime(float time);       // 衰减时间 s
+    void setEngine(ReverbEngine engine);
+    
+    // 卷积引擎的脉冲响应（UI 线程）：重采样、切分与频谱计算都在调用线程完成，
+    // 完成后交给音频线程，新旧脉冲响应之间交叉淡化
+    bool loadImpulseResponse(const QString &filePath, QString *errorMessage = nullptr);
+    void setImpulseResponse(const ImpulseResponse &response);
+    bool hasImpulseResponse() const { return !m_impulseResponse.isEmpty(); }
+    int convolutionBlockSize() const;    // 即卷积引擎湿信号的延迟（样本）
 
 private:
-    void initializeDelayLines();
-    void processAllPass(QVector<float> &data, int channels);
-    void processComb(QVector<float> &data, int channels);
-    
-    // 延迟线
-    struct DelayLine {
-        QVector<float> buffer;
-        int writePos;
-        int readPos;
-        float feedback;
-        float gain;
+    // 卷积引擎：每个处理声道一个卷积器，按脉冲响应的声道循环取用
+    struct ConvolutionEngine {
+        QVector<PartitionedConvolver> convolvers;
     };
     
-    QVector<DelayLine> m_allPassDelays;
-    QVector<DelayLine> m_combDelays;
-    
-    // 混响参数
+    void initializeDelayLines();
+    void updateCombFeedback();
+    void applyPreDelay(const AudioBlock &block);
+    void mixWet(const AudioBlock &block, float wetScale);
+    void processFreeverb(const AudioBlock &block);
+    void processConvolution(const AudioBlock &block);
+    void adoptPendingEngine();
+    ConvolutionEngine *buildConvolutionEngine() const;
+    void collectRetiredEngines();
+    void releaseEngines();
+    
+    QVector<ReverbTank> m_tanks;         // 每声道一个
+    
+    // 混响参数（音频线程侧）
     float m_roomSize;
     float m_damping;
-    float m_wetLevel;
-    float m_dryLevel;
+    SmoothedValue m_wetLevel;
+    SmoothedValue m_dryLevel;
     float m_preDelay;
     float m_decayTime;
+    ReverbEngine m_engine;
     
     // 内部状态
     int m_sampleRate;
-    QVector<float> m_preDelayBuffer;
+    int m_channels;
+    QVector<float> m_preDelayBuffer;   // [channel][preDelayMask + 1]
     int m_preDelayPos;
+    int m_preDelaySamples;
+    int m_preDelayMask;                // 延迟线长度取 2 的幂，读写以掩码回绕
+    
+    // 卷积引擎
+    ImpulseResponse m_impulseResponse;                 // 原始脉冲响应，仅 UI 线程访问
+    ConvolutionEngine *m_convolution;                  // 音频线程当前使用
+    ConvolutionEngine *m_fadingConvolution;            // 交叉淡出中的旧引擎
+    std::atomic<ConvolutionEngine*> m_pendingConvolution;  // UI -> 音频线程
+    SpscQueue<ConvolutionEngine*> m_retiredConvolutions;   // 音频线程 -> UI，由 UI 线程释放
+    AudioBuffer m_wetBuffer;           // 湿信号（两种引擎共用）
+    QVector<float> m_fadeBuffer;       // 旧引擎的湿信号
+    int m_fadeLength;
+    int m_fadePos;
 };
 
 /**
@@ -140,10 +283,21 @@ class EchoEffect : public AudioEffect {
     Q_OBJECT
 
 public:
+    enum Parameter {
+        DelayTime,
+        Feedback,
+        WetLevel,
+        DryLevel,
+        NumEchoes,
+        EchoSpread
+    };
+
     explicit EchoEffect(QObject *parent = nullptr);
     
-    void process(QVector<float> &audioData, int channels, int sampleRate) override;
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
     void reset() override;
+    void applyParameter(int id, float value) override;
     
     // 回声参数
     void setDelayTime(float time);       // 延迟时间 ms
@@ -154,24 +308,28 @@ public:
     void setEchoSpread(float spread);    // 回声间隔
 
 private:
+    void initializeTaps();
+    void updateTaps();
+    
     struct EchoTap {
         QVector<float> delayBuffer;
         int bufferSize;
         int writePos;
-        float delayTime;
+        float delayScale;   // 相对基础延迟的倍数
         float gain;
     };
     
-    QVector<EchoTap> m_echoTaps;
+    QVector<EchoTap> m_echoTaps;     // 每个抽头的缓冲为 [channel][bufferSize]
     
-    float m_delayTime;
+    SmoothedValue m_delayTime;
     float m_feedback;
-    float m_wetLevel;
-    float m_dryLevel;
+    SmoothedValue m_wetLevel;
+    SmoothedValue m_dryLevel;
     int m_numEchoes;
     float m_echoSpread;
     
     int m_sampleRate;
+    int m_channels;
 };
 
 /**
@@ -182,10 +340,22 @@ class ChorusEffect : public AudioEffect {
     Q_OBJECT
 
 public:
+    enum Parameter {
+        Rate,
+        Depth,
+        Delay,
+        Feedback,
+        WetLevel,
+        DryLevel,
+        Voices
+    };
+
     explicit ChorusEffect(QObject *parent = nullptr);
     
-    void process(QVector<float> &audioData, int channels, int sampleRate) override;
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
     void reset() override;
+    void applyParameter(int id, float value) override;
     
     // 合唱参数
     void setRate(float rate);            // LFO频率 Hz
@@ -197,6 +367,8 @@ public:
     void setVoices(int voices);          // 声部数量
 
 private:
+    void initializeVoices();
+    
     struct ChorusVoice {
         QVector<float> delayBuffer;
         int bufferSize;
@@ -206,23 +378,26 @@ private:
         float detune;
     };
     
-    QVector<ChorusVoice> m_voices;
+    QVector<ChorusVoice> m_voices;   // 每个声部的缓冲为 [channel][bufferSize]
     
     float m_rate;
-    float m_depth;
-    float m_delay;
+    SmoothedValue m_depth;
+    SmoothedValue m_delay;
     float m_feedback;
-    float m_wetLevel;
-    float m_dryLevel;
+    SmoothedValue m_wetLevel;
+    SmoothedValue m_dryLevel;
     int m_numVoices;
     
     int m_sampleRate;
+    int m_channels;
     float m_lfoPhase;
 };
 
 /**
  * 动态范围处理器
- * 包括压缩器、限幅器、门限器等
+ * 包括压缩器、限幅器、门限器等。
+ * 前瞻时检测电平取前瞻窗口内的最大值，增益作用于延迟后的信号，
+ * 峰值到达输出之前增益已经降下来；输出相对输入延迟前瞻时间
  */
 class DynamicsProcessor : public AudioEffect {
     Q_OBJECT
@@ -235,10 +410,22 @@ public:
         Expander
     };
 
+    enum Parameter {
+        Threshold,
+        Ratio,
+        Attack,
+        Release,
+        Knee,
+        MakeupGain,
+        Lookahead
+    };
+
     explicit DynamicsProcessor(ProcessorType type, QObject *parent = nullptr);
     
-    void process(QVector<float> &audioData, int channels, int sampleRate) override;
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
     void reset() override;
+    void applyParameter(int id, float value) override;
     
     // 动态处理参数
     void setThreshold(float threshold);  // 阈值 dB
@@ -250,26 +437,146 @@ public:
     void setLookahead(float time);       // 前瞻时间 ms
 
 private:
-    float calculateGainReduction(float inputLevel);
-    float dbToLinear(float db);
-    float linearToDb(float linear);
+    void updateTimeConstants();
+    void slidingMaximum(float *levels, int frames);
+    void computeGains(int frames);
+    void resetWindow();
     
     ProcessorType m_processorType;
     
-    float m_threshold;
+    SmoothedValue m_threshold;
     float m_ratio;
     float m_attack;
     float m_release;
     float m_knee;
-    float m_makeupGain;
+    SmoothedValue m_makeupGain;
     float m_lookahead;
     
     // 内部状态
     float m_envelope;
-    QVector<float> m_lookaheadBuffer;
+    float m_attackCoeff;
+    float m_releaseCoeff;
+    QVector<float> m_lookaheadBuffer;   // [channel][lookaheadMask + 1]
     int m_lookaheadSamples;
+    int m_lookaheadMask;                // 延迟线长度取 2 的幂
     int m_lookaheadPos;
+    
+    // 前瞻窗口最大值：单调递减队列，按样本序号判断是否滑出窗口，均摊每样本 O(1)
+    QVector<float> m_windowValues;
+    QVector<quint32> m_windowIndices;
+    quint32 m_windowHead;
+    quint32 m_windowTail;
+    quint32 m_sampleIndex;
+    
+    // 块内中间结果：检测电平 -> 窗口峰值 -> 包络 -> 增益，就地覆盖
+    QVector<float> m_detector;
+    QVector<float> m_thresholdRamp;
+    QVector<float> m_makeupRamp;
+    
     int m_sampleRate;
+    int m_channels;
+};
+
+/**
+ * 非线性效果器基类：可选 2x/4x/8x 过采样
+ * 子类在 processOversampled() 中以 oversampledRate() 处理，产生的高次谐波在降采样时被半带滤波器滤除，
+ * 不会折叠回可听频段；过采样引入的延迟经 latency() 报告，供效果链补偿
+ */
+class OversampledEffect : public AudioEffect {
+    Q_OBJECT
+
+public:
+    // 参数 0 固定为过采样倍数，子类的参数从 1 开始编号
+    enum { OversamplingParameter = 0 };
+
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
+    void reset() override;
+    void applyParameter(int id, float value) override;
+
+    void setOversampling(int factor);    // 1/2/4/8
+
+protected:
+    OversampledEffect(EffectType type, int defaultFactor, QObject *parent);
+
+    // 音频线程：处理过采样后的块
+    virtual void processOversampled(const AudioBlock &block) = 0;
+    // 音频线程：prepare() 或倍数变化后调用，子类据此调整与采样率相关的状态，不可分配内存
+    virtual void oversamplingChanged(int oversampledRate) { Q_UNUSED(oversampledRate) }
+    int oversamplingFactor() const { return m_oversampler.factor(); }
+    int oversampledRate() const { return m_preparedSampleRate * m_oversampler.factor(); }
+
+private:
+    Oversampler m_oversampler;
+};
+
+/**
+ * 失真效果器
+ * 有理函数近似的 tanh 软削波，默认 4 倍过采样
+ */
+class DistortionEffect : public OversampledEffect {
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        Drive = OversamplingParameter + 1,
+        Mix,
+        OutputGain
+    };
+
+    explicit DistortionEffect(QObject *parent = nullptr);
+
+    void applyParameter(int id, float value) override;
+
+    void setDrive(float drive);          // 驱动 dB
+    void setMix(float mix);              // 干湿比 0-1
+    void setOutputGain(float gain);      // 输出增益 dB
+
+protected:
+    void processOversampled(const AudioBlock &block) override;
+    void oversamplingChanged(int oversampledRate) override;
+
+private:
+    SmoothedValue m_drive;        // 线性
+    SmoothedValue m_mix;
+    SmoothedValue m_outputGain;   // 线性
+};
+
+/**
+ * 位压缩效果器
+ * 降低量化位数（可取小数位，便于平滑扫动）并按原采样率做采样保持，默认 2 倍过采样
+ */
+class BitCrusherEffect : public OversampledEffect {
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        BitDepth = OversamplingParameter + 1,
+        Downsample,
+        Mix
+    };
+
+    explicit BitCrusherEffect(QObject *parent = nullptr);
+
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void reset() override;
+    void applyParameter(int id, float value) override;
+
+    void setBitDepth(float bits);        // 量化位数 1-16
+    void setDownsample(int factor);      // 采样保持长度（原采样率样本数）
+    void setMix(float mix);              // 干湿比 0-1
+
+protected:
+    void processOversampled(const AudioBlock &block) override;
+    void oversamplingChanged(int oversampledRate) override;
+
+private:
+    float m_levels;          // 2^(bits-1)
+    int m_downsample;
+    int m_holdLength;        // 过采样率下的保持长度
+    SmoothedValue m_mix;
+    QVector<float> m_heldSamples;   // [channel]
+    QVector<int> m_holdCounters;    // [channel]
 };
 
 /**
@@ -301,12 +608,27 @@ public:
         static EQBand fromJson(const QJsonObject &json);
     };
 
+    // 每个频段占用连续的一组参数：id = 频段序号 * BandParameterCount + BandParameter
+    enum BandParameter {
+        BandGain,
+        BandFrequency,
+        BandQ,
+        BandType,
+        BandEnabled,
+        BandParameterCount
+    };
+    static int bandParameter(int band, BandParameter parameter) { return band * BandParameterCount + parameter; }
+
     explicit MultibandEqualizer(QObject *parent = nullptr);
     
-    void process(QVector<float> &audioData, int channels, int sampleRate) override;
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
     void reset() override;
+    void applyParameter(int id, float value) override;
     
     // 频段操作
+    // 增删频段会重新分配处理状态，须在效果器开始处理之前调用；
+    // updateBand() 只投递参数，可在播放中调用
     void addBand(const EQBand &band);
     void removeBand(int index);
     void updateBand(int index, const EQBand &band);
@@ -319,19 +641,19 @@ public:
     void setupParametricEqualizer();    // 参数均衡器
 
 private:
-    struct BiquadFilter {
+    struct BiquadCoefficients {
         float b0, b1, b2;  // 前馈系数
         float a1, a2;      // 反馈系数
-        float x1, x2;      // 输入延迟
-        float y1, y2;      // 输出延迟
         
-        void reset();
-        float process(float input);
-        void calculateCoefficients(const EQBand &band, int sampleRate);
+        static BiquadCoefficients fromBand(const EQBand &band, int sampleRate);
     };
     
-    QVector<EQBand> m_bands;
-    QVector<QVector<BiquadFilter>> m_filters; // [band][channel]
+    void rebuildCascade();
+    void updateCoefficients(int index, bool smooth);
+    void clearBands();
+    
+    QVector<EQBand> m_bands;   // 音频线程侧的频段参数
+    BiquadCascade m_cascade;   // 每个频段一级，各声道独立状态
     
     int m_sampleRate;
     int m_channels;
@@ -340,6 +662,8 @@ private:
 /**
  * 空间音效处理器
  * 实现3D定位和环绕声效果
+ * 启用 HRTF 且已载入测量集时，声源下混为单声道后经 HrtfRenderer 双耳渲染（取代声像与串扰模拟），
+ * 引入一个 HRTF 分区的延迟；更换测量集时新旧渲染器交叉淡化
  */
 class SpatialAudioProcessor : public AudioEffect {
     Q_OBJECT
@@ -354,10 +678,28 @@ public:
         bool enabled;
     };
 
+    enum Parameter {
+        SourceX,
+        SourceY,
+        SourceZ,
+        ListenerX,
+        ListenerY,
+        ListenerZ,
+        ListenerYaw,
+        ListenerPitch,
+        ListenerRoll,
+        Hrtf,
+        Surround,
+        RoomSimulation
+    };
+
     explicit SpatialAudioProcessor(QObject *parent = nullptr);
+    ~SpatialAudioProcessor();
     
-    void process(QVector<float> &audioData, int channels, int sampleRate) override;
+    void prepare(int sampleRate, int channels, int maxBlockFrames) override;
+    void processBlock(const AudioBlock &block) override;
     void reset() override;
+    void applyParameter(int id, float value) override;
     
     // 空间定位
     void setListenerPosition(float x, float y, float z);
@@ -365,8 +707,11 @@ public:
     void setSourcePosition(float x, float y, float z);
     
     // HRTF处理
+    // 测量集（UI 线程）：重采样与各方向的分区频谱都在调用线程算好，再交给音频线程
     void enableHRTF(bool enabled);
-    void loadHRTFData(const QString &filePath);
+    bool loadHRTFData(const QString &filePath, QString *errorMessage = nullptr);
+    void setHrtfDataset(const HrtfDataset &dataset);
+    bool hasHrtfData() const { return !m_hrtfDataset.isEmpty(); }
     
     // 环绕声
     void setSurroundMode(bool enabled);
@@ -374,10 +719,17 @@ public:
 
 private:
     void calculateStereoPosition();
-    void applyHRTF(QVector<float> &audioData);
-    void applyCrossfeed(QVector<float> &audioData);
+    void applyCrossfeed(const AudioBlock &block);
+    void processHrtf(const AudioBlock &block);
+    void adoptPendingRenderer();
+    HrtfRenderer *buildHrtfRenderer() const;
+    void collectRetiredRenderers();
+    void releaseRenderers();
     
     AudioSource m_source;
+    SmoothedValue m_gainLeft;
+    SmoothedValue m_gainRight;
+    SmoothedValue m_distanceGain;   // HRTF 模式下只施加距离衰减
     float m_listenerX, m_listenerY, m_listenerZ;
     float m_listenerYaw, m_listenerPitch, m_listenerRoll;
     
@@ -385,10 +737,20 @@ private:
     bool m_surroundEnabled;
     bool m_roomSimEnabled;
     
-    QVector<QVector<float>> m_hrtfLeft;
-    QVector<QVector<float>> m_hrtfRight;
-    
     int m_sampleRate;
+    float m_crossfeedState[2];   // 串扰低通状态
+    
+    // HRTF 渲染
+    HrtfDataset m_hrtfDataset;                     // 原始测量集，仅 UI 线程访问
+    HrtfRenderer *m_hrtf;                          // 音频线程当前使用
+    HrtfRenderer *m_fadingHrtf;                    // 交叉淡出中的旧渲染器
+    std::atomic<HrtfRenderer*> m_pendingHrtf;      // UI -> 音频线程
+    SpscQueue<HrtfRenderer*> m_retiredHrtf;        // 音频线程 -> UI，由 UI 线程释放
+    bool m_hrtfActive;                             // 上一个块是否走了 HRTF
+    QVector<float> m_monoBuffer;
+    QVector<float> m_fadeBuffer;                   // [ear][maxBlockFrames]：旧渲染器的输出
+    int m_fadeLength;
+    int m_fadePos;
 };
 
 /**
@@ -402,7 +764,9 @@ public:
     explicit AudioEffectChain(QObject *parent = nullptr);
     ~AudioEffectChain();
     
-    // 效果链操作
+    // 效果链操作（UI 线程）
+    // 每次拓扑变化都在调用线程构建新的不可变快照，音频线程以原子指针交换取用；
+    // 被替换的快照与移除的效果器在音频线程离开后于 UI 线程回收，音频线程全程不加锁
     void addEffect(AudioEffect *effect);
     void insertEffect(int index, AudioEffect *effect);
     void removeEffect(int index);
@@ -415,10 +779,19 @@ public:
     void setEffectParameter(int index, const QString &parameter, float value);
     
     // 链处理
+    // prepare() 在控制线程调用：先换上空快照、等音频线程离开后重新分配各效果器，再发布新快照；
+    // processBlock() 为实时路径，按快照顺序就地处理各效果。
+    // processAudio() 遇到与快照不同的流格式时原样输出并登记新格式，由控制线程的定时器调用 prepare()
+    void prepare(int sampleRate, int channels, int maxBlockFrames);
+    void processBlock(const AudioBlock &block);
     void processAudio(QVector<float> &audioData, int channels, int sampleRate);
-    void reset();
+    void processAudio(float *interleaved, int frames, int channels, int sampleRate);
+    void reset();   // 可在任意线程调用，在下一个块开始时执行
+    // 已启用效果器的延迟总和（样本数），音频线程每块更新，任意线程可读；
+    // 播放时钟据此扣除，使歌词与进度对应实际听到的位置
+    int latency() const { return m_latency.load(std::memory_order_relaxed); }
     
-    // 链管理
+    // 链管理（UI 侧视图）
     int getEffectCount() const;
     AudioEffect* getEffect(int index) const;
     QVector<AudioEffect*> getAllEffects() const;
@@ -439,7 +812,67 @@ signals:
     void chainChanged();
 
 private:
-    QVector<AudioEffect*> m_effects;
-    QMutex m_effectsMutex;
+    friend class AudioEffect;
+    
+    // UI 线程投递给音频线程的参数更新
+    struct ParameterUpdate {
+        int effectId;
+        int parameterId;
+        float value;
+    };
+    
+    // 不可变的效果链快照，发布后只被音频线程读取；交错接口的平面缓冲随快照按其格式分配
+    struct ChainSnapshot {
+        QVector<AudioEffect*> effects;
+        int sampleRate = 0;
+        int channels = 0;
+        AudioBuffer blockBuffer;
+    };
+    
+    // 等待回收的旧快照及随之移除的效果器，epoch 为替换时音频线程的纪元
+    struct RetiredSnapshot {
+        ChainSnapshot *snapshot;
+        QVector<AudioEffect*> removedEffects;
+        quint32 epoch;
+    };
+    
+    void prepareEffect(AudioEffect *effect);
+    void attachEffect(AudioEffect *effect);
+    void detachEffect(AudioEffect *effect);
+    void postParameter(AudioEffect *effect, int parameterId, float value);
+    bool flushOverflowUpdates();
+    void applyPendingParameters();
+    void runEffects(const ChainSnapshot *snapshot, const AudioBlock &block);
+    // 控制线程：处理音频线程登记的格式变化
+    void applyRequestedFormat();
+    // 等待音频线程离开调用前已进入的块
+    void waitForAudioThread() const;
+    
+    // 以 m_effects 构建并发布新快照，旧快照连同 removed 一起退役（调用方持有 m_effectsMutex）
+    void publishSnapshot(const QVector<AudioEffect*> &removed = QVector<AudioEffect*>());
+    void reclaimRetired();
+    
+    QVector<AudioEffect*> m_effects;          // UI 侧效果列表，与最新快照一致
+    mutable QMutex m_effectsMutex;            // 只在非实时线程之间使用
+    std::atomic<ChainSnapshot*> m_snapshot;
+    // 音频线程进入 processBlock 时加一、离开时再加一，奇数表示正在处理
+    std::atomic<quint32> m_audioEpoch;
+    QVector<RetiredSnapshot> m_retired;
+    QTimer *m_reclaimTimer;
+    QTimer *m_overflowTimer;                  // 有暂存的参数更新时定期补发
+    QTimer *m_formatTimer;
+    // 音频线程登记的流格式（采样率 << 8 | 声道数），0 表示没有
+    std::atomic<qint64> m_requestedFormat;
+    std::atomic<bool> m_resetPending;
+    std::atomic<int> m_latency;
+    
+    SpscQueue<ParameterUpdate> m_parameterQueue;
+    QVector<ParameterUpdate> m_overflowUpdates;   // 队列满时暂存，仅 UI 线程访问
+    int m_nextEffectId;
     QMap<QString, QJsonObject> m_chainPresets;
+    
+    // 控制线程的处理格式，发布快照时写入快照
+    int m_sampleRate;
+    int m_channels;
+    int m_maxBlockFrames;
 };
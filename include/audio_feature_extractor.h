@@ -0,0 +1,88 @@
+#pragma once
+#include <QVector>
+#include "fft.h"
+#include "spectrum_bands.h"
+#include "loudness_analyzer.h"
+
+/**
+ * 离线音频特征提取
+ * 输入为下混、重采样到低分析采样率（默认 22.05kHz）的单声道流，按块送入即可，不保存整首曲目的样本。
+ * 所有特征共用同一个 STFT（2048 点 Hann 窗，跳 512 点，约 43 帧/秒），每帧只做一次 FFT：
+ *   - mel 频段的压缩谱通量 -> 起音包络，结束时做自相关估计 BPM 与节拍强度
+ *   - 100Hz~5kHz 频点按音级折叠成 12 维色度，逐帧归一化后累加，结束时与 Krumhansl 调性轮廓做相关求调
+ *   - 频谱质心、85% 滚降、平坦度（0~8kHz）与逐跳的 RMS、过零率
+ *   - 时域样本同时送入 LoudnessAnalyzer 得到门限积分响度（单声道近似，与立体声响度可差约 3dB）
+ * 每跳仅保存两个浮点数（起音强度与 RMS），十分钟的曲目约 200KB
+ */
+class AudioFeatureExtractor {
+public:
+    static const int DefaultSampleRate = 22050;
+
+    // 底层描述量，由调用方映射为感知特征
+    struct Result {
+        bool valid = false;
+        double durationSec = 0.0;
+        double tempo = 0.0;             // BPM，无明显节拍时为 0
+        double beatStrength = 0.0;      // 节拍周期处的归一化自相关 0-1
+        int keyIndex = -1;              // 0 = C ... 11 = B
+        bool major = true;
+        double keyClarity = 0.0;        // 最佳调与次佳调的相关系数之差
+        double loudnessLufs = -70.0;
+        double rmsDb = -90.0;           // 非静音跳的平均 RMS
+        double dynamicRangeDb = 0.0;    // 跳 RMS 的 95 与 10 百分位之差
+        double lowEnergyRatio = 0.0;    // RMS 低于所在一秒均值一半的跳所占比例（语音偏高）
+        double onsetRate = 0.0;         // 每秒起音数
+        double spectralCentroid = 0.0;  // Hz
+        double spectralRolloff = 0.0;   // Hz
+        double spectralFlatness = 0.0;  // 0（纯音）- 1（白噪声）
+        double zeroCrossingRate = 0.0;  // 每样本
+    };
+
+    explicit AudioFeatureExtractor(int sampleRate = DefaultSampleRate);
+
+    int sampleRate() const { return m_sampleRate; }
+    void reset();
+
+    // 送入单声道样本，任意块长
+    void process(const float *samples, int count);
+    // 处理完剩余样本并汇总；之后需 reset() 才能复用
+    Result finish();
+
+private:
+    void analyzeFrame(const float *frame);
+    double estimateTempo(double *strength) const;
+    void estimateKey(Result &result) const;
+
+    int m_sampleRate;
+    int m_frameSize;
+    int m_hopSize;
+
+    RealFFT m_fft;
+    SpectrumBandMapper m_melBands;
+    LoudnessAnalyzer m_loudness;
+    QVector<float> m_window;
+    QVector<float> m_pending;       // 未满一帧的样本，每跳前移
+    int m_pendingCount;
+    QVector<float> m_windowed;
+    QVector<float> m_re;
+    QVector<float> m_im;
+    QVector<float> m_power;
+    QVector<float> m_bandPower;
+    QVector<float> m_previousBands; // 上一帧的压缩 mel 谱
+
+    // 色度：参与折叠的频点及其音级
+    QVector<int> m_chromaBins;
+    QVector<int> m_chromaClasses;
+    double m_chroma[12];
+
+    int m_spectralMaxBin;
+    double m_centroidSum;
+    double m_rolloffSum;
+    double m_flatnessSum;
+    int m_spectralFrames;
+    double m_zeroCrossings;
+
+    QVector<float> m_onsetEnvelope; // 每跳一个值
+    QVector<float> m_hopRms;
+    qint64 m_samples;
+};
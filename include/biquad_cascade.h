@@ -0,0 +1,75 @@
+#pragma once
+#include <QVector>
+
+/**
+ * 串联二阶节滤波器（SIMD）
+ * 系数与状态按结构数组存放：b0[N] b1[N] b2[N] a1[N] a2[N]，N 为补齐到向量宽度的级数。
+ * 向量内核采用斜波前（wavefront）调度：第 k 个通道（lane）承载第 k 级滤波器，
+ * 在第 t 步处理第 t-k 个样本，于是每个样本只需一次向量运算即可推进所有级；
+ * 块首尾的三角区域按掩码处理，整体不引入额外延迟。
+ */
+class BiquadCascade {
+public:
+    enum Kernel {
+        ScalarKernel,
+        Sse2Kernel,
+        Avx2Kernel,
+        NeonKernel
+    };
+
+    BiquadCascade();
+
+    // 分配内存，不可在音频线程调用
+    void setSize(int stages, int channels);
+    int stageCount() const { return m_stages; }
+    int channelCount() const { return m_channels; }
+
+    // 立即设置第 stage 级的归一化系数（a0 = 1）；直通级使用 setBypass
+    void setCoefficients(int stage, float b0, float b1, float b2, float a1, float a2);
+    void setBypass(int stage);
+
+    // 音频线程调用：在 rampLength 个样本内把系数线性过渡到目标值，避免拉链噪声。
+    // 二阶节的稳定域（a1, a2 三角形）是凸集，两组稳定系数之间的线性插值仍然稳定
+    void setTargetCoefficients(int stage, float b0, float b1, float b2, float a1, float a2);
+    void setRampLength(int samples);
+    bool isRamping() const { return m_rampRemaining > 0; }
+
+    void reset();
+
+    // 就地处理一个平面块的各声道
+    void process(float *const *channels, int channelCount, int frames);
+
+    // 运行时按 CPU 特性选择的内核
+    static Kernel activeKernel();
+    static const char *kernelName(Kernel kernel);
+
+private:
+    int m_stages;
+    int m_lanes;        // 补齐后的级数
+    int m_channels;
+    QVector<float> m_coeffs;   // [5][lanes]
+    QVector<float> m_targets;  // [5][lanes] 斜坡目标
+    QVector<float> m_deltas;   // [5][lanes] 每样本增量
+    QVector<float> m_state;    // [channel][2][lanes]，转置直接 II 型的 s1/s2
+    int m_rampLength;
+    int m_rampRemaining;
+};
+
+// 各指令集内核：coeffs/deltas 与 state 的布局同上，lanes 为向量宽度的整数倍；
+// 前 rampSteps 个样本每样本把系数加上 deltas（不写回 coeffs）
+namespace BiquadKernels {
+void processScalar(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                   float *samples, int frames);
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+void processSse2(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                 float *samples, int frames);
+#endif
+#if defined(ENABLE_AVX2_KERNELS)
+void processAvx2(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                 float *samples, int frames);
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+void processNeon(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                 float *samples, int frames);
+#endif
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <QVector>
+#include <QPair>
+#include <QSemaphore>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "audio_buffer.h"
+#include "spsc_queue.h"
+#include "work_stealing_deque.h"
+
+class AudioEffectChain;
+
+/**
+ * 多区域 DSP 图调度器
+ * 一台设备驱动多路独立输出时，每个区域的效果链是图中的一个节点；节点可以以其他节点的输出
+ * （求和）为输入，例如多个区域共用一个前级节点。音频线程每个周期调用一次 process()：
+ * 入度为零的节点放在共享的就绪表中，工作线程（包括调用线程本身）依次领取；节点完成后，
+ * 入度降为零的后继压入本线程的双端队列，空闲线程从其他线程的队列窃取（Chase–Lev）。
+ * 工作线程常驻、绑定 CPU 核心并尽量提升为实时优先级，周期之间在信号量上休眠；
+ * 周期内空转一阵仍无节点可做时挂起在本周期的就绪信号量上，直到有新的就绪节点或周期结束，
+ * 共用前级完成后各区域节点仍能分散到所有工作线程；
+ * 周期内不加锁、不分配内存，效果链只走 processBlock() 的无锁路径。
+ * 整个周期超过截止时间（周期时长乘以预算比例）时累加错过截止计数
+ */
+class DspGraph {
+public:
+    // workerCount 不含调用线程；小于 0 时取 CPU 核数减一
+    explicit DspGraph(int workerCount = -1);
+    ~DspGraph();
+
+    // 拓扑（非音频线程）：编辑后 commit() 构建不可变的调度快照，音频线程在下一个周期开始时取用。
+    // 节点不拥有效果链，效果链的生命周期须长于图；chain 为空的节点只对输入求和。
+    // connect() 在节点不存在或会形成环时返回 false
+    int addNode(AudioEffectChain *chain);
+    void removeNode(int node);
+    bool connect(int from, int to);
+    void disconnect(int from, int to);
+    void commit();
+
+    // 非音频线程，音频停止时调用：固定格式，按该格式 prepare 各节点的效果链并分配缓冲
+    void prepare(int sampleRate, int channels, int maxBlockFrames);
+
+    // 音频线程：周期开始前向源节点的缓冲写入输入，process() 之后从各区域节点读取输出；
+    // 无输入连接的节点就地处理自己的缓冲。节点不在当前快照中时返回空块
+    AudioBlock nodeBlock(int node, int frames);
+    void process(int frames);
+
+    // 截止时间 = 周期时长 × budget，为驱动与后续混音留出余量
+    void setDeadlineBudget(double budget);
+    int workerCount() const { return m_workers.size(); }
+
+    // 统计，任意线程可读
+    quint64 periodCount() const { return m_periods.load(std::memory_order_relaxed); }
+    quint64 deadlineMisses() const { return m_deadlineMisses.load(std::memory_order_relaxed); }
+    double lastPeriodLoad() const;   // 上一周期耗时 / 周期时长
+
+private:
+    class Worker;
+
+    struct Node {
+        int id;
+        AudioEffectChain *chain;
+        AudioBuffer buffer;
+    };
+
+    // 不可变的调度快照：节点、按 CSR 存放的前驱/后继，以及每个周期复用的计数与队列
+    struct Schedule {
+        QVector<Node*> nodes;
+        QVector<int> inDegree;
+        QVector<int> predecessorOffsets;   // 节点 i 的前驱为 predecessors[offsets[i], offsets[i + 1])
+        QVector<int> predecessors;
+        QVector<int> successorOffsets;
+        QVector<int> successors;
+        QVector<int> sources;              // 入度为零的节点
+        std::unique_ptr<std::atomic<int>[]> pending;   // 本周期尚未完成的前驱数
+        std::vector<std::unique_ptr<WorkStealingDeque<int>>> deques;   // 每个执行线程一个
+        QVector<Node*> removedNodes;       // 随本快照退役一起释放的节点
+
+        ~Schedule() { qDeleteAll(removedNodes); }
+    };
+
+    Schedule *buildSchedule() const;
+    bool hasPath(int from, int to) const;
+    void adoptPendingSchedule();
+    void collectRetired();
+    void prepareNode(Node *node);
+
+    // 执行线程的周期循环：领取源节点、弹出本地队列、窃取；调用线程直到全部节点完成才返回
+    void runPeriod(int executor);
+    void runNode(Schedule *schedule, int executor, int index);
+    // 工作线程在周期内挂起，等待 runNode() 发出的就绪或周期结束信号
+    void park();
+    void workerLoop(int executor);
+
+    // 拓扑，仅非音频线程访问
+    QVector<Node*> m_nodes;
+    QVector<QPair<int, int>> m_edges;
+    QVector<Node*> m_removed;          // 自上次 commit() 以来移除的节点
+    int m_nextNodeId;
+
+    Schedule *m_schedule;                          // 音频线程当前使用
+    std::atomic<Schedule*> m_pendingSchedule;      // 非音频线程 -> 音频线程
+    SpscQueue<Schedule*> m_retiredSchedules;       // 音频线程 -> 非音频线程释放
+
+    // 周期状态：m_periodActive 与 m_activeExecutors 保证 process() 返回后没有工作线程仍在访问快照
+    std::atomic<bool> m_periodActive;
+    std::atomic<int> m_activeExecutors;
+    std::atomic<int> m_remaining;
+    std::atomic<int> m_sourceCursor;
+    int m_frames;
+
+    QVector<Worker*> m_workers;
+    QSemaphore m_wake;
+    QSemaphore m_ready;                // 周期内挂起的工作线程在此等待，周期结束时清空
+    std::atomic<int> m_parked;
+    std::atomic<bool> m_stopping;
+
+    int m_sampleRate;
+    int m_channels;
+    int m_maxBlockFrames;
+    std::atomic<float> m_deadlineBudget;
+    std::atomic<quint64> m_periods;
+    std::atomic<quint64> m_deadlineMisses;
+    std::atomic<float> m_lastLoad;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * 动态处理器的静态增益曲线（SIMD）
+ * levels 为包络的线性电平，就地替换为线性增益；thresholds/makeups 为逐样本的阈值与补偿增益（dB）。
+ * 曲线写成无分支的选择运算，对数/指数使用 FastMath 的同一组多项式，向量与标量尾部结果一致
+ */
+namespace DynamicsKernels {
+// 压缩/限幅：超出阈值的部分在 ±knee/2 内为二次曲线，之上按 slope = 1/ratio - 1 直线衰减
+void compressorGains(float *levels, const float *thresholds, const float *makeups, int frames,
+                     float slope, float knee);
+// 门限/扩展：低于阈值的部分按 slope = ratio - 1 向下扩展，最多衰减到 floorDb
+void expanderGains(float *levels, const float *thresholds, const float *makeups, int frames,
+                   float slope, float floorDb);
+}
@@ -13,6 +13,7 @@
 // 引入我们创建的高级组件
 #include "materialui_components.h"
 #include "smart_playlist.h"
+#include "online_music_service.h"
 #include "spectrum_analyzer.h"
 #include "audio_effects.h"
 #include "gesture_system.h"
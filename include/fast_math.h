@@ -0,0 +1,53 @@
+#pragma once
+#include <QtGlobal>
+#include <cstring>
+
+/**
+ * 快速对数/指数近似
+ * 指数部分直接从 IEEE 754 位模式取出或拼装，尾数部分用多项式逼近，不查表也没有分支。
+ * log2 对正规数的绝对误差 < 1.5e-5（换算到分贝 < 1e-4 dB）；
+ * exp2 的相对误差 < 4e-6，输入钳制在 [-126, 126]
+ */
+namespace FastMath {
+// 最小二乘拟合 log2(1 + u)，u ∈ [0, 1)
+const float Log2Poly[6] = {1.43909257e-05f, 1.44159208f, -0.707253435f, 0.411561486f, -0.189832451f, 0.0439286295f};
+// 最小二乘拟合 2^f，f ∈ [0, 1)
+const float Exp2Poly[5] = {1.0000036f, 0.692969551f, 0.241621323f, 0.0517177351f, 0.0136839831f};
+
+const float DbPerLog2 = 6.02059991f;    // 20 / log2(10)
+const float Log2PerDb = 0.166096404f;   // log2(10) / 20
+const float MinLevel = 1e-30f;
+const float MinLevelDb = -180.0f;
+
+inline float log2(float x) {
+    quint32 bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const float exponent = float(int(bits >> 23) - 127);
+    bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+    float mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(mantissa));
+    const float u = mantissa - 1.0f;
+    const float *c = Log2Poly;
+    return exponent + (c[0] + u * (c[1] + u * (c[2] + u * (c[3] + u * (c[4] + u * c[5])))));
+}
+
+inline float exp2(float x) {
+    x = qBound(-126.0f, x, 126.0f);
+    int i = int(x);
+    if (x < float(i)) --i;
+    const float f = x - float(i);
+    const float *c = Exp2Poly;
+    const quint32 bits = quint32(i + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return scale * (c[0] + f * (c[1] + f * (c[2] + f * (c[3] + f * c[4]))));
+}
+
+inline float linearToDb(float linear) {
+    return qMax(DbPerLog2 * log2(qMax(linear, MinLevel)), MinLevelDb);
+}
+
+inline float dbToLinear(float db) {
+    return exp2(db * Log2PerDb);
+}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QString>
+
+/**
+ * 特征向量的最近邻索引
+ * 向量按维度分列连续存放（SoA）：第 d 维的全部条目是一段连续 float，查询时每次取 4 个条目，
+ * 沿维度累加 q·x 得到平方距离 |x|² - 2q·x + |q|²（SSE2/NEON 展开），
+ * 与当前第 k 好的距离比较后才进入大小为 k 的堆，绝大多数条目只花一次比较。
+ * 删除只打墓碑（|x|² 置为无穷大），rebuild() 时压缩。
+ * 条目数达到阈值（默认 10 万）后 rebuild() 额外训练倒排文件索引（IVF）：
+ * k-means 取约 √N 个中心，存储按所属中心重排使每个列表连续，查询只扫描最近的若干个列表，
+ * 加上重建后新增（未编入列表）的尾部。不是线程安全的，由所属对象在同一线程使用
+ */
+class FeatureIndex {
+public:
+    struct Match {
+        QString id;
+        float distance;     // 平方欧氏距离
+    };
+
+    explicit FeatureIndex(int dimensions = 0);
+
+    // 修改维度会清空索引
+    void setDimensions(int dimensions);
+    int dimensions() const { return m_dimensions; }
+    int size() const { return m_slots.size(); }
+    bool isEmpty() const { return m_slots.isEmpty(); }
+    void clear();
+
+    // 插入或更新，vector 为 dimensions() 个值
+    void upsert(const QString &id, const float *vector);
+    bool remove(const QString &id);
+    bool contains(const QString &id) const { return m_slots.contains(id); }
+    bool vectorFor(const QString &id, float *vector) const;
+
+    // 距 query 最近的 k 个条目，按距离升序；exclude 为要跳过的条目（例如查询歌曲本身）
+    QVector<Match> nearest(const float *query, int k, const QString &exclude = QString()) const;
+
+    // 全量扫描：槽位 [0, slotCount()) 到 target 的加权平方距离 Σ w_d (x_d - t_d)²，写入 out；
+    // 墓碑为无穷大。用于按目标打分整个曲库，不经过 IVF
+    int slotCount() const { return m_used; }
+    const QString &idAt(int slot) const { return m_ids[slot]; }
+    void weightedDistances(const float *target, const float *weights, float *out) const;
+
+    // 近似索引：条目数不低于阈值时 rebuild() 训练 IVF，0 表示始终精确扫描
+    void setApproximateThreshold(int items) { m_approximateThreshold = items; }
+    void setProbeCount(int lists) { m_probeCount = qMax(1, lists); }
+    bool isApproximate() const { return !m_listStart.isEmpty(); }
+
+    // 墓碑或未编入列表的新条目较多时返回 true
+    bool needsRebuild() const;
+    // 压缩墓碑，条目足够多时重新训练 IVF；10 万条约需数百毫秒，不要在每次查询前调用
+    void rebuild();
+
+private:
+    float *column(int d) { return m_columns.data() + d * m_capacity; }
+    const float *column(int d) const { return m_columns.constData() + d * m_capacity; }
+    void grow(int capacity);
+    void setSlot(int slot, const float *vector);
+    void removeSlot(int slot);
+    void trainLists(int listCount);
+    // 扫描 [begin, end) 并更新 top-k 堆
+    void scan(const float *query, float querySq, int begin, int end, int exclude, int k,
+              QVector<QPair<float, int>> &heap) const;
+
+    int m_dimensions;
+    int m_capacity;
+    int m_used;                     // 已占用的槽位（含墓碑）
+    int m_tombstones;
+    QVector<float> m_columns;       // dimensions × capacity，按维度分列
+    QVector<float> m_normSq;        // 每个槽位的 |x|²，墓碑为无穷大
+    QVector<QString> m_ids;
+    QHash<QString, int> m_slots;
+
+    // IVF：槽位 [listStart[c], listStart[c + 1]) 属于中心 c，[indexedEnd, used) 为尾部
+    int m_approximateThreshold;
+    int m_probeCount;
+    int m_indexedEnd;
+    QVector<float> m_centroids;     // 按行存放，listCount × dimensions
+    QVector<float> m_centroidNormSq;
+    QVector<int> m_listStart;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <QString>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+#include <QJsonObject>
+
+/**
+ * 持久化特征库
+ * 以文件指纹为键保存任意 JSON 对象（音频特征），文件移动、改名后仍能命中。
+ * 磁盘格式为只追加的 JSON Lines，每行一条记录：
+ *   {"fp": 指纹, "value": {...}}                      特征
+ *   {"path": 路径, "size": 字节数, "mtime": 毫秒, "fp": 指纹}  路径 -> 指纹缓存，大小与修改时间未变时免读文件
+ * 写入先进入内存缓冲，每 32 条或 flush() 时落盘（检查点），崩溃最多丢失一个批次；
+ * 打开时截掉不完整的末行，失效记录超过有效记录时原子重写压缩。
+ * 所有方法线程安全，可由多个分析线程同时调用
+ */
+class FeatureStore {
+public:
+    FeatureStore();
+    ~FeatureStore();
+
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const;
+
+    // 文件大小 + 首尾各 64KB 内容的 SHA-1（十六进制）；读取失败时返回空串
+    static QString fingerprint(const QString &filePath);
+    // 先查路径缓存，未命中时计算指纹并记录
+    QString fingerprintFor(const QString &filePath, qint64 size, qint64 modified);
+    // 只查路径缓存，不读文件；未记录或大小、修改时间已变时返回空串
+    QString cachedFingerprint(const QString &filePath, qint64 size, qint64 modified) const;
+
+    bool lookup(const QString &fingerprint, QJsonObject *value) const;
+    void insert(const QString &fingerprint, const QJsonObject &value);
+    int size() const;
+
+    // 把缓冲中的记录写入磁盘并刷新
+    void flush();
+
+private:
+    struct PathEntry {
+        qint64 size = -1;
+        qint64 modified = 0;
+        QString fingerprint;
+    };
+
+    void appendRecord(const QJsonObject &record);
+    void flushLocked();
+    bool compactLocked();
+
+    mutable QMutex m_mutex;
+    QString m_filePath;
+    QFile m_file;
+    QHash<QString, QJsonObject> m_values;
+    QHash<QString, PathEntry> m_paths;
+    QByteArray m_pending;
+    int m_pendingRecords;
+    int m_fileRecords;      // 文件中的记录数（含被覆盖的旧记录）
+};
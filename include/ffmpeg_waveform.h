@@ -1,5 +1,9 @@
 #pragma once
 #include <QString>
 #include <QVector>
+#include "loudness_analyzer.h"
 
 QVector<float> extractWaveformFFmpeg(const QString &filePath, int samplePoints = 256);
+
+// 一次解码同时得到波形与 EBU R128 响度；loudness 为空时只提取波形
+QVector<float> extractWaveformFFmpeg(const QString &filePath, int samplePoints, LoudnessInfo *loudness);
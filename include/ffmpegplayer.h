@@ -1,9 +1,20 @@
 #pragma once
 #include <QObject>
+#include "loudness_analyzer.h"
+
+class AudioEffectChain;
+class PcmRingBuffer;
 
 class FFmpegPlayer : public QObject {
     Q_OBJECT
 public:
+    // 响度归一化模式
+    enum ReplayGainMode {
+        ReplayGainOff,
+        ReplayGainTrack,    // 按单曲响度归一化
+        ReplayGainAlbum     // 按专辑响度归一化，保留专辑内的相对响度
+    };
+
     explicit FFmpegPlayer(QObject *parent = nullptr);
     ~FFmpegPlayer();
     
@@ -14,7 +25,28 @@ public:
     void seek(qint64 positionMs);
     
     qint64 duration() const;
+    // 当前听到的位置：解码位置扣除音效链延迟，歌词同步与进度条都以此为准
     qint64 position() const;
+    // 音效链引入的输出延迟（毫秒），随效果器启用与参数变化更新
+    qint64 outputLatency() const;
+    
+    // 响度归一化
+    void setReplayGainMode(ReplayGainMode mode);
+    ReplayGainMode replayGainMode() const;
+    void setPreampDb(double db);
+    void setLoudness(const LoudnessInfo &track, const LoudnessInfo &album = LoudnessInfo());
+    float replayGainScale() const;
+    
+    // 音效链：UI 线程增删效果器、修改参数，处理在音频线程的 processPcm 中进行
+    AudioEffectChain *effectChain() const;
+    
+    // 分析环：processPcm 的最终输出（混为单声道）写入其中，频谱分析等读者直接从环中读取
+    const PcmRingBuffer *analysisTap() const;
+    
+    // 输出处理：音频线程对每个交错 PCM 缓冲区调用，先做响度归一化
+    // （增益变化时在缓冲区内线性过渡），再经过音效链，最后写入分析环。
+    // 解码与输出尚未实现（load/play 只是占位），接入时在交给音频设备之前调用；在此之前分析环一直为空
+    void processPcm(float *interleaved, int frames, int channels);
     
 signals:
     void positionChanged(qint64 ms);
@@ -25,7 +57,9 @@ signals:
     void errorOccurred(const QString &errorMessage);
     
 private:
+    void updateReplayGain();
+    
     // 私有实现细节
     class Private;
     Private *d;
-};
\ No newline at end of file
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <QVector>
+#include <memory>
+
+/**
+ * 实数 FFT
+ * 长度 N 为 2 的幂，内部用 N/2 点复数 FFT 加一次拆分后处理实现。复数 FFT 为基 4 按时间抽取
+ * （log2(N/2) 为奇数时先做一级基 2），每一级的旋转因子连续存放，蝶形沿 j 方向用 SSE2/NEON 展开。
+ * 位反转交换表与旋转因子按尺寸缓存、所有实例共享（多路频谱同尺寸时只算一次），
+ * 在 setSize() 中取得，变换过程不分配内存、不加锁。
+ * 配置时找到 FFTW3（单精度）则可切换到系统库后端，结果与内置实现一致。
+ * 频谱按实部、虚部分开存放（各 N/2 + 1 个频点），便于逐频点乘加的循环向量化。
+ */
+class RealFFT {
+public:
+    enum Backend {
+        Builtin,    // 内置基 4 实现
+        System      // 系统 FFT 库（FFTW3），未编译进来时退回 Builtin
+    };
+
+    explicit RealFFT(int size = 0);
+
+    // 取得查找表（首次使用某尺寸时计算），不可在音频线程调用；size 须为不小于 4 的 2 的幂
+    void setSize(int size);
+    int size() const { return m_size; }
+    int binCount() const { return m_size / 2 + 1; }
+
+    // 不可在音频线程调用；默认使用系统库（可用时）
+    void setBackend(Backend backend);
+    Backend backend() const { return m_backend; }
+    static bool systemBackendAvailable();
+
+    // 正变换：N 个实数 -> N/2 + 1 个频点，不归一化
+    void forward(const float *input, float *re, float *im);
+    // 逆变换：N/2 + 1 个频点 -> N 个实数，已含归一化，与 forward() 互逆
+    void inverse(const float *re, const float *im, float *output);
+
+    static bool isPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+    static int nextPowerOfTwo(int n);
+
+private:
+    struct Tables;
+
+    // 某尺寸的只读查找表，进程内缓存
+    static std::shared_ptr<const Tables> tablesForSize(int size);
+    // N/2 点原位复数 FFT（分离实部虚部），inverse 时使用共轭旋转因子且不缩放
+    void complexTransform(float *re, float *im, bool inverse);
+    bool useSystemBackend() const;
+
+    int m_size;
+    Backend m_backend;
+    std::shared_ptr<const Tables> m_tables;
+    QVector<float> m_workRe;       // N/2 + 1 点工作区
+    QVector<float> m_workIm;
+};
@@ -14,6 +14,7 @@
 #include <QPropertyAnimation>
 #include <QEasingCurve>
 #include <QJsonObject>
+#include "gesture_templates.h"
 
 /**
  * 高级手势识别器
@@ -102,9 +103,12 @@ public:
     void saveTrainedGesture(const QString &gestureName);
     void loadTrainedGestures(const QString &filePath);
     
-    // 手势模板匹配
-    void addGestureTemplate(const QString &name, const QVector<QPointF> &template_);
-    qreal matchGesture(const QVector<QPointF> &gesture, const QString &templateName);
+    // 手势模板匹配：模板添加时归一化一次，存放在 GestureTemplateIndex 里，识别时一次扫描全部模板
+    void addGestureTemplate(const QString &name, const QVector<QPointF> &template_) { m_gestureTemplates.add(name, template_); }
+    void removeGestureTemplate(const QString &name) { m_gestureTemplates.remove(name); }
+    qreal matchGesture(const QVector<QPointF> &gesture, const QString &templateName) const {
+        return qMax(0.0f, m_gestureTemplates.score(gesture, templateName));
+    }
 
 signals:
     void gestureDetected(GestureType type, const GestureData &data);
@@ -148,7 +152,16 @@ private:
     bool recognizePan();
     bool recognizeSwipe();
     bool recognizeCircle();
-    bool recognizeCustomShape();
+    // 训练模式下把本次路径存为模板；否则取最相似的模板，相似度不低于阈值时发出 customGestureDetected
+    bool recognizeCustomShape() {
+        if (m_trainingMode) {
+            return !m_trainingGestureName.isEmpty() && m_gestureTemplates.add(m_trainingGestureName, m_currentGesture.path);
+        }
+        const GestureTemplateIndex::Match match = m_gestureTemplates.best(m_currentGesture.path, kCustomShapeThreshold);
+        if (match.name.isEmpty()) return false;
+        emit customGestureDetected(match.name, match.score);
+        return true;
+    }
     
     // 几何计算
     qreal calculateDistance(const QPointF &p1, const QPointF &p2);
@@ -157,13 +170,6 @@ private:
     SwipeDirection calculateSwipeDirection(const QPointF &start, const QPointF &end);
     bool isCircularMotion(const QVector<QPointF> &path, qreal &clockwise);
     
-    // 模板匹配算法
-    qreal dollarOneRecognizer(const QVector<QPointF> &gesture, const QVector<QPointF> &template_);
-    QVector<QPointF> resamplePath(const QVector<QPointF> &path, int numPoints);
-    QVector<QPointF> rotatePath(const QVector<QPointF> &path, qreal angle);
-    QVector<QPointF> scalePath(const QVector<QPointF> &path);
-    QVector<QPointF> translatePath(const QVector<QPointF> &path, const QPointF &centroid);
-    
     QWidget *m_targetWidget;
     QMap<GestureType, bool> m_enabledGestures;
     
@@ -189,7 +195,8 @@ private:
     // 自定义手势
     bool m_trainingMode;
     QString m_trainingGestureName;
-    QMap<QString, QVector<QPointF>> m_gestureTemplates;
+    GestureTemplateIndex m_gestureTemplates;
+    static constexpr float kCustomShapeThreshold = 0.85f;     // 低于此相似度不算识别成功
     
     // 多指跟踪
     QMap<int, QPointF> m_touchPoints;
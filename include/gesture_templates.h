@@ -0,0 +1,66 @@
+#pragma once
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QPointF>
+
+/**
+ * 笔画手势模板库（Protractor）
+ * 路径先归一化为定长向量：原地重采样为 kPoints 个等距点，平移到质心，整体缩放为单位长度
+ * （保持长宽比），写入固定大小的 float 数组，不产生中间 QVector。
+ * 两条归一化路径在旋转 θ 后的余弦相似度为 a·cosθ + b·sinθ，其中 a = Σ(tx·gx + ty·gy)、
+ * b = Σ(tx·gy − ty·gx)，最优 θ 有闭式解，不需要 $1 的黄金分割搜索；
+ * 区分朝向时 θ 限制在 ±maxRotation 内，超出时取边界。
+ * 样本每 4 个一组按分量交错存放（组内为 SoA：第 d 个分量的 4 个值相邻），
+ * 扫描时顺序读取，一次对 4 个样本累加 a、b（SSE2/NEON），数百个样本的匹配在微秒量级。
+ * 同一名字可以有多个样本，得分取其中最好的一个。
+ * 不是线程安全的，由所属对象在同一线程使用
+ */
+class GestureTemplateIndex {
+public:
+    static const int kPoints = 64;
+    static const int kDimensions = 2 * kPoints;    // x0, y0, x1, y1, ...
+
+    struct Match {
+        QString name;
+        float score = -1.0f;    // 最优旋转下的余弦相似度，1 为完全一致
+    };
+
+    explicit GestureTemplateIndex(bool orientationSensitive = true);
+
+    // 区分朝向时允许的最大旋转（弧度），默认 π/4；不区分朝向时不限
+    void setOrientationSensitive(bool sensitive) { m_orientationSensitive = sensitive; }
+    bool isOrientationSensitive() const { return m_orientationSensitive; }
+    void setMaxRotation(float radians);
+
+    // 路径太短（少于 2 个点或长度为 0）时返回 false
+    bool add(const QString &name, const QVector<QPointF> &path);
+    int remove(const QString &name);
+    void clear();
+    int size() const { return m_names.size(); }
+    bool isEmpty() const { return m_names.isEmpty(); }
+    QStringList names() const;
+
+    // 得分最高的模板；没有模板或路径无效时 score 为 -1，最高分低于 minScore 时 name 为空
+    Match best(const QVector<QPointF> &path, float minScore = -1.0f) const;
+    // 按名字取最好的样本，得分降序，至多 k 个
+    QVector<Match> match(const QVector<QPointF> &path, int k) const;
+    // 只与指定名字的样本比较；没有该名字时返回 -1
+    float score(const QVector<QPointF> &path, const QString &name) const;
+
+    // 归一化到 out[kDimensions]；失败时返回 false
+    static bool normalize(const QPointF *points, int count, float *out);
+
+private:
+    float &component(int slot, int d) { return m_blocks[(slot >> 2) * kDimensions * 4 + d * 4 + (slot & 3)]; }
+    // 全部样本对归一化向量 g 的得分，写入 out[size()]
+    void scoreAll(const float *g, float *out) const;
+
+    bool m_orientationSensitive;
+    float m_maxRotation;
+    float m_cosMax;
+    float m_sinMax;
+    float m_tanMax;
+    QVector<float> m_blocks;        // 每组 kDimensions × 4，空位为零
+    QVector<QString> m_names;
+};
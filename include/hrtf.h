@@ -0,0 +1,94 @@
+#pragma once
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include "fft.h"
+
+/**
+ * HRTF 测量集
+ * 按 SOFA（AES69）SimpleFreeFieldHRIR 约定组织：M 个声源方向，每个方向左右耳各一条 HRIR。
+ * 读取 SOFA 文件导出的 JSON（字段名与 SOFA 变量一致：SourcePosition、Data.IR、Data.SamplingRate），
+ * 不依赖 netCDF/HDF5 库；球坐标与直角坐标两种 SourcePosition 都支持
+ */
+struct HrtfDataset {
+    struct Measurement {
+        float azimuth;      // 度，SOFA 约定：0° 正前方，逆时针（向左）为正
+        float elevation;    // 度，向上为正
+        QVector<float> left;
+        QVector<float> right;
+    };
+
+    QVector<Measurement> measurements;
+    int sampleRate = 0;
+
+    bool isEmpty() const { return measurements.isEmpty(); }
+    int irLength() const;
+
+    // 读取文件，失败时返回空测量集并写入错误信息
+    static HrtfDataset loadSofaJson(const QString &filePath, QString *errorMessage = nullptr);
+    static HrtfDataset fromSofaJson(const QByteArray &data, QString *errorMessage = nullptr);
+
+    // 线性插值重采样到目标采样率（逐条 HRIR 复用 ImpulseResponse 的重采样）
+    HrtfDataset resampled(int targetRate) const;
+};
+
+/**
+ * 双耳 HRTF 渲染器：单声道输入 -> 左右耳输出
+ * 均匀分区重叠保留卷积，输入的频域延迟线与滤波器无关，换方向只需换一组滤波器频谱。
+ * 全部测量方向的分区频谱在 setDataset() 中一次算好（频谱缓存）；任意方向取角距离最近的三个
+ * 测量点按距离反比加权，卷积是线性的，频谱加权等价于 HRIR 的时域插值。
+ * 方向变化时新旧两组滤波器各做一次逆变换，在一个分区内交叉淡化；
+ * 每个分区的运算量固定：一次正变换、每耳（淡化时两倍）分区数次频点乘加与一次逆变换。
+ * 输出相对输入固定延迟一个分区
+ */
+class HrtfRenderer {
+public:
+    HrtfRenderer();
+
+    // 计算频谱缓存并分配全部内存，不可在音频线程调用；dataset 需已重采样到处理采样率
+    void setDataset(const HrtfDataset &dataset, int partitionSize);
+    bool isEmpty() const { return m_directionCount == 0; }
+    int partitionSize() const { return m_partitionSize; }
+    int latency() const { return m_partitionSize; }
+
+    // 清空延迟线与 FIFO，保留频谱缓存与当前方向
+    void reset();
+
+    // 音频线程：方位角向右为正、仰角向上为正（度），在下一个分区开始时生效
+    void setDirection(float azimuth, float elevation);
+    // 音频线程：input 可以与 left 或 right 是同一块内存
+    void process(const float *input, float *left, float *right, int frames);
+
+private:
+    void processPartition();
+    // 三个最近测量点的插值频谱写入 filter，布局 [ear][partition][实部 | 虚部]
+    void interpolateFilter(float azimuth, float elevation, float *filter) const;
+    // 用 filter 对延迟线做频点乘加并逆变换，两耳各 B 个样本写入 output
+    void convolve(const float *filter, float *output);
+
+    RealFFT m_fft;
+    int m_partitionSize;          // B
+    int m_partitionCount;         // P
+    int m_binCount;               // B + 1
+    int m_directionCount;
+
+    QVector<float> m_directions;  // [direction][x y z] 单位向量，x 向右、y 向上、z 向前
+    QVector<float> m_spectra;     // 频谱缓存 [direction][ear][partition][实部 | 虚部]
+    QVector<float> m_filters[2];  // 当前使用与即将淡入的插值滤波器
+    int m_activeFilter;
+    bool m_hasFilter;
+    float m_targetAzimuth;
+    float m_targetElevation;
+    float m_filterAzimuth;
+    float m_filterElevation;
+
+    QVector<float> m_delayLine;   // 输入的频域延迟线 [partition][实部 | 虚部]，环形使用
+    int m_delayLinePos;
+    QVector<float> m_inputWindow; // 2B：上一块与当前块的输入
+    QVector<float> m_outputBlock; // [ear][B]：上一次分区计算的输出
+    QVector<float> m_fadeBlock;   // [ear][B]：淡化时新滤波器的输出
+    QVector<float> m_accumRe;
+    QVector<float> m_accumIm;
+    QVector<float> m_timeScratch; // 2B：逆变换结果
+    int m_fifoPos;
+};
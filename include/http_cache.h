@@ -0,0 +1,96 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QThreadPool>
+
+/**
+ * 持久化的 HTTP 响应缓存
+ * 每条响应一个文件，文件名为请求键的 SHA-1：首行是紧凑 JSON 头（ETag、Last-Modified、过期时刻等），
+ * 其后是原样的响应体，经 QSaveFile 原子写入。打开目录时只列目录、按文件大小与修改时间建立内存索引，
+ * 不读文件内容。读写响应体都不持有锁：读盘在调用线程上锁外进行，写盘交给单个后台线程按序执行，
+ * 写完之前条目留在待写表里，查询直接从内存返回。
+ * 过期的条目不删除：调用方带上 If-None-Match / If-Modified-Since 做条件请求，
+ * 304 时 refresh() 续期而不必重新下载；请求失败时仍可用旧内容兜底。
+ * 总大小超过上限时按最近使用时间淘汰；文件修改时间即跨进程的最近使用时间，命中时（每条至多每小时一次）
+ * 在锁外更新，重启后常显示的封面不会因写入较早而先被淘汰。最近读过的小条目另留一份在内存里，
+ * 列表滚动时反复显示同一张封面不会每次都读盘。所有方法线程安全
+ */
+class HttpCache {
+public:
+    struct Entry {
+        QByteArray body;
+        QByteArray etag;
+        QByteArray lastModified;
+        QByteArray contentType;
+        int status = 200;               // 也缓存 404，避免反复查询不存在的歌词/封面
+        qint64 storedAt = 0;            // 毫秒时间戳
+        qint64 expiresAt = 0;
+
+        bool isFresh(qint64 nowMs) const { return nowMs < expiresAt; }
+    };
+
+    explicit HttpCache(qint64 maxBytes = 256 * 1024 * 1024);
+    ~HttpCache();
+
+    bool open(const QString &directory);
+    bool isOpen() const;
+    QString directory() const;
+
+    bool lookup(const QString &key, Entry *entry);
+    void insert(const QString &key, const Entry &entry);
+    // 条件请求返回 304：内容不变，只更新过期时刻（以及服务器给出的新 ETag）；新头部在后台写回
+    bool refresh(const QString &key, qint64 expiresAt, const QByteArray &etag = QByteArray());
+    void remove(const QString &key);
+    void clear();
+
+    int size() const;
+    qint64 totalBytes() const;
+    void setMaxBytes(qint64 bytes);
+
+private:
+    class WriteTask;
+
+    struct IndexEntry {
+        qint64 bytes = 0;
+        qint64 lastUsed = 0;
+        qint64 onDisk = 0;          // 文件修改时间最后一次写成的最近使用时间
+    };
+
+    struct PendingWrite {
+        Entry entry;
+        quint64 generation = 0;     // 同一文件被再次写入时旧任务据此放弃
+    };
+
+    QString pathFor(const QString &fileName) const;
+    static QString fileNameFor(const QString &key);
+    static bool readEntry(const QString &path, Entry *entry);
+    static bool writeEntry(const QString &path, const Entry &entry);
+    bool load(const QString &fileName, Entry *entry);
+    bool cachedLocked(const QString &fileName, Entry *entry) const;
+    // 记录一次命中；需要把最近使用时间写到文件修改时间上时返回文件路径，由调用方在锁外更新
+    QString markUsedLocked(const QString &fileName, IndexEntry &index);
+    static void touchFile(const QString &path);
+    void queueWriteLocked(const QString &fileName, const Entry &entry);
+    void writePending(const QString &fileName, quint64 generation);
+    void removeLocked(const QString &fileName);
+    void touchMemory(const QString &fileName, const Entry &entry);
+    void evictLocked();
+
+    mutable QMutex m_mutex;
+    QString m_directory;
+    qint64 m_maxBytes;
+    qint64 m_totalBytes;
+    QHash<QString, IndexEntry> m_index;         // 文件名 -> 大小与最近使用时间
+
+    // 内存副本：只放小条目，按插入顺序近似 LRU
+    QHash<QString, Entry> m_memory;
+    QVector<QString> m_memoryOrder;
+    qint64 m_memoryBytes;
+
+    QHash<QString, PendingWrite> m_pendingWrites;   // 已入队、尚未落盘的条目
+    quint64 m_nextGeneration;
+    QThreadPool m_writer;                           // 单线程，保证同一文件按入队顺序写
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+/**
+ * 脉冲响应
+ * 从本地 WAV 文件（PCM 16/24/32 位整数或 32 位浮点）读取的多声道冲激响应，
+ * 供卷积混响等效果在非音频线程预处理后使用
+ */
+struct ImpulseResponse {
+    QVector<QVector<float>> channels;
+    int sampleRate = 0;
+
+    bool isEmpty() const { return channels.isEmpty() || channels.first().isEmpty(); }
+    int channelCount() const { return channels.size(); }
+    int length() const { return channels.isEmpty() ? 0 : channels.first().size(); }
+
+    // 读取文件，失败时返回空响应并写入错误信息
+    static ImpulseResponse loadWav(const QString &filePath, QString *errorMessage = nullptr);
+    static ImpulseResponse fromWavData(const QByteArray &data, QString *errorMessage = nullptr);
+
+    // 线性插值重采样到目标采样率
+    ImpulseResponse resampled(int targetRate) const;
+    // 去掉末尾低于 thresholdDb（相对峰值）的静音部分，减少分区数
+    void trimTail(float thresholdDb = -90.0f);
+    // 按声道间最大能量归一化到单位能量，使不同 IR 的湿信号响度一致
+    void normalizeEnergy();
+};
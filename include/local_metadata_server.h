@@ -0,0 +1,96 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <QUrl>
+#include <QByteArray>
+#include <QJsonObject>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * 本地元数据替身服务
+ * 在 127.0.0.1 上监听的最小 HTTP/1.1 服务，数据全部来自内存，供测试与离线开发时代替真实在线服务，
+ * 配合 LocalMetadataProvider 使用。接口：
+ *   GET /search?q=|artist=|album=&limit=     {"tracks": [...]}
+ *   GET /recommendations?seeds=&limit=       {"tracks": [...]}，seeds 为以换行分隔的 "歌手 - 标题"
+ *   GET /trending?genre=&limit=              {"tracks": [...]}
+ *   GET /lyrics?artist=&title=               {"lyrics": "..."}，没有时 404
+ *   GET /album?artist=&album=                {"images": [{"url": "/image/<n>", "size": 300}]}，没有时 404
+ *   GET /image/<n>                           图片字节
+ * 每个响应带 ETag 与 Cache-Control: max-age，If-None-Match 匹配时返回 304。
+ * 按路径统计请求次数与同时处理中的请求数峰值，可以设置响应延迟、让接下来的若干请求返回 429，
+ * 用来验证缓存、条件请求、相同请求合并、并发上限与 Retry-After
+ */
+class LocalMetadataServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LocalMetadataServer(QObject *parent = nullptr);
+    ~LocalMetadataServer();
+
+    // port 为 0 时由系统分配
+    bool listen(quint16 port = 0);
+    void close();
+    quint16 port() const;
+    QUrl baseUrl() const;
+
+    // 曲目对象字段同 OnlineMusicService::OnlineTrack::toJson()，可额外带 "genre"
+    void addTrack(const QJsonObject &track);
+    void setLyrics(const QString &artist, const QString &title, const QString &lyrics);
+    void setAlbumArt(const QString &artist, const QString &album, const QByteArray &image,
+                     int size = 300, const QByteArray &contentType = "image/png");
+    void clear();
+
+    void setMaxAge(int seconds) { m_maxAgeSeconds = seconds; }
+    void setResponseDelay(int ms) { m_responseDelayMs = ms; }
+    // 接下来的 count 个请求返回 429 Too Many Requests，带 Retry-After: retryAfterSeconds
+    void setRateLimited(int count, int retryAfterSeconds = 1);
+
+    // path 为空时返回总数；路径不含查询参数，如 "/album"
+    int requestCount(const QString &path = QString()) const;
+    int notModifiedCount() const { return m_notModified; }
+    // 已收到请求、尚未响应的连接数的峰值
+    int peakConcurrentRequests() const { return m_peakActive; }
+    void resetCounters();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    struct Response {
+        int status = 200;
+        QByteArray body;
+        QByteArray contentType = "application/json";
+        int retryAfter = 0;             // 秒，429 时写入 Retry-After
+    };
+    struct Image {
+        QByteArray data;
+        QByteArray contentType;
+        int size = 0;
+    };
+
+    static QString key(const QString &first, const QString &second);
+    Response route(const QUrl &url) const;
+    QVector<QJsonObject> matchTracks(const QUrl &url) const;
+    void respond(QTcpSocket *socket, const Response &response, const QByteArray &ifNoneMatch);
+
+    QTcpServer *m_server;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QSet<QTcpSocket*> m_active;             // 已收到请求、等待响应的连接
+    QVector<QJsonObject> m_tracks;
+    QHash<QString, QString> m_lyrics;
+    QHash<QString, int> m_albumArt;         // 歌手/专辑 -> 图片序号
+    QVector<Image> m_images;
+    QMap<QString, int> m_requestCounts;
+    int m_notModified;
+    int m_peakActive;
+    int m_maxAgeSeconds;
+    int m_responseDelayMs;
+    int m_rateLimited;                      // 还要以 429 拒绝的请求数
+    int m_retryAfterSeconds;
+};
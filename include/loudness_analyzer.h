@@ -0,0 +1,76 @@
+#pragma once
+#include <QVector>
+#include <QJsonObject>
+
+/**
+ * 响度信息
+ * EBU R128 / ITU-R BS.1770 分析结果，用于 ReplayGain 风格的播放增益
+ */
+struct LoudnessInfo {
+    bool valid = false;
+    double integratedLufs = 0.0;   // 整体响度 LUFS
+    double truePeakDb = -120.0;    // 真峰值 dBTP
+    double durationSec = 0.0;      // 参与分析的时长，专辑响度按时长加权
+
+    // 达到参考响度所需的增益（ReplayGain 2.0 参考值 -18 LUFS）
+    double gainDb(double referenceLufs = -18.0) const;
+    double truePeakLinear() const;
+
+    QJsonObject toJson() const;
+    static LoudnessInfo fromJson(const QJsonObject &obj);
+
+    // 由多首曲目合成专辑响度：按时长加权的能量平均，峰值取最大
+    static LoudnessInfo combine(const QVector<LoudnessInfo> &tracks);
+};
+
+/**
+ * EBU R128 响度分析器
+ * K 加权 + 400ms 门限块积分响度，4 倍过采样真峰值检测
+ * 以交错 float 样本流式输入，适合与波形提取共用一次解码
+ */
+class LoudnessAnalyzer {
+public:
+    LoudnessAnalyzer(int sampleRate, int channels);
+
+    void process(const float *interleaved, int frames);
+    LoudnessInfo result() const;
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    struct ChannelState {
+        double z1 = 0.0, z2 = 0.0;      // 高架预滤波器状态
+        double r1 = 0.0, r2 = 0.0;      // RLB 高通状态
+        double weight = 1.0;            // 声道加权 (BS.1770)
+        QVector<float> peakHistory;     // 真峰值 FIR 历史（双份存储，免取模）
+        int peakPos = 0;
+    };
+
+    void setupKWeighting();
+    void setupTruePeakFilter();
+    void finishStep();
+
+    int m_sampleRate;
+    int m_channels;
+    Biquad m_shelf;
+    Biquad m_highPass;
+    QVector<ChannelState> m_state;
+
+    // 门限积分：100ms 步进，4 步组成一个 400ms 块（75% 重叠）
+    int m_stepFrames;
+    int m_stepPos;
+    double m_stepEnergy;
+    double m_stepRing[4];
+    int m_stepCount;
+    QVector<double> m_blockEnergies;
+
+    // 真峰值：多相插值滤波器 [phase][tap]
+    int m_oversample;
+    int m_peakTaps;
+    QVector<float> m_peakCoeffs;
+    float m_peak;
+
+    qint64 m_frames;
+};
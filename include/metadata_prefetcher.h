@@ -0,0 +1,58 @@
+#pragma once
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <QSize>
+#include <QTimer>
+#include "play_order.h"
+
+class OnlineMusicService;
+
+/**
+ * 歌词与封面的预测预取
+ * 按当前播放顺序（随机模式即 PlayOrder 的洗牌排列）取当前曲目之后的 N 首，
+ * 通过 OnlineMusicService 的预取接口以后台优先级、限定带宽把歌词与封面提前放进缓存，
+ * 切歌时界面直接命中缓存，不再等网络。
+ * 队列、模式或当前曲目变化后稍等片刻（连续切歌时不反复提交）再提交新一批，
+ * 并撤销已不在前方的旧预取；仍在前方的曲目沿用进行中的请求。
+ * 作为 OnlineMusicService 的子对象创建，随其销毁；单独销毁时已提交的预取照常完成
+ */
+class MetadataPrefetcher : public QObject {
+    Q_OBJECT
+
+public:
+    struct Track {
+        QString artist;
+        QString title;
+        QString album;
+    };
+
+    explicit MetadataPrefetcher(OnlineMusicService *service);
+
+    void setLookahead(int tracks) { m_lookahead = qMax(0, tracks); }
+    int lookahead() const { return m_lookahead; }
+    void setAlbumArtSize(const QSize &size) { m_artSize = size; }
+    void setLyricsEnabled(bool enabled) { m_lyricsEnabled = enabled; }
+    void setAlbumArtEnabled(bool enabled) { m_albumArtEnabled = enabled; }
+
+    // 队列、播放模式或当前曲目变化时调用；queue 与 order 的下标一一对应
+    void update(const QVector<Track> &queue, const PlayOrder &order, int current);
+    // 撤销全部预取
+    void cancel();
+
+private slots:
+    void submit();
+
+private:
+    static QString signature(const QVector<Track> &tracks);
+
+    OnlineMusicService *m_service;
+    QTimer *m_settleTimer;
+    QVector<Track> m_upcoming;          // 待提交的即将播放曲目
+    QString m_submittedSignature;       // 已提交批次的内容，没变时不重复提交
+    int m_generation;
+    int m_lookahead;
+    QSize m_artSize;
+    bool m_lyricsEnabled;
+    bool m_albumArtEnabled;
+};
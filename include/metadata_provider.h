@@ -0,0 +1,91 @@
+#pragma once
+#include <QString>
+#include <QMap>
+#include <QVector>
+#include <QSize>
+#include <QUrl>
+#include <QJsonObject>
+#include <QNetworkRequest>
+
+/**
+ * 在线元数据服务的提供方接口
+ * 提供方只负责“请求怎么拼、响应怎么解析”以及自身的访问限制，不直接发请求：
+ * 排队、限流、合并相同请求与缓存都由 OnlineMusicService 统一处理，
+ * 新增一个服务只需实现本接口，测试时换成指向本地替身服务器的 LocalMetadataProvider。
+ * parseTracks() 返回的对象字段与 OnlineMusicService::OnlineTrack::toJson() 一致
+ */
+class MetadataProvider {
+public:
+    enum RequestKind {
+        Search,             // 参数 q / artist / album 之一
+        Recommendations,    // 参数 seeds（以换行分隔），limit
+        Trending,           // 参数 genre，limit
+        Lyrics,             // 参数 artist，title
+        AlbumArt,           // 参数 artist，album；响应中给出图片地址
+        Image               // 参数 url；下载图片本身
+    };
+
+    struct Query {
+        RequestKind kind = Search;
+        QMap<QString, QString> params;
+    };
+
+    virtual ~MetadataProvider() = default;
+
+    virtual QString name() const = 0;
+    virtual bool supports(RequestKind kind) const = 0;
+    virtual QNetworkRequest buildRequest(const Query &query) const = 0;
+
+    virtual QVector<QJsonObject> parseTracks(const QByteArray &body) const;
+    virtual QString parseLyrics(const QByteArray &body) const;
+    // AlbumArt 响应中最接近 size 的图片地址；没有时返回空 URL
+    virtual QUrl parseImageUrl(const QByteArray &body, const QSize &size) const;
+
+    // 访问限制：同时进行的请求数与平均每秒请求数
+    virtual int maxConcurrentRequests() const { return 2; }
+    virtual double requestsPerSecond() const { return 4.0; }
+    // 缓存有效期下限：服务器给的 max-age 更短时按此值，封面与歌词几乎不会变化
+    virtual qint64 minimumTtlMs(RequestKind kind) const;
+};
+
+/**
+ * Last.fm 公开 API（ws.audioscrobbler.com/2.0，JSON 格式）
+ * 不提供歌词；按服务条款每秒不超过 5 个请求
+ */
+class LastFmProvider : public MetadataProvider {
+public:
+    explicit LastFmProvider(const QString &apiKey);
+
+    QString name() const override { return "lastfm"; }
+    bool supports(RequestKind kind) const override;
+    QNetworkRequest buildRequest(const Query &query) const override;
+    QVector<QJsonObject> parseTracks(const QByteArray &body) const override;
+    QUrl parseImageUrl(const QByteArray &body, const QSize &size) const override;
+
+private:
+    QString m_apiKey;
+};
+
+/**
+ * 本地替身服务（LocalMetadataServer）的提供方
+ * 接口与响应格式都很简单，也可以作为自建元数据服务的参考实现
+ */
+class LocalMetadataProvider : public MetadataProvider {
+public:
+    explicit LocalMetadataProvider(const QUrl &baseUrl,
+                                   int maxConcurrent = 4, double requestsPerSecond = 50.0);
+
+    QString name() const override { return "local"; }
+    bool supports(RequestKind) const override { return true; }
+    QNetworkRequest buildRequest(const Query &query) const override;
+    QVector<QJsonObject> parseTracks(const QByteArray &body) const override;
+    QString parseLyrics(const QByteArray &body) const override;
+    QUrl parseImageUrl(const QByteArray &body, const QSize &size) const override;
+    int maxConcurrentRequests() const override { return m_maxConcurrent; }
+    double requestsPerSecond() const override { return m_requestsPerSecond; }
+
+private:
+    QUrl m_baseUrl;
+    int m_maxConcurrent;
+    double m_requestsPerSecond;
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <QObject>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QQueue>
+#include <QSize>
+#include <QPixmap>
+#include "../include/http_cache.h"
+#include "../include/metadata_provider.h"
+
+/**
+ * 在线音乐服务集成
+ * 请求的拼装与解析交给可替换的 MetadataProvider（Last.fm、本地替身服务等），本类负责：
+ * - 合并：相同请求（同一提供方、同一 URL）进行中时只挂上回调，不再发第二次；
+ * - 缓存：响应写入持久化的 HttpCache，有效期取服务器 max-age/Expires 与提供方下限中较长者，
+ *   过期后带 If-None-Match / If-Modified-Since 重新验证，304 时沿用旧内容，请求失败时也用旧内容兜底；
+ * - 限流：每个提供方独立的并发上限与令牌桶，超出的请求排队，429/503 时按 Retry-After 暂停该提供方。
+ * 专辑封面分两步：先取专辑信息得到图片地址，再下载图片，两步都经过合并与缓存。
+ * 预取（prefetch*）只填充缓存、不发信号，排在前台请求之后，最多占用并发上限减一个连接，
+ * 另受后台带宽预算约束；同一请求被前台调用方再次请求时立即提升为前台。
+ * 所有方法在所属线程（通常是界面线程）调用，结果一律通过信号异步返回，缓存命中也不例外
+ */
+class OnlineMusicService : public QObject {
+    Q_OBJECT
+
+public:
+    struct OnlineTrack {
+        QString id;
+        QString title;
+        QString artist;
+        QString album;
+        QString previewUrl;
+        QString albumArtUrl;
+        int duration_ms;
+        bool isPlayable;
+        
+        QJsonObject toJson() const;
+        static OnlineTrack fromJson(const QJsonObject &obj);
+    };
+
+    enum ServiceType {
+        Spotify,
+        AppleMusic,
+        YouTubeMusic,
+        LastFM,
+        Deezer
+    };
+
+    explicit OnlineMusicService(QObject *parent = nullptr);
+    ~OnlineMusicService();
+    
+    // 配置服务；目前只有 Last.fm 有对应的提供方，其余类型只记录密钥
+    void configureService(ServiceType type, const QString &apiKey, const QString &secret = "");
+    // 注册提供方并接管所有权；同名提供方会被替换。每类请求使用第一个支持它的提供方
+    void addProvider(MetadataProvider *provider);
+    // 默认位于系统缓存目录下的 online 子目录
+    void setCacheDirectory(const QString &directory);
+    HttpCache &cache() { return m_cache; }
+    // 排队中与进行中的请求数（合并后的）
+    int pendingRequestCount() const { return m_fetches.size(); }
+    
+    // 搜索音乐
+    void searchTracks(const QString &query, int limit = 20);
+    void searchArtist(const QString &artist);
+    void searchAlbum(const QString &album);
+    
+    // 获取推荐
+    void getRecommendations(const QStringList &seedTracks, int limit = 20);
+    void getTrendingTracks(const QString &genre = "", int limit = 50);
+    
+    // 获取歌词
+    void getLyrics(const QString &artist, const QString &title);
+    
+    // 获取专辑封面
+    void getAlbumArt(const QString &artist, const QString &album, const QSize &size = QSize(300, 300));
+
+    // 预取歌词与封面到缓存；generation 为调用方的批次号，cancelPrefetches(g) 撤销不属于第 g 批的预取，
+    // 已在下载的也会中止（仍被其他批次或前台调用方需要的除外）
+    void prefetchLyrics(const QString &artist, const QString &title, int generation);
+    void prefetchAlbumArt(const QString &artist, const QString &album, const QSize &size, int generation);
+    void cancelPrefetches(int keepGeneration);
+    // 后台预取的带宽上限（字节/秒），0 表示不限；默认 128 KiB/s
+    void setPrefetchBandwidth(qint64 bytesPerSecond);
+
+signals:
+    void searchCompleted(const QVector<OnlineTrack> &tracks);
+    void recommendationsReady(const QVector<OnlineTrack> &tracks);
+    void lyricsReceived(const QString &artist, const QString &title, const QString &lyrics);
+    void albumArtReceived(const QString &artist, const QString &album, const QPixmap &art);
+    void errorOccurred(const QString &error);
+
+private slots:
+    void onNetworkReply();
+    void pumpQueues();
+
+private:
+    // 请求完成后要通知的调用方
+    struct Waiter {
+        QString artist;
+        QString album;
+        QString title;
+        QSize size;
+        int prefetch = -1;              // 预取批次号，-1 表示前台调用方
+
+        bool isPrefetch() const { return prefetch >= 0; }
+        bool operator==(const Waiter &other) const {
+            return artist == other.artist && album == other.album && title == other.title
+                && size == other.size && prefetch == other.prefetch;
+        }
+    };
+
+    // 一个去重后的请求：排队或进行中时留在 m_fetches 里，相同请求只追加 waiters
+    struct Fetch {
+        QString key;
+        int provider = -1;
+        MetadataProvider::Query query;
+        QNetworkRequest request;
+        QVector<Waiter> waiters;
+        HttpCache::Entry stale;         // 过期的缓存内容，用于条件请求与失败兜底
+        bool hasStale = false;
+        int retries = 0;
+        QNetworkReply *reply = nullptr;
+        bool background = false;        // 按后台请求排队/占用连接
+
+        bool hasForegroundWaiter() const;
+    };
+
+    struct ProviderState {
+        MetadataProvider *provider = nullptr;
+        int active = 0;
+        double tokens = 0.0;
+        qint64 refilledAt = 0;
+        qint64 blockedUntil = 0;        // 429/503 后暂停到此时刻
+        int activeBackground = 0;
+        QQueue<QString> waiting;        // 排队请求的键
+        QQueue<QString> background;     // 排队的预取，前台队列空闲时才发出
+    };
+
+    void request(const MetadataProvider::Query &query, const Waiter &waiter);
+    int providerFor(MetadataProvider::RequestKind kind) const;
+    void start(Fetch &fetch);
+    // 取一个令牌；不够时返回 false 并给出需要等待的毫秒数
+    bool takeToken(ProviderState &state, qint64 nowMs, qint64 *waitMs);
+    bool takePrefetchBudget(qint64 nowMs, qint64 *waitMs);
+    void release(Fetch &fetch);
+    // 缓存有效期截止时刻；响应禁止缓存时返回 -1
+    qint64 expiryFor(QNetworkReply *reply, const Fetch &fetch, int status, qint64 nowMs) const;
+    void deliver(const Fetch &fetch, const HttpCache::Entry &entry);
+
+    QNetworkAccessManager *m_networkManager;
+    QMap<ServiceType, QString> m_apiKeys;
+    QMap<ServiceType, QString> m_apiSecrets;
+    QMap<QNetworkReply*, QString> m_pendingRequests;    // 回复 -> 请求键
+    QHash<QString, Fetch> m_fetches;
+    QVector<ProviderState> m_providers;
+    HttpCache m_cache;
+    QTimer *m_pumpTimer;
+    qint64 m_prefetchBytesPerSecond;
+    double m_prefetchBudget;            // 可透支：下载完成后按实际字节数扣除
+    qint64 m_budgetRefilledAt;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <QVector>
+
+/**
+ * 起音（节拍）检测：频谱通量 + 自适应阈值
+ * 每个 STFT 帧把功率谱压缩为 log2(1 + γ·P)，与上一帧逐频点相减、只取增长部分，
+ * 按频点数平均得到通量。最近约一秒的通量存放在固定长度的环形历史中，
+ * 均值与平方和随写入增量更新（O(1)），阈值 = 均值 + k·标准差。
+ * 通量超过阈值且为局部极大（需要后一帧确认，延迟一跳）、并且距上次起音超过不应期时判为起音。
+ * 运行在分析线程，每帧一次压缩与一次减法，没有排序、没有内存分配
+ */
+class OnsetDetector {
+public:
+    OnsetDetector();
+
+    // 按频点数与帧率（每秒 STFT 帧数）分配历史与上一帧缓冲，并清空状态
+    void configure(int binCount, double frameRate);
+    void reset();
+
+    // 灵敏度 [0, 1]：越高阈值越低（k 从 3 线性降到 0.5），默认 0.5
+    void setSensitivity(float sensitivity);
+    float sensitivity() const { return m_sensitivity; }
+
+    // 每帧调用，power 为 binCount 个频点的功率；判定上一帧为起音时返回 true 并写入强度 [0, 1]
+    bool process(const float *power, float *intensity);
+
+    float lastFlux() const { return m_current; }
+
+private:
+    int m_binCount;
+    QVector<float> m_previous;    // 上一帧的压缩谱
+    bool m_hasPrevious;
+
+    QVector<float> m_history;     // 通量的环形历史
+    int m_historyPos;
+    int m_historyFill;
+    double m_sum;
+    double m_sumSquares;
+
+    float m_beforeCandidate;      // 候选帧的前一帧通量
+    float m_candidate;            // 上一帧通量（候选）
+    float m_current;
+    int m_refractoryFrames;
+    int m_framesSinceOnset;
+    float m_sensitivity;
+    float m_thresholdSigma;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <QVector>
+#include "audio_buffer.h"
+
+/**
+ * 半带多相过采样器（1x / 2x / 4x / 8x）
+ * 每级 2 倍，是一个线性相位半带 FIR（长 4K-1，中心抽头 0.5，距中心偶数位置的抽头为零）的多相分解：
+ * 上采样时偶数输出走对称 FIR、奇数输出就是延迟后的输入；降采样时把输入拆成偶/奇两路，
+ * 偶路走对称 FIR、奇路只乘中心抽头。两个方向的内层都是同一个对称乘加核（SIMD）。
+ * 第一级过渡带最窄、抽头最多，之后各级的信号已经限带，抽头依次减少。
+ * 系数在 setup() 时用 Kaiser 窗设计，全部级按最大倍数预先分配，切换倍数不分配内存
+ */
+class Oversampler {
+public:
+    static const int MaxFactor = 8;
+
+    Oversampler();
+
+    // 分配全部内存，不可在音频线程调用
+    void setup(int channels, int maxBlockFrames);
+    // 音频线程可调用：倍数取 1/2/4/8（其他值取最接近的 2 的幂），切换时清空滤波器状态
+    void setFactor(int factor);
+    int factor() const { return m_factor; }
+    // 上采样与降采样合计引入的延迟（原采样率下的样本数，四舍五入）
+    int latency() const { return latencyFor(m_factor); }
+    static int latencyFor(int factor);
+    void reset();
+
+    // 音频线程：上采样，返回内部缓冲上的过采样块（frameCount = frames * factor）；1x 时原样返回
+    AudioBlock upsample(const AudioBlock &block);
+    // 音频线程：把 upsample() 返回并处理过的块降采样写回 block
+    void downsample(const AudioBlock &block);
+
+private:
+    struct Stage {
+        QVector<float> coeffs;    // g[j]：距中心 2j+1 处的抽头，j = 0..K-1
+        int taps;                 // K
+        int maxFrames;            // 本级低采样率一侧的最大帧数
+        QVector<float> upHistory; // [channel][2K-1 历史 | 输入]
+        QVector<float> downEven;  // [channel][2K-1 历史 | 偶数样本]
+        QVector<float> downOdd;   // [channel][K 历史 | 奇数样本]
+    };
+    static void designStage(Stage &stage, int taps);
+    void upsampleStage(Stage &stage, int ch, const float *input, float *output, int frames);
+    void downsampleStage(Stage &stage, int ch, const float *input, float *output, int frames);
+
+    int m_factor;
+    int m_stageCount;   // log2(factor)
+    int m_channels;
+    Stage m_stages[3];
+    AudioBuffer m_buffers[2];   // 级间乒乓缓冲，容量 maxBlockFrames * MaxFactor
+    QVector<float> m_scratch;   // 上采样偶数相的 FIR 结果
+};
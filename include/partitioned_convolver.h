@@ -0,0 +1,50 @@
+#pragma once
+#include <QVector>
+#include "fft.h"
+
+/**
+ * 均匀分区重叠保留（UPOLS）卷积器，单声道
+ * 脉冲响应切成长度为 B 的分区，各分区的 2B 点频谱预先算好；
+ * 每凑满 B 个输入样本做一次 2B 点 FFT，写入频域延迟线，
+ * 与全部分区频谱乘加后逆变换，取后半段即为这 B 个样本的输出。
+ * 每块的运算量固定（一次正变换、一次逆变换、分区数次频点乘加），不随时间波动；
+ * 输入以 FIFO 缓冲，可接受任意长度的块，输出相对输入固定延迟 B 个样本。
+ */
+class PartitionedConvolver {
+public:
+    PartitionedConvolver();
+
+    // 切分脉冲响应并计算各分区频谱，分配全部内存，不可在音频线程调用
+    // partitionSize 向上取整为 2 的幂
+    void setImpulseResponse(const float *impulse, int length, int partitionSize);
+    bool isEmpty() const { return m_partitionCount == 0; }
+    int partitionSize() const { return m_partitionSize; }
+    int partitionCount() const { return m_partitionCount; }
+    int latency() const { return m_partitionSize; }
+
+    // 清空延迟线与 FIFO，保留脉冲响应
+    void reset();
+
+    // 音频线程：input 与 output 可以是同一块内存
+    void process(const float *input, float *output, int frames);
+
+private:
+    void processPartition();
+
+    RealFFT m_fft;
+    int m_partitionSize;          // B
+    int m_partitionCount;         // P
+    int m_binCount;               // B + 1
+
+    // 频谱按 [分区][实部 binCount | 虚部 binCount] 存放
+    QVector<float> m_impulseSpectra;
+    QVector<float> m_delayLine;   // 频域延迟线，布局同上，环形使用
+    int m_delayLinePos;
+
+    QVector<float> m_inputWindow;  // 2B：上一块与当前块的输入
+    QVector<float> m_outputBlock;  // B：上一次分区计算的输出
+    QVector<float> m_accumRe;      // 频点乘加结果
+    QVector<float> m_accumIm;
+    QVector<float> m_timeScratch;  // 2B：逆变换结果
+    int m_fifoPos;
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * 播放 PCM 分析环
+ * 音频线程在输出处理末尾写入：交错 PCM 在这里混为单声道 float，格式只转换这一次；
+ * 写入从不阻塞，写满后覆盖最旧的数据。分析端按绝对样本位置取得至多两段连续视图
+ * （环绕时第二段非空）直接读取、不复制，读完用 isIntact() 确认期间没有被覆盖（顺序锁式校验），
+ * 被覆盖的帧丢弃即可。单写者；读者各自维护读位置，互不影响
+ */
+class PcmRingBuffer {
+public:
+    struct Span {
+        const float *first = nullptr;
+        int firstCount = 0;
+        const float *second = nullptr;
+        int secondCount = 0;
+
+        float at(int i) const { return i < firstCount ? first[i] : second[i - firstCount]; }
+    };
+
+    // 容量向上取整到 2 的幂，应不小于最大分析帧长加一个音频回调的长度
+    explicit PcmRingBuffer(int capacity = 65536) {
+        int size = 2;
+        while (size < capacity) size <<= 1;
+        m_buffer.fill(0.0f, size);
+        m_data = m_buffer.data();
+        m_mask = size - 1;
+    }
+
+    int capacity() const { return int(m_mask) + 1; }
+
+    // 写入端：采样率随音频设备变化，读者据此重建频率映射
+    void setSampleRate(int sampleRate) { m_sampleRate.store(sampleRate, std::memory_order_relaxed); }
+    int sampleRate() const { return m_sampleRate.load(std::memory_order_relaxed); }
+
+    // 写入端（音频线程），不分配内存、不加锁
+    void write(const float *interleaved, int frames, int channels) {
+        if (!interleaved || frames <= 0 || channels <= 0) return;
+        const int skip = qMax(0, frames - capacity());
+        interleaved += qint64(skip) * channels;
+        frames -= skip;
+
+        const quint64 start = m_end.load(std::memory_order_relaxed);
+        beginWrite(start + frames);
+        if (channels == 1) {
+            for (int i = 0; i < frames; ++i) m_data[(start + i) & m_mask] = interleaved[i];
+        } else if (channels == 2) {
+            for (int i = 0; i < frames; ++i) {
+                m_data[(start + i) & m_mask] = 0.5f * (interleaved[2 * i] + interleaved[2 * i + 1]);
+            }
+        } else {
+            const float scale = 1.0f / channels;
+            for (int i = 0; i < frames; ++i) {
+                const float *frame = interleaved + qint64(i) * channels;
+                float sum = 0.0f;
+                for (int ch = 0; ch < channels; ++ch) sum += frame[ch];
+                m_data[(start + i) & m_mask] = sum * scale;
+            }
+        }
+        m_end.store(start + frames, std::memory_order_release);
+    }
+
+    // 写入端：已是单声道 float 的样本
+    void writeMono(const float *samples, int frames) {
+        write(samples, frames, 1);
+    }
+
+    // 读取端：已发布的样本总数（绝对位置，不回绕）
+    quint64 writePosition() const { return m_end.load(std::memory_order_acquire); }
+
+    // 读取端：[position, position + count) 的视图，调用方保证该区间已发布且在最近 capacity() 个样本之内
+    Span read(quint64 position, int count) const {
+        Span span;
+        const int index = int(position & m_mask);
+        span.first = m_data + index;
+        span.firstCount = qMin(count, capacity() - index);
+        span.second = m_data;
+        span.secondCount = count - span.firstCount;
+        return span;
+    }
+
+    // 读取端：读完从 position 开始的数据后调用，返回 false 表示读取期间写入端已覆盖了其中一部分
+    bool isIntact(quint64 position) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_reserved.load(std::memory_order_relaxed) - position <= quint64(capacity());
+    }
+
+private:
+    PcmRingBuffer(const PcmRingBuffer &) = delete;
+    PcmRingBuffer &operator=(const PcmRingBuffer &) = delete;
+
+    // 先公布即将写到的位置再写数据，读者的校验因此能覆盖正在进行的写入
+    void beginWrite(quint64 end) {
+        m_reserved.store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    QVector<float> m_buffer;
+    float *m_data;
+    quint64 m_mask;
+    std::atomic<int> m_sampleRate{44100};
+    alignas(64) std::atomic<quint64> m_reserved{0};
+    alignas(64) std::atomic<quint64> m_end{0};
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <QString>
+#include <QFile>
+#include <QJsonObject>
+#include <functional>
+
+/**
+ * 有界的播放记录日志
+ * 只追加的 JSON Lines，每次播放一行，写入后立即刷新（播放事件很稀疏，不需要批量）。
+ * 当前文件达到上限条数时改名为 "<文件名>.1"（覆盖更早的一份）并重新开始，
+ * 磁盘上最多保留 2 × maxRecords 条，多年的播放记录也不会无限增长。
+ * 偏好本身由 PreferenceModel 在线维护，日志只用于偏好文件丢失时重放与审计
+ */
+class PlayLog {
+public:
+    explicit PlayLog(int maxRecords = 10000);
+    ~PlayLog();
+
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString filePath() const { return m_filePath; }
+
+    void append(const QJsonObject &record);
+
+    // 按时间顺序（先 .1 后当前文件）回放全部记录，跳过损坏的行
+    void replay(const std::function<void(const QJsonObject &)> &visitor) const;
+
+private:
+    void rotate();
+
+    int m_maxRecords;
+    int m_records;          // 当前文件中的记录数
+    QString m_filePath;
+    QFile m_file;
+};
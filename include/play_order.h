@@ -0,0 +1,39 @@
+#pragma once
+#include <QVector>
+
+enum class PlayMode {
+    Sequential,
+    Random,
+    SingleLoop
+};
+
+/**
+ * 播放顺序
+ * 随机模式在队列或模式变化时生成一次完整的洗牌排列，之后的下一首、上一首都沿这个排列走，
+ * 每首恰好播放一次，而且“接下来几首”是确定的，预取可以提前知道。
+ * 单曲循环的重复由播放器在曲目结束时处理；手动切歌与预取按顺序播放的相邻曲目
+ */
+class PlayOrder {
+public:
+    PlayOrder();
+
+    // 队列变化时调用；随机模式下 current（若有效）排在排列首位，其余重新洗牌
+    void reset(int count, PlayMode mode, int current = -1);
+    void setMode(PlayMode mode, int current = -1) { reset(m_count, mode, current); }
+    PlayMode mode() const { return m_mode; }
+    int count() const { return m_count; }
+
+    // 到头时返回 -1；current 为 -1（尚未播放）时 next() 返回顺序中的第一首
+    int next(int current) const;
+    int previous(int current) const;
+    // current 之后的至多 n 首，按播放顺序
+    QVector<int> upcoming(int current, int n) const;
+
+private:
+    int positionOf(int index) const;
+
+    PlayMode m_mode;
+    int m_count;
+    QVector<int> m_order;       // 随机模式：播放位置 -> 队列下标
+    QVector<int> m_position;    // 队列下标 -> 播放位置
+};
@@ -29,17 +29,21 @@
 #include "../src/ui/lyricsvisualwidget.h"
 #include "ffmpegplayer.h"
 #include "materialui_components.h"
+#include "play_order.h"
 
-enum class PlayMode {
-    Sequential,
-    Random,
-    SingleLoop
-};
+class MultibandEqualizer;
+class PlaylistManager;
+class OnlineMusicService;
+class MetadataPrefetcher;
 
 class PlayerWindow : public QMainWindow {
     Q_OBJECT
 public:
     explicit PlayerWindow(QWidget *parent = nullptr);
+    // 曲库中已分析过的歌曲直接使用保存的波形与响度，不再重新解码
+    void setLibrary(const PlaylistManager *library) { this->library = library; }
+    // 在线封面与按播放顺序的预取；未接入网络模块时忽略
+    void setOnlineService(OnlineMusicService *service);
 
 protected:
     void dragEnterEvent(QDragEnterEvent *event) override;
@@ -99,14 +103,21 @@ private:
     // Equalizer Window
     QWidget *equalizerWindow;
     QSlider *eqSliders[10];
+    MultibandEqualizer *equalizer; // 属于播放器的音效链
     
     // Core functionality
     FFmpegPlayer *player;
     QTimer *progressTimer;
     PlayMode currentPlayMode;
+    PlayOrder playOrder;        // 下一首/上一首沿此顺序，随机模式为固定的洗牌排列
     bool isDarkTheme;
     int currentTrackIndex;
     QStringList playlist;
+    const PlaylistManager *library;
+    OnlineMusicService *onlineService;
+    MetadataPrefetcher *prefetcher;     // onlineService 的子对象
+    QString pendingArtArtist;           // 正在等在线封面的曲目
+    QString pendingArtAlbum;
     qint64 totalDuration; // 当前歌曲的总时长
     
     // Animation and Effects
@@ -151,6 +162,7 @@ private:
     void updatePlayModeIcon();
     void updateVolumeIcon(int volume);
     void addFilesToPlaylist(const QStringList &files);
+    void updatePrefetch();
     void showVolumeSlider(bool show);
     QString formatTime(qint64 timeMs);
     void applyModernStyle();
@@ -1,6 +1,8 @@
 #pragma once
 #include <QString>
 #include <QList>
+#include <QObject>
+#include <QThreadPool>
 #include "playlist.h"
 
 class PlaylistManager {
@@ -9,4 +11,16 @@ public:
     void scanMusicFolders(const QString &musicRootDir, const QString &myMusicDir);
     void loadPlaylists(const QString &myMusicDir);
     void savePlaylists(const QString &myMusicDir);
+    // 增量响度分析：只重新分析新增或修改过的文件，并重算专辑响度
+    // 分析在后台线程进行，立即返回；结果回到调用线程的事件循环中合并并保存
+    void updateLoudness(const QString &myMusicDir);
+    // 按文件路径查找曲库中的歌曲，没有时返回 nullptr
+    const SongInfo *findSong(const QString &filePath) const;
+
+private:
+    struct LoudnessBatch;
+    void applyLoudness(const LoudnessBatch &batch);
+
+    QObject m_context;          // 合并结果的投递目标，随管理器销毁，未处理的投递一并丢弃
+    QThreadPool m_pool;         // 析构时等待进行中的分析；须在 m_context 之后声明
 };
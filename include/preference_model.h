@@ -0,0 +1,63 @@
+#pragma once
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QJsonObject>
+
+/**
+ * 指数衰减的用户偏好
+ * 每次播放折入一个奖励值 r ∈ [-1, 2]，偏好权重为历次奖励按半衰期衰减后的和。
+ * 所有权重共用一个时间基准 t0，存储值为 r·e^{λ(t - t0)}，读取时乘 e^{-λ(now - t0)}：
+ * 折入一次事件只改动涉及的几个键，O(1)，不需要逐键衰减，也不需要保留播放历史。
+ * 指数增长到一定程度时整体换基（每隔数年一次）；键数超过上限时一次性剔除权重绝对值最小的四分之一，
+ * 均摊仍为 O(1)，内存有界。
+ * 能量与情感偏好为正奖励加权的衰减平均，分子分母同比例缩放，同样 O(1)
+ */
+class PreferenceModel {
+public:
+    enum Dimension {
+        Artist,
+        Genre,
+        Mood,
+        DimensionCount
+    };
+
+    explicit PreferenceModel(double halfLifeDays = 30.0, int maxKeys = 4096);
+
+    void setHalfLifeDays(double days);
+    double halfLifeDays() const { return m_halfLifeDays; }
+    void clear();
+    bool isEmpty() const;
+
+    // 折入奖励；key 为空时忽略
+    void add(Dimension dimension, const QString &key, double reward, qint64 timestampMs);
+    void addHour(int hour, double reward, qint64 timestampMs);
+    // 只有正奖励参与能量/情感偏好的平均
+    void addTarget(double energy, double valence, double reward, qint64 timestampMs);
+
+    double weight(Dimension dimension, const QString &key, qint64 nowMs) const;
+    QMap<QString, double> weights(Dimension dimension, qint64 nowMs) const;
+    double hourWeight(int hour, qint64 nowMs) const;
+    double energyPreference() const;
+    double valencePreference() const;
+
+    QJsonObject toJson() const;
+    void fromJson(const QJsonObject &obj);
+
+private:
+    // e^{λ(t - t0)}，必要时先换基
+    double scaleAt(qint64 timestampMs);
+    double decayAt(qint64 nowMs) const;
+    void rebase(qint64 timestampMs);
+    void prune(QHash<QString, double> &weights);
+
+    double m_halfLifeDays;
+    double m_lambda;                // 每毫秒的衰减率
+    int m_maxKeys;
+    qint64 m_epoch;                 // t0
+    QHash<QString, double> m_weights[DimensionCount];
+    double m_hours[24];
+    double m_energySum;             // Σ r·s·energy
+    double m_valenceSum;
+    double m_targetWeight;          // Σ r·s
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include <QObject>
+#include <QVector>
+#include <QByteArray>
+#include "fft.h"
+#include "pcm_ring_buffer.h"
+#include "spectrum_bands.h"
+#include "onset_detector.h"
+
+class QTimer;
+
+/**
+ * 实时音频处理器
+ * 处理音频信号并提取频谱数据。
+ * 短时傅里叶变换：输入为单声道分析环，每隔 hop 个样本取一帧（FFT 长度，默认 75% 重叠），
+ * 乘窗时直接从环中读取、不另行复制，再做实数 FFT 得到功率谱。
+ * 频谱与特征按音频时间以固定频率发出（默认 60 Hz），与音频回调的块大小无关：
+ * 发出时把频率范围内的功率（或经稀疏映射矩阵汇总成的显示频段）换算为 0..1 的显示电平，
+ * 并计算 RMS、峰值、过零率与频谱质心。每一跳的功率谱同时送入起音检测，检测到即发出 beatDetected，
+ * 不等显示节拍，延迟约为一跳加上拉取间隔。
+ * 两种输入方式：setSource() 接入播放引擎的分析环，按发出频率定时拉取；
+ * 或由 processAudioData() 推送原始 PCM，解码一次写入内部的环。
+ * 窗表与 FFT 查找表只在 FFT 长度或窗类型变化时重建（FFT 查找表按尺寸在所有实例间共享），
+ * 每帧不做三角函数运算，对数用 FastMath 近似；多路频谱同时刷新时每路的开销基本就是每跳一次 FFT
+ */
+class RealTimeAudioProcessor : public QObject {
+    Q_OBJECT
+
+public:
+    explicit RealTimeAudioProcessor(QObject *parent = nullptr);
+    ~RealTimeAudioProcessor();
+
+    // 设置音频参数：sampleSize 为位深，8 位无符号、16/24 位有符号整数、32 位浮点，多声道交错
+    void setAudioFormat(int sampleRate, int channels, int sampleSize);
+
+    // 推送方式：解码后写入内部分析环并处理其中已凑齐的帧
+    void processAudioData(const QByteArray &data);
+
+    // 拉取方式：定时从 source 读取（例如 FFmpegPlayer::analysisTap()），采样率取自 source；
+    // source 须比处理器活得久，传入空指针回到推送方式
+    void setSource(const PcmRingBuffer *source);
+
+    // FFT参数
+    void setFFTSize(int size);
+    void setWindowFunction(int type); // 0=Hanning, 1=Hamming, 2=Blackman
+
+    // 帧移（样本），不大于 FFT 长度；0 表示跟随 FFT 长度取 1/4（75% 重叠）
+    void setHopSize(int samples);
+    int hopSize() const { return m_hopSize; }
+    // 频谱与特征的发出频率（Hz，按音频时间计），拉取方式下同时是轮询频率
+    void setUpdateRate(int hz);
+
+    // 频率范围
+    void setFrequencyRange(int minFreq, int maxFreq);
+
+    // 显示频段：count > 0 时频谱输出为频率范围内按刻度划分的 count 个频段（SpectrumAnalyzer::setBandCount
+    // 应同步到这里），0 表示逐频点输出。映射矩阵只在 FFT 长度、采样率、频率范围或频段数变化时重建
+    void setBandCount(int count);
+    int bandCount() const { return m_bandCount; }
+    void setBandScale(SpectrumBandMapper::Scale scale);
+
+    // 节拍（起音）检测，默认开启；灵敏度见 OnsetDetector::setSensitivity
+    void setBeatDetectionEnabled(bool enabled);
+    void setBeatSensitivity(float sensitivity);
+
+    // 获取处理结果
+    QVector<float> getSpectrum() const { return m_spectrum; }
+    QVector<float> getWaveform() const { return m_waveform; }
+
+    // 特征提取
+    float getCurrentRMS() const { return m_currentRMS; }
+    float getCurrentPeak() const { return m_currentPeak; }
+    float getZeroCrossingRate() const { return m_zeroCrossingRate; }
+    float getSpectralCentroid() const { return m_spectralCentroid; }
+
+signals:
+    void spectrumReady(const QVector<float> &spectrum);
+    void waveformReady(const QVector<float> &waveform);
+    void audioFeaturesReady(float rms, float peak, float zcr, float centroid);
+    void beatDetected(qreal intensity);
+
+private:
+    const PcmRingBuffer &activeRing() const { return m_source ? *m_source : m_inputRing; }
+    void pollSource();
+    // 处理环中已凑齐的全部帧，到达发出时刻的帧计算显示数据并发出信号
+    void analyze(const PcmRingBuffer &ring);
+    // 从当前写入位置重新开始分帧（格式、帧长、帧移或输入源变化后），起音检测随之按新的帧率重置
+    void resetStream();
+    // 每跳只计算起音检测用到的低频频点功率，其余频点只在发出帧上计算
+    void performFFT(bool display);
+    // 帧复制为波形输出，并计算时域特征
+    void extractFeatures(const PcmRingBuffer::Span &frame);
+    void applyWindowFunction(const PcmRingBuffer::Span &frame);
+    // 按窗类型与 FFT 长度重建窗表，幅度按相干增益归一化（满幅正弦读数为 0 dB）
+    void rebuildWindow();
+    // 频率范围对应的频点区间与频段映射，参数未变时映射矩阵不重建
+    void updateBinRange();
+
+    // 音频参数
+    int m_sampleRate;
+    int m_channels;
+    int m_sampleSize;
+
+    // FFT参数
+    int m_fftSize;
+    int m_windowType;
+    int m_minFreq;
+    int m_maxFreq;
+    int m_minBin;
+    int m_maxBin;
+    int m_hopSize;
+    bool m_autoHop;
+    int m_updateRate;
+    int m_bandCount;
+    SpectrumBandMapper::Scale m_bandScale;
+    SpectrumBandMapper m_bandMapper;
+    OnsetDetector m_onsetDetector;
+    int m_onsetBins;                  // 起音检测使用的频点数（kOnsetMaxFreq 以下）
+    bool m_beatDetection;
+
+    // 输入
+    const PcmRingBuffer *m_source;
+    PcmRingBuffer m_inputRing;        // 推送方式的分析环
+    QVector<float> m_decodeBuffer;    // 推送方式的分段解码缓冲
+    QTimer *m_pollTimer;
+    quint64 m_nextFramePos;           // 下一帧在环中的起始位置
+    quint64 m_nextEmitPos;            // 帧尾到达该位置时发出
+
+    // 处理缓冲区
+    RealFFT m_fft;
+    QVector<float> m_windowedBuffer;  // 乘窗后的 FFT 输入
+    QVector<float> m_fftRe;           // 频谱实部 / 虚部，各 N/2 + 1 个频点
+    QVector<float> m_fftIm;
+    QVector<float> m_power;           // 功率谱
+    QVector<float> m_bandPower;       // 各显示频段的平均功率
+    QVector<float> m_windowFunction;
+
+    // 输出数据
+    QVector<float> m_spectrum;
+    QVector<float> m_waveform;        // 最近一次发出的帧（未加窗）
+
+    // 音频特征
+    float m_currentRMS;
+    float m_currentPeak;
+    float m_zeroCrossingRate;
+    float m_spectralCentroid;
+
+    // 处理状态
+    bool m_initialized;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <QVector>
+
+/**
+ * Freeverb 混响核心（单声道）：8 个并联梳状滤波器 + 4 个串联全通滤波器
+ * 所有延迟线长度取 2 的幂，读写位置以掩码回绕，处理循环中没有分支。
+ * 8 个梳状滤波器交错存放在同一缓冲区（buffer[pos * 8 + lane]）并共用写位置，
+ * 每个样本的阻尼低通与反馈在 SIMD 通道上一次完成，写回是一次连续的向量存储；
+ * 全通滤波器逐级对整块处理，内层循环只有一条延迟线。
+ */
+class ReverbTank {
+public:
+    static const int CombCount = 8;
+    static const int AllPassCount = 4;
+
+    ReverbTank();
+
+    // 设置各延迟线长度（样本）并分配内存，不可在音频线程调用
+    void setDelays(const int *combDelays, const int *allPassDelays);
+    int combDelay(int comb) const { return m_combDelays[comb]; }
+
+    void setCombFeedback(int comb, float feedback) { m_combFeedback[comb] = feedback; }
+    void setDamping(float damping);   // 0-1
+    void reset();
+
+    // 音频线程：input 与 output 可以是同一块内存
+    void process(const float *input, float *output, int frames);
+
+private:
+    void processCombs(const float *input, float *output, int frames);
+    void processAllPasses(float *samples, int frames);
+
+    struct AllPass {
+        QVector<float> buffer;
+        int mask;
+        int pos;
+        int delay;
+    };
+
+    QVector<float> m_combBuffer;   // [size][CombCount]
+    int m_combMask;
+    int m_combPos;
+    int m_combDelays[CombCount];
+    float m_combFeedback[CombCount];
+    float m_combFilterState[CombCount];   // 阻尼低通状态
+    float m_damp1;
+    float m_damp2;
+    AllPass m_allPasses[AllPassCount];
+};
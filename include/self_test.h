@@ -0,0 +1,10 @@
+#pragma once
+#include <QString>
+
+/**
+ * 内置自检
+ * 用合成数据校验不依赖界面与音频设备的计算组件，每个组件一个套件，套件表在 self_test.cpp 末尾。
+ * 由 musicplayer --self-test [套件] 运行，ctest 按套件分别注册；不指定套件时全部运行。
+ * 返回失败的检查数，0 表示全部通过
+ */
+int runSelfTests(const QString &suite = QString());
@@ -2,70 +2,127 @@
 #include <QObject>
 #include <QVector>
 #include <QMap>
+#include <QHash>
 #include <QString>
 #include <QTimer>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QThread>
+#include <QThreadPool>
 #include <QMutex>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QSet>
+#include <QElapsedTimer>
+#include <atomic>
+#include <deque>
 #include "../include/songinfo.h"
+#include "../include/feature_store.h"
+#include "../include/feature_index.h"
+#include "../include/preference_model.h"
+#include "../include/play_log.h"
 
 /**
  * 音乐特征分析器
  * 分析音频文件的各种特征用于推荐算法
+ * 每个文件只解码一次：FFmpeg 在重采样时直接下混为 22.05kHz 单声道，
+ * 流式送入 AudioFeatureExtractor，节奏、调性、响度与频谱特征共用同一个 STFT
  */
 class MusicAnalyzer : public QObject {
     Q_OBJECT
 
 public:
     struct AudioFeatures {
-        double tempo;           // BPM
-        double energy;          // 能量 0-1
-        double valence;         // 情感倾向 0-1 (sad-happy)
-        double danceability;    // 可舞性 0-1
-        double acousticness;    // 声学性 0-1
-        double instrumentalness; // 器乐性 0-1
-        double loudness;        // 响度 dB
-        double speechiness;     // 语音性 0-1
+        double tempo = 0.0;             // BPM
+        double energy = 0.0;            // 能量 0-1
+        double valence = 0.0;           // 情感倾向 0-1 (sad-happy)
+        double danceability = 0.0;      // 可舞性 0-1
+        double acousticness = 0.0;      // 声学性 0-1
+        double instrumentalness = 0.0;  // 器乐性 0-1
+        double loudness = -70.0;        // 响度 dB
+        double speechiness = 0.0;       // 语音性 0-1
         QString key;            // 音调
         QString mode;           // 调式 (major/minor)
-        int duration_ms;        // 时长毫秒
-        
+        int duration_ms = 0;    // 时长毫秒
+
+        // 解码失败或尚未分析时时长为 0
+        bool isValid() const { return duration_ms > 0; }
         QJsonObject toJson() const;
         static AudioFeatures fromJson(const QJsonObject &obj);
     };
 
     explicit MusicAnalyzer(QObject *parent = nullptr);
-    
-    // 分析音频文件特征
+    ~MusicAnalyzer();
+
+    // 打开持久化特征库（按文件指纹），之后的分析结果都会写入，重启后不再重复分析
+    bool openFeatureStore(const QString &filePath);
+
+    // 分析音频文件特征：同步执行，依次查内存缓存、特征库，都未命中才解码；
+    // 解码失败时返回 isValid() 为 false 的特征
     AudioFeatures analyzeFile(const QString &filePath);
-    
-    // 批量分析
+    // 只查缓存与特征库，不解码；路径未记录过指纹时读文件计算
+    bool cachedFeatures(const QString &filePath, AudioFeatures *features);
+    // 同上，但只用已记录的路径指纹，不读文件内容，可在界面线程对整个曲库调用；
+    // 尚未计算指纹的文件返回 false，由 analyzeLibrary() 在后台补上
+    bool indexedFeatures(const QString &filePath, AudioFeatures *features);
+
+    // 批量分析：加入后台队列立即返回，可重复调用追加；在有界线程池（低优先级线程）中执行，
+    // 特征库中已有的文件只计算指纹。进度按批节流发出，全部完成后发出 libraryAnalysisCompleted
     void analyzeLibrary(const QStringList &filePaths);
+    // 把仍在排队的文件提到队首，例如当前播放队列中的曲目
+    void prioritize(const QStringList &filePaths);
+    void cancelLibraryAnalysis();
+    bool isAnalyzingLibrary() const;
+    // 默认为 CPU 核数减一，给播放留出一个核
+    void setMaxThreads(int count);
     
-    // 获取相似度 (0-1)
+    // 获取相似度 (0-1)：1 减去加权特征向量的欧氏距离与最大可能距离之比
     double calculateSimilarity(const AudioFeatures &f1, const AudioFeatures &f2);
 
+    // 归一化、加权后的特征向量（速度取对数、调性放在五度圈上），用于相似度与最近邻索引
+    static const int FeatureDimensions = 11;
+    static void featureVector(const AudioFeatures &features, float *vector);
+
 signals:
+    // 新解码出的特征，以及批量分析中首次按指纹从特征库载入的特征
     void analysisCompleted(const QString &filePath, const AudioFeatures &features);
     void libraryAnalysisProgress(int current, int total);
     void libraryAnalysisCompleted();
 
 private:
+    class LibraryWorker;
+
     QMap<QString, AudioFeatures> m_featuresCache;
     QMutex m_cacheMutex;
-    
-    // 内部分析方法
-    static double extractTempo(const QString &filePath);
-    static double extractEnergy(const QString &filePath);
-    static double extractValence(const QString &filePath);
+    FeatureStore m_store;
+
+    // 批量分析队列：优先队列先出；已取走的文件从 m_pending 中移除，两个队列里的旧条目取出时跳过
+    QThreadPool m_pool;
+    mutable QMutex m_queueMutex;
+    std::deque<QString> m_queue;
+    std::deque<QString> m_priorityQueue;
+    QSet<QString> m_pending;
+    int m_maxThreads;
+    int m_activeWorkers;
+    int m_total;
+    int m_done;
+    QElapsedTimer m_progressTimer;
+    std::atomic<bool> m_cancelRequested;
+
+    // 一次流式解码提取全部特征，可在任意线程调用
+    static AudioFeatures extractFeatures(const QString &filePath);
+    // 特征库查找或解码分析，结果写入缓存与特征库；fromStore 表示未解码
+    AudioFeatures lookupOrAnalyze(const QString &filePath, bool *fromStore);
+    bool storedFeatures(const QString &filePath, AudioFeatures *features, bool computeFingerprint);
+    bool takeNextJob(QString *filePath);
+    void runLibraryWorker();
 };
 
+Q_DECLARE_METATYPE(MusicAnalyzer::AudioFeatures)
+
 /**
  * 智能推荐引擎
  * 基于音乐特征、用户行为等进行推荐
+ * 用户偏好按 30 天半衰期指数衰减、逐次在线更新（见 PreferenceModel），
+ * 每次播放 O(1) 折入；播放记录追加到有界的磁盘日志，内存中只保留最近若干条
  */
 class RecommendationEngine : public QObject {
     Q_OBJECT
@@ -85,8 +142,8 @@ public:
         QMap<QString, double> artistWeights;     // 艺术家偏好权重
         QMap<QString, double> moodWeights;       // 心情偏好权重
         QMap<int, double> timeWeights;           // 时间偏好权重 (小时)
-        double energyPreference;                 // 能量偏好
-        double valencePreference;                // 情感偏好
+        double energyPreference = 0.5;           // 能量偏好
+        double valencePreference = 0.5;          // 情感偏好
         
         QJsonObject toJson() const;
         static UserPreference fromJson(const QJsonObject &obj);
@@ -106,19 +163,22 @@ public:
 
     explicit RecommendationEngine(QObject *parent = nullptr);
     
-    // 设置音乐分析器
+    // 设置音乐分析器：分析器新产出的特征会即时加入相似度索引
     void setMusicAnalyzer(MusicAnalyzer *analyzer);
+    // 设置曲库，并用分析器已缓存的特征重建相似度索引
+    void setMusicLibrary(const QVector<SongInfo> &songs);
     
-    // 学习用户偏好
+    // 学习用户偏好：每次播放按完成率、跳过与喜欢折算为奖励值并即时折入
     void updateUserPreference(const PlayHistory &history, const SongInfo &song);
     void learnFromPlaylist(const QVector<SongInfo> &playlist);
     
-    // 生成推荐
+    // 生成推荐；引擎的公有方法可在任意线程调用（智能播放列表在工作线程中重新计算）
     QVector<SongInfo> recommend(RecommendationType type, 
                                const SongInfo &baseSong = SongInfo(),
                                int count = 20);
     
-    // 获取推荐播放列表
+    // 获取推荐播放列表：对曲库已分析的歌曲一次向量化打分，取高分候选后贪心装入时长预算
+    // （误差 ±30 秒内，同一歌手至少间隔 3 首），凑不齐时交换候选修补总时长
     QVector<SongInfo> generateSmartPlaylist(const QString &mood, 
                                            const QString &activity,
                                            int duration_minutes = 60);
@@ -127,18 +187,52 @@ public:
     void saveUserPreference(const QString &filePath);
     void loadUserPreference(const QString &filePath);
     
-    // 获取当前用户偏好
-    UserPreference getUserPreference() const { return m_userPreference; }
+    // 获取当前用户偏好（衰减到当前时刻的快照）
+    UserPreference getUserPreference() const;
+    // 最近的播放记录（持锁复制），最多 RecentPlayCount 条
+    std::deque<PlayHistory> recentPlays() const;
+
+    static const int RecentPlayCount = 512;
 
 signals:
     void recommendationReady(const QVector<SongInfo> &songs);
     void userPreferenceUpdated();
+    void libraryUpdated();
+    void featuresUpdated();     // 有歌曲的特征加入或更新
+
+private slots:
+    void onFeaturesAnalyzed(const QString &filePath, const MusicAnalyzer::AudioFeatures &features);
 
 private:
+    mutable QMutex m_mutex;     // 保护以下全部状态；主线程更新，工作线程读取
     MusicAnalyzer *m_analyzer;
-    UserPreference m_userPreference;
-    QVector<PlayHistory> m_playHistory;
+    PreferenceModel m_preferences;
+    PlayLog m_playLog;
+    std::deque<PlayHistory> m_playHistory;  // 最近的播放，完整记录在 m_playLog
     QVector<SongInfo> m_musicLibrary;
+    QHash<QString, int> m_libraryRows;      // 文件路径 -> m_musicLibrary 下标
+    FeatureIndex m_featureIndex;            // 曲库中已分析歌曲的特征向量
+
+    // 心情/活动对应的目标特征（featureVector 空间）与各维权重
+    struct FeatureTarget {
+        float target[MusicAnalyzer::FeatureDimensions] = {};
+        float weights[MusicAnalyzer::FeatureDimensions] = {};
+        float maxDistance = 0.0f;       // 加权平方距离的上界，用于归一化为 0-1 的契合度
+    };
+    struct Candidate {
+        int row;                        // m_musicLibrary 下标
+        double score;
+        qint64 durationMs;
+        int artist;                     // 歌手编号，同名歌手相同
+    };
+
+    void rebuildFeatureIndex();
+    FeatureTarget targetFor(const QString &mood, const QString &activity) const;
+    // 扫描整个特征矩阵打分，返回得分最高的 limit 首（计入歌手偏好与最近跳过），按得分降序
+    QVector<Candidate> scoreLibrary(const FeatureTarget &target, int limit);
+    double targetFit(const SongInfo &song, const FeatureTarget &target);
+    // 折入一条日志记录（updateUserPreference 与日志回放共用）
+    void foldPlay(const QJsonObject &event);
     
     // 推荐算法
     QVector<SongInfo> recommendSimilar(const SongInfo &baseSong, int count);
@@ -146,6 +240,7 @@ private:
     QVector<SongInfo> recommendByTime(int count);
     QVector<SongInfo> recommendByActivity(const QString &activity, int count);
     QVector<SongInfo> recommendDiscovery(int count);
+    QVector<SongInfo> recommendFavoriteArtists(int count);
     
     // 评分计算
     double calculateSongScore(const SongInfo &song, const SongInfo &baseSong = SongInfo());
@@ -163,6 +258,9 @@ private:
 /**
  * 智能播放列表管理器
  * 自动生成和管理各种智能播放列表
+ * 自动更新按依赖追踪：每种列表只依赖曲库、特征、用户偏好中的若干项（时间类还依赖时段），
+ * 引擎发出变更信号时只记下版本号，变更稳定一段时间后才重新计算依赖它的列表；
+ * 计算在低优先级工作线程中进行，结果回到所属线程一次性替换。没有变更时定时器不运行
  */
 class SmartPlaylistManager : public QObject {
     Q_OBJECT
@@ -184,6 +282,7 @@ public:
     };
 
     explicit SmartPlaylistManager(QObject *parent = nullptr);
+    ~SmartPlaylistManager();
     
     // 设置推荐引擎
     void setRecommendationEngine(RecommendationEngine *engine);
@@ -196,7 +295,7 @@ public:
     // 预定义智能播放列表
     void createDefaultPlaylists();
     
-    // 更新播放列表
+    // 立即在后台重新计算（不论输入是否变化），完成后发出 playlistUpdated
     void updatePlaylist(const QString &playlistId);
     void updateAllPlaylists();
     
@@ -222,12 +321,44 @@ private slots:
     void onAutoUpdateTimer();
 
 private:
+    class UpdateTask;
+
+    enum Input {
+        LibraryInput,
+        FeatureInput,
+        PreferenceInput,
+        InputCount
+    };
+
+    struct UpdateState {
+        quint64 versions[InputCount] = {};  // 上次计算所依据的输入版本
+        bool running = false;
+        bool queued = false;                // 计算期间又被请求，完成后再算一次
+    };
+
     RecommendationEngine *m_engine;
     QMap<QString, SmartPlaylist> m_playlists;
+    QHash<QString, UpdateState> m_updateStates;
     QTimer *m_autoUpdateTimer;
+    QThreadPool m_pool;
+    quint64 m_inputVersions[InputCount];
+    qint64 m_dirtySince[InputCount];        // 尚未稳定的变更最早发生的时间，0 表示没有
+    qint64 m_lastChange[InputCount];        // 最近一次变更的时间
+    int m_runningUpdates;
+
+    void markDirty(Input input);
+    // 输入安静 kSettleMs 后视为稳定；持续变更时最多等到首次变更后 kMaxSettleMs
+    qint64 settleDeadline(int input) const;
+    bool needsUpdate(const SmartPlaylist &playlist, qint64 now) const;
+    void scheduleUpdate(const QString &playlistId);
+    void finishUpdate(const QString &playlistId, const QVector<SongInfo> &songs, const quint64 *versions);
+    // 按最早到期的变更与时段边界重新设置定时器
+    void armTimer();
+    static QVector<SongInfo> computeSongs(RecommendationEngine *engine, const SmartPlaylist &playlist);
     
     // 生成播放列表ID
     QString generatePlaylistId();
+    bool hasPlaylistNamed(const QString &name) const;
     
     // 预定义播放列表创建方法
     void createDiscoveryWeekly();
@@ -235,79 +366,3 @@ private:
     void createActivityPlaylists();
     void createTimePlaylists();
 };
-
-/**
- * 在线音乐服务集成
- * 集成各种在线音乐服务API
- */
-class OnlineMusicService : public QObject {
-    Q_OBJECT
-
-public:
-    struct OnlineTrack {
-        QString id;
-        QString title;
-        QString artist;
-        QString album;
-        QString previewUrl;
-        QString albumArtUrl;
-        int duration_ms;
-        bool isPlayable;
-        
-        QJsonObject toJson() const;
-        static OnlineTrack fromJson(const QJsonObject &obj);
-    };
-
-    enum ServiceType {
-        Spotify,
-        AppleMusic,
-        YouTubeMusic,
-        LastFM,
-        Deezer
-    };
-
-    explicit OnlineMusicService(QObject *parent = nullptr);
-    
-    // 配置服务
-    void configureService(ServiceType type, const QString &apiKey, const QString &secret = "");
-    
-    // 搜索音乐
-    void searchTracks(const QString &query, int limit = 20);
-    void searchArtist(const QString &artist);
-    void searchAlbum(const QString &album);
-    
-    // 获取推荐
-    void getRecommendations(const QStringList &seedTracks, int limit = 20);
-    void getTrendingTracks(const QString &genre = "", int limit = 50);
-    
-    // 获取歌词
-    void getLyrics(const QString &artist, const QString &title);
-    
-    // 获取专辑封面
-    void getAlbumArt(const QString &artist, const QString &album, const QSize &size = QSize(300, 300));
-
-signals:
-    void searchCompleted(const QVector<OnlineTrack> &tracks);
-    void recommendationsReady(const QVector<OnlineTrack> &tracks);
-    void lyricsReceived(const QString &artist, const QString &title, const QString &lyrics);
-    void albumArtReceived(const QString &artist, const QString &album, const QPixmap &art);
-    void errorOccurred(const QString &error);
-
-private slots:
-    void onNetworkReply();
-
-private:
-    QNetworkAccessManager *m_networkManager;
-    QMap<ServiceType, QString> m_apiKeys;
-    QMap<ServiceType, QString> m_apiSecrets;
-    QMap<QNetworkReply*, QString> m_pendingRequests;
-    
-    // API调用方法
-    void makeApiRequest(const QString &url, const QMap<QString, QString> &headers = QMap<QString, QString>());
-    QString buildSpotifyUrl(const QString &endpoint, const QMap<QString, QString> &params = QMap<QString, QString>());
-    QString buildLastFMUrl(const QString &method, const QMap<QString, QString> &params = QMap<QString, QString>());
-    
-    // 数据解析
-    QVector<OnlineTrack> parseSpotifyTracks(const QJsonObject &response);
-    QString parseLastFMLyrics(const QJsonObject &response);
-};
@@ -2,6 +2,7 @@
 #include <QString>
 #include <QImage>
 #include <QVector>
+#include "loudness_analyzer.h"
 
 struct SongInfo {
     QString filePath;
@@ -12,4 +13,7 @@ struct SongInfo {
     QString lyrics;
     QImage cover;
     QVector<float> waveform; // 可视化用波形数据
+    LoudnessInfo trackLoudness;   // 单曲响度
+    LoudnessInfo albumLoudness;   // 所属专辑的合成响度
+    qint64 lastModified = 0;      // 上次分析时的文件修改时间，用于增量扫描
 };
@@ -10,7 +10,7 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLBuffer>
-#include <complex>
+#include "realtime_audio_processor.h"
 
 /**
  * 高级频谱分析器
@@ -81,6 +81,9 @@ public slots:
     void startAnimation();
     void stopAnimation();
     void resetAnimation();
+    // 接 RealTimeAudioProcessor::beatDetected（分析线程检测，排队连接送到 UI 线程）：
+    // 记录节拍时刻与强度供动画衰减使用，并转发 beatDetected；绘制路径中不做检测
+    void handleBeat(qreal intensity);
 
 signals:
     void beatDetected(qreal intensity);
@@ -114,7 +117,6 @@ private:
     // 工具方法
     void updatePeaks();
     void applySmoothing();
-    void detectBeats();
     QVector<QColor> generateColorGradient(ColorScheme scheme, int count);
     
     // 成员变量
@@ -153,10 +155,9 @@ private:
     QVector<QVector3D> m_particleVelocities;
     QVector<QColor> m_colors;
     
-    // 节拍检测
+    // 节拍（检测在 RealTimeAudioProcessor 的 OnsetDetector 中进行）
     qreal m_lastBeatTime;
-    qreal m_energySum;
-    QVector<qreal> m_energyHistory;
+    qreal m_beatIntensity;
 };
 
 /**
@@ -235,81 +236,6 @@ private:
     unsigned int m_depthTexture;
 };
 
-/**
- * 实时音频处理器
- * 处理音频信号并提取频谱数据
- */
-class RealTimeAudioProcessor : public QObject {
-    Q_OBJECT
-
-public:
-    explicit RealTimeAudioProcessor(QObject *parent = nullptr);
-    ~RealTimeAudioProcessor();
-
-    // 设置音频参数
-    void setAudioFormat(int sampleRate, int channels, int sampleSize);
-    
-    // 处理音频数据
-    void processAudioData(const QByteArray &data);
-    
-    // FFT参数
-    void setFFTSize(int size);
-    void setWindowFunction(int type); // 0=Hanning, 1=Hamming, 2=Blackman
-    
-    // 频率范围
-    void setFrequencyRange(int minFreq, int maxFreq);
-    
-    // 获取处理结果
-    QVector<float> getSpectrum() const { return m_spectrum; }
-    QVector<float> getWaveform() const { return m_waveform; }
-    
-    // 特征提取
-    float getCurrentRMS() const { return m_currentRMS; }
-    float getCurrentPeak() const { return m_currentPeak; }
-    float getZeroCrossingRate() const { return m_zeroCrossingRate; }
-    float getSpectralCentroid() const { return m_spectralCentroid; }
-
-signals:
-    void spectrumReady(const QVector<float> &spectrum);
-    void waveformReady(const QVector<float> &waveform);
-    void audioFeaturesReady(float rms, float peak, float zcr, float centroid);
-
-private:
-    void performFFT();
-    void extractFeatures();
-    void applyWindowFunction();
-    
-    // 音频参数
-    int m_sampleRate;
-    int m_channels;
-    int m_sampleSize;
-    
-    // FFT参数
-    int m_fftSize;
-    int m_windowType;
-    int m_minFreq;
-    int m_maxFreq;
-    
-    // 处理缓冲区
-    QVector<float> m_audioBuffer;
-    QVector<std::complex<float>> m_fftBuffer;
-    QVector<float> m_windowFunction;
-    
-    // 输出数据
-    QVector<float> m_spectrum;
-    QVector<float> m_waveform;
-    
-    // 音频特征
-    float m_currentRMS;
-    float m_currentPeak;
-    float m_zeroCrossingRate;
-    float m_spectralCentroid;
-    
-    // 处理状态
-    bool m_initialized;
-    int m_bufferPos;
-};
-
 /**
  * 可视化控制面板
  * 控制各种可视化参数的UI面板
@@ -0,0 +1,47 @@
+#pragma once
+#include <QVector>
+
+/**
+ * FFT 频点 -> 显示频段的稀疏映射
+ * 频段中心按 mel 或对数刻度在频率范围内等距分布，每个频段是以相邻两个中心为底边端点的三角滤波器，
+ * 中心处权重为 1（HTK 约定），频段输出为三角加权的功率和：单音按其自身电平显示，
+ * 宽频段的噪声读数相应更高，大致抵消音乐频谱随频率下降的趋势。
+ * 三角滤波器只与相邻频段重叠，每个频段的非零权重是一段连续频点，按频段存放起始频点与权重（CSR），
+ * 逐帧计算即若干段连续点积（SSE2/NEON 展开），总运算量约为两倍频点数，不做超越函数运算。
+ * 窄于两个频点间距的频段（低频、频段很多时）退化为中心频率处相邻两个频点的线性插值
+ */
+class SpectrumBandMapper {
+public:
+    enum Scale {
+        Mel,            // 感知刻度，低频分辨率高
+        Logarithmic     // 每频段等倍频程
+    };
+
+    SpectrumBandMapper();
+
+    // 重建映射矩阵；参数与上次完全相同时不做任何事并返回 false
+    bool configure(int fftSize, int sampleRate, float minFreq, float maxFreq, int bandCount, Scale scale);
+
+    int bandCount() const { return m_bandCount; }
+    bool isEmpty() const { return m_bandCount == 0; }
+    // 映射用到的频点范围 [firstBin, lastBin]，调用方只需为这些频点计算功率
+    int firstBin() const { return m_firstBin; }
+    int lastBin() const { return m_lastBin; }
+
+    // power 以频点 0 为起点（至少覆盖到 lastBin），bands 写入 bandCount() 个值
+    void apply(const float *power, float *bands) const;
+
+private:
+    int m_fftSize;
+    int m_sampleRate;
+    float m_minFreq;
+    float m_maxFreq;
+    int m_bandCount;
+    Scale m_scale;
+
+    int m_firstBin;
+    int m_lastBin;
+    QVector<int> m_bandStart;    // 频段 b 的首个频点
+    QVector<int> m_offsets;      // 频段 b 的权重为 weights[offsets[b], offsets[b + 1])
+    QVector<float> m_weights;
+};
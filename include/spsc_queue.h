@@ -0,0 +1,55 @@
+#pragma once
+#include <QVector>
+#include <atomic>
+
+/**
+ * 单生产者单消费者无锁队列
+ * 固定容量（向上取整到 2 的幂），push/pop 均不分配内存、不加锁，
+ * 用于 UI 线程向音频线程投递消息
+ */
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(int capacity = 1024) {
+        int size = 2;
+        while (size < capacity) size <<= 1;
+        m_buffer.resize(size);
+        m_data = m_buffer.data();
+        m_mask = quint32(size - 1);
+    }
+
+    // 仅生产者线程调用，队列满时返回 false
+    bool push(const T &item) {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) return false;
+        m_data[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅消费者线程调用，队列空时返回 false
+    bool pop(T &item) {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        item = m_data[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    int capacity() const { return int(m_mask) + 1; }
+
+private:
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    QVector<T> m_buffer;
+    T *m_data;
+    quint32 m_mask;
+    // 读写索引分处不同缓存行，避免两个线程互相失效
+    alignas(64) std::atomic<quint32> m_head{0};
+    alignas(64) std::atomic<quint32> m_tail{0};
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+/**
+ * 工作窃取双端队列（Chase–Lev，按 Lê 等人的 C11 内存序版本）
+ * 所有者线程在底端 push/pop（后进先出，刚就绪的任务数据还在缓存里），
+ * 其他线程在顶端 steal（先进先出）；只有队列剩最后一个元素时两端才以 CAS 竞争。
+ * 固定容量（向上取整到 2 的幂），调用方保证同时在队列中的元素不超过容量，不分配内存、不加锁
+ */
+template<typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int capacity = 64) {
+        int size = 2;
+        while (size < capacity) size <<= 1;
+        m_buffer.reset(new std::atomic<T>[size]);
+        m_mask = size - 1;
+    }
+
+    // 仅所有者线程调用
+    void push(T item) {
+        const qint64 bottom = m_bottom.load(std::memory_order_relaxed);
+        m_buffer[bottom & m_mask].store(item, std::memory_order_relaxed);
+        // 以 release 发布（原算法用 release 栅栏加 relaxed 写，效果相同），窃取者借此看到任务的输入数据
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // 仅所有者线程调用，队列空时返回 false
+    bool pop(T &item) {
+        const qint64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        qint64 top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = m_buffer[bottom & m_mask].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // 最后一个元素：与窃取者竞争
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                           std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // 任意线程调用；队列空或竞争失败时返回 false
+    bool steal(T &item) {
+        qint64 top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const qint64 bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) return false;
+        item = m_buffer[top & m_mask].load(std::memory_order_relaxed);
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed);
+    }
+
+    int capacity() const { return int(m_mask) + 1; }
+
+private:
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    std::unique_ptr<std::atomic<T>[]> m_buffer;
+    qint64 m_mask;
+    // 两端索引分处不同缓存行；64 位计数不会回绕
+    alignas(64) std::atomic<qint64> m_top{0};
+    alignas(64) std::atomic<qint64> m_bottom{0};
+};
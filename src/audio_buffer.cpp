@@ -0,0 +1,47 @@
+#include "../include/audio_buffer.h"
+#include <algorithm>
+
+AudioBuffer::AudioBuffer(int channels, int frames) {
+    setSize(channels, frames);
+}
+
+void AudioBuffer::setSize(int channels, int frames) {
+    m_channels = std::max(channels, 0);
+    m_frames = std::max(frames, 0);
+    m_data.fill(0.0f, m_channels * m_frames);
+    m_pointers.resize(m_channels);
+    float *base = m_data.data();
+    for (int ch = 0; ch < m_channels; ++ch) {
+        m_pointers[ch] = base + ch * m_frames;
+    }
+}
+
+void AudioBuffer::clear() {
+    std::fill(m_data.begin(), m_data.end(), 0.0f);
+}
+
+AudioBlock AudioBuffer::block(int frames) const {
+    AudioBlock b;
+    b.channels = m_pointers.constData();
+    b.channelCount = m_channels;
+    b.frameCount = std::min(frames, m_frames);
+    return b;
+}
+
+void AudioBuffer::deinterleave(const float *interleaved, int frames) {
+    frames = std::min(frames, m_frames);
+    for (int ch = 0; ch < m_channels; ++ch) {
+        float *dst = m_pointers[ch];
+        const float *src = interleaved + ch;
+        for (int i = 0; i < frames; ++i) dst[i] = src[i * m_channels];
+    }
+}
+
+void AudioBuffer::interleave(float *interleaved, int frames) const {
+    frames = std::min(frames, m_frames);
+    for (int ch = 0; ch < m_channels; ++ch) {
+        const float *src = m_pointers[ch];
+        float *dst = interleaved + ch;
+        for (int i = 0; i < frames; ++i) dst[i * m_channels] = src[i];
+    }
+}
@@ -0,0 +1,2271 @@
+#include "../include/audio_effects.h"
+#include "../include/dynamics_kernels.h"
+#include "../include/fast_math.h"
+#include <QJsonArray>
+#include <QtMath>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const int kDefaultBlockFrames = 1024;
+const float kSmoothingMs = 20.0f;
+const int kParameterQueueSize = 1024;
+const int kReclaimIntervalMs = 50;
+const int kOverflowRetryMs = 20;
+const int kFormatPollMs = 50;
+
+// Freeverb 调谐参数（44.1kHz 下的采样数）
+const int kCombTuning[8] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};
+const int kAllPassTuning[4] = {556, 441, 341, 225};
+const int kStereoSpread = 23;
+const float kReverbInputGain = 0.015f;
+const float kReverbWetScale = 3.0f;
+const float kMaxPreDelayMs = 200.0f;
+
+// 卷积混响：卷积块取处理块大小（2 的幂），切换脉冲响应时交叉淡化
+const int kMinConvolutionBlock = 64;
+const int kMaxConvolutionBlock = 4096;
+const float kConvolutionFadeMs = 50.0f;
+const int kRetiredConvolutionQueueSize = 4;
+
+const int kMaxEchoes = 8;
+const float kMaxEchoDelayMs = 2000.0f;
+
+const int kMaxChorusVoices = 8;
+const float kMaxChorusDelayMs = 50.0f;
+
+const float kMaxLookaheadMs = 50.0f;
+const float kExpanderFloorDb = -80.0f;
+
+// HRTF：HRIR 通常只有几百个样本，分区取小以压低延迟；更换测量集时交叉淡化
+const int kHrtfPartitionSize = 128;
+const float kHrtfFadeMs = 50.0f;
+const int kRetiredHrtfQueueSize = 4;
+
+const float kStandardBandFrequencies[10] = {32, 64, 125, 250, 500, 1000, 2000, 4000, 8000, 16000};
+}
+
+// SmoothedValue Implementation
+void SmoothedValue::setTarget(float value) {
+    if (value == m_target) return;
+    m_target = value;
+    if (m_rampLength <= 0) {
+        m_current = value;
+        m_remaining = 0;
+        return;
+    }
+    m_step = (m_target - m_current) / m_rampLength;
+    m_remaining = m_rampLength;
+}
+
+void SmoothedValue::skip(int samples) {
+    if (m_remaining <= 0) return;
+    if (samples >= m_remaining) {
+        m_current = m_target;
+        m_remaining = 0;
+        return;
+    }
+    m_current += m_step * samples;
+    m_remaining -= samples;
+}
+
+// AudioEffect Implementation
+AudioEffect::AudioEffect(EffectType type, QObject *parent)
+    : QObject(parent)
+    , m_effectType(type)
+    , m_enabled(true)
+    , m_latency(0)
+    , m_preparedSampleRate(0)
+    , m_preparedChannels(0)
+    , m_maxBlockFrames(0)
+    , m_syncing(false)
+    , m_chain(nullptr)
+    , m_effectId(-1)
+{
+}
+
+AudioEffect *AudioEffect::create(EffectType type, QObject *parent) {
+    switch (type) {
+    case Reverb:
+        return new ReverbEffect(parent);
+    case Echo:
+        return new EchoEffect(parent);
+    case Chorus:
+        return new ChorusEffect(parent);
+    case Distortion:
+        return new DistortionEffect(parent);
+    case BitCrusher:
+        return new BitCrusherEffect(parent);
+    case Compression:
+        return new DynamicsProcessor(DynamicsProcessor::Compressor, parent);
+    case Limiter:
+        return new DynamicsProcessor(DynamicsProcessor::Limiter, parent);
+    case NoiseGate:
+        return new DynamicsProcessor(DynamicsProcessor::Gate, parent);
+    case Equalizer:
+        return new MultibandEqualizer(parent);
+    case Spatializer:
+        return new SpatialAudioProcessor(parent);
+    default:
+        return nullptr;
+    }
+}
+
+void AudioEffect::process(QVector<float> &audioData, int channels, int sampleRate) {
+    if (!isEnabled() || channels <= 0 || audioData.isEmpty()) return;
+
+    // 兼容路径允许在格式变化时重新分配，实时路径请直接调用 prepare()/processBlock()
+    if (channels != m_preparedChannels || sampleRate != m_preparedSampleRate) {
+        prepare(sampleRate, channels, qMax(m_maxBlockFrames, kDefaultBlockFrames));
+    }
+    if (m_interleavedScratch.channelCount() != channels || m_interleavedScratch.capacity() != m_maxBlockFrames) {
+        m_interleavedScratch.setSize(channels, m_maxBlockFrames);
+    }
+
+    const int totalFrames = audioData.size() / channels;
+    float *data = audioData.data();
+    for (int offset = 0; offset < totalFrames; offset += m_maxBlockFrames) {
+        const int frames = qMin(m_maxBlockFrames, totalFrames - offset);
+        float *chunk = data + offset * channels;
+        m_interleavedScratch.deinterleave(chunk, frames);
+        processBlock(m_interleavedScratch.block(frames));
+        m_interleavedScratch.interleave(chunk, frames);
+    }
+}
+
+void AudioEffect::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    m_preparedSampleRate = sampleRate;
+    m_preparedChannels = channels;
+    m_maxBlockFrames = qMax(maxBlockFrames, 1);
+}
+
+void AudioEffect::setEnabled(bool enabled) {
+    if (m_enabled.exchange(enabled, std::memory_order_relaxed) == enabled) return;
+    emit enabledChanged(enabled);
+}
+
+int AudioEffect::addParameter(const QString &name, float defaultValue, float minValue, float maxValue) {
+    ParameterInfo info;
+    info.name = name;
+    info.minValue = minValue;
+    info.maxValue = maxValue;
+    m_parameterInfo.append(info);
+    m_parameterValues.append(qBound(minValue, defaultValue, maxValue));
+    return m_parameterInfo.size() - 1;
+}
+
+void AudioEffect::removeLastParameters(int count) {
+    count = qBound(0, count, m_parameterInfo.size());
+    m_parameterInfo.resize(m_parameterInfo.size() - count);
+    m_parameterValues.resize(m_parameterValues.size() - count);
+}
+
+void AudioEffect::syncParameters() {
+    m_syncing = true;
+    for (int id = 0; id < m_parameterValues.size(); ++id) {
+        applyParameter(id, m_parameterValues[id]);
+    }
+    m_syncing = false;
+}
+
+int AudioEffect::smoothingSamples() const {
+    return int(kSmoothingMs * m_preparedSampleRate / 1000.0f);
+}
+
+void AudioEffect::setSmoothed(SmoothedValue &value, float target) const {
+    if (m_syncing) {
+        value.reset(target);
+    } else {
+        value.setTarget(target);
+    }
+}
+
+void AudioEffect::setParameter(int id, float value) {
+    if (id < 0 || id >= m_parameterInfo.size()) return;
+    const ParameterInfo &info = m_parameterInfo[id];
+    value = qBound(info.minValue, value, info.maxValue);
+    if (m_parameterValues[id] == value) return;
+    m_parameterValues[id] = value;
+
+    if (m_chain) {
+        m_chain->postParameter(this, id, value);
+    } else if (isPrepared()) {
+        // 未加入效果链时由调用方保证与处理在同一线程
+        applyParameter(id, value);
+    }
+    emit parameterChanged(info.name, value);
+}
+
+void AudioEffect::setParameter(const QString &name, float value) {
+    setParameter(parameterId(name), value);
+}
+
+float AudioEffect::getParameter(int id) const {
+    return m_parameterValues.value(id, 0.0f);
+}
+
+float AudioEffect::getParameter(const QString &name) const {
+    return getParameter(parameterId(name));
+}
+
+int AudioEffect::parameterId(const QString &name) const {
+    for (int id = 0; id < m_parameterInfo.size(); ++id) {
+        if (m_parameterInfo[id].name == name) return id;
+    }
+    return -1;
+}
+
+QString AudioEffect::parameterName(int id) const {
+    if (id < 0 || id >= m_parameterInfo.size()) return QString();
+    return m_parameterInfo[id].name;
+}
+
+QStringList AudioEffect::getParameterNames() const {
+    QStringList names;
+    for (const ParameterInfo &info : m_parameterInfo) {
+        names.append(info.name);
+    }
+    return names;
+}
+
+void AudioEffect::loadPreset(const QString &presetName) {
+    if (m_presets.contains(presetName)) {
+        fromJson(m_presets.value(presetName));
+    }
+}
+
+void AudioEffect::savePreset(const QString &presetName) {
+    m_presets[presetName] = toJson();
+}
+
+QStringList AudioEffect::getPresetNames() const {
+    return m_presets.keys();
+}
+
+QString AudioEffect::effectName() const {
+    switch (m_effectType) {
+    case Reverb: return "混响";
+    case Echo: return "回声";
+    case Chorus: return "合唱";
+    case Flanger: return "镶边器";
+    case Phaser: return "相位器";
+    case Distortion: return "失真";
+    case Compression: return "压缩";
+    case Limiter: return "限幅器";
+    case NoiseGate: return "噪音门";
+    case Tremolo: return "颤音";
+    case Vibrato: return "振音";
+    case BitCrusher: return "位压缩";
+    case FilterLowPass: return "低通滤波";
+    case FilterHighPass: return "高通滤波";
+    case FilterBandPass: return "带通滤波";
+    case FilterNotch: return "陷波滤波";
+    case Equalizer: return "均衡器";
+    case Stereoizer: return "立体声增强";
+    case Spatializer: return "空间化";
+    }
+    return QString();
+}
+
+QJsonObject AudioEffect::toJson() const {
+    QJsonObject json;
+    json["type"] = static_cast<int>(m_effectType);
+    json["enabled"] = isEnabled();
+    QJsonObject params;
+    for (int id = 0; id < m_parameterInfo.size(); ++id) {
+        params[m_parameterInfo[id].name] = m_parameterValues[id];
+    }
+    json["parameters"] = params;
+    return json;
+}
+
+void AudioEffect::fromJson(const QJsonObject &json) {
+    setEnabled(json["enabled"].toBool(true));
+    QJsonObject params = json["parameters"].toObject();
+    for (const QString &name : params.keys()) {
+        setParameter(name, static_cast<float>(params[name].toDouble()));
+    }
+}
+
+// ReverbEffect Implementation
+ReverbEffect::ReverbEffect(QObject *parent)
+    : AudioEffect(Reverb, parent)
+    , m_roomSize(0.5f)
+    , m_damping(0.5f)
+    , m_preDelay(0.0f)
+    , m_decayTime(0.0f)
+    , m_engine(Freeverb)
+    , m_sampleRate(44100)
+    , m_channels(0)
+    , m_preDelayPos(0)
+    , m_preDelaySamples(0)
+    , m_preDelayMask(0)
+    , m_convolution(nullptr)
+    , m_fadingConvolution(nullptr)
+    , m_pendingConvolution(nullptr)
+    , m_retiredConvolutions(kRetiredConvolutionQueueSize)
+    , m_fadeLength(0)
+    , m_fadePos(0)
+{
+    addParameter("roomSize", 0.5f, 0.0f, 1.0f);
+    addParameter("damping", 0.5f, 0.0f, 1.0f);
+    addParameter("wetLevel", 0.33f, 0.0f, 1.0f);
+    addParameter("dryLevel", 0.7f, 0.0f, 1.0f);
+    addParameter("preDelay", 0.0f, 0.0f, kMaxPreDelayMs);
+    addParameter("decayTime", 0.0f, 0.0f, 30.0f);
+    addParameter("engine", Freeverb, Freeverb, Convolution);
+}
+
+ReverbEffect::~ReverbEffect() {
+    releaseEngines();
+}
+
+void ReverbEffect::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    initializeDelayLines();
+
+    const int preDelaySize = RealFFT::nextPowerOfTwo(int(kMaxPreDelayMs * m_sampleRate / 1000.0f) + 1);
+    m_preDelayMask = preDelaySize - 1;
+    m_preDelayBuffer.fill(0.0f, m_channels * preDelaySize);
+    m_preDelayPos = 0;
+
+    // 音频线程此时不在处理，直接按新格式重建卷积引擎
+    releaseEngines();
+    m_wetBuffer.setSize(m_channels, this->maxBlockFrames());
+    m_fadeBuffer.fill(0.0f, this->maxBlockFrames());
+    m_fadeLength = qMax(1, int(kConvolutionFadeMs * m_sampleRate / 1000.0f));
+    m_fadePos = 0;
+    m_convolution = buildConvolutionEngine();
+
+    m_wetLevel.setRampLength(smoothingSamples());
+    m_dryLevel.setRampLength(smoothingSamples());
+    syncParameters();
+}
+
+void ReverbEffect::initializeDelayLines() {
+    const float scale = m_sampleRate / 44100.0f;
+    m_tanks.resize(m_channels);
+
+    for (int ch = 0; ch < m_channels; ++ch) {
+        // 奇数声道加入立体声展宽偏移
+        const int spread = (ch % 2) ? kStereoSpread : 0;
+        int combDelays[ReverbTank::CombCount];
+        int allPassDelays[ReverbTank::AllPassCount];
+        for (int i = 0; i < ReverbTank::CombCount; ++i) {
+            combDelays[i] = int((kCombTuning[i] + spread) * scale);
+        }
+        for (int i = 0; i < ReverbTank::AllPassCount; ++i) {
+            allPassDelays[i] = int((kAllPassTuning[i] + spread) * scale);
+        }
+        m_tanks[ch].setDelays(combDelays, allPassDelays);
+        m_tanks[ch].setDamping(m_damping);
+    }
+    updateCombFeedback();
+}
+
+void ReverbEffect::updateCombFeedback() {
+    for (ReverbTank &tank : m_tanks) {
+        for (int i = 0; i < ReverbTank::CombCount; ++i) {
+            float feedback;
+            if (m_decayTime > 0.0f) {
+                // 按 RT60 推导每条梳状滤波器的反馈：经过 decayTime 衰减 60dB，房间大小拉伸衰减时间
+                const float rt60 = m_decayTime * (0.5f + m_roomSize);
+                feedback = std::pow(10.0f, -3.0f * tank.combDelay(i) / (rt60 * m_sampleRate));
+            } else {
+                feedback = m_roomSize * 0.28f + 0.7f;
+            }
+            tank.setCombFeedback(i, qMin(feedback, 0.98f));
+        }
+    }
+}
+
+void ReverbEffect::applyPreDelay(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+    const int mask = m_preDelayMask;
+    const int delay = m_preDelaySamples;
+
+    // 先写后读，预延迟为 0 时读到的就是当前样本，无需分支
+    for (int ch = 0; ch < channels; ++ch) {
+        const float *x = block.channel(ch);
+        float *wet = m_wetBuffer.channel(ch);
+        float *line = m_preDelayBuffer.data() + ch * (mask + 1);
+        int pos = m_preDelayPos;
+        for (int i = 0; i < frames; ++i) {
+            line[pos] = x[i];
+            wet[i] = line[(pos - delay) & mask];
+            pos = (pos + 1) & mask;
+        }
+    }
+    m_preDelayPos = (m_preDelayPos + frames) & mask;
+}
+
+void ReverbEffect::mixWet(const AudioBlock &block, float wetScale) {
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+
+    // 各声道使用相同的平滑轨迹，处理完后统一推进
+    for (int ch = 0; ch < channels; ++ch) {
+        float *x = block.channel(ch);
+        const float *wet = m_wetBuffer.channel(ch);
+        SmoothedValue wetLevel = m_wetLevel;
+        SmoothedValue dryLevel = m_dryLevel;
+        for (int i = 0; i < frames; ++i) {
+            x[i] = x[i] * dryLevel.next() + wet[i] * (wetLevel.next() * wetScale);
+        }
+    }
+    m_wetLevel.skip(frames);
+    m_dryLevel.skip(frames);
+}
+
+void ReverbEffect::processBlock(const AudioBlock &block) {
+    if (m_engine == Convolution) {
+        processConvolution(block);
+    } else {
+        processFreeverb(block);
+    }
+}
+
+void ReverbEffect::processFreeverb(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+    applyPreDelay(block);
+
+    for (int ch = 0; ch < channels; ++ch) {
+        float *wet = m_wetBuffer.channel(ch);
+        for (int i = 0; i < frames; ++i) {
+            wet[i] *= kReverbInputGain;
+        }
+        m_tanks[ch].process(wet, wet, frames);
+    }
+    mixWet(block, kReverbWetScale);
+}
+
+void ReverbEffect::processConvolution(const AudioBlock &block) {
+    adoptPendingEngine();
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+    float *fade = m_fadeBuffer.data();
+    applyPreDelay(block);
+
+    for (int ch = 0; ch < channels; ++ch) {
+        float *wet = m_wetBuffer.channel(ch);
+        if (m_fadingConvolution) {
+            m_fadingConvolution->convolvers[ch].process(wet, fade, frames);
+        }
+        if (m_convolution) {
+            m_convolution->convolvers[ch].process(wet, wet, frames);
+        } else {
+            std::memset(wet, 0, sizeof(float) * frames);
+        }
+        if (m_fadingConvolution) {
+            const float step = 1.0f / m_fadeLength;
+            for (int i = 0; i < frames; ++i) {
+                const float gain = qMin(1.0f, (m_fadePos + i) * step);
+                wet[i] = wet[i] * gain + fade[i] * (1.0f - gain);
+            }
+        }
+    }
+
+    if (m_fadingConvolution) {
+        m_fadePos += frames;
+        // 淡出完成后交回 UI 线程释放；队列满时下个块再试
+        if (m_fadePos >= m_fadeLength && m_retiredConvolutions.push(m_fadingConvolution)) {
+            m_fadingConvolution = nullptr;
+        }
+    }
+    mixWet(block, 1.0f);
+}
+
+void ReverbEffect::adoptPendingEngine() {
+    // 上一次交叉淡化尚未结束时暂不接收，保证同时最多两个引擎在运行
+    if (m_fadingConvolution) return;
+    ConvolutionEngine *engine = m_pendingConvolution.exchange(nullptr, std::memory_order_acq_rel);
+    if (!engine) return;
+    m_fadingConvolution = m_convolution;
+    m_convolution = engine;
+    m_fadePos = 0;
+}
+
+ReverbEffect::ConvolutionEngine *ReverbEffect::buildConvolutionEngine() const {
+    if (m_impulseResponse.isEmpty() || !isPrepared()) return nullptr;
+
+    const ImpulseResponse response = m_impulseResponse.resampled(m_sampleRate);
+    const int blockSize = convolutionBlockSize();
+    ConvolutionEngine *engine = new ConvolutionEngine;
+    engine->convolvers.resize(m_channels);
+    for (int ch = 0; ch < m_channels; ++ch) {
+        const QVector<float> &impulse = response.channels[ch % response.channelCount()];
+        engine->convolvers[ch].setImpulseResponse(impulse.constData(), impulse.size(), blockSize);
+    }
+    return engine;
+}
+
+void ReverbEffect::collectRetiredEngines() {
+    ConvolutionEngine *engine = nullptr;
+    while (m_retiredConvolutions.pop(engine)) {
+        delete engine;
+    }
+}
+
+void ReverbEffect::releaseEngines() {
+    collectRetiredEngines();
+    delete m_pendingConvolution.exchange(nullptr);
+    delete m_fadingConvolution;
+    delete m_convolution;
+    m_fadingConvolution = nullptr;
+    m_convolution = nullptr;
+}
+
+int ReverbEffect::convolutionBlockSize() const {
+    return RealFFT::nextPowerOfTwo(qBound(kMinConvolutionBlock, maxBlockFrames(), kMaxConvolutionBlock));
+}
+
+bool ReverbEffect::loadImpulseResponse(const QString &filePath, QString *errorMessage) {
+    const ImpulseResponse response = ImpulseResponse::loadWav(filePath, errorMessage);
+    if (response.isEmpty()) return false;
+    setImpulseResponse(response);
+    return true;
+}
+
+void ReverbEffect::setImpulseResponse(const ImpulseResponse &response) {
+    collectRetiredEngines();
+    m_impulseResponse = response;
+    m_impulseResponse.trimTail();
+    m_impulseResponse.normalizeEnergy();
+    if (!isPrepared()) return;
+
+    // 分区频谱在这里算好；音频线程还没取走的上一个引擎由这里释放
+    delete m_pendingConvolution.exchange(buildConvolutionEngine(), std::memory_order_acq_rel);
+}
+
+void ReverbEffect::reset() {
+    for (ReverbTank &tank : m_tanks) {
+        tank.reset();
+    }
+    m_preDelayBuffer.fill(0.0f);
+    m_preDelayPos = 0;
+
+    for (ConvolutionEngine *engine : {m_convolution, m_fadingConvolution}) {
+        if (!engine) continue;
+        PartitionedConvolver *convolvers = engine->convolvers.data();
+        for (int ch = 0; ch < engine->convolvers.size(); ++ch) {
+            convolvers[ch].reset();
+        }
+    }
+}
+
+void ReverbEffect::applyParameter(int id, float value) {
+    switch (id) {
+    case RoomSize:
+        m_roomSize = value;
+        updateCombFeedback();
+        break;
+    case Damping:
+        m_damping = value;
+        for (ReverbTank &tank : m_tanks) {
+            tank.setDamping(m_damping);
+        }
+        break;
+    case WetLevel:
+        setSmoothed(m_wetLevel, value);
+        break;
+    case DryLevel:
+        setSmoothed(m_dryLevel, value);
+        break;
+    case PreDelay:
+        m_preDelay = value;
+        m_preDelaySamples = qMin(int(m_preDelay * m_sampleRate / 1000.0f), m_preDelayMask);
+        break;
+    case DecayTime:
+        m_decayTime = value;
+        updateCombFeedback();
+        break;
+    case Engine: {
+        const ReverbEngine engine = value >= 0.5f ? Convolution : Freeverb;
+        // 切换引擎时清空状态，避免另一套引擎残留的尾音在切回时出现
+        if (engine != m_engine && !m_syncing) reset();
+        m_engine = engine;
+        break;
+    }
+    }
+}
+
+void ReverbEffect::setRoomSize(float size) {
+    setParameter(RoomSize, size);
+}
+
+void ReverbEffect::setDamping(float damping) {
+    setParameter(Damping, damping);
+}
+
+void ReverbEffect::setWetLevel(float level) {
+    setParameter(WetLevel, level);
+}
+
+void ReverbEffect::setDryLevel(float level) {
+    setParameter(DryLevel, level);
+}
+
+void ReverbEffect::setPreDelay(float delay) {
+    setParameter(PreDelay, delay);
+}
+
+void ReverbEffect::setDecayTime(float time) {
+    setParameter(DecayTime, time);
+}
+
+void ReverbEffect::setEngine(ReverbEngine engine) {
+    setParameter(Engine, engine);
+}
+
+// EchoEffect Implementation
+EchoEffect::EchoEffect(QObject *parent)
+    : AudioEffect(Echo, parent)
+    , m_feedback(0.4f)
+    , m_numEchoes(1)
+    , m_echoSpread(1.0f)
+    , m_sampleRate(44100)
+    , m_channels(0)
+{
+    addParameter("delayTime", 250.0f, 1.0f, kMaxEchoDelayMs);
+    addParameter("feedback", 0.4f, 0.0f, 0.95f);
+    addParameter("wetLevel", 0.5f, 0.0f, 1.0f);
+    addParameter("dryLevel", 1.0f, 0.0f, 1.0f);
+    addParameter("numEchoes", 1.0f, 1.0f, kMaxEchoes);
+    addParameter("echoSpread", 1.0f, 0.0f, 4.0f);
+}
+
+void EchoEffect::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    initializeTaps();
+
+    m_delayTime.setRampLength(smoothingSamples());
+    m_wetLevel.setRampLength(smoothingSamples());
+    m_dryLevel.setRampLength(smoothingSamples());
+    syncParameters();
+}
+
+void EchoEffect::initializeTaps() {
+    // 按最大延迟一次性分配全部抽头，修改参数时不再分配
+    m_echoTaps.resize(kMaxEchoes);
+    for (EchoTap &tap : m_echoTaps) {
+        tap.bufferSize = int(kMaxEchoDelayMs * m_sampleRate / 1000.0f) + 1;
+        tap.delayBuffer.fill(0.0f, m_channels * tap.bufferSize);
+        tap.writePos = 0;
+    }
+    updateTaps();
+}
+
+void EchoEffect::updateTaps() {
+    for (int i = 0; i < m_echoTaps.size(); ++i) {
+        EchoTap &tap = m_echoTaps[i];
+        tap.delayScale = 1.0f + i * m_echoSpread;
+        tap.gain = std::pow(m_feedback, float(i));
+    }
+}
+
+void EchoEffect::processBlock(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+    const int taps = qMin(m_numEchoes, m_echoTaps.size());
+    const float tapNorm = 1.0f / qMax(1, taps);
+    const float samplesPerMs = m_sampleRate / 1000.0f;
+
+    for (int i = 0; i < frames; ++i) {
+        const float baseDelay = m_delayTime.next() * samplesPerMs;
+        const float wet = m_wetLevel.next() * tapNorm;
+        const float dry = m_dryLevel.next();
+
+        for (int ch = 0; ch < channels; ++ch) {
+            float *x = block.channel(ch);
+            const float in = x[i];
+            float echo = 0.0f;
+            for (int t = 0; t < taps; ++t) {
+                EchoTap &tap = m_echoTaps[t];
+                float *buffer = tap.delayBuffer.data() + ch * tap.bufferSize;
+                const int delay = qBound(1, int(baseDelay * tap.delayScale), tap.bufferSize - 1);
+                int readPos = tap.writePos - delay;
+                if (readPos < 0) readPos += tap.bufferSize;
+                const float y = buffer[readPos];
+                buffer[tap.writePos] = in + y * m_feedback;
+                echo += y * tap.gain;
+            }
+            x[i] = in * dry + echo * wet;
+        }
+        for (int t = 0; t < taps; ++t) {
+            EchoTap &tap = m_echoTaps[t];
+            if (++tap.writePos >= tap.bufferSize) tap.writePos = 0;
+        }
+    }
+}
+
+void EchoEffect::reset() {
+    for (EchoTap &tap : m_echoTaps) {
+        tap.delayBuffer.fill(0.0f);
+        tap.writePos = 0;
+    }
+}
+
+void EchoEffect::applyParameter(int id, float value) {
+    switch (id) {
+    case DelayTime:
+        setSmoothed(m_delayTime, value);
+        break;
+    case Feedback:
+        m_feedback = value;
+        updateTaps();
+        break;
+    case WetLevel:
+        setSmoothed(m_wetLevel, value);
+        break;
+    case DryLevel:
+        setSmoothed(m_dryLevel, value);
+        break;
+    case NumEchoes:
+        m_numEchoes = qRound(value);
+        break;
+    case EchoSpread:
+        m_echoSpread = value;
+        updateTaps();
+        break;
+    }
+}
+
+void EchoEffect::setDelayTime(float time) {
+    setParameter(DelayTime, time);
+}
+
+void EchoEffect::setFeedback(float feedback) {
+    setParameter(Feedback, feedback);
+}
+
+void EchoEffect::setWetLevel(float level) {
+    setParameter(WetLevel, level);
+}
+
+void EchoEffect::setDryLevel(float level) {
+    setParameter(DryLevel, level);
+}
+
+void EchoEffect::setNumEchoes(int count) {
+    setParameter(NumEchoes, count);
+}
+
+void EchoEffect::setEchoSpread(float spread) {
+    setParameter(EchoSpread, spread);
+}
+
+// ChorusEffect Implementation
+ChorusEffect::ChorusEffect(QObject *parent)
+    : AudioEffect(Chorus, parent)
+    , m_rate(0.8f)
+    , m_feedback(0.0f)
+    , m_numVoices(3)
+    , m_sampleRate(44100)
+    , m_channels(0)
+    , m_lfoPhase(0.0f)
+{
+    addParameter("rate", 0.8f, 0.01f, 10.0f);
+    addParameter("depth", 0.5f, 0.0f, 1.0f);
+    addParameter("delay", 20.0f, 1.0f, kMaxChorusDelayMs);
+    addParameter("feedback", 0.0f, 0.0f, 0.9f);
+    addParameter("wetLevel", 0.5f, 0.0f, 1.0f);
+    addParameter("dryLevel", 0.8f, 0.0f, 1.0f);
+    addParameter("voices", 3.0f, 1.0f, kMaxChorusVoices);
+}
+
+void ChorusEffect::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    initializeVoices();
+
+    m_depth.setRampLength(smoothingSamples());
+    m_delay.setRampLength(smoothingSamples());
+    m_wetLevel.setRampLength(smoothingSamples());
+    m_dryLevel.setRampLength(smoothingSamples());
+    syncParameters();
+}
+
+void ChorusEffect::initializeVoices() {
+    // 基础延迟 + 调制深度的上限，留两个采样给线性插值
+    const int bufferSize = int(2.0f * kMaxChorusDelayMs * m_sampleRate / 1000.0f) + 2;
+    m_voices.resize(kMaxChorusVoices);
+    for (int v = 0; v < kMaxChorusVoices; ++v) {
+        ChorusVoice &voice = m_voices[v];
+        voice.bufferSize = bufferSize;
+        voice.delayBuffer.fill(0.0f, m_channels * bufferSize);
+        voice.writePos = 0;
+        voice.phase = float(v) / kMaxChorusVoices;
+        voice.gain = 1.0f;
+        // 各声部 LFO 频率略有差异，避免同步调制
+        voice.detune = 1.0f + 0.07f * (v - (kMaxChorusVoices - 1) / 2.0f) / kMaxChorusVoices;
+    }
+}
+
+void ChorusEffect::processBlock(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+    const int voices = qMin(m_numVoices, m_voices.size());
+    if (voices <= 0) return;
+
+    const float samplesPerMs = m_sampleRate / 1000.0f;
+    const float voiceNorm = 1.0f / voices;
+
+    for (int i = 0; i < frames; ++i) {
+        const float baseDelay = m_delay.next() * samplesPerMs;
+        const float modDepth = m_depth.next() * baseDelay;
+        const float wet = m_wetLevel.next() * voiceNorm;
+        const float dry = m_dryLevel.next();
+
+        for (int ch = 0; ch < channels; ++ch) {
+            float *x = block.channel(ch);
+            const float in = x[i];
+            // 声道间 LFO 相位错开 90 度以获得立体声宽度
+            const float channelPhase = 0.25f * ch;
+            float chorus = 0.0f;
+            for (int v = 0; v < voices; ++v) {
+                ChorusVoice &voice = m_voices[v];
+                float *buffer = voice.delayBuffer.data() + ch * voice.bufferSize;
+                const float lfo = std::sin(2.0f * float(M_PI) * (voice.phase + channelPhase));
+                const float delay = qBound(1.0f, baseDelay + modDepth * lfo, float(voice.bufferSize - 2));
+
+                float readPos = voice.writePos - delay;
+                if (readPos < 0.0f) readPos += voice.bufferSize;
+                const int i0 = int(readPos);
+                const int i1 = (i0 + 1) % voice.bufferSize;
+                const float frac = readPos - i0;
+                const float y = buffer[i0] + (buffer[i1] - buffer[i0]) * frac;
+
+                buffer[voice.writePos] = in + y * m_feedback;
+                chorus += y * voice.gain;
+            }
+            x[i] = in * dry + chorus * wet;
+        }
+
+        for (int v = 0; v < voices; ++v) {
+            ChorusVoice &voice = m_voices[v];
+            voice.phase += m_rate * voice.detune / m_sampleRate;
+            if (voice.phase >= 1.0f) voice.phase -= 1.0f;
+            if (++voice.writePos >= voice.bufferSize) voice.writePos = 0;
+        }
+    }
+}
+
+void ChorusEffect::reset() {
+    for (ChorusVoice &voice : m_voices) {
+        voice.delayBuffer.fill(0.0f);
+        voice.writePos = 0;
+    }
+    m_lfoPhase = 0.0f;
+}
+
+void ChorusEffect::applyParameter(int id, float value) {
+    switch (id) {
+    case Rate:
+        m_rate = value;
+        break;
+    case Depth:
+        setSmoothed(m_depth, value);
+        break;
+    case Delay:
+        setSmoothed(m_delay, value);
+        break;
+    case Feedback:
+        m_feedback = value;
+        break;
+    case WetLevel:
+        setSmoothed(m_wetLevel, value);
+        break;
+    case DryLevel:
+        setSmoothed(m_dryLevel, value);
+        break;
+    case Voices:
+        m_numVoices = qRound(value);
+        break;
+    }
+}
+
+void ChorusEffect::setRate(float rate) {
+    setParameter(Rate, rate);
+}
+
+void ChorusEffect::setDepth(float depth) {
+    setParameter(Depth, depth);
+}
+
+void ChorusEffect::setDelay(float delay) {
+    setParameter(Delay, delay);
+}
+
+void ChorusEffect::setFeedback(float feedback) {
+    setParameter(Feedback, feedback);
+}
+
+void ChorusEffect::setWetLevel(float level) {
+    setParameter(WetLevel, level);
+}
+
+void ChorusEffect::setDryLevel(float level) {
+    setParameter(DryLevel, level);
+}
+
+void ChorusEffect::setVoices(int voices) {
+    setParameter(Voices, voices);
+}
+
+// DynamicsProcessor Implementation
+DynamicsProcessor::DynamicsProcessor(ProcessorType type, QObject *parent)
+    : AudioEffect(type == Limiter ? AudioEffect::Limiter
+                  : type == Gate ? AudioEffect::NoiseGate
+                  : AudioEffect::Compression, parent)
+    , m_processorType(type)
+    , m_ratio(4.0f)
+    , m_attack(10.0f)
+    , m_release(100.0f)
+    , m_knee(6.0f)
+    , m_lookahead(0.0f)
+    , m_envelope(0.0f)
+    , m_attackCoeff(0.0f)
+    , m_releaseCoeff(0.0f)
+    , m_lookaheadSamples(0)
+    , m_lookaheadMask(0)
+    , m_lookaheadPos(0)
+    , m_windowHead(0)
+    , m_windowTail(0)
+    , m_sampleIndex(0)
+    , m_sampleRate(44100)
+    , m_channels(0)
+{
+    float threshold = -20.0f;
+    float ratio = 4.0f;
+    float attack = 10.0f;
+    float release = 100.0f;
+    float knee = 6.0f;
+    float lookahead = 0.0f;
+    switch (type) {
+    case Limiter:
+        threshold = -1.0f;
+        ratio = 100.0f;
+        attack = 0.5f;
+        release = 50.0f;
+        knee = 0.0f;
+        lookahead = 5.0f;
+        break;
+    case Gate:
+        threshold = -50.0f;
+        ratio = 10.0f;
+        attack = 1.0f;
+        knee = 0.0f;
+        break;
+    case Expander:
+        threshold = -40.0f;
+        ratio = 2.0f;
+        break;
+    case Compressor:
+        break;
+    }
+
+    addParameter("threshold", threshold, -80.0f, 0.0f);
+    addParameter("ratio", ratio, 1.0f, 100.0f);
+    addParameter("attack", attack, 0.0f, 500.0f);
+    addParameter("release", release, 1.0f, 5000.0f);
+    addParameter("knee", knee, 0.0f, 24.0f);
+    addParameter("makeupGain", 0.0f, -24.0f, 24.0f);
+    addParameter("lookahead", lookahead, 0.0f, kMaxLookaheadMs);
+}
+
+void DynamicsProcessor::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+
+    // 按最大前瞻时间分配，调整前瞻时间时不再分配
+    const int lookaheadSize = RealFFT::nextPowerOfTwo(int(kMaxLookaheadMs * m_sampleRate / 1000.0f) + 1);
+    m_lookaheadMask = lookaheadSize - 1;
+    m_lookaheadBuffer.fill(0.0f, m_channels * lookaheadSize);
+    m_lookaheadPos = 0;
+    m_windowValues.fill(0.0f, lookaheadSize);
+    m_windowIndices.fill(0, lookaheadSize);
+    resetWindow();
+    m_envelope = 0.0f;
+
+    m_detector.fill(0.0f, this->maxBlockFrames());
+    m_thresholdRamp.fill(0.0f, this->maxBlockFrames());
+    m_makeupRamp.fill(0.0f, this->maxBlockFrames());
+
+    m_threshold.setRampLength(smoothingSamples());
+    m_makeupGain.setRampLength(smoothingSamples());
+    syncParameters();
+}
+
+void DynamicsProcessor::updateTimeConstants() {
+    m_attackCoeff = m_attack > 0.0f ? std::exp(-1.0f / (m_attack * 0.001f * m_sampleRate)) : 0.0f;
+    m_releaseCoeff = m_release > 0.0f ? std::exp(-1.0f / (m_release * 0.001f * m_sampleRate)) : 0.0f;
+}
+
+void DynamicsProcessor::resetWindow() {
+    m_windowHead = 0;
+    m_windowTail = 0;
+    m_sampleIndex = 0;
+}
+
+void DynamicsProcessor::slidingMaximum(float *levels, int frames) {
+    const quint32 window = quint32(m_lookaheadSamples) + 1;
+    const quint32 mask = quint32(m_lookaheadMask);
+    float *values = m_windowValues.data();
+    quint32 *indices = m_windowIndices.data();
+    quint32 head = m_windowHead;
+    quint32 tail = m_windowTail;
+    quint32 index = m_sampleIndex;
+
+    for (int i = 0; i < frames; ++i, ++index) {
+        const float level = levels[i];
+        // 队尾不大于新值的元素此后不可能再成为最大值；每个样本最多入队、出队各一次
+        while (tail != head && values[(tail - 1) & mask] <= level) --tail;
+        values[tail & mask] = level;
+        indices[tail & mask] = index;
+        ++tail;
+        while (index - indices[head & mask] >= window) ++head;
+        levels[i] = values[head & mask];
+    }
+
+    m_windowHead = head;
+    m_windowTail = tail;
+    m_sampleIndex = index;
+}
+
+void DynamicsProcessor::computeGains(int frames) {
+    if (m_processorType == Gate || m_processorType == Expander) {
+        DynamicsKernels::expanderGains(m_detector.data(), m_thresholdRamp.constData(), m_makeupRamp.constData(),
+                                       frames, m_ratio - 1.0f, kExpanderFloorDb);
+    } else {
+        DynamicsKernels::compressorGains(m_detector.data(), m_thresholdRamp.constData(), m_makeupRamp.constData(),
+                                         frames, 1.0f / m_ratio - 1.0f, m_knee);
+    }
+}
+
+void DynamicsProcessor::processBlock(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, m_channels);
+    const int frames = block.frameCount;
+    float *levels = m_detector.data();
+    float *thresholds = m_thresholdRamp.data();
+    float *makeups = m_makeupRamp.data();
+
+    // 声道联动：取各声道最大值作为检测电平
+    std::memset(levels, 0, sizeof(float) * frames);
+    for (int ch = 0; ch < channels; ++ch) {
+        const float *x = block.channel(ch);
+        for (int i = 0; i < frames; ++i) {
+            levels[i] = qMax(levels[i], std::abs(x[i]));
+        }
+    }
+
+    // 前瞻：检测电平取当前输入及其之前 lookahead 个样本的最大值
+    if (m_lookaheadSamples > 0) {
+        slidingMaximum(levels, frames);
+    }
+
+    // 包络跟随是逐样本递推，参数斜坡在同一循环里展开成数组
+    float envelope = m_envelope;
+    for (int i = 0; i < frames; ++i) {
+        const float level = levels[i];
+        const float coeff = level > envelope ? m_attackCoeff : m_releaseCoeff;
+        envelope = level + coeff * (envelope - level);
+        levels[i] = envelope;
+        thresholds[i] = m_threshold.next();
+        makeups[i] = m_makeupGain.next();
+    }
+    m_envelope = envelope;
+
+    computeGains(frames);
+
+    // 增益作用于延迟后的信号；先写后读，前瞻为 0 时读到的就是当前样本
+    const int mask = m_lookaheadMask;
+    const int delay = m_lookaheadSamples;
+    for (int ch = 0; ch < channels; ++ch) {
+        float *x = block.channel(ch);
+        float *line = m_lookaheadBuffer.data() + ch * (mask + 1);
+        int pos = m_lookaheadPos;
+        for (int i = 0; i < frames; ++i) {
+            line[pos] = x[i];
+            x[i] = line[(pos - delay) & mask] * levels[i];
+            pos = (pos + 1) & mask;
+        }
+    }
+    m_lookaheadPos = (m_lookaheadPos + frames) & mask;
+}
+
+void DynamicsProcessor::reset() {
+    m_envelope = 0.0f;
+    m_lookaheadBuffer.fill(0.0f);
+    m_lookaheadPos = 0;
+    resetWindow();
+}
+
+void DynamicsProcessor::applyParameter(int id, float value) {
+    switch (id) {
+    case Threshold:
+        setSmoothed(m_threshold, value);
+        break;
+    case Ratio:
+        m_ratio = value;
+        break;
+    case Attack:
+        m_attack = value;
+        updateTimeConstants();
+        break;
+    case Release:
+        m_release = value;
+        updateTimeConstants();
+        break;
+    case Knee:
+        m_knee = value;
+        break;
+    case MakeupGain:
+        setSmoothed(m_makeupGain, value);
+        break;
+    case Lookahead:
+        m_lookahead = value;
+        m_lookaheadSamples = qMin(int(m_lookahead * m_sampleRate / 1000.0f), m_lookaheadMask);
+        setLatency(m_lookaheadSamples);
+        // 窗口长度变化后旧队列不再有效，从当前样本重新累积
+        resetWindow();
+        break;
+    }
+}
+
+void DynamicsProcessor::setThreshold(float threshold) {
+    setParameter(Threshold, threshold);
+}
+
+void DynamicsProcessor::setRatio(float ratio) {
+    setParameter(Ratio, ratio);
+}
+
+void DynamicsProcessor::setAttack(float attack) {
+    setParameter(Attack, attack);
+}
+
+void DynamicsProcessor::setRelease(float release) {
+    setParameter(Release, release);
+}
+
+void DynamicsProcessor::setKnee(float knee) {
+    setParameter(Knee, knee);
+}
+
+void DynamicsProcessor::setMakeupGain(float gain) {
+    setParameter(MakeupGain, gain);
+}
+
+void DynamicsProcessor::setLookahead(float time) {
+    setParameter(Lookahead, time);
+}
+
+// OversampledEffect Implementation
+OversampledEffect::OversampledEffect(EffectType type, int defaultFactor, QObject *parent)
+    : AudioEffect(type, parent)
+{
+    addParameter("oversampling", defaultFactor, 1, Oversampler::MaxFactor);
+}
+
+void OversampledEffect::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    // 按最大倍数分配，之后切换倍数不再分配
+    m_oversampler.setup(channels, this->maxBlockFrames());
+    syncParameters();
+}
+
+void OversampledEffect::processBlock(const AudioBlock &block) {
+    const AudioBlock oversampled = m_oversampler.upsample(block);
+    processOversampled(oversampled);
+    m_oversampler.downsample(block);
+}
+
+void OversampledEffect::reset() {
+    m_oversampler.reset();
+}
+
+void OversampledEffect::applyParameter(int id, float value) {
+    if (id != OversamplingParameter) return;
+    m_oversampler.setFactor(qRound(value));
+    setLatency(m_oversampler.latency());
+    oversamplingChanged(oversampledRate());
+}
+
+void OversampledEffect::setOversampling(int factor) {
+    setParameter(OversamplingParameter, factor);
+}
+
+// DistortionEffect Implementation
+DistortionEffect::DistortionEffect(QObject *parent)
+    : OversampledEffect(Distortion, 4, parent)
+{
+    addParameter("drive", 12.0f, 0.0f, 48.0f);
+    addParameter("mix", 1.0f, 0.0f, 1.0f);
+    addParameter("outputGain", -6.0f, -24.0f, 12.0f);
+}
+
+void DistortionEffect::oversamplingChanged(int oversampledRate) {
+    Q_UNUSED(oversampledRate)
+    // 平滑时长按过采样后的样本数计，保持与原采样率下相同的时间
+    const int ramp = smoothingSamples() * oversamplingFactor();
+    m_drive.setRampLength(ramp);
+    m_mix.setRampLength(ramp);
+    m_outputGain.setRampLength(ramp);
+}
+
+void DistortionEffect::processOversampled(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, preparedChannels());
+    const int frames = block.frameCount;
+
+    // 各声道使用相同的平滑轨迹，处理完后统一推进
+    for (int ch = 0; ch < channels; ++ch) {
+        float *x = block.channel(ch);
+        SmoothedValue drive = m_drive;
+        SmoothedValue mix = m_mix;
+        SmoothedValue outputGain = m_outputGain;
+        for (int i = 0; i < frames; ++i) {
+            const float dry = x[i];
+            // tanh 的 [3/3] 有理近似，|v| >= 3 时输出恰为 ±1，曲线连续
+            const float v = qBound(-3.0f, dry * drive.next(), 3.0f);
+            const float wet = v * (27.0f + v * v) / (27.0f + 9.0f * v * v);
+            x[i] = (dry + (wet - dry) * mix.next()) * outputGain.next();
+        }
+    }
+    m_drive.skip(frames);
+    m_mix.skip(frames);
+    m_outputGain.skip(frames);
+}
+
+void DistortionEffect::applyParameter(int id, float value) {
+    switch (id) {
+    case Drive:
+        setSmoothed(m_drive, FastMath::dbToLinear(value));
+        break;
+    case Mix:
+        setSmoothed(m_mix, value);
+        break;
+    case OutputGain:
+        setSmoothed(m_outputGain, FastMath::dbToLinear(value));
+        break;
+    default:
+        OversampledEffect::applyParameter(id, value);
+        break;
+    }
+}
+
+void DistortionEffect::setDrive(float drive) {
+    setParameter(Drive, drive);
+}
+
+void DistortionEffect::setMix(float mix) {
+    setParameter(Mix, mix);
+}
+
+void DistortionEffect::setOutputGain(float gain) {
+    setParameter(OutputGain, gain);
+}
+
+// BitCrusherEffect Implementation
+BitCrusherEffect::BitCrusherEffect(QObject *parent)
+    : OversampledEffect(BitCrusher, 2, parent)
+    , m_levels(128.0f)
+    , m_downsample(1)
+    , m_holdLength(1)
+{
+    addParameter("bitDepth", 8.0f, 1.0f, 16.0f);
+    addParameter("downsample", 1.0f, 1.0f, 32.0f);
+    addParameter("mix", 1.0f, 0.0f, 1.0f);
+}
+
+void BitCrusherEffect::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    m_heldSamples.fill(0.0f, channels);
+    m_holdCounters.fill(0, channels);
+    OversampledEffect::prepare(sampleRate, channels, maxBlockFrames);
+}
+
+void BitCrusherEffect::reset() {
+    OversampledEffect::reset();
+    m_heldSamples.fill(0.0f);
+    m_holdCounters.fill(0);
+}
+
+void BitCrusherEffect::oversamplingChanged(int oversampledRate) {
+    Q_UNUSED(oversampledRate)
+    m_holdLength = m_downsample * oversamplingFactor();
+    m_mix.setRampLength(smoothingSamples() * oversamplingFactor());
+}
+
+void BitCrusherEffect::processOversampled(const AudioBlock &block) {
+    const int channels = qMin(block.channelCount, preparedChannels());
+    const int frames = block.frameCount;
+    const float levels = m_levels;
+    const float step = 1.0f / levels;
+    const int holdLength = m_holdLength;
+
+    for (int ch = 0; ch < channels; ++ch) {
+        float *x = block.channel(ch);
+        float held = m_heldSamples[ch];
+        int counter = m_holdCounters[ch];
+        SmoothedValue mix = m_mix;
+        for (int i = 0; i < frames; ++i) {
+            const float dry = x[i];
+            if (counter == 0) {
+                held = std::floor(dry * levels + 0.5f) * step;
+            }
+            if (++counter >= holdLength) counter = 0;
+            x[i] = dry + (held - dry) * mix.next();
+        }
+        m_heldSamples[ch] = held;
+        m_holdCounters[ch] = counter;
+    }
+    m_mix.skip(frames);
+}
+
+void BitCrusherEffect::applyParameter(int id, float value) {
+    switch (id) {
+    case BitDepth:
+        m_levels = FastMath::exp2(value - 1.0f);
+        break;
+    case Downsample:
+        m_downsample = qMax(1, qRound(value));
+        m_holdLength = m_downsample * oversamplingFactor();
+        break;
+    case Mix:
+        setSmoothed(m_mix, value);
+        break;
+    default:
+        OversampledEffect::applyParameter(id, value);
+        break;
+    }
+}
+
+void BitCrusherEffect::setBitDepth(float bits) {
+    setParameter(BitDepth, bits);
+}
+
+void BitCrusherEffect::setDownsample(int factor) {
+    setParameter(Downsample, factor);
+}
+
+void BitCrusherEffect::setMix(float mix) {
+    setParameter(Mix, mix);
+}
+
+// MultibandEqualizer Implementation
+QJsonObject MultibandEqualizer::EQBand::toJson() const {
+    QJsonObject json;
+    json["type"] = static_cast<int>(type);
+    json["frequency"] = frequency;
+    json["gain"] = gain;
+    json["q"] = q;
+    json["enabled"] = enabled;
+    return json;
+}
+
+MultibandEqualizer::EQBand MultibandEqualizer::EQBand::fromJson(const QJsonObject &json) {
+    EQBand band;
+    band.type = static_cast<FilterType>(json["type"].toInt(Peak));
+    band.frequency = static_cast<float>(json["frequency"].toDouble(1000.0));
+    band.gain = static_cast<float>(json["gain"].toDouble(0.0));
+    band.q = static_cast<float>(json["q"].toDouble(1.0));
+    band.enabled = json["enabled"].toBool(true);
+    return band;
+}
+
+MultibandEqualizer::BiquadCoefficients MultibandEqualizer::BiquadCoefficients::fromBand(const EQBand &band, int sampleRate) {
+    // RBJ Audio EQ Cookbook
+    const double freq = qBound(10.0, double(band.frequency), sampleRate * 0.49);
+    const double q = qMax(0.05, double(band.q));
+    const double A = std::pow(10.0, band.gain / 40.0);
+    const double w0 = 2.0 * M_PI * freq / sampleRate;
+    const double cosw = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double sqrtA2alpha = 2.0 * std::sqrt(A) * alpha;
+
+    double nb0 = 1.0, nb1 = 0.0, nb2 = 0.0, na0 = 1.0, na1 = 0.0, na2 = 0.0;
+    switch (band.type) {
+    case EQBand::LowPass:
+        nb0 = (1.0 - cosw) / 2.0; nb1 = 1.0 - cosw; nb2 = nb0;
+        na0 = 1.0 + alpha; na1 = -2.0 * cosw; na2 = 1.0 - alpha;
+        break;
+    case EQBand::HighPass:
+        nb0 = (1.0 + cosw) / 2.0; nb1 = -(1.0 + cosw); nb2 = nb0;
+        na0 = 1.0 + alpha; na1 = -2.0 * cosw; na2 = 1.0 - alpha;
+        break;
+    case EQBand::BandPass:
+        nb0 = alpha; nb1 = 0.0; nb2 = -alpha;
+        na0 = 1.0 + alpha; na1 = -2.0 * cosw; na2 = 1.0 - alpha;
+        break;
+    case EQBand::BandStop:
+        nb0 = 1.0; nb1 = -2.0 * cosw; nb2 = 1.0;
+        na0 = 1.0 + alpha; na1 = -2.0 * cosw; na2 = 1.0 - alpha;
+        break;
+    case EQBand::LowShelf:
+        nb0 = A * ((A + 1.0) - (A - 1.0) * cosw + sqrtA2alpha);
+        nb1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw);
+        nb2 = A * ((A + 1.0) - (A - 1.0) * cosw - sqrtA2alpha);
+        na0 = (A + 1.0) + (A - 1.0) * cosw + sqrtA2alpha;
+        na1 = -2.0 * ((A - 1.0) + (A + 1.0) * cosw);
+        na2 = (A + 1.0) + (A - 1.0) * cosw - sqrtA2alpha;
+        break;
+    case EQBand::HighShelf:
+        nb0 = A * ((A + 1.0) + (A - 1.0) * cosw + sqrtA2alpha);
+        nb1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw);
+        nb2 = A * ((A + 1.0) + (A - 1.0) * cosw - sqrtA2alpha);
+        na0 = (A + 1.0) - (A - 1.0) * cosw + sqrtA2alpha;
+        na1 = 2.0 * ((A - 1.0) - (A + 1.0) * cosw);
+        na2 = (A + 1.0) - (A - 1.0) * cosw - sqrtA2alpha;
+        break;
+    case EQBand::Peak:
+        nb0 = 1.0 + alpha * A; nb1 = -2.0 * cosw; nb2 = 1.0 - alpha * A;
+        na0 = 1.0 + alpha / A; na1 = -2.0 * cosw; na2 = 1.0 - alpha / A;
+        break;
+    }
+
+    BiquadCoefficients c;
+    c.b0 = float(nb0 / na0);
+    c.b1 = float(nb1 / na0);
+    c.b2 = float(nb2 / na0);
+    c.a1 = float(na1 / na0);
+    c.a2 = float(na2 / na0);
+    return c;
+}
+
+MultibandEqualizer::MultibandEqualizer(QObject *parent)
+    : AudioEffect(Equalizer, parent)
+    , m_sampleRate(44100)
+    , m_channels(0)
+{
+    setupStandardBands();
+}
+
+void MultibandEqualizer::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    m_cascade.setRampLength(smoothingSamples());
+    rebuildCascade();
+    syncParameters();
+}
+
+void MultibandEqualizer::rebuildCascade() {
+    m_cascade.setSize(m_bands.size(), m_channels);
+    for (int b = 0; b < m_bands.size(); ++b) {
+        updateCoefficients(b, false);
+    }
+}
+
+void MultibandEqualizer::updateCoefficients(int index, bool smooth) {
+    if (index < 0 || index >= m_cascade.stageCount()) return;
+    const EQBand &band = m_bands[index];
+    // 关闭的频段过渡到直通，而不是直接跳过，避免开关时爆音
+    BiquadCoefficients c = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    if (band.enabled) {
+        c = BiquadCoefficients::fromBand(band, m_sampleRate);
+    }
+    if (smooth) {
+        m_cascade.setTargetCoefficients(index, c.b0, c.b1, c.b2, c.a1, c.a2);
+    } else {
+        m_cascade.setCoefficients(index, c.b0, c.b1, c.b2, c.a1, c.a2);
+    }
+}
+
+void MultibandEqualizer::processBlock(const AudioBlock &block) {
+    m_cascade.process(block.channels, block.channelCount, block.frameCount);
+}
+
+void MultibandEqualizer::reset() {
+    m_cascade.reset();
+}
+
+void MultibandEqualizer::applyParameter(int id, float value) {
+    const int index = id / BandParameterCount;
+    if (id < 0 || index >= m_bands.size()) return;
+    EQBand &band = m_bands[index];
+    switch (id % BandParameterCount) {
+    case BandGain:
+        band.gain = value;
+        break;
+    case BandFrequency:
+        band.frequency = value;
+        break;
+    case BandQ:
+        band.q = value;
+        break;
+    case BandType:
+        band.type = static_cast<EQBand::FilterType>(qRound(value));
+        break;
+    case BandEnabled:
+        band.enabled = value >= 0.5f;
+        break;
+    }
+    updateCoefficients(index, !m_syncing);
+}
+
+void MultibandEqualizer::addBand(const EQBand &band) {
+    const int index = m_bands.size();
+    addParameter(QString("band%1Gain").arg(index), band.gain, -24.0f, 24.0f);
+    addParameter(QString("band%1Frequency").arg(index), band.frequency, 10.0f, 24000.0f);
+    addParameter(QString("band%1Q").arg(index), band.q, 0.05f, 20.0f);
+    addParameter(QString("band%1Type").arg(index), band.type, EQBand::LowPass, EQBand::Peak);
+    addParameter(QString("band%1Enabled").arg(index), band.enabled ? 1.0f : 0.0f, 0.0f, 1.0f);
+    m_bands.append(band);
+    if (isPrepared()) rebuildCascade();
+}
+
+void MultibandEqualizer::removeBand(int index) {
+    if (index < 0 || index >= getBandCount()) return;
+    // 之后频段的参数 id 与名称都会变化，按剩余频段重建
+    QVector<EQBand> bands;
+    for (int i = 0; i < getBandCount(); ++i) {
+        if (i != index) bands.append(getBand(i));
+    }
+    clearBands();
+    for (const EQBand &band : bands) {
+        addBand(band);
+    }
+}
+
+void MultibandEqualizer::updateBand(int index, const EQBand &band) {
+    if (index < 0 || index >= getBandCount()) return;
+    // 只投递参数，系数在音频线程平滑过渡，保留滤波器状态
+    setParameter(bandParameter(index, BandGain), band.gain);
+    setParameter(bandParameter(index, BandFrequency), band.frequency);
+    setParameter(bandParameter(index, BandQ), band.q);
+    setParameter(bandParameter(index, BandType), band.type);
+    setParameter(bandParameter(index, BandEnabled), band.enabled ? 1.0f : 0.0f);
+}
+
+MultibandEqualizer::EQBand MultibandEqualizer::getBand(int index) const {
+    EQBand band;
+    band.gain = getParameter(bandParameter(index, BandGain));
+    band.frequency = getParameter(bandParameter(index, BandFrequency));
+    band.q = getParameter(bandParameter(index, BandQ));
+    band.type = static_cast<EQBand::FilterType>(qRound(getParameter(bandParameter(index, BandType))));
+    band.enabled = getParameter(bandParameter(index, BandEnabled)) >= 0.5f;
+    return band;
+}
+
+int MultibandEqualizer::getBandCount() const {
+    return parameterCount() / BandParameterCount;
+}
+
+void MultibandEqualizer::clearBands() {
+    removeLastParameters(parameterCount());
+    m_bands.clear();
+}
+
+void MultibandEqualizer::setupStandardBands() {
+    // 与播放器均衡器窗口的 10 个滑块对应：两端为搁架滤波，中间为峰值滤波
+    clearBands();
+    for (int i = 0; i < 10; ++i) {
+        EQBand band;
+        band.type = i == 0 ? EQBand::LowShelf : (i == 9 ? EQBand::HighShelf : EQBand::Peak);
+        band.frequency = kStandardBandFrequencies[i];
+        band.gain = 0.0f;
+        band.q = 1.41f;
+        band.enabled = true;
+        addBand(band);
+    }
+}
+
+void MultibandEqualizer::setupGraphicEqualizer() {
+    clearBands();
+    for (int i = 0; i < 10; ++i) {
+        EQBand band;
+        band.type = EQBand::Peak;
+        band.frequency = kStandardBandFrequencies[i];
+        band.gain = 0.0f;
+        band.q = 1.0f;
+        band.enabled = true;
+        addBand(band);
+    }
+}
+
+void MultibandEqualizer::setupParametricEqualizer() {
+    const EQBand::FilterType types[5] = {EQBand::LowShelf, EQBand::Peak, EQBand::Peak, EQBand::Peak, EQBand::HighShelf};
+    const float frequencies[5] = {80, 250, 1000, 4000, 12000};
+    clearBands();
+    for (int i = 0; i < 5; ++i) {
+        EQBand band;
+        band.type = types[i];
+        band.frequency = frequencies[i];
+        band.gain = 0.0f;
+        band.q = 0.707f;
+        band.enabled = true;
+        addBand(band);
+    }
+}
+
+// SpatialAudioProcessor Implementation
+SpatialAudioProcessor::SpatialAudioProcessor(QObject *parent)
+    : AudioEffect(Spatializer, parent)
+    , m_listenerX(0.0f), m_listenerY(0.0f), m_listenerZ(0.0f)
+    , m_listenerYaw(0.0f), m_listenerPitch(0.0f), m_listenerRoll(0.0f)
+    , m_hrtfEnabled(false)
+    , m_surroundEnabled(false)
+    , m_roomSimEnabled(false)
+    , m_sampleRate(44100)
+    , m_crossfeedState{0.0f, 0.0f}
+    , m_hrtf(nullptr)
+    , m_fadingHrtf(nullptr)
+    , m_pendingHrtf(nullptr)
+    , m_retiredHrtf(kRetiredHrtfQueueSize)
+    , m_hrtfActive(false)
+    , m_fadeLength(0)
+    , m_fadePos(0)
+{
+    m_source.x = 0.0f;
+    m_source.y = 0.0f;
+    m_source.z = 1.0f;
+    m_source.enabled = true;
+
+    addParameter("sourceX", 0.0f, -100.0f, 100.0f);
+    addParameter("sourceY", 0.0f, -100.0f, 100.0f);
+    addParameter("sourceZ", 1.0f, -100.0f, 100.0f);
+    addParameter("listenerX", 0.0f, -100.0f, 100.0f);
+    addParameter("listenerY", 0.0f, -100.0f, 100.0f);
+    addParameter("listenerZ", 0.0f, -100.0f, 100.0f);
+    addParameter("listenerYaw", 0.0f, -180.0f, 180.0f);
+    addParameter("listenerPitch", 0.0f, -90.0f, 90.0f);
+    addParameter("listenerRoll", 0.0f, -180.0f, 180.0f);
+    addParameter("hrtf", 0.0f, 0.0f, 1.0f);
+    addParameter("surround", 0.0f, 0.0f, 1.0f);
+    addParameter("roomSimulation", 0.0f, 0.0f, 1.0f);
+    calculateStereoPosition();
+}
+
+SpatialAudioProcessor::~SpatialAudioProcessor() {
+    releaseRenderers();
+}
+
+void SpatialAudioProcessor::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    AudioEffect::prepare(sampleRate, channels, maxBlockFrames);
+    m_sampleRate = sampleRate;
+    m_crossfeedState[0] = m_crossfeedState[1] = 0.0f;
+
+    // 音频线程此时不在处理，直接按新采样率重建渲染器
+    releaseRenderers();
+    m_monoBuffer.fill(0.0f, this->maxBlockFrames());
+    m_fadeBuffer.fill(0.0f, 2 * this->maxBlockFrames());
+    m_fadeLength = qMax(1, int(kHrtfFadeMs * m_sampleRate / 1000.0f));
+    m_fadePos = 0;
+    m_hrtf = buildHrtfRenderer();
+    m_hrtfActive = false;
+
+    m_gainLeft.setRampLength(smoothingSamples());
+    m_gainRight.setRampLength(smoothingSamples());
+    m_distanceGain.setRampLength(smoothingSamples());
+    syncParameters();
+}
+
+void SpatialAudioProcessor::calculateStereoPosition() {
+    // 坐标系：x 向右，y 向上，z 向前；yaw 为听者绕 y 轴的转角（度）
+    const float dx = m_source.x - m_listenerX;
+    const float dy = m_source.y - m_listenerY;
+    const float dz = m_source.z - m_listenerZ;
+    m_source.distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    m_source.azimuth = qRadiansToDegrees(std::atan2(dx, dz)) - m_listenerYaw;
+    m_source.elevation = qRadiansToDegrees(std::atan2(dy, std::sqrt(dx * dx + dz * dz))) - m_listenerPitch;
+
+    // 等功率声像 + 距离衰减（1 米内不衰减）
+    const float pan = std::sin(qDegreesToRadians(m_source.azimuth));
+    const float angle = (pan + 1.0f) * float(M_PI) / 4.0f;
+    const float attenuation = 1.0f / qMax(1.0f, m_source.distance);
+    m_source.gainLeft = std::cos(angle) * float(M_SQRT2) * attenuation;
+    m_source.gainRight = std::sin(angle) * float(M_SQRT2) * attenuation;
+    setSmoothed(m_gainLeft, m_source.gainLeft);
+    setSmoothed(m_gainRight, m_source.gainRight);
+    setSmoothed(m_distanceGain, attenuation);
+}
+
+void SpatialAudioProcessor::processBlock(const AudioBlock &block) {
+    if (!m_source.enabled || block.channelCount < 2) return;
+    adoptPendingRenderer();
+    const bool binaural = m_hrtfEnabled && m_hrtf;
+    setLatency(binaural ? m_hrtf->latency() : 0);
+    if (binaural) {
+        processHrtf(block);
+        return;
+    }
+    m_hrtfActive = false;
+
+    const int frames = block.frameCount;
+    float *left = block.channel(0);
+    float *right = block.channel(1);
+
+    if (m_gainLeft.isSmoothing() || m_gainRight.isSmoothing()) {
+        for (int i = 0; i < frames; ++i) {
+            left[i] *= m_gainLeft.next();
+            right[i] *= m_gainRight.next();
+        }
+    } else {
+        const float gainLeft = m_gainLeft.current();
+        const float gainRight = m_gainRight.current();
+        for (int i = 0; i < frames; ++i) {
+            left[i] *= gainLeft;
+            right[i] *= gainRight;
+        }
+    }
+    if (m_surroundEnabled) {
+        applyCrossfeed(block);
+    }
+}
+
+void SpatialAudioProcessor::applyCrossfeed(const AudioBlock &block) {
+    // 耳机串扰模拟：对侧声道经约 700Hz 低通后以 -10dB 混入
+    const float coeff = std::exp(-2.0f * float(M_PI) * 700.0f / m_sampleRate);
+    const float level = 0.32f;
+    const float norm = 1.0f / (1.0f + level);
+    float *left = block.channel(0);
+    float *right = block.channel(1);
+    float stateL = m_crossfeedState[0];
+    float stateR = m_crossfeedState[1];
+
+    for (int i = 0; i < block.frameCount; ++i) {
+        const float l = left[i];
+        const float r = right[i];
+        stateL = l + coeff * (stateL - l);
+        stateR = r + coeff * (stateR - r);
+        left[i] = (l + level * stateR) * norm;
+        right[i] = (r + level * stateL) * norm;
+    }
+    m_crossfeedState[0] = stateL;
+    m_crossfeedState[1] = stateR;
+}
+
+void SpatialAudioProcessor::processHrtf(const AudioBlock &block) {
+    // 从声像模式切回时延迟线里是过时的输入，清空后重新累积
+    if (!m_hrtfActive) {
+        m_hrtf->reset();
+        m_hrtfActive = true;
+    }
+
+    const int frames = block.frameCount;
+    float *left = block.channel(0);
+    float *right = block.channel(1);
+    float *mono = m_monoBuffer.data();
+    for (int i = 0; i < frames; ++i) {
+        mono[i] = (left[i] + right[i]) * 0.5f * m_distanceGain.next();
+    }
+
+    m_hrtf->setDirection(m_source.azimuth, m_source.elevation);
+    if (m_fadingHrtf && m_fadePos < m_fadeLength) {
+        float *fadeLeft = m_fadeBuffer.data();
+        float *fadeRight = fadeLeft + maxBlockFrames();
+        m_fadingHrtf->setDirection(m_source.azimuth, m_source.elevation);
+        m_fadingHrtf->process(mono, fadeLeft, fadeRight, frames);
+        m_hrtf->process(mono, left, right, frames);
+
+        const float step = 1.0f / m_fadeLength;
+        for (int i = 0; i < frames; ++i) {
+            const float gain = qMin(1.0f, (m_fadePos + i) * step);
+            left[i] = left[i] * gain + fadeLeft[i] * (1.0f - gain);
+            right[i] = right[i] * gain + fadeRight[i] * (1.0f - gain);
+        }
+        m_fadePos += frames;
+    } else {
+        m_hrtf->process(mono, left, right, frames);
+    }
+}
+
+void SpatialAudioProcessor::adoptPendingRenderer() {
+    // 淡出完成的旧渲染器交回 UI 线程释放；队列满时下个块再试
+    if (m_fadingHrtf && m_fadePos >= m_fadeLength && m_retiredHrtf.push(m_fadingHrtf)) {
+        m_fadingHrtf = nullptr;
+    }
+    // 上一次交叉淡化尚未结束时暂不接收，保证同时最多两个渲染器在运行
+    if (m_fadingHrtf) return;
+    HrtfRenderer *renderer = m_pendingHrtf.exchange(nullptr, std::memory_order_acq_rel);
+    if (!renderer) return;
+    // 当前未在渲染时旧渲染器没有可淡出的输出，下个块直接退役
+    m_fadingHrtf = m_hrtf;
+    m_hrtf = renderer;
+    m_fadePos = m_hrtfActive ? 0 : m_fadeLength;
+}
+
+HrtfRenderer *SpatialAudioProcessor::buildHrtfRenderer() const {
+    if (m_hrtfDataset.isEmpty() || !isPrepared()) return nullptr;
+
+    HrtfRenderer *renderer = new HrtfRenderer;
+    renderer->setDataset(m_hrtfDataset.resampled(m_sampleRate), kHrtfPartitionSize);
+    return renderer;
+}
+
+void SpatialAudioProcessor::collectRetiredRenderers() {
+    HrtfRenderer *renderer = nullptr;
+    while (m_retiredHrtf.pop(renderer)) {
+        delete renderer;
+    }
+}
+
+void SpatialAudioProcessor::releaseRenderers() {
+    collectRetiredRenderers();
+    delete m_pendingHrtf.exchange(nullptr);
+    delete m_fadingHrtf;
+    delete m_hrtf;
+    m_fadingHrtf = nullptr;
+    m_hrtf = nullptr;
+}
+
+bool SpatialAudioProcessor::loadHRTFData(const QString &filePath, QString *errorMessage) {
+    const HrtfDataset dataset = HrtfDataset::loadSofaJson(filePath, errorMessage);
+    if (dataset.isEmpty()) return false;
+    setHrtfDataset(dataset);
+    return true;
+}
+
+void SpatialAudioProcessor::setHrtfDataset(const HrtfDataset &dataset) {
+    collectRetiredRenderers();
+    m_hrtfDataset = dataset;
+    if (!isPrepared()) return;
+
+    // 频谱缓存在这里算好；音频线程还没取走的上一个渲染器由这里释放
+    delete m_pendingHrtf.exchange(buildHrtfRenderer(), std::memory_order_acq_rel);
+}
+
+void SpatialAudioProcessor::reset() {
+    m_crossfeedState[0] = m_crossfeedState[1] = 0.0f;
+    for (HrtfRenderer *renderer : {m_hrtf, m_fadingHrtf}) {
+        if (renderer) renderer->reset();
+    }
+}
+
+void SpatialAudioProcessor::applyParameter(int id, float value) {
+    switch (id) {
+    case SourceX: m_source.x = value; break;
+    case SourceY: m_source.y = value; break;
+    case SourceZ: m_source.z = value; break;
+    case ListenerX: m_listenerX = value; break;
+    case ListenerY: m_listenerY = value; break;
+    case ListenerZ: m_listenerZ = value; break;
+    case ListenerYaw: m_listenerYaw = value; break;
+    case ListenerPitch: m_listenerPitch = value; break;
+    case ListenerRoll: m_listenerRoll = value; break;
+    case Hrtf: m_hrtfEnabled = value >= 0.5f; return;
+    case Surround: m_surroundEnabled = value >= 0.5f; return;
+    case RoomSimulation: m_roomSimEnabled = value >= 0.5f; return;
+    default: return;
+    }
+    calculateStereoPosition();
+}
+
+void SpatialAudioProcessor::setListenerPosition(float x, float y, float z) {
+    setParameter(ListenerX, x);
+    setParameter(ListenerY, y);
+    setParameter(ListenerZ, z);
+}
+
+void SpatialAudioProcessor::setListenerOrientation(float yaw, float pitch, float roll) {
+    setParameter(ListenerYaw, yaw);
+    setParameter(ListenerPitch, pitch);
+    setParameter(ListenerRoll, roll);
+}
+
+void SpatialAudioProcessor::setSourcePosition(float x, float y, float z) {
+    setParameter(SourceX, x);
+    setParameter(SourceY, y);
+    setParameter(SourceZ, z);
+}
+
+void SpatialAudioProcessor::enableHRTF(bool enabled) {
+    setParameter(Hrtf, enabled ? 1.0f : 0.0f);
+}
+
+void SpatialAudioProcessor::setSurroundMode(bool enabled) {
+    setParameter(Surround, enabled ? 1.0f : 0.0f);
+}
+
+void SpatialAudioProcessor::setRoomSimulation(bool enabled) {
+    setParameter(RoomSimulation, enabled ? 1.0f : 0.0f);
+}
+
+// AudioEffectChain Implementation
+AudioEffectChain::AudioEffectChain(QObject *parent)
+    : QObject(parent)
+    , m_snapshot(new ChainSnapshot)
+    , m_audioEpoch(0)
+    , m_reclaimTimer(new QTimer(this))
+    , m_overflowTimer(new QTimer(this))
+    , m_formatTimer(new QTimer(this))
+    , m_requestedFormat(0)
+    , m_resetPending(false)
+    , m_latency(0)
+    , m_parameterQueue(kParameterQueueSize)
+    , m_nextEffectId(0)
+    , m_sampleRate(44100)
+    , m_channels(2)
+    , m_maxBlockFrames(kDefaultBlockFrames)
+{
+    // 初始快照尚未被音频线程看到，可以直接填写
+    ChainSnapshot *initial = m_snapshot.load();
+    initial->sampleRate = m_sampleRate;
+    initial->channels = m_channels;
+    initial->blockBuffer.setSize(m_channels, m_maxBlockFrames);
+
+    // 有待回收的快照时定期检查音频线程是否已离开
+    m_reclaimTimer->setInterval(kReclaimIntervalMs);
+    connect(m_reclaimTimer, &QTimer::timeout, this, &AudioEffectChain::reclaimRetired);
+
+    // 音频线程长时间不取消息时，暂存的更新由定时器补发，用户停止操作后最后的数值也会生效
+    m_overflowTimer->setInterval(kOverflowRetryMs);
+    connect(m_overflowTimer, &QTimer::timeout, this, [this]() {
+        if (flushOverflowUpdates()) m_overflowTimer->stop();
+    });
+
+    // 音频线程不分配内存，格式变化由这里在控制线程完成
+    m_formatTimer->setInterval(kFormatPollMs);
+    connect(m_formatTimer, &QTimer::timeout, this, &AudioEffectChain::applyRequestedFormat);
+    m_formatTimer->start();
+}
+
+AudioEffectChain::~AudioEffectChain() {
+    clearEffects();
+    // 析构时音频线程已不再处理本链，剩余的快照可以直接释放
+    for (const RetiredSnapshot &retired : m_retired) {
+        qDeleteAll(retired.removedEffects);
+        delete retired.snapshot;
+    }
+    delete m_snapshot.load();
+}
+
+void AudioEffectChain::prepareEffect(AudioEffect *effect) {
+    effect->prepare(m_sampleRate, m_channels, m_maxBlockFrames);
+}
+
+void AudioEffectChain::attachEffect(AudioEffect *effect) {
+    effect->m_chain = this;
+    effect->m_effectId = m_nextEffectId++;
+}
+
+void AudioEffectChain::detachEffect(AudioEffect *effect) {
+    // id 不再复用，音频线程可能仍在旧快照中按 id 查找，因此保留不改；
+    // 新快照中找不到该 id，队列中残留的消息会被丢弃
+    effect->m_chain = nullptr;
+}
+
+void AudioEffectChain::postParameter(AudioEffect *effect, int parameterId, float value) {
+    ParameterUpdate update;
+    update.effectId = effect->m_effectId;
+    update.parameterId = parameterId;
+    update.value = value;
+
+    // 先补发之前因队列满而暂存的更新，保持先后顺序
+    if (flushOverflowUpdates() && m_parameterQueue.push(update)) return;
+
+    // 音频线程长时间未取走消息（例如暂停中）时在 UI 侧合并，只保留每个参数的最新值
+    for (ParameterUpdate &pending : m_overflowUpdates) {
+        if (pending.effectId == update.effectId && pending.parameterId == update.parameterId) {
+            pending.value = update.value;
+            return;
+        }
+    }
+    m_overflowUpdates.append(update);
+    if (!m_overflowTimer->isActive()) m_overflowTimer->start();
+}
+
+bool AudioEffectChain::flushOverflowUpdates() {
+    while (!m_overflowUpdates.isEmpty() && m_parameterQueue.push(m_overflowUpdates.first())) {
+        m_overflowUpdates.removeFirst();
+    }
+    return m_overflowUpdates.isEmpty();
+}
+
+void AudioEffectChain::applyPendingParameters() {
+    ParameterUpdate update;
+    while (m_parameterQueue.pop(update)) {
+        // 出队之后再读快照：投递前已发布的效果器一定能找到
+        const ChainSnapshot *snapshot = m_snapshot.load(std::memory_order_acquire);
+        for (AudioEffect *effect : snapshot->effects) {
+            if (effect->m_effectId == update.effectId) {
+                effect->applyParameter(update.parameterId, update.value);
+                break;
+            }
+        }
+    }
+}
+
+void AudioEffectChain::publishSnapshot(const QVector<AudioEffect*> &removed) {
+    ChainSnapshot *snapshot = new ChainSnapshot;
+    snapshot->effects = m_effects;
+    snapshot->sampleRate = m_sampleRate;
+    snapshot->channels = m_channels;
+    snapshot->blockBuffer.setSize(m_channels, m_maxBlockFrames);
+
+    RetiredSnapshot retired;
+    retired.snapshot = m_snapshot.exchange(snapshot);
+    retired.removedEffects = removed;
+    // 必须在交换之后读取纪元：若此时为偶数，音频线程下一次进入必然读到新快照；
+    // 若为奇数，等纪元变化（离开当前块）后旧快照才不再被引用
+    retired.epoch = m_audioEpoch.load();
+    m_retired.append(retired);
+
+    for (AudioEffect *effect : removed) {
+        detachEffect(effect);
+    }
+}
+
+void AudioEffectChain::reclaimRetired() {
+    QVector<RetiredSnapshot> reclaimable;
+    {
+        QMutexLocker locker(&m_effectsMutex);
+        const quint32 epoch = m_audioEpoch.load();
+        for (int i = 0; i < m_retired.size();) {
+            const quint32 retiredEpoch = m_retired[i].epoch;
+            if ((retiredEpoch & 1u) == 0 || retiredEpoch != epoch) {
+                reclaimable.append(m_retired.takeAt(i));
+            } else {
+                ++i;
+            }
+        }
+        if (m_retired.isEmpty()) {
+            m_reclaimTimer->stop();
+        } else if (!m_reclaimTimer->isActive()) {
+            m_reclaimTimer->start();
+        }
+    }
+
+    // 在非实时线程释放，析构效果器的开销不会落到音频线程
+    for (const RetiredSnapshot &retired : reclaimable) {
+        qDeleteAll(retired.removedEffects);
+        delete retired.snapshot;
+    }
+}
+
+void AudioEffectChain::addEffect(AudioEffect *effect) {
+    insertEffect(getEffectCount(), effect);
+}
+
+void AudioEffectChain::insertEffect(int index, AudioEffect *effect) {
+    if (!effect) return;
+    {
+        QMutexLocker locker(&m_effectsMutex);
+        // 在发布之前完成分配，音频线程看到的效果器总是已就绪的
+        prepareEffect(effect);
+        effect->setParent(this);
+        attachEffect(effect);
+        index = qBound(0, index, m_effects.size());
+        m_effects.insert(index, effect);
+        publishSnapshot();
+    }
+    reclaimRetired();
+    emit effectAdded(index, effect);
+    emit chainChanged();
+}
+
+void AudioEffectChain::removeEffect(int index) {
+    {
+        QMutexLocker locker(&m_effectsMutex);
+        if (index < 0 || index >= m_effects.size()) return;
+        QVector<AudioEffect*> removed;
+        removed.append(m_effects.takeAt(index));
+        publishSnapshot(removed);
+    }
+    reclaimRetired();
+    emit effectRemoved(index);
+    emit chainChanged();
+}
+
+void AudioEffectChain::removeEffect(AudioEffect *effect) {
+    int index = -1;
+    {
+        QMutexLocker locker(&m_effectsMutex);
+        index = m_effects.indexOf(effect);
+    }
+    removeEffect(index);
+}
+
+void AudioEffectChain::moveEffect(int from, int to) {
+    {
+        QMutexLocker locker(&m_effectsMutex);
+        if (from < 0 || from >= m_effects.size() || to < 0 || to >= m_effects.size() || from == to) return;
+        m_effects.move(from, to);
+        publishSnapshot();
+    }
+    reclaimRetired();
+    emit effectMoved(from, to);
+    emit chainChanged();
+}
+
+void AudioEffectChain::clearEffects() {
+    {
+        QMutexLocker locker(&m_effectsMutex);
+        if (m_effects.isEmpty()) return;
+        QVector<AudioEffect*> removed;
+        removed.swap(m_effects);
+        publishSnapshot(removed);
+    }
+    reclaimRetired();
+    emit chainChanged();
+}
+
+void AudioEffectChain::setEffectEnabled(int index, bool enabled) {
+    if (AudioEffect *effect = getEffect(index)) {
+        effect->setEnabled(enabled);
+    }
+}
+
+void AudioEffectChain::setEffectParameter(int index, const QString &parameter, float value) {
+    if (AudioEffect *effect = getEffect(index)) {
+        effect->setParameter(parameter, value);
+    }
+}
+
+void AudioEffectChain::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    {
+        // 与拓扑修改互斥，保证新加入的效果器按最新格式分配
+        QMutexLocker locker(&m_effectsMutex);
+        // 先发布不含效果器的快照，音频线程离开旧快照后效果器不再被引用，才能重新分配
+        const QVector<AudioEffect*> effects = m_effects;
+        m_effects.clear();
+        publishSnapshot();
+        waitForAudioThread();
+
+        m_sampleRate = sampleRate;
+        m_channels = qMax(channels, 1);
+        m_maxBlockFrames = qMax(maxBlockFrames, 1);
+        for (AudioEffect *effect : effects) {
+            prepareEffect(effect);
+        }
+        m_effects = effects;
+        publishSnapshot();
+    }
+    reclaimRetired();
+}
+
+void AudioEffectChain::waitForAudioThread() const {
+    // 纪元为偶数说明音频线程不在块内，下一次进入必然读到已发布的快照
+    const quint32 epoch = m_audioEpoch.load();
+    if ((epoch & 1u) == 0) return;
+    while (m_audioEpoch.load() == epoch) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+void AudioEffectChain::applyRequestedFormat() {
+    const qint64 format = m_requestedFormat.exchange(0, std::memory_order_relaxed);
+    if (format == 0) return;
+    const int sampleRate = int(format >> 8);
+    const int channels = int(format & 0xff);
+    if (sampleRate != m_sampleRate || channels != m_channels) {
+        prepare(sampleRate, channels, m_maxBlockFrames);
+    }
+}
+
+void AudioEffectChain::processBlock(const AudioBlock &block) {
+    // 进入时纪元变为奇数，离开时恢复偶数；期间读到的快照不会被回收
+    m_audioEpoch.fetch_add(1);
+    runEffects(m_snapshot.load(), block);
+    m_audioEpoch.fetch_add(1, std::memory_order_release);
+}
+
+void AudioEffectChain::runEffects(const ChainSnapshot *snapshot, const AudioBlock &block) {
+    applyPendingParameters();
+    if (m_resetPending.exchange(false, std::memory_order_acquire)) {
+        for (AudioEffect *effect : snapshot->effects) {
+            effect->reset();
+        }
+    }
+    int latency = 0;
+    for (AudioEffect *effect : snapshot->effects) {
+        if (effect->isEnabled()) {
+            effect->processBlock(block);
+            latency += effect->latency();
+        }
+    }
+    m_latency.store(latency, std::memory_order_relaxed);
+}
+
+void AudioEffectChain::processAudio(QVector<float> &audioData, int channels, int sampleRate) {
+    if (channels <= 0) return;
+    processAudio(audioData.data(), audioData.size() / channels, channels, sampleRate);
+}
+
+void AudioEffectChain::processAudio(float *interleaved, int frames, int channels, int sampleRate) {
+    if (!interleaved || channels <= 0 || frames <= 0) return;
+    m_audioEpoch.fetch_add(1);
+    ChainSnapshot *snapshot = m_snapshot.load();
+    if (channels != snapshot->channels || sampleRate != snapshot->sampleRate) {
+        // 只在流格式变化时发生（新曲目开始）：原样输出，由控制线程按新格式准备后再处理
+        if (channels <= 0xff) {
+            m_requestedFormat.store((qint64(sampleRate) << 8) | channels, std::memory_order_relaxed);
+        }
+        m_audioEpoch.fetch_add(1, std::memory_order_release);
+        return;
+    }
+
+    // 交错数据按块拆成平面缓冲，整条链在同一块上就地处理
+    AudioBuffer &buffer = snapshot->blockBuffer;
+    const int blockFrames = buffer.capacity();
+    for (int offset = 0; offset < frames; offset += blockFrames) {
+        const int count = qMin(blockFrames, frames - offset);
+        float *chunk = interleaved + offset * channels;
+        buffer.deinterleave(chunk, count);
+        runEffects(snapshot, buffer.block(count));
+        buffer.interleave(chunk, count);
+    }
+    m_audioEpoch.fetch_add(1, std::memory_order_release);
+}
+
+void AudioEffectChain::reset() {
+    m_resetPending.store(true, std::memory_order_release);
+}
+
+int AudioEffectChain::getEffectCount() const {
+    QMutexLocker locker(&m_effectsMutex);
+    return m_effects.size();
+}
+
+AudioEffect* AudioEffectChain::getEffect(int index) const {
+    QMutexLocker locker(&m_effectsMutex);
+    return m_effects.value(index, nullptr);
+}
+
+QVector<AudioEffect*> AudioEffectChain::getAllEffects() const {
+    QMutexLocker locker(&m_effectsMutex);
+    return m_effects;
+}
+
+void AudioEffectChain::saveChainPreset(const QString &name) {
+    m_chainPresets[name] = toJson();
+}
+
+void AudioEffectChain::loadChainPreset(const QString &name) {
+    if (m_chainPresets.contains(name)) {
+        fromJson(m_chainPresets.value(name));
+    }
+}
+
+QStringList AudioEffectChain::getChainPresets() const {
+    return m_chainPresets.keys();
+}
+
+QJsonObject AudioEffectChain::toJson() const {
+    QJsonArray effects;
+    for (AudioEffect *effect : getAllEffects()) {
+        effects.append(effect->toJson());
+    }
+    QJsonObject json;
+    json["effects"] = effects;
+    return json;
+}
+
+void AudioEffectChain::fromJson(const QJsonObject &json) {
+    clearEffects();
+    for (const QJsonValue &value : json["effects"].toArray()) {
+        QJsonObject effectJson = value.toObject();
+        AudioEffect *effect = AudioEffect::create(static_cast<AudioEffect::EffectType>(effectJson["type"].toInt()));
+        if (!effect) continue;
+        effect->fromJson(effectJson);
+        addEffect(effect);
+    }
+}
@@ -0,0 +1,344 @@
+#include "../include/audio_feature_extractor.h"
+#include "../include/fast_math.h"
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+const int kFrameSize = 2048;
+const int kMelBands = 40;
+const float kCompression = 1e4f;
+const double kChromaMinFreq = 100.0;
+const double kChromaMaxFreq = 5000.0;
+const double kSpectralMaxFreq = 8000.0;
+const double kRolloffFraction = 0.85;
+const float kSilenceRms = 1e-3f;        // -60 dBFS
+const double kMinTempo = 50.0;
+const double kMaxTempo = 220.0;
+const double kTempoPriorCenter = 120.0;
+const double kTempoPriorOctaves = 0.9;
+
+// Krumhansl-Kessler 调性轮廓，主音在下标 0
+const double kMajorProfile[12] = {6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88};
+const double kMinorProfile[12] = {6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17};
+
+double correlate(const double *chroma, int tonic, const double *profile) {
+    double meanC = 0.0, meanP = 0.0;
+    for (int i = 0; i < 12; ++i) {
+        meanC += chroma[i];
+        meanP += profile[i];
+    }
+    meanC /= 12.0;
+    meanP /= 12.0;
+    double cov = 0.0, varC = 0.0, varP = 0.0;
+    for (int i = 0; i < 12; ++i) {
+        const double c = chroma[(i + tonic) % 12] - meanC;
+        const double p = profile[i] - meanP;
+        cov += c * p;
+        varC += c * c;
+        varP += p * p;
+    }
+    return varC > 0.0 ? cov / std::sqrt(varC * varP) : 0.0;
+}
+
+double percentile(QVector<float> values, double fraction) {
+    if (values.isEmpty()) return 0.0;
+    const int index = qBound(0, int(fraction * (values.size() - 1)), values.size() - 1);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+}
+
+AudioFeatureExtractor::AudioFeatureExtractor(int sampleRate)
+    : m_sampleRate(qMax(sampleRate, 8000))
+    , m_frameSize(kFrameSize)
+    , m_hopSize(kFrameSize / 4)
+    , m_fft(kFrameSize)
+    , m_loudness(m_sampleRate, 1)
+    , m_pendingCount(0)
+    , m_spectralMaxBin(0)
+{
+    m_window.resize(m_frameSize);
+    for (int i = 0; i < m_frameSize; ++i) {
+        m_window[i] = float(0.5 - 0.5 * std::cos(2.0 * M_PI * i / m_frameSize));
+    }
+    m_pending.resize(m_frameSize);
+    m_windowed.resize(m_frameSize);
+    m_re.resize(m_fft.binCount());
+    m_im.resize(m_fft.binCount());
+    m_power.resize(m_fft.binCount());
+    m_bandPower.resize(kMelBands);
+
+    m_melBands.configure(m_frameSize, m_sampleRate, 30.0f, m_sampleRate * 0.5f, kMelBands, SpectrumBandMapper::Mel);
+
+    const double binHz = double(m_sampleRate) / m_frameSize;
+    for (int k = 1; k < m_fft.binCount(); ++k) {
+        const double f = k * binHz;
+        if (f < kChromaMinFreq || f > kChromaMaxFreq) continue;
+        const int midi = int(std::lround(12.0 * std::log2(f / 440.0) + 69.0));
+        m_chromaBins.append(k);
+        m_chromaClasses.append(midi % 12);
+    }
+    m_spectralMaxBin = qMin(m_fft.binCount() - 1, int(kSpectralMaxFreq / binHz));
+    reset();
+}
+
+void AudioFeatureExtractor::reset() {
+    m_pendingCount = 0;
+    m_loudness = LoudnessAnalyzer(m_sampleRate, 1);
+    m_previousBands.clear();
+    std::fill(m_chroma, m_chroma + 12, 0.0);
+    m_centroidSum = 0.0;
+    m_rolloffSum = 0.0;
+    m_flatnessSum = 0.0;
+    m_spectralFrames = 0;
+    m_zeroCrossings = 0.0;
+    m_onsetEnvelope.clear();
+    m_hopRms.clear();
+    m_samples = 0;
+}
+
+void AudioFeatureExtractor::process(const float *samples, int count) {
+    if (!samples || count <= 0) return;
+    m_loudness.process(samples, count);
+    m_samples += count;
+
+    float *pending = m_pending.data();
+    while (count > 0) {
+        const int take = qMin(count, m_frameSize - m_pendingCount);
+        std::memcpy(pending + m_pendingCount, samples, size_t(take) * sizeof(float));
+        m_pendingCount += take;
+        samples += take;
+        count -= take;
+        if (m_pendingCount == m_frameSize) {
+            analyzeFrame(pending);
+            std::memmove(pending, pending + m_hopSize, size_t(m_frameSize - m_hopSize) * sizeof(float));
+            m_pendingCount -= m_hopSize;
+        }
+    }
+}
+
+void AudioFeatureExtractor::analyzeFrame(const float *frame) {
+    // 时域：只统计帧内最新的一跳，每个样本计一次
+    const float *hop = frame + m_frameSize - m_hopSize;
+    double energy = 0.0;
+    int crossings = 0;
+    for (int i = 0; i < m_hopSize; ++i) {
+        energy += double(hop[i]) * hop[i];
+        if (i > 0 && (hop[i] >= 0.0f) != (hop[i - 1] >= 0.0f)) ++crossings;
+    }
+    const float rms = float(std::sqrt(energy / m_hopSize));
+    m_hopRms.append(rms);
+    m_zeroCrossings += crossings;
+
+    const float *window = m_window.constData();
+    float *windowed = m_windowed.data();
+    for (int i = 0; i < m_frameSize; ++i) windowed[i] = frame[i] * window[i];
+    m_fft.forward(windowed, m_re.data(), m_im.data());
+    const float *re = m_re.constData();
+    const float *im = m_im.constData();
+    float *power = m_power.data();
+    const int bins = m_fft.binCount();
+    for (int k = 0; k < bins; ++k) power[k] = re[k] * re[k] + im[k] * im[k];
+
+    // 起音包络：压缩 mel 谱的半波整流差分
+    m_melBands.apply(power, m_bandPower.data());
+    const float *bands = m_bandPower.constData();
+    float flux = 0.0f;
+    if (m_previousBands.isEmpty()) {
+        m_previousBands.resize(kMelBands);
+        for (int b = 0; b < kMelBands; ++b) m_previousBands[b] = FastMath::log2(1.0f + kCompression * bands[b]);
+    } else {
+        float *previous = m_previousBands.data();
+        for (int b = 0; b < kMelBands; ++b) {
+            const float compressed = FastMath::log2(1.0f + kCompression * bands[b]);
+            flux += qMax(compressed - previous[b], 0.0f);
+            previous[b] = compressed;
+        }
+    }
+    m_onsetEnvelope.append(flux / kMelBands);
+
+    if (rms < kSilenceRms) return;
+
+    // 色度：逐帧按最大值归一化后累加，响的段落不主导调性判断
+    double chroma[12] = {0.0};
+    const int chromaCount = m_chromaBins.size();
+    const int *chromaBins = m_chromaBins.constData();
+    const int *chromaClasses = m_chromaClasses.constData();
+    for (int i = 0; i < chromaCount; ++i) chroma[chromaClasses[i]] += std::sqrt(power[chromaBins[i]]);
+    const double chromaMax = *std::max_element(chroma, chroma + 12);
+    if (chromaMax > 0.0) {
+        for (int c = 0; c < 12; ++c) m_chroma[c] += chroma[c] / chromaMax;
+    }
+
+    // 频谱形状
+    const double binHz = double(m_sampleRate) / m_frameSize;
+    double magSum = 0.0, weighted = 0.0, powerSum = 0.0, logSum = 0.0;
+    for (int k = 1; k <= m_spectralMaxBin; ++k) {
+        const double magnitude = std::sqrt(power[k]);
+        magSum += magnitude;
+        weighted += magnitude * k;
+        powerSum += power[k];
+        logSum += FastMath::log2(power[k] + FastMath::MinLevel);
+    }
+    if (powerSum <= 0.0) return;
+    const double rolloffTarget = powerSum * kRolloffFraction;
+    double cumulative = 0.0;
+    int rolloffBin = m_spectralMaxBin;
+    for (int k = 1; k <= m_spectralMaxBin; ++k) {
+        cumulative += power[k];
+        if (cumulative >= rolloffTarget) {
+            rolloffBin = k;
+            break;
+        }
+    }
+    const double geometricMean = std::exp2(logSum / m_spectralMaxBin);
+    m_centroidSum += weighted / magSum * binHz;
+    m_rolloffSum += rolloffBin * binHz;
+    m_flatnessSum += qBound(0.0, geometricMean / (powerSum / m_spectralMaxBin), 1.0);
+    ++m_spectralFrames;
+}
+
+double AudioFeatureExtractor::estimateTempo(double *strength) const {
+    *strength = 0.0;
+    const double frameRate = double(m_sampleRate) / m_hopSize;
+    const int minLag = qMax(1, int(std::floor(frameRate * 60.0 / kMaxTempo)));
+    const int maxLag = int(std::ceil(frameRate * 60.0 / kMinTempo));
+    const int count = m_onsetEnvelope.size();
+    if (count < 4 * maxLag) return 0.0;
+
+    // 减去约一秒的滑动均值（高通），自相关只反映周期性而不是整体响度起伏
+    const float *envelope = m_onsetEnvelope.constData();
+    QVector<double> prefix(count + 1, 0.0);
+    for (int i = 0; i < count; ++i) prefix[i + 1] = prefix[i] + envelope[i];
+    const int half = qMax(1, int(frameRate / 2));
+    QVector<float> detrended(count);
+    for (int i = 0; i < count; ++i) {
+        const int lo = qMax(0, i - half);
+        const int hi = qMin(count, i + half + 1);
+        detrended[i] = float(envelope[i] - (prefix[hi] - prefix[lo]) / (hi - lo));
+    }
+
+    const int lags = 2 * maxLag + 2;
+    QVector<double> ac(lags, 0.0);
+    const float *d = detrended.constData();
+    for (int lag = 0; lag < lags; ++lag) {
+        double sum = 0.0;
+        for (int i = lag; i < count; ++i) sum += double(d[i]) * d[i - lag];
+        ac[lag] = sum / (count - lag);
+    }
+    if (ac[0] <= 0.0) return 0.0;
+
+    // 对数域高斯先验（中心 120 BPM）加二倍周期项，压制倍频/半频误判
+    int best = -1;
+    double bestScore = 0.0;
+    for (int lag = minLag; lag <= maxLag; ++lag) {
+        const double octaves = std::log2(60.0 * frameRate / lag / kTempoPriorCenter) / kTempoPriorOctaves;
+        const double score = std::exp(-0.5 * octaves * octaves) * (ac[lag] + 0.5 * ac[2 * lag]);
+        if (score > bestScore) {
+            bestScore = score;
+            best = lag;
+        }
+    }
+    if (best < 0) return 0.0;
+
+    // 抛物线插值得到小数周期，整数周期在 120 BPM 附近的量化误差约 5 BPM
+    double period = best;
+    const double left = ac[best - 1], center = ac[best], right = ac[best + 1];
+    const double denominator = left - 2.0 * center + right;
+    if (denominator < 0.0) period += qBound(-0.5, 0.5 * (left - right) / denominator, 0.5);
+    *strength = qBound(0.0, center / ac[0], 1.0);
+    return 60.0 * frameRate / period;
+}
+
+void AudioFeatureExtractor::estimateKey(Result &result) const {
+    double best = -2.0, second = -2.0;
+    for (int tonic = 0; tonic < 12; ++tonic) {
+        for (int mode = 0; mode < 2; ++mode) {
+            const double r = correlate(m_chroma, tonic, mode == 0 ? kMajorProfile : kMinorProfile);
+            if (r > best) {
+                second = best;
+                best = r;
+                result.keyIndex = tonic;
+                result.major = mode == 0;
+            } else if (r > second) {
+                second = r;
+            }
+        }
+    }
+    result.keyClarity = qMax(0.0, best - second);
+}
+
+AudioFeatureExtractor::Result AudioFeatureExtractor::finish() {
+    Result result;
+    // 尾部补零凑满最后一帧
+    if (m_pendingCount > m_frameSize - m_hopSize) {
+        std::fill(m_pending.begin() + m_pendingCount, m_pending.end(), 0.0f);
+        analyzeFrame(m_pending.constData());
+    }
+    m_pendingCount = 0;
+    if (m_samples == 0) return result;
+
+    result.valid = true;
+    result.durationSec = double(m_samples) / m_sampleRate;
+    const LoudnessInfo loudness = m_loudness.result();
+    if (loudness.valid) result.loudnessLufs = loudness.integratedLufs;
+    result.zeroCrossingRate = m_zeroCrossings / qMax<qint64>(1, m_hopRms.size() * qint64(m_hopSize));
+
+    if (m_spectralFrames > 0) {
+        result.spectralCentroid = m_centroidSum / m_spectralFrames;
+        result.spectralRolloff = m_rolloffSum / m_spectralFrames;
+        result.spectralFlatness = m_flatnessSum / m_spectralFrames;
+        estimateKey(result);
+    }
+    result.tempo = estimateTempo(&result.beatStrength);
+
+    // 跳 RMS 统计：只看非静音部分
+    QVector<float> levels;
+    levels.reserve(m_hopRms.size());
+    double energy = 0.0;
+    for (float rms : m_hopRms) {
+        if (rms < kSilenceRms) continue;
+        levels.append(FastMath::linearToDb(rms));
+        energy += double(rms) * rms;
+    }
+    if (!levels.isEmpty()) {
+        result.rmsDb = 10.0 * std::log10(energy / levels.size());
+        result.dynamicRangeDb = percentile(levels, 0.95) - percentile(levels, 0.10);
+    }
+
+    const int hops = m_hopRms.size();
+    const double frameRate = double(m_sampleRate) / m_hopSize;
+    if (hops > 0) {
+        QVector<double> prefix(hops + 1, 0.0);
+        for (int i = 0; i < hops; ++i) prefix[i + 1] = prefix[i] + m_hopRms[i];
+        const int half = qMax(1, int(frameRate / 2));
+        int low = 0, active = 0;
+        for (int i = 0; i < hops; ++i) {
+            const int lo = qMax(0, i - half);
+            const int hi = qMin(hops, i + half + 1);
+            const double localMean = (prefix[hi] - prefix[lo]) / (hi - lo);
+            if (localMean < kSilenceRms) continue;
+            ++active;
+            if (m_hopRms[i] < 0.5 * localMean) ++low;
+        }
+        result.lowEnergyRatio = active > 0 ? double(low) / active : 0.0;
+
+        // 起音计数：包络超过全曲均值 + 1.5 倍标准差的局部极大
+        double mean = 0.0, squares = 0.0;
+        for (float v : m_onsetEnvelope) {
+            mean += v;
+            squares += double(v) * v;
+        }
+        mean /= hops;
+        const double threshold = mean + 1.5 * std::sqrt(qMax(0.0, squares / hops - mean * mean));
+        int onsets = 0;
+        for (int i = 1; i + 1 < hops; ++i) {
+            const float v = m_onsetEnvelope[i];
+            if (v > threshold && v >= m_onsetEnvelope[i - 1] && v > m_onsetEnvelope[i + 1]) ++onsets;
+        }
+        result.onsetRate = onsets / result.durationSec;
+    }
+    return result;
+}
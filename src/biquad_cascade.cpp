@@ -0,0 +1,282 @@
+#include "../include/biquad_cascade.h"
+#include "biquad_wavefront.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BIQUAD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BIQUAD_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(ENABLE_AVX2_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+typedef void (*KernelFunction)(const float *, const float *, int, float *, int, float *, int);
+
+int laneWidth(BiquadCascade::Kernel kernel) {
+    switch (kernel) {
+    case BiquadCascade::Avx2Kernel: return 8;
+    case BiquadCascade::Sse2Kernel:
+    case BiquadCascade::NeonKernel: return 4;
+    case BiquadCascade::ScalarKernel: break;
+    }
+    return 1;
+}
+
+bool cpuSupportsAvx2() {
+#if defined(ENABLE_AVX2_KERNELS)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma) return false;
+    // 操作系统需保存 YMM 寄存器状态
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#else
+    return false;
+#endif
+}
+
+BiquadCascade::Kernel detectKernel() {
+    if (cpuSupportsAvx2()) return BiquadCascade::Avx2Kernel;
+#if defined(BIQUAD_HAVE_SSE2)
+    return BiquadCascade::Sse2Kernel;
+#elif defined(BIQUAD_HAVE_NEON)
+    return BiquadCascade::NeonKernel;
+#else
+    return BiquadCascade::ScalarKernel;
+#endif
+}
+
+KernelFunction kernelFunction(BiquadCascade::Kernel kernel) {
+    switch (kernel) {
+#if defined(ENABLE_AVX2_KERNELS)
+    case BiquadCascade::Avx2Kernel: return BiquadKernels::processAvx2;
+#endif
+#if defined(BIQUAD_HAVE_SSE2)
+    case BiquadCascade::Sse2Kernel: return BiquadKernels::processSse2;
+#endif
+#if defined(BIQUAD_HAVE_NEON)
+    case BiquadCascade::NeonKernel: return BiquadKernels::processNeon;
+#endif
+    default: break;
+    }
+    return BiquadKernels::processScalar;
+}
+
+#if defined(BIQUAD_HAVE_SSE2)
+struct Sse2Ops {
+    typedef __m128 Reg;
+    typedef __m128 Mask;
+    static const int Width = 4;
+
+    static Reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Reg a) { _mm_storeu_ps(p, a); }
+    static Reg zero() { return _mm_setzero_ps(); }
+    static Reg set1(float v) { return _mm_set1_ps(v); }
+    static Reg ramp(float k) { return _mm_setr_ps(k, k + 1.0f, k + 2.0f, k + 3.0f); }
+    static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Reg nmadd(Reg a, Reg b, Reg c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+    static Mask lessEqual(Reg a, Reg b) { return _mm_cmple_ps(a, b); }
+    static Mask greater(Reg a, Reg b) { return _mm_cmpgt_ps(a, b); }
+    static Mask maskAnd(Mask a, Mask b) { return _mm_and_ps(a, b); }
+    static Reg select(Mask m, Reg a, Reg b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    // (c3, a0, a1, a2)
+    static Reg shiftUp(Reg a, Reg c) {
+        return _mm_move_ss(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 1, 0, 3)),
+                           _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    static float lastLane(Reg a) { return _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3))); }
+};
+#endif
+
+#if defined(BIQUAD_HAVE_NEON)
+struct NeonOps {
+    typedef float32x4_t Reg;
+    typedef uint32x4_t Mask;
+    static const int Width = 4;
+
+    static Reg load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, Reg a) { vst1q_f32(p, a); }
+    static Reg zero() { return vdupq_n_f32(0.0f); }
+    static Reg set1(float v) { return vdupq_n_f32(v); }
+    static Reg ramp(float k) {
+        const float values[4] = {k, k + 1.0f, k + 2.0f, k + 3.0f};
+        return vld1q_f32(values);
+    }
+    static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return vmlaq_f32(c, a, b); }
+    static Reg nmadd(Reg a, Reg b, Reg c) { return vmlsq_f32(c, a, b); }
+    static Mask lessEqual(Reg a, Reg b) { return vcleq_f32(a, b); }
+    static Mask greater(Reg a, Reg b) { return vcgtq_f32(a, b); }
+    static Mask maskAnd(Mask a, Mask b) { return vandq_u32(a, b); }
+    static Reg select(Mask m, Reg a, Reg b) { return vbslq_f32(m, a, b); }
+    static Reg shiftUp(Reg a, Reg c) { return vextq_f32(c, a, 3); }
+    static float lastLane(Reg a) { return vgetq_lane_f32(a, 3); }
+};
+#endif
+}
+
+namespace BiquadKernels {
+void processScalar(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                   float *samples, int frames) {
+    float *s1 = state;
+    float *s2 = state + lanes;
+    // 斜坡期间系数逐样本变化，使用局部副本（超过 64 级时退化为按块更新）
+    float c[5 * 64];
+    const bool ramping = rampSteps > 0 && lanes <= 64;
+    if (ramping) std::memcpy(c, coeffs, sizeof(float) * 5 * lanes);
+    const float *b = ramping ? c : coeffs;
+
+    for (int i = 0; i < frames; ++i) {
+        float x = samples[i];
+        for (int k = 0; k < lanes; ++k) {
+            const float y = b[k] * x + s1[k];
+            s1[k] = b[lanes + k] * x - b[3 * lanes + k] * y + s2[k];
+            s2[k] = b[2 * lanes + k] * x - b[4 * lanes + k] * y;
+            x = y;
+        }
+        samples[i] = x;
+        if (ramping && i < rampSteps) {
+            for (int k = 0; k < 5 * lanes; ++k) c[k] += deltas[k];
+        }
+    }
+}
+
+#if defined(BIQUAD_HAVE_SSE2)
+void processSse2(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                 float *samples, int frames) {
+    wavefrontProcess<Sse2Ops, 4>(coeffs, deltas, rampSteps, state, lanes, samples, frames);
+}
+#endif
+
+#if defined(BIQUAD_HAVE_NEON)
+void processNeon(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                 float *samples, int frames) {
+    wavefrontProcess<NeonOps, 4>(coeffs, deltas, rampSteps, state, lanes, samples, frames);
+}
+#endif
+}
+
+// BiquadCascade Implementation
+BiquadCascade::BiquadCascade()
+    : m_stages(0)
+    , m_lanes(0)
+    , m_channels(0)
+    , m_rampLength(0)
+    , m_rampRemaining(0)
+{
+}
+
+void BiquadCascade::setSize(int stages, int channels) {
+    const int width = laneWidth(activeKernel());
+    m_stages = qMax(stages, 0);
+    m_channels = qMax(channels, 0);
+    m_lanes = (m_stages + width - 1) / width * width;
+
+    m_coeffs.fill(0.0f, 5 * m_lanes);
+    m_targets.fill(0.0f, 5 * m_lanes);
+    m_deltas.fill(0.0f, 5 * m_lanes);
+    m_state.fill(0.0f, m_channels * 2 * m_lanes);
+    m_rampRemaining = 0;
+    // 补齐的级为直通
+    for (int k = 0; k < m_lanes; ++k) {
+        setBypass(k);
+    }
+}
+
+void BiquadCascade::setCoefficients(int stage, float b0, float b1, float b2, float a1, float a2) {
+    if (stage < 0 || stage >= m_lanes) return;
+    const float values[5] = {b0, b1, b2, a1, a2};
+    for (int i = 0; i < 5; ++i) {
+        m_coeffs[i * m_lanes + stage] = values[i];
+        m_targets[i * m_lanes + stage] = values[i];
+        m_deltas[i * m_lanes + stage] = 0.0f;
+    }
+}
+
+void BiquadCascade::setTargetCoefficients(int stage, float b0, float b1, float b2, float a1, float a2) {
+    if (stage < 0 || stage >= m_lanes) return;
+    if (m_rampLength <= 0) {
+        setCoefficients(stage, b0, b1, b2, a1, a2);
+        return;
+    }
+    const float values[5] = {b0, b1, b2, a1, a2};
+    for (int i = 0; i < 5; ++i) {
+        m_targets[i * m_lanes + stage] = values[i];
+    }
+    // 所有级从当前系数重新开始一段完整斜坡，保证同时到达目标
+    const float scale = 1.0f / m_rampLength;
+    for (int i = 0; i < m_coeffs.size(); ++i) {
+        m_deltas[i] = (m_targets[i] - m_coeffs[i]) * scale;
+    }
+    m_rampRemaining = m_rampLength;
+}
+
+void BiquadCascade::setBypass(int stage) {
+    setCoefficients(stage, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void BiquadCascade::setRampLength(int samples) {
+    m_rampLength = qMax(samples, 0);
+}
+
+void BiquadCascade::reset() {
+    std::memset(m_state.data(), 0, sizeof(float) * m_state.size());
+}
+
+void BiquadCascade::process(float *const *channels, int channelCount, int frames) {
+    if (m_lanes == 0 || frames <= 0) return;
+    static const KernelFunction kernel = kernelFunction(activeKernel());
+    const int rampSteps = qMin(m_rampRemaining, frames);
+    const float *coeffs = m_coeffs.constData();
+    const float *deltas = m_deltas.constData();
+    float *state = m_state.data();
+
+    // 各声道从相同的系数出发，斜坡在内核的寄存器中推进
+    channelCount = qMin(channelCount, m_channels);
+    for (int ch = 0; ch < channelCount; ++ch) {
+        kernel(coeffs, deltas, rampSteps, state + ch * 2 * m_lanes, m_lanes, channels[ch], frames);
+    }
+
+    if (rampSteps == 0) return;
+    m_rampRemaining -= rampSteps;
+    float *c = m_coeffs.data();
+    if (m_rampRemaining == 0) {
+        // 斜坡结束时对齐目标，消除累加误差
+        std::memcpy(c, m_targets.constData(), sizeof(float) * m_coeffs.size());
+    } else {
+        for (int i = 0; i < m_coeffs.size(); ++i) c[i] += deltas[i] * rampSteps;
+    }
+}
+
+BiquadCascade::Kernel BiquadCascade::activeKernel() {
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+const char *BiquadCascade::kernelName(Kernel kernel) {
+    switch (kernel) {
+    case ScalarKernel: return "scalar";
+    case Sse2Kernel: return "sse2";
+    case Avx2Kernel: return "avx2";
+    case NeonKernel: return "neon";
+    }
+    return "unknown";
+}
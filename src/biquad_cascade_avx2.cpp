@@ -0,0 +1,45 @@
+// 本文件以 AVX2/FMA 编译选项单独构建，只在运行时检测到对应 CPU 特性后才会被调用。
+// 这里不要调用 Qt 或标准库的内联模板函数，以免高指令集的实例被链接器合并给其它源文件使用。
+#include "../include/biquad_cascade.h"
+#include "biquad_wavefront.h"
+#include <immintrin.h>
+
+namespace {
+struct Avx2Ops {
+    typedef __m256 Reg;
+    typedef __m256 Mask;
+    static const int Width = 8;
+
+    static Reg load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, Reg a) { _mm256_storeu_ps(p, a); }
+    static Reg zero() { return _mm256_setzero_ps(); }
+    static Reg set1(float v) { return _mm256_set1_ps(v); }
+    static Reg ramp(float k) {
+        return _mm256_setr_ps(k, k + 1.0f, k + 2.0f, k + 3.0f, k + 4.0f, k + 5.0f, k + 6.0f, k + 7.0f);
+    }
+    static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+    static Reg nmadd(Reg a, Reg b, Reg c) { return _mm256_fnmadd_ps(a, b, c); }
+    static Mask lessEqual(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static Mask greater(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask maskAnd(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Reg select(Mask m, Reg a, Reg b) { return _mm256_blendv_ps(b, a, m); }
+    // (c7, a0, a1, ..., a6)
+    static Reg shiftUp(Reg a, Reg c) {
+        const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+        const __m256i top = _mm256_set1_epi32(7);
+        return _mm256_blend_ps(_mm256_permutevar8x32_ps(a, rotate), _mm256_permutevar8x32_ps(c, top), 0x01);
+    }
+    static float lastLane(Reg a) {
+        return _mm256_cvtss_f32(_mm256_permutevar8x32_ps(a, _mm256_set1_epi32(7)));
+    }
+};
+}
+
+namespace BiquadKernels {
+void processAvx2(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                 float *samples, int frames) {
+    wavefrontProcess<Avx2Ops, 2>(coeffs, deltas, rampSteps, state, lanes, samples, frames);
+}
+}
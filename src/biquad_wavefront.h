@@ -0,0 +1,147 @@
+#pragma once
+
+// 斜波前串联二阶节内核模板，仅供各指令集的内核源文件包含。
+// 不同源文件以不同编译选项构建（如 -mavx2），因此全部放在匿名命名空间中，
+// 避免链接器把高指令集版本的内联实例合并到基础版本里。
+
+namespace {
+
+// V 为指令集封装：Reg/Mask 类型、Width 以及 load/store/madd 等操作
+// coeffs: [5][lanes]，state: [2][lanes]（s1、s2），处理 [base, base + R * Width) 这一组级
+template<class V, int R, bool Masked>
+inline void wavefrontStep(typename V::Reg (&pipe)[R], typename V::Reg (&s1)[R], typename V::Reg (&s2)[R],
+                          const typename V::Reg (&b0)[R], const typename V::Reg (&b1)[R],
+                          const typename V::Reg (&b2)[R], const typename V::Reg (&a1)[R],
+                          const typename V::Reg (&a2)[R], const typename V::Reg (&laneIndex)[R],
+                          float input, int t, int frames)
+{
+    typename V::Reg tVec = V::set1(float(t));
+    typename V::Reg tailVec = V::set1(float(t - frames));
+
+    // 从高到低更新，保证每级读到的是上一级上一步的输出
+    for (int r = R - 1; r >= 0; --r) {
+        typename V::Reg carry = r == 0 ? V::set1(input) : pipe[r - 1];
+        typename V::Reg u = V::shiftUp(pipe[r], carry);
+
+        // 转置直接 II 型
+        typename V::Reg y = V::madd(b0[r], u, s1[r]);
+        typename V::Reg n1 = V::madd(b1[r], u, V::nmadd(a1[r], y, s2[r]));
+        typename V::Reg n2 = V::nmadd(a2[r], y, V::mul(b2[r], u));
+
+        if (Masked) {
+            // 第 k 级在第 t 步处理样本 t - k，仅当 0 <= t - k < frames 时推进状态
+            typename V::Mask active = V::maskAnd(V::lessEqual(laneIndex[r], tVec),
+                                                 V::greater(laneIndex[r], tailVec));
+            s1[r] = V::select(active, n1, s1[r]);
+            s2[r] = V::select(active, n2, s2[r]);
+        } else {
+            s1[r] = n1;
+            s2[r] = n2;
+        }
+        pipe[r] = y;
+    }
+}
+
+// 系数斜坡：每步把各级系数加上对应增量
+template<class V, int R>
+inline void wavefrontRamp(typename V::Reg (&b0)[R], typename V::Reg (&b1)[R], typename V::Reg (&b2)[R],
+                          typename V::Reg (&a1)[R], typename V::Reg (&a2)[R],
+                          const typename V::Reg (&d0)[R], const typename V::Reg (&d1)[R],
+                          const typename V::Reg (&d2)[R], const typename V::Reg (&e1)[R],
+                          const typename V::Reg (&e2)[R])
+{
+    for (int r = 0; r < R; ++r) {
+        b0[r] = V::add(b0[r], d0[r]);
+        b1[r] = V::add(b1[r], d1[r]);
+        b2[r] = V::add(b2[r], d2[r]);
+        a1[r] = V::add(a1[r], e1[r]);
+        a2[r] = V::add(a2[r], e2[r]);
+    }
+}
+
+// coeffs/deltas: [5][lanes]，state: [2][lanes]（s1、s2），处理 [base, base + R * Width) 这一组级。
+// 前 rampSteps 步每步把系数加上 deltas（deltas 为空时 rampSteps 必须为 0）
+template<class V, int R>
+void wavefrontPass(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes, int base,
+                   float *samples, int frames)
+{
+    typedef typename V::Reg Reg;
+    const int lead = R * V::Width - 1;
+
+    Reg b0[R], b1[R], b2[R], a1[R], a2[R];
+    Reg d0[R], d1[R], d2[R], e1[R], e2[R];
+    Reg s1[R], s2[R], pipe[R], laneIndex[R];
+    for (int r = 0; r < R; ++r) {
+        const int offset = base + r * V::Width;
+        b0[r] = V::load(coeffs + offset);
+        b1[r] = V::load(coeffs + lanes + offset);
+        b2[r] = V::load(coeffs + 2 * lanes + offset);
+        a1[r] = V::load(coeffs + 3 * lanes + offset);
+        a2[r] = V::load(coeffs + 4 * lanes + offset);
+        if (rampSteps > 0) {
+            d0[r] = V::load(deltas + offset);
+            d1[r] = V::load(deltas + lanes + offset);
+            d2[r] = V::load(deltas + 2 * lanes + offset);
+            e1[r] = V::load(deltas + 3 * lanes + offset);
+            e2[r] = V::load(deltas + 4 * lanes + offset);
+        } else {
+            d0[r] = d1[r] = d2[r] = e1[r] = e2[r] = V::zero();
+        }
+        s1[r] = V::load(state + offset);
+        s2[r] = V::load(state + lanes + offset);
+        pipe[r] = V::zero();
+        laneIndex[r] = V::ramp(float(r * V::Width));
+    }
+
+    // 前导三角：后面的级尚未拿到样本
+    int t = 0;
+    for (; t < lead; ++t) {
+        const float input = t < frames ? samples[t] : 0.0f;
+        wavefrontStep<V, R, true>(pipe, s1, s2, b0, b1, b2, a1, a2, laneIndex, input, t, frames);
+        if (t < rampSteps) wavefrontRamp<V, R>(b0, b1, b2, a1, a2, d0, d1, d2, e1, e2);
+    }
+    // 主体：所有级同时有效，无掩码；输出比输入落后 lead 个样本，可就地写回
+    const int rampEnd = rampSteps < frames ? rampSteps : frames;
+    for (; t < rampEnd; ++t) {
+        wavefrontStep<V, R, false>(pipe, s1, s2, b0, b1, b2, a1, a2, laneIndex, samples[t], t, frames);
+        wavefrontRamp<V, R>(b0, b1, b2, a1, a2, d0, d1, d2, e1, e2);
+        samples[t - lead] = V::lastLane(pipe[R - 1]);
+    }
+    for (; t < frames; ++t) {
+        wavefrontStep<V, R, false>(pipe, s1, s2, b0, b1, b2, a1, a2, laneIndex, samples[t], t, frames);
+        samples[t - lead] = V::lastLane(pipe[R - 1]);
+    }
+    // 收尾三角：把流水线中剩余的样本推到最后一级
+    for (; t < frames + lead; ++t) {
+        wavefrontStep<V, R, true>(pipe, s1, s2, b0, b1, b2, a1, a2, laneIndex, 0.0f, t, frames);
+        if (t >= lead) samples[t - lead] = V::lastLane(pipe[R - 1]);
+    }
+
+    for (int r = 0; r < R; ++r) {
+        const int offset = base + r * V::Width;
+        V::store(state + offset, s1[r]);
+        V::store(state + lanes + offset, s2[r]);
+    }
+}
+
+// 以最多 MaxRegs 个向量为一组依次处理所有级
+template<class V, int MaxRegs>
+void wavefrontProcess(const float *coeffs, const float *deltas, int rampSteps, float *state, int lanes,
+                      float *samples, int frames)
+{
+    if (frames <= 0) return;
+    for (int base = 0; base < lanes; base += MaxRegs * V::Width) {
+        const int regs = (lanes - base) / V::Width;
+        if (regs >= MaxRegs) {
+            wavefrontPass<V, MaxRegs>(coeffs, deltas, rampSteps, state, lanes, base, samples, frames);
+        } else if (MaxRegs > 3 && regs == 3) {
+            wavefrontPass<V, (MaxRegs > 3 ? 3 : 1)>(coeffs, deltas, rampSteps, state, lanes, base, samples, frames);
+        } else if (MaxRegs > 2 && regs == 2) {
+            wavefrontPass<V, (MaxRegs > 2 ? 2 : 1)>(coeffs, deltas, rampSteps, state, lanes, base, samples, frames);
+        } else {
+            wavefrontPass<V, 1>(coeffs, deltas, rampSteps, state, lanes, base, samples, frames);
+        }
+    }
+}
+
+} // namespace
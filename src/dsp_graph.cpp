@@ -0,0 +1,429 @@
+#include "../include/dsp_graph.h"
+#include "../include/audio_effects.h"
+#include <QHash>
+#include <QThread>
+#include <chrono>
+#include <cstring>
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DSP_GRAPH_HAVE_PAUSE 1
+#endif
+
+namespace {
+const int kRetiredScheduleQueueSize = 4;
+const float kDefaultDeadlineBudget = 0.8f;
+const int kIdleSpins = 256;
+// 挂起的兜底超时：唤醒与挂起交错而错过信号时，最多多等这么久
+const int kParkTimeoutMs = 1;
+
+void cpuRelax() {
+#if defined(DSP_GRAPH_HAVE_PAUSE)
+    _mm_pause();
+#endif
+}
+
+// 绑定到指定核心并尝试提升为实时调度；没有权限时保持普通调度继续运行
+void pinCurrentThread(int cpu) {
+#if defined(Q_OS_LINUX)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    // 比最高优先级低一级，给音频设备线程留出位置
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#elif defined(Q_OS_WIN)
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    Q_UNUSED(cpu)
+#endif
+}
+}
+
+class DspGraph::Worker : public QThread {
+public:
+    Worker(DspGraph *graph, int executor, int cpu)
+        : m_graph(graph), m_executor(executor), m_cpu(cpu) {}
+
+protected:
+    void run() override {
+        pinCurrentThread(m_cpu);
+        m_graph->workerLoop(m_executor);
+    }
+
+private:
+    DspGraph *m_graph;
+    int m_executor;
+    int m_cpu;
+};
+
+DspGraph::DspGraph(int workerCount)
+    : m_nextNodeId(0)
+    , m_schedule(nullptr)
+    , m_pendingSchedule(nullptr)
+    , m_retiredSchedules(kRetiredScheduleQueueSize)
+    , m_periodActive(false)
+    , m_activeExecutors(0)
+    , m_remaining(0)
+    , m_sourceCursor(0)
+    , m_frames(0)
+    , m_parked(0)
+    , m_stopping(false)
+    , m_sampleRate(0)
+    , m_channels(0)
+    , m_maxBlockFrames(0)
+    , m_deadlineBudget(kDefaultDeadlineBudget)
+    , m_periods(0)
+    , m_deadlineMisses(0)
+    , m_lastLoad(0.0f)
+{
+    // 执行线程 0 是调用 process() 的音频线程，工作线程从 1 开始，依次绑定到其余核心
+    const int cpus = qMax(1, QThread::idealThreadCount());
+    if (workerCount < 0) workerCount = cpus - 1;
+    for (int i = 0; i < workerCount; ++i) {
+        m_workers.append(new Worker(this, i + 1, (i + 1) % cpus));
+    }
+    m_schedule = buildSchedule();
+    for (Worker *worker : m_workers) {
+        worker->start();
+    }
+}
+
+DspGraph::~DspGraph() {
+    m_stopping.store(true, std::memory_order_release);
+    m_wake.release(m_workers.size());
+    for (Worker *worker : m_workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    collectRetired();
+    delete m_pendingSchedule.exchange(nullptr);
+    delete m_schedule;
+    qDeleteAll(m_nodes);
+    qDeleteAll(m_removed);
+}
+
+int DspGraph::addNode(AudioEffectChain *chain) {
+    Node *node = new Node;
+    node->id = m_nextNodeId++;
+    node->chain = chain;
+    prepareNode(node);
+    m_nodes.append(node);
+    return node->id;
+}
+
+void DspGraph::removeNode(int node) {
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes[i]->id != node) continue;
+        // 当前快照可能仍在使用，随下一次 commit() 的快照退役后释放
+        m_removed.append(m_nodes.takeAt(i));
+        break;
+    }
+    for (int i = m_edges.size() - 1; i >= 0; --i) {
+        if (m_edges[i].first == node || m_edges[i].second == node) m_edges.removeAt(i);
+    }
+}
+
+bool DspGraph::connect(int from, int to) {
+    bool hasFrom = false;
+    bool hasTo = false;
+    for (const Node *node : m_nodes) {
+        hasFrom |= node->id == from;
+        hasTo |= node->id == to;
+    }
+    if (!hasFrom || !hasTo || from == to) return false;
+    if (m_edges.contains(qMakePair(from, to))) return true;
+    // to 已能到达 from 时再连 from -> to 会形成环
+    if (hasPath(to, from)) return false;
+    m_edges.append(qMakePair(from, to));
+    return true;
+}
+
+void DspGraph::disconnect(int from, int to) {
+    m_edges.removeAll(qMakePair(from, to));
+}
+
+bool DspGraph::hasPath(int from, int to) const {
+    QVector<int> stack;
+    QVector<int> visited;
+    stack.append(from);
+    while (!stack.isEmpty()) {
+        const int current = stack.takeLast();
+        if (current == to) return true;
+        if (visited.contains(current)) continue;
+        visited.append(current);
+        for (const QPair<int, int> &edge : m_edges) {
+            if (edge.first == current) stack.append(edge.second);
+        }
+    }
+    return false;
+}
+
+void DspGraph::commit() {
+    // 先回收再发布：每次发布最多让音频线程退役一个快照，退役队列不会满
+    collectRetired();
+    Schedule *schedule = buildSchedule();
+    schedule->removedNodes = m_removed;
+    m_removed.clear();
+
+    // 音频线程还没取走的上一个快照由这里释放，它待释放的节点转给新快照
+    Schedule *stale = m_pendingSchedule.exchange(schedule, std::memory_order_acq_rel);
+    if (stale) {
+        schedule->removedNodes += stale->removedNodes;
+        stale->removedNodes.clear();
+        delete stale;
+    }
+}
+
+DspGraph::Schedule *DspGraph::buildSchedule() const {
+    Schedule *schedule = new Schedule;
+    const int count = m_nodes.size();
+
+    QHash<int, int> indexOf;
+    for (int i = 0; i < count; ++i) indexOf.insert(m_nodes[i]->id, i);
+    QVector<QVector<int>> successors(count);
+    QVector<QVector<int>> predecessors(count);
+    QVector<int> inDegree(count, 0);
+    for (const QPair<int, int> &edge : m_edges) {
+        const int from = indexOf.value(edge.first);
+        const int to = indexOf.value(edge.second);
+        successors[from].append(to);
+        predecessors[to].append(from);
+        ++inDegree[to];
+    }
+
+    // Kahn 拓扑排序，快照内的节点下标按拓扑序排列
+    QVector<int> order;
+    QVector<int> remaining = inDegree;
+    for (int i = 0; i < count; ++i) {
+        if (remaining[i] == 0) order.append(i);
+    }
+    for (int k = 0; k < order.size(); ++k) {
+        for (int next : successors[order[k]]) {
+            if (--remaining[next] == 0) order.append(next);
+        }
+    }
+    QVector<int> position(count);
+    for (int k = 0; k < count; ++k) position[order[k]] = k;
+
+    schedule->nodes.resize(count);
+    schedule->inDegree.resize(count);
+    schedule->predecessorOffsets.append(0);
+    schedule->successorOffsets.append(0);
+    for (int k = 0; k < count; ++k) {
+        const int i = order[k];
+        schedule->nodes[k] = m_nodes[i];
+        schedule->inDegree[k] = inDegree[i];
+        if (inDegree[i] == 0) schedule->sources.append(k);
+        for (int p : predecessors[i]) schedule->predecessors.append(position[p]);
+        for (int s : successors[i]) schedule->successors.append(position[s]);
+        schedule->predecessorOffsets.append(schedule->predecessors.size());
+        schedule->successorOffsets.append(schedule->successors.size());
+    }
+
+    schedule->pending.reset(new std::atomic<int>[qMax(count, 1)]);
+    for (int i = 0; i <= m_workers.size(); ++i) {
+        schedule->deques.emplace_back(new WorkStealingDeque<int>(qMax(count, 2)));
+    }
+    return schedule;
+}
+
+void DspGraph::collectRetired() {
+    Schedule *schedule = nullptr;
+    while (m_retiredSchedules.pop(schedule)) {
+        delete schedule;
+    }
+}
+
+void DspGraph::prepareNode(Node *node) {
+    if (m_maxBlockFrames <= 0) return;
+    node->buffer.setSize(m_channels, m_maxBlockFrames);
+    if (node->chain) node->chain->prepare(m_sampleRate, m_channels, m_maxBlockFrames);
+}
+
+void DspGraph::prepare(int sampleRate, int channels, int maxBlockFrames) {
+    m_sampleRate = sampleRate;
+    m_channels = qMax(channels, 1);
+    m_maxBlockFrames = qMax(maxBlockFrames, 1);
+
+    // 音频线程此时不在处理，直接取用待发布的快照；仍在当前快照中的已移除节点也按新格式分配
+    collectRetired();
+    adoptPendingSchedule();
+    collectRetired();
+    for (Node *node : m_nodes) prepareNode(node);
+    for (Node *node : m_removed) prepareNode(node);
+}
+
+void DspGraph::setDeadlineBudget(double budget) {
+    m_deadlineBudget.store(float(qBound(0.05, budget, 1.0)), std::memory_order_relaxed);
+}
+
+double DspGraph::lastPeriodLoad() const {
+    return m_lastLoad.load(std::memory_order_relaxed);
+}
+
+void DspGraph::adoptPendingSchedule() {
+    Schedule *next = m_pendingSchedule.exchange(nullptr, std::memory_order_acq_rel);
+    if (!next) return;
+    m_retiredSchedules.push(m_schedule);
+    m_schedule = next;
+}
+
+AudioBlock DspGraph::nodeBlock(int node, int frames) {
+    adoptPendingSchedule();
+    for (Node *candidate : m_schedule->nodes) {
+        if (candidate->id == node) return candidate->buffer.block(qMin(frames, m_maxBlockFrames));
+    }
+    return AudioBlock();
+}
+
+void DspGraph::process(int frames) {
+    adoptPendingSchedule();
+    Schedule *schedule = m_schedule;
+    const int count = schedule->nodes.size();
+    if (count == 0 || frames <= 0 || m_maxBlockFrames <= 0) return;
+
+    const auto start = std::chrono::steady_clock::now();
+    m_frames = qMin(frames, m_maxBlockFrames);
+    for (int i = 0; i < count; ++i) {
+        schedule->pending[i].store(schedule->inDegree[i], std::memory_order_relaxed);
+    }
+    m_sourceCursor.store(0, std::memory_order_relaxed);
+    m_remaining.store(count, std::memory_order_relaxed);
+    m_periodActive.store(true, std::memory_order_seq_cst);
+
+    // 只有一个节点时不必唤醒工作线程；调用线程自身也作为执行线程 0 参与
+    m_wake.release(qMin(m_workers.size(), count - 1));
+    runPeriod(0);
+
+    // 关闭本周期并等仍在循环中的工作线程离开，之后快照可以安全替换
+    m_periodActive.store(false, std::memory_order_seq_cst);
+    while (m_activeExecutors.load(std::memory_order_seq_cst) > 0) {
+        cpuRelax();
+    }
+    // 丢弃发给已离开线程的多余信号，不带入下一个周期
+    while (m_ready.tryAcquire()) {
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double period = double(m_frames) / qMax(m_sampleRate, 1);
+    const float load = float(elapsed / period);
+    m_lastLoad.store(load, std::memory_order_relaxed);
+    if (load > m_deadlineBudget.load(std::memory_order_relaxed)) {
+        m_deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_periods.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DspGraph::workerLoop(int executor) {
+    for (;;) {
+        m_wake.acquire();
+        if (m_stopping.load(std::memory_order_acquire)) return;
+        runPeriod(executor);
+    }
+}
+
+void DspGraph::runPeriod(int executor) {
+    // 先登记再检查周期是否仍在进行（与 process() 的关闭顺序相反），迟到的唤醒不会碰到快照
+    m_activeExecutors.fetch_add(1, std::memory_order_seq_cst);
+    if (!m_periodActive.load(std::memory_order_seq_cst)) {
+        m_activeExecutors.fetch_sub(1, std::memory_order_seq_cst);
+        return;
+    }
+
+    Schedule *schedule = m_schedule;
+    const int executors = int(schedule->deques.size());
+    const int sourceCount = schedule->sources.size();
+    WorkStealingDeque<int> &own = *schedule->deques[executor];
+    int idle = 0;
+    while (m_remaining.load(std::memory_order_acquire) > 0) {
+        int index = -1;
+        bool found = own.pop(index);
+        if (!found && m_sourceCursor.load(std::memory_order_relaxed) < sourceCount) {
+            const int cursor = m_sourceCursor.fetch_add(1, std::memory_order_acq_rel);
+            if (cursor < sourceCount) {
+                index = schedule->sources[cursor];
+                found = true;
+            }
+        }
+        for (int k = 1; !found && k < executors; ++k) {
+            found = schedule->deques[(executor + k) % executors]->steal(index);
+        }
+
+        if (found) {
+            runNode(schedule, executor, index);
+            idle = 0;
+        } else if (++idle < kIdleSpins) {
+            cpuRelax();
+        } else if (executor != 0) {
+            // 工作线程空转一阵后挂起，避免实时优先级的自旋饿死同核的其他线程；
+            // 挂起期间仍留在本周期，后继就绪时被唤醒去窃取
+            park();
+            idle = 0;
+        } else {
+            QThread::yieldCurrentThread();
+        }
+    }
+    m_activeExecutors.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void DspGraph::park() {
+    m_parked.fetch_add(1, std::memory_order_seq_cst);
+    if (m_remaining.load(std::memory_order_seq_cst) > 0) {
+        m_ready.tryAcquire(1, kParkTimeoutMs);
+    }
+    m_parked.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void DspGraph::runNode(Schedule *schedule, int executor, int index) {
+    Node *node = schedule->nodes[index];
+    const AudioBlock block = node->buffer.block(m_frames);
+
+    // 有输入连接的节点以各前驱输出之和为输入
+    const int first = schedule->predecessorOffsets[index];
+    const int last = schedule->predecessorOffsets[index + 1];
+    if (first < last) {
+        for (int ch = 0; ch < block.channelCount; ++ch) {
+            float *target = block.channel(ch);
+            std::memcpy(target, schedule->nodes[schedule->predecessors[first]]->buffer.channel(ch),
+                        sizeof(float) * block.frameCount);
+            for (int p = first + 1; p < last; ++p) {
+                const float *source = schedule->nodes[schedule->predecessors[p]]->buffer.channel(ch);
+                for (int i = 0; i < block.frameCount; ++i) target[i] += source[i];
+            }
+        }
+    }
+    if (node->chain) {
+        node->chain->processBlock(block);
+    }
+
+    // 入度降为零的后继压入本线程队列，其他线程空闲时会来窃取
+    int ready = 0;
+    for (int s = schedule->successorOffsets[index]; s < schedule->successorOffsets[index + 1]; ++s) {
+        const int successor = schedule->successors[s];
+        if (schedule->pending[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            schedule->deques[executor]->push(successor);
+            ++ready;
+        }
+    }
+    const int remaining = m_remaining.fetch_sub(1, std::memory_order_seq_cst) - 1;
+
+    // 本线程自己接着做一个，其余的唤醒挂起的线程来窃取；全部完成时唤醒所有挂起的线程离开
+    const int parked = m_parked.load(std::memory_order_seq_cst);
+    if (parked > 0) {
+        const int wake = remaining == 0 ? parked : qMin(parked, ready - 1);
+        if (wake > 0) m_ready.release(wake);
+    }
+}
@@ -0,0 +1,180 @@
+#include "../include/dynamics_kernels.h"
+#include "../include/fast_math.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DYNAMICS_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DYNAMICS_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+#if defined(DYNAMICS_HAVE_SSE2)
+struct Sse2Ops {
+    typedef __m128 Reg;
+    typedef __m128 Mask;
+    static const int Width = 4;
+
+    static Reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Reg a) { _mm_storeu_ps(p, a); }
+    static Reg set1(float v) { return _mm_set1_ps(v); }
+    static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+    static Mask greater(Reg a, Reg b) { return _mm_cmpgt_ps(a, b); }
+    static Reg select(Mask m, Reg a, Reg b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+    // 拆出指数与 [1, 2) 的尾数
+    static Reg exponent(Reg x, Reg *mantissa) {
+        const __m128i bits = _mm_castps_si128(x);
+        *mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+                                                  _mm_set1_epi32(0x3F800000)));
+        return _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    }
+    static Reg floor(Reg x) {
+        const Reg truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(x, truncated), _mm_set1_ps(1.0f)));
+    }
+    // 2^n，n 为 [-126, 126] 内的整数值
+    static Reg pow2(Reg n) {
+        return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23));
+    }
+};
+#endif
+
+#if defined(DYNAMICS_HAVE_NEON)
+struct NeonOps {
+    typedef float32x4_t Reg;
+    typedef uint32x4_t Mask;
+    static const int Width = 4;
+
+    static Reg load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, Reg a) { vst1q_f32(p, a); }
+    static Reg set1(float v) { return vdupq_n_f32(v); }
+    static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+    static Reg sub(Reg a, Reg b) { return vsubq_f32(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return vmlaq_f32(c, a, b); }
+    static Reg max(Reg a, Reg b) { return vmaxq_f32(a, b); }
+    static Reg min(Reg a, Reg b) { return vminq_f32(a, b); }
+    static Mask greater(Reg a, Reg b) { return vcgtq_f32(a, b); }
+    static Reg select(Mask m, Reg a, Reg b) { return vbslq_f32(m, a, b); }
+
+    static Reg exponent(Reg x, Reg *mantissa) {
+        const uint32x4_t bits = vreinterpretq_u32_f32(x);
+        *mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)),
+                                                    vdupq_n_u32(0x3F800000)));
+        return vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+    }
+    static Reg floor(Reg x) {
+        const Reg truncated = vcvtq_f32_s32(vcvtq_s32_f32(x));
+        const uint32x4_t below = vandq_u32(vcltq_f32(x, truncated), vreinterpretq_u32_f32(vdupq_n_f32(1.0f)));
+        return vsubq_f32(truncated, vreinterpretq_f32_u32(below));
+    }
+    static Reg pow2(Reg n) {
+        return vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23));
+    }
+};
+#endif
+
+template <typename Ops>
+struct VectorMath {
+    typedef typename Ops::Reg Reg;
+
+    static Reg linearToDb(Reg linear) {
+        Reg mantissa;
+        const Reg exponent = Ops::exponent(Ops::max(linear, Ops::set1(FastMath::MinLevel)), &mantissa);
+        const Reg u = Ops::sub(mantissa, Ops::set1(1.0f));
+        const float *c = FastMath::Log2Poly;
+        Reg p = Ops::set1(c[5]);
+        for (int k = 4; k >= 0; --k) p = Ops::madd(p, u, Ops::set1(c[k]));
+        return Ops::max(Ops::mul(Ops::add(exponent, p), Ops::set1(FastMath::DbPerLog2)),
+                        Ops::set1(FastMath::MinLevelDb));
+    }
+
+    static Reg dbToLinear(Reg db) {
+        Reg x = Ops::mul(db, Ops::set1(FastMath::Log2PerDb));
+        x = Ops::min(Ops::max(x, Ops::set1(-126.0f)), Ops::set1(126.0f));
+        const Reg n = Ops::floor(x);
+        const Reg f = Ops::sub(x, n);
+        const float *c = FastMath::Exp2Poly;
+        Reg p = Ops::set1(c[4]);
+        for (int k = 3; k >= 0; --k) p = Ops::madd(p, f, Ops::set1(c[k]));
+        return Ops::mul(Ops::pow2(n), p);
+    }
+
+    static int compressor(float *levels, const float *thresholds, const float *makeups, int frames,
+                          float slope, float knee) {
+        const Reg slopes = Ops::set1(slope);
+        const Reg halfKnee = Ops::set1(knee * 0.5f);
+        const Reg kneeSlope = Ops::set1(knee > 0.0f ? slope * 0.5f / knee : 0.0f);
+        const Reg zero = Ops::set1(0.0f);
+        int i = 0;
+        for (; i + Ops::Width <= frames; i += Ops::Width) {
+            const Reg over = Ops::sub(linearToDb(Ops::load(levels + i)), Ops::load(thresholds + i));
+            const Reg x = Ops::max(Ops::add(over, halfKnee), zero);
+            const Reg reduction = Ops::select(Ops::greater(over, halfKnee), Ops::mul(slopes, over),
+                                              Ops::mul(kneeSlope, Ops::mul(x, x)));
+            Ops::store(levels + i, dbToLinear(Ops::add(reduction, Ops::load(makeups + i))));
+        }
+        return i;
+    }
+
+    static int expander(float *levels, const float *thresholds, const float *makeups, int frames,
+                        float slope, float floorDb) {
+        const Reg slopes = Ops::set1(-slope);
+        const Reg floors = Ops::set1(floorDb);
+        const Reg zero = Ops::set1(0.0f);
+        int i = 0;
+        for (; i + Ops::Width <= frames; i += Ops::Width) {
+            const Reg under = Ops::max(Ops::sub(Ops::load(thresholds + i), linearToDb(Ops::load(levels + i))), zero);
+            const Reg reduction = Ops::max(Ops::mul(slopes, under), floors);
+            Ops::store(levels + i, dbToLinear(Ops::add(reduction, Ops::load(makeups + i))));
+        }
+        return i;
+    }
+};
+
+#if defined(DYNAMICS_HAVE_SSE2)
+typedef VectorMath<Sse2Ops> ActiveMath;
+#elif defined(DYNAMICS_HAVE_NEON)
+typedef VectorMath<NeonOps> ActiveMath;
+#endif
+}
+
+namespace DynamicsKernels {
+void compressorGains(float *levels, const float *thresholds, const float *makeups, int frames,
+                     float slope, float knee) {
+    int i = 0;
+#if defined(DYNAMICS_HAVE_SSE2) || defined(DYNAMICS_HAVE_NEON)
+    i = ActiveMath::compressor(levels, thresholds, makeups, frames, slope, knee);
+#endif
+    const float halfKnee = knee * 0.5f;
+    const float kneeSlope = knee > 0.0f ? slope * 0.5f / knee : 0.0f;
+    for (; i < frames; ++i) {
+        const float over = FastMath::linearToDb(levels[i]) - thresholds[i];
+        const float x = qMax(over + halfKnee, 0.0f);
+        const float reduction = over > halfKnee ? slope * over : kneeSlope * x * x;
+        levels[i] = FastMath::dbToLinear(reduction + makeups[i]);
+    }
+}
+
+void expanderGains(float *levels, const float *thresholds, const float *makeups, int frames,
+                   float slope, float floorDb) {
+    int i = 0;
+#if defined(DYNAMICS_HAVE_SSE2) || defined(DYNAMICS_HAVE_NEON)
+    i = ActiveMath::expander(levels, thresholds, makeups, frames, slope, floorDb);
+#endif
+    for (; i < frames; ++i) {
+        const float under = qMax(thresholds[i] - FastMath::linearToDb(levels[i]), 0.0f);
+        const float reduction = qMax(-slope * under, floorDb);
+        levels[i] = FastMath::dbToLinear(reduction + makeups[i]);
+    }
+}
+}
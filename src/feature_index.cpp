@@ -0,0 +1,430 @@
+#include "../include/feature_index.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FEATURES_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FEATURES_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+const float kInfinity = std::numeric_limits<float>::infinity();
+const int kDefaultThreshold = 100000;
+const int kDefaultProbes = 16;
+const int kTrainingIterations = 8;
+const int kSamplesPerList = 48;
+
+// 槽位 i..i+3 到 query 的平方距离；返回小于 worst 的通道掩码（位 j 对应槽位 i + j）
+inline int distances4(const float *columns, int stride, int dims, int i, const float *query,
+                      const float *normSq, float querySq, float worst, float *out) {
+#if defined(FEATURES_HAVE_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for (int d = 0; d < dims; ++d) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(query[d]), _mm_loadu_ps(columns + d * stride + i)));
+    }
+    const __m128 dist = _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(normSq + i), _mm_add_ps(acc, acc)), _mm_set1_ps(querySq));
+    _mm_storeu_ps(out, dist);
+    return _mm_movemask_ps(_mm_cmplt_ps(dist, _mm_set1_ps(worst)));
+#elif defined(FEATURES_HAVE_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (int d = 0; d < dims; ++d) acc = vmlaq_n_f32(acc, vld1q_f32(columns + d * stride + i), query[d]);
+    const float32x4_t dist = vaddq_f32(vsubq_f32(vld1q_f32(normSq + i), vaddq_f32(acc, acc)), vdupq_n_f32(querySq));
+    vst1q_f32(out, dist);
+#else
+    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int d = 0; d < dims; ++d) {
+        const float *c = columns + d * stride + i;
+        for (int j = 0; j < 4; ++j) acc[j] += query[d] * c[j];
+    }
+    for (int j = 0; j < 4; ++j) out[j] = normSq[i + j] - 2.0f * acc[j] + querySq;
+#endif
+#if !defined(FEATURES_HAVE_SSE2)
+    int mask = 0;
+    for (int j = 0; j < 4; ++j) {
+        if (out[j] < worst) mask |= 1 << j;
+    }
+    return mask;
+#endif
+}
+
+inline float distance1(const float *columns, int stride, int dims, int i, const float *query,
+                       const float *normSq, float querySq) {
+    float dot = 0.0f;
+    for (int d = 0; d < dims; ++d) dot += query[d] * columns[d * stride + i];
+    return normSq[i] - 2.0f * dot + querySq;
+}
+
+// 按列存放的 count 个向量中离 query 最近的一个
+int nearestColumn(const float *columns, int stride, int dims, int count, const float *normSq,
+                  const float *query) {
+    int best = 0;
+    float bestDistance = kInfinity;
+    float dist[4];
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int mask = distances4(columns, stride, dims, i, query, normSq, 0.0f, bestDistance, dist);
+        for (int j = 0; mask; ++j, mask >>= 1) {
+            if ((mask & 1) && dist[j] < bestDistance) {
+                bestDistance = dist[j];
+                best = i + j;
+            }
+        }
+    }
+    for (; i < count; ++i) {
+        const float d = distance1(columns, stride, dims, i, query, normSq, 0.0f);
+        if (d < bestDistance) {
+            bestDistance = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+inline void pushCandidate(QVector<QPair<float, int>> &heap, int k, float distance, int slot) {
+    if (heap.size() < k) {
+        heap.append(qMakePair(distance, slot));
+        std::push_heap(heap.begin(), heap.end());
+    } else {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.last() = qMakePair(distance, slot);
+        std::push_heap(heap.begin(), heap.end());
+    }
+}
+}
+
+FeatureIndex::FeatureIndex(int dimensions)
+    : m_dimensions(qMax(0, dimensions))
+    , m_capacity(0)
+    , m_used(0)
+    , m_tombstones(0)
+    , m_approximateThreshold(kDefaultThreshold)
+    , m_probeCount(kDefaultProbes)
+    , m_indexedEnd(0)
+{
+}
+
+void FeatureIndex::setDimensions(int dimensions) {
+    m_dimensions = qMax(0, dimensions);
+    clear();
+}
+
+void FeatureIndex::clear() {
+    m_capacity = 0;
+    m_used = 0;
+    m_tombstones = 0;
+    m_columns.clear();
+    m_normSq.clear();
+    m_ids.clear();
+    m_slots.clear();
+    m_indexedEnd = 0;
+    m_centroids.clear();
+    m_centroidNormSq.clear();
+    m_listStart.clear();
+}
+
+void FeatureIndex::grow(int capacity) {
+    QVector<float> columns(m_dimensions * capacity, 0.0f);
+    for (int d = 0; d < m_dimensions; ++d) {
+        if (m_used > 0) std::memcpy(columns.data() + d * capacity, column(d), sizeof(float) * m_used);
+    }
+    m_columns.swap(columns);
+    m_normSq.resize(capacity);
+    m_ids.resize(capacity);
+    m_capacity = capacity;
+}
+
+void FeatureIndex::setSlot(int slot, const float *vector) {
+    float normSq = 0.0f;
+    for (int d = 0; d < m_dimensions; ++d) {
+        column(d)[slot] = vector[d];
+        normSq += vector[d] * vector[d];
+    }
+    m_normSq[slot] = normSq;
+}
+
+void FeatureIndex::removeSlot(int slot) {
+    m_normSq[slot] = kInfinity;
+    m_ids[slot].clear();
+    ++m_tombstones;
+}
+
+void FeatureIndex::upsert(const QString &id, const float *vector) {
+    if (m_dimensions == 0) return;
+    const int existing = m_slots.value(id, -1);
+    // 尾部（或未建 IVF 时的全部）可原地更新；已编入列表的条目可能换中心，改为墓碑加追加
+    if (existing >= m_indexedEnd) {
+        setSlot(existing, vector);
+        return;
+    }
+    if (existing >= 0) removeSlot(existing);
+    if (m_used == m_capacity) grow(qMax(64, m_capacity * 2));
+    const int slot = m_used++;
+    setSlot(slot, vector);
+    m_ids[slot] = id;
+    m_slots.insert(id, slot);
+}
+
+bool FeatureIndex::remove(const QString &id) {
+    const int slot = m_slots.value(id, -1);
+    if (slot < 0) return false;
+    m_slots.remove(id);
+    removeSlot(slot);
+    return true;
+}
+
+bool FeatureIndex::vectorFor(const QString &id, float *vector) const {
+    const int slot = m_slots.value(id, -1);
+    if (slot < 0) return false;
+    for (int d = 0; d < m_dimensions; ++d) vector[d] = column(d)[slot];
+    return true;
+}
+
+void FeatureIndex::scan(const float *query, float querySq, int begin, int end, int exclude, int k,
+                        QVector<QPair<float, int>> &heap) const {
+    const float *columns = m_columns.constData();
+    const float *normSq = m_normSq.constData();
+    float worst = heap.size() == k ? heap.first().first : kInfinity;
+    float dist[4];
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        int mask = distances4(columns, m_capacity, m_dimensions, i, query, normSq, querySq, worst, dist);
+        for (int j = 0; mask; ++j, mask >>= 1) {
+            if (!(mask & 1) || i + j == exclude || dist[j] >= worst) continue;
+            pushCandidate(heap, k, dist[j], i + j);
+            if (heap.size() == k) worst = heap.first().first;
+        }
+    }
+    for (; i < end; ++i) {
+        const float d = distance1(columns, m_capacity, m_dimensions, i, query, normSq, querySq);
+        if (d >= worst || i == exclude) continue;
+        pushCandidate(heap, k, d, i);
+        if (heap.size() == k) worst = heap.first().first;
+    }
+}
+
+QVector<FeatureIndex::Match> FeatureIndex::nearest(const float *query, int k, const QString &exclude) const {
+    QVector<Match> result;
+    if (k <= 0 || m_slots.isEmpty()) return result;
+
+    const int excludeSlot = exclude.isEmpty() ? -1 : m_slots.value(exclude, -1);
+    float querySq = 0.0f;
+    for (int d = 0; d < m_dimensions; ++d) querySq += query[d] * query[d];
+
+    QVector<QPair<float, int>> heap;
+    heap.reserve(k);
+    if (isApproximate()) {
+        // 选出最近的若干个中心，只扫描它们的列表与未编入列表的尾部
+        const int lists = m_listStart.size() - 1;
+        QVector<QPair<float, int>> centroids(lists);
+        for (int c = 0; c < lists; ++c) {
+            centroids[c] = qMakePair(distance1(m_centroids.constData(), lists, m_dimensions, c, query,
+                                               m_centroidNormSq.constData(), querySq), c);
+        }
+        const int probes = qMin(m_probeCount, lists);
+        std::partial_sort(centroids.begin(), centroids.begin() + probes, centroids.end());
+        for (int p = 0; p < probes; ++p) {
+            const int c = centroids[p].second;
+            scan(query, querySq, m_listStart[c], m_listStart[c + 1], excludeSlot, k, heap);
+        }
+        scan(query, querySq, m_indexedEnd, m_used, excludeSlot, k, heap);
+    } else {
+        scan(query, querySq, 0, m_used, excludeSlot, k, heap);
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    result.reserve(heap.size());
+    for (const QPair<float, int> &entry : heap) {
+        if (std::isinf(entry.first)) break;
+        result.append(Match{m_ids[entry.second], qMax(0.0f, entry.first)});
+    }
+    return result;
+}
+
+void FeatureIndex::weightedDistances(const float *target, const float *weights, float *out) const {
+    // 只累加权重非零的维度
+    int active[64];
+    int dims = 0;
+    for (int d = 0; d < m_dimensions && dims < 64; ++d) {
+        if (weights[d] != 0.0f) active[dims++] = d;
+    }
+    const float *columns = m_columns.constData();
+    int i = 0;
+#if defined(FEATURES_HAVE_SSE2)
+    for (; i + 4 <= m_used; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int a = 0; a < dims; ++a) {
+            const int d = active[a];
+            const __m128 diff = _mm_sub_ps(_mm_loadu_ps(columns + d * m_capacity + i), _mm_set1_ps(target[d]));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[d]), _mm_mul_ps(diff, diff)));
+        }
+        _mm_storeu_ps(out + i, acc);
+    }
+#elif defined(FEATURES_HAVE_NEON)
+    for (; i + 4 <= m_used; i += 4) {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (int a = 0; a < dims; ++a) {
+            const int d = active[a];
+            const float32x4_t diff = vsubq_f32(vld1q_f32(columns + d * m_capacity + i), vdupq_n_f32(target[d]));
+            acc = vmlaq_n_f32(acc, vmulq_f32(diff, diff), weights[d]);
+        }
+        vst1q_f32(out + i, acc);
+    }
+#endif
+    for (; i < m_used; ++i) {
+        float acc = 0.0f;
+        for (int a = 0; a < dims; ++a) {
+            const int d = active[a];
+            const float diff = columns[d * m_capacity + i] - target[d];
+            acc += weights[d] * diff * diff;
+        }
+        out[i] = acc;
+    }
+    if (m_tombstones > 0) {
+        for (int slot = 0; slot < m_used; ++slot) {
+            if (std::isinf(m_normSq[slot])) out[slot] = kInfinity;
+        }
+    }
+}
+
+bool FeatureIndex::needsRebuild() const {
+    if (m_tombstones > qMax(64, size() / 8)) return true;
+    if (m_approximateThreshold <= 0) return false;
+    if (!isApproximate()) return size() >= m_approximateThreshold;
+    return m_used - m_indexedEnd > qMax(1024, m_indexedEnd / 10);
+}
+
+void FeatureIndex::rebuild() {
+    const int count = size();
+    if (m_approximateThreshold > 0 && count >= m_approximateThreshold) {
+        trainLists(qMax(1, int(std::lround(std::sqrt(double(count))))));
+        return;
+    }
+
+    // 只压缩墓碑，保持原有顺序
+    QVector<int> order;
+    order.reserve(count);
+    for (int slot = 0; slot < m_used; ++slot) {
+        if (!std::isinf(m_normSq[slot])) order.append(slot);
+    }
+    const int capacity = qMax(64, count);
+    QVector<float> columns(m_dimensions * capacity, 0.0f);
+    QVector<float> normSq(capacity);
+    QVector<QString> ids(capacity);
+    for (int i = 0; i < count; ++i) {
+        const int slot = order[i];
+        for (int d = 0; d < m_dimensions; ++d) columns[d * capacity + i] = column(d)[slot];
+        normSq[i] = m_normSq[slot];
+        ids[i] = m_ids[slot];
+        m_slots.insert(ids[i], i);
+    }
+    m_columns.swap(columns);
+    m_normSq.swap(normSq);
+    m_ids.swap(ids);
+    m_capacity = capacity;
+    m_used = count;
+    m_tombstones = 0;
+    m_indexedEnd = 0;
+    m_centroids.clear();
+    m_centroidNormSq.clear();
+    m_listStart.clear();
+}
+
+void FeatureIndex::trainLists(int listCount) {
+    const int dims = m_dimensions;
+    QVector<int> live;
+    live.reserve(size());
+    for (int slot = 0; slot < m_used; ++slot) {
+        if (!std::isinf(m_normSq[slot])) live.append(slot);
+    }
+    const int count = live.size();
+    listCount = qMin(listCount, count);
+
+    // 等间隔取样训练 k-means（确定性，结果可复现）；中心按列存放以复用距离内核
+    const int samples = qMin(count, listCount * kSamplesPerList);
+    QVector<float> sample(samples * dims);
+    for (int s = 0; s < samples; ++s) {
+        const int slot = live[int(qint64(s) * count / samples)];
+        for (int d = 0; d < dims; ++d) sample[s * dims + d] = column(d)[slot];
+    }
+    QVector<float> centroids(dims * listCount);
+    QVector<float> centroidNormSq(listCount);
+    auto updateNorms = [&]() {
+        for (int c = 0; c < listCount; ++c) {
+            float normSq = 0.0f;
+            for (int d = 0; d < dims; ++d) normSq += centroids[d * listCount + c] * centroids[d * listCount + c];
+            centroidNormSq[c] = normSq;
+        }
+    };
+    for (int c = 0; c < listCount; ++c) {
+        const int s = int(qint64(c) * samples / listCount);
+        for (int d = 0; d < dims; ++d) centroids[d * listCount + c] = sample[s * dims + d];
+    }
+    updateNorms();
+
+    QVector<double> sums(dims * listCount);
+    QVector<int> members(listCount);
+    for (int iteration = 0; iteration < kTrainingIterations; ++iteration) {
+        sums.fill(0.0);
+        members.fill(0);
+        for (int s = 0; s < samples; ++s) {
+            const float *v = sample.constData() + s * dims;
+            const int c = nearestColumn(centroids.constData(), listCount, dims, listCount,
+                                        centroidNormSq.constData(), v);
+            for (int d = 0; d < dims; ++d) sums[d * listCount + c] += v[d];
+            ++members[c];
+        }
+        for (int c = 0; c < listCount; ++c) {
+            // 空中心重新放到一个样本上
+            const int reseed = int((qint64(c) * 7919 + iteration) % samples);
+            for (int d = 0; d < dims; ++d) {
+                centroids[d * listCount + c] = members[c] > 0 ? float(sums[d * listCount + c] / members[c])
+                                                             : sample[reseed * dims + d];
+            }
+        }
+        updateNorms();
+    }
+
+    // 全部条目归入最近的中心，按中心计数排序重排存储
+    QVector<int> assignment(count);
+    QVector<int> listStart(listCount + 1, 0);
+    QVector<float> vector(dims);
+    for (int i = 0; i < count; ++i) {
+        for (int d = 0; d < dims; ++d) vector[d] = column(d)[live[i]];
+        assignment[i] = nearestColumn(centroids.constData(), listCount, dims, listCount,
+                                      centroidNormSq.constData(), vector.constData());
+        ++listStart[assignment[i] + 1];
+    }
+    for (int c = 0; c < listCount; ++c) listStart[c + 1] += listStart[c];
+
+    const int capacity = count + qMax(1024, count / 8);   // 为尾部追加留余量
+    QVector<float> columns(dims * capacity, 0.0f);
+    QVector<float> normSq(capacity);
+    QVector<QString> ids(capacity);
+    QVector<int> fill = listStart;
+    for (int i = 0; i < count; ++i) {
+        const int slot = live[i];
+        const int target = fill[assignment[i]]++;
+        for (int d = 0; d < dims; ++d) columns[d * capacity + target] = column(d)[slot];
+        normSq[target] = m_normSq[slot];
+        ids[target] = m_ids[slot];
+        m_slots.insert(ids[target], target);
+    }
+    m_columns.swap(columns);
+    m_normSq.swap(normSq);
+    m_ids.swap(ids);
+    m_capacity = capacity;
+    m_used = count;
+    m_tombstones = 0;
+    m_indexedEnd = count;
+    m_centroids.swap(centroids);
+    m_centroidNormSq.swap(centroidNormSq);
+    m_listStart.swap(listStart);
+}
@@ -0,0 +1,200 @@
+#include "../include/feature_store.h"
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+const qint64 kFingerprintChunk = 64 * 1024;
+const int kCheckpointRecords = 32;
+const int kCompactSlack = 256;      // 少量失效记录不值得重写
+}
+
+FeatureStore::FeatureStore()
+    : m_pendingRecords(0)
+    , m_fileRecords(0)
+{
+}
+
+FeatureStore::~FeatureStore() {
+    close();
+}
+
+bool FeatureStore::open(const QString &filePath) {
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen()) {
+        flushLocked();
+        m_file.close();
+    }
+    m_values.clear();
+    m_paths.clear();
+    m_pending.clear();
+    m_pendingRecords = 0;
+    m_fileRecords = 0;
+    m_filePath = filePath;
+    m_file.setFileName(filePath);
+
+    if (m_file.open(QIODevice::ReadOnly)) {
+        const QByteArray data = m_file.readAll();
+        m_file.close();
+        int lineStart = 0;
+        while (lineStart < data.size()) {
+            const int lineEnd = data.indexOf('\n', lineStart);
+            if (lineEnd < 0) break;
+            const QJsonObject record = QJsonDocument::fromJson(data.mid(lineStart, lineEnd - lineStart)).object();
+            lineStart = lineEnd + 1;
+            ++m_fileRecords;
+            const QString fp = record["fp"].toString();
+            if (fp.isEmpty()) continue;
+            if (record.contains("value")) {
+                m_values.insert(fp, record["value"].toObject());
+            } else if (record.contains("path")) {
+                PathEntry entry;
+                entry.size = qint64(record["size"].toDouble(-1));
+                entry.modified = qint64(record["mtime"].toDouble());
+                entry.fingerprint = fp;
+                m_paths.insert(record["path"].toString(), entry);
+            }
+        }
+        // 上次写到一半的末行直接截掉，否则后续追加会接在残行后面
+        if (lineStart < data.size() && !m_file.resize(lineStart)) {
+            qWarning() << "Failed to truncate feature store:" << filePath;
+        }
+    }
+
+    if (m_fileRecords > 2 * (m_values.size() + m_paths.size()) + kCompactSlack) compactLocked();
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open feature store:" << filePath << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void FeatureStore::close() {
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen()) {
+        flushLocked();
+        m_file.close();
+    }
+    m_values.clear();
+    m_paths.clear();
+}
+
+bool FeatureStore::isOpen() const {
+    QMutexLocker locker(&m_mutex);
+    return m_file.isOpen();
+}
+
+QString FeatureStore::fingerprint(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return QString();
+    const qint64 size = file.size();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(size));
+    hash.addData(file.read(kFingerprintChunk));
+    if (size > 2 * kFingerprintChunk && file.seek(size - kFingerprintChunk)) {
+        hash.addData(file.read(kFingerprintChunk));
+    } else {
+        hash.addData(file.readAll());
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString FeatureStore::cachedFingerprint(const QString &filePath, qint64 size, qint64 modified) const {
+    QMutexLocker locker(&m_mutex);
+    const PathEntry entry = m_paths.value(filePath);
+    if (entry.size == size && entry.modified == modified) return entry.fingerprint;
+    return QString();
+}
+
+QString FeatureStore::fingerprintFor(const QString &filePath, qint64 size, qint64 modified) {
+    const QString cached = cachedFingerprint(filePath, size, modified);
+    if (!cached.isEmpty()) return cached;
+
+    // 读文件在锁外进行，其他线程可同时查询
+    const QString fp = fingerprint(filePath);
+    if (fp.isEmpty()) return fp;
+
+    QMutexLocker locker(&m_mutex);
+    PathEntry entry;
+    entry.size = size;
+    entry.modified = modified;
+    entry.fingerprint = fp;
+    m_paths.insert(filePath, entry);
+    QJsonObject record;
+    record["path"] = filePath;
+    record["size"] = double(size);
+    record["mtime"] = double(modified);
+    record["fp"] = fp;
+    appendRecord(record);
+    return fp;
+}
+
+bool FeatureStore::lookup(const QString &fingerprint, QJsonObject *value) const {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_values.constFind(fingerprint);
+    if (it == m_values.constEnd()) return false;
+    if (value) *value = it.value();
+    return true;
+}
+
+void FeatureStore::insert(const QString &fingerprint, const QJsonObject &value) {
+    if (fingerprint.isEmpty()) return;
+    QMutexLocker locker(&m_mutex);
+    m_values.insert(fingerprint, value);
+    QJsonObject record;
+    record["fp"] = fingerprint;
+    record["value"] = value;
+    appendRecord(record);
+}
+
+int FeatureStore::size() const {
+    QMutexLocker locker(&m_mutex);
+    return m_values.size();
+}
+
+void FeatureStore::flush() {
+    QMutexLocker locker(&m_mutex);
+    flushLocked();
+}
+
+void FeatureStore::appendRecord(const QJsonObject &record) {
+    if (!m_file.isOpen()) return;
+    m_pending += QJsonDocument(record).toJson(QJsonDocument::Compact);
+    m_pending += '\n';
+    if (++m_pendingRecords >= kCheckpointRecords) flushLocked();
+}
+
+void FeatureStore::flushLocked() {
+    if (m_pending.isEmpty() || !m_file.isOpen()) return;
+    if (m_file.write(m_pending) != m_pending.size()) {
+        qWarning() << "Failed to write feature store:" << m_file.errorString();
+    }
+    m_file.flush();
+    m_fileRecords += m_pendingRecords;
+    m_pending.clear();
+    m_pendingRecords = 0;
+}
+
+bool FeatureStore::compactLocked() {
+    QSaveFile out(m_filePath);
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    for (auto it = m_paths.constBegin(); it != m_paths.constEnd(); ++it) {
+        QJsonObject record;
+        record["path"] = it.key();
+        record["size"] = double(it.value().size);
+        record["mtime"] = double(it.value().modified);
+        record["fp"] = it.value().fingerprint;
+        out.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    }
+    for (auto it = m_values.constBegin(); it != m_values.constEnd(); ++it) {
+        QJsonObject record;
+        record["fp"] = it.key();
+        record["value"] = it.value();
+        out.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    }
+    if (!out.commit()) return false;
+    m_fileRecords = m_paths.size() + m_values.size();
+    return true;
+}
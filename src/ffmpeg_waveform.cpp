@@ -14,6 +14,11 @@ extern "C" {
 #endif
 
 QVector<float> extractWaveformFFmpeg(const QString& filePath, int samplePoints) {
+    return extractWaveformFFmpeg(filePath, samplePoints, nullptr);
+}
+
+QVector<float> extractWaveformFFmpeg(const QString& filePath, int samplePoints, LoudnessInfo* loudness) {
+    if (loudness) *loudness = LoudnessInfo();
 #if !defined(ENABLE_FFMPEG)
     Q_UNUSED(filePath)
     // 无 FFmpeg 时返回空波形，避免运行时加载 FFmpeg DLL
@@ -49,9 +54,12 @@ QVector<float> extractWaveformFFmpeg(const QString& filePath, int samplePoints)
     if (avcodec_open2(codec_ctx, dec, nullptr) < 0) { qWarning() << "Failed to open codec"; avcodec_free_context(&codec_ctx); avformat_close_input(&fmt_ctx); return waveform; }
     SwrContext* swr_ctx = swr_alloc();
     if (!swr_ctx) { qWarning() << "Failed to allocate resampler"; avcodec_free_context(&codec_ctx); avformat_close_input(&fmt_ctx); return waveform; }
-    AVChannelLayout in_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    AVChannelLayout out_ch_layout = AV_CHANNEL_LAYOUT_MONO;
-    if (codecpar->ch_layout.nb_channels == 1) { in_ch_layout = AV_CHANNEL_LAYOUT_MONO; }
+    // 保留原始声道输出，波形在解码循环中下混，响度需要逐声道 K 加权
+    int channels = codecpar->ch_layout.nb_channels > 0 ? codecpar->ch_layout.nb_channels : 2;
+    AVChannelLayout in_ch_layout;
+    AVChannelLayout out_ch_layout;
+    av_channel_layout_default(&in_ch_layout, channels);
+    av_channel_layout_default(&out_ch_layout, channels);
     av_opt_set_chlayout(swr_ctx, "in_chlayout", &in_ch_layout, 0);
     av_opt_set_chlayout(swr_ctx, "out_chlayout", &out_ch_layout, 0);
     av_opt_set_int(swr_ctx, "in_sample_rate", codecpar->sample_rate, 0);
@@ -62,6 +70,7 @@ QVector<float> extractWaveformFFmpeg(const QString& filePath, int samplePoints)
     AVPacket* pkt = av_packet_alloc();
     AVFrame* frame = av_frame_alloc();
     QVector<float> samples;
+    LoudnessAnalyzer analyzer(codecpar->sample_rate, channels);
     if (!pkt || !frame) { qWarning() << "Failed to allocate packet or frame"; goto cleanup; }
     while (av_read_frame(fmt_ctx, pkt) >= 0) {
         if (pkt->stream_index == audio_stream_index) {
@@ -69,11 +78,16 @@ QVector<float> extractWaveformFFmpeg(const QString& filePath, int samplePoints)
                 while (avcodec_receive_frame(codec_ctx, frame) == 0) {
                     uint8_t** out_data = nullptr;
                     int out_samples = av_rescale_rnd(swr_get_delay(swr_ctx, codecpar->sample_rate) + frame->nb_samples, codecpar->sample_rate, codecpar->sample_rate, AV_ROUND_UP);
-                    if (av_samples_alloc_array_and_samples(&out_data, nullptr, 1, out_samples, AV_SAMPLE_FMT_FLT, 0) < 0) { av_frame_unref(frame); continue; }
+                    if (av_samples_alloc_array_and_samples(&out_data, nullptr, channels, out_samples, AV_SAMPLE_FMT_FLT, 0) < 0) { av_frame_unref(frame); continue; }
                     int converted = swr_convert(swr_ctx, out_data, out_samples, (const uint8_t**)frame->data, frame->nb_samples);
                     if (converted > 0) {
                         float* out = reinterpret_cast<float*>(out_data[0]);
-                        for (int i = 0; i < converted; i++) samples.append(out[i]);
+                        if (loudness) analyzer.process(out, converted);
+                        for (int i = 0; i < converted; i++) {
+                            float mono = 0.0f;
+                            for (int ch = 0; ch < channels; ch++) mono += out[i * channels + ch];
+                            samples.append(mono / channels);
+                        }
                     }
                     if (out_data) { av_freep(&out_data[0]); av_freep(&out_data); }
                 }
@@ -87,6 +101,7 @@ cleanup:
     if (swr_ctx) swr_free(&swr_ctx);
     if (codec_ctx) avcodec_free_context(&codec_ctx);
     if (fmt_ctx) avformat_close_input(&fmt_ctx);
+    if (loudness) *loudness = analyzer.result();
     if (samples.size() > samplePoints) {
         int step = samples.size() / samplePoints;
         for (int i = 0; i < samplePoints; i++) {
@@ -1,5 +1,9 @@
 #include "../include/ffmpegplayer.h"
+#include "../include/audio_effects.h"
+#include "../include/pcm_ring_buffer.h"
 #include <QDebug>
+#include <atomic>
+#include <cmath>
 
 class FFmpegPlayer::Private {
 public:
@@ -7,9 +11,23 @@ public:
     bool isPlaying = false;
     qint64 currentPosition = 0;
     qint64 totalDuration = 0;
+    int sampleRate = 44100;
+    
+    // 响度归一化（UI 线程写入，音频线程只读 targetGain）
+    ReplayGainMode replayGainMode = ReplayGainTrack;
+    double preampDb = 0.0;
+    LoudnessInfo trackLoudness;
+    LoudnessInfo albumLoudness;
+    std::atomic<float> targetGain{1.0f};
+    float currentGain = 1.0f; // 仅音频线程访问
+    
+    AudioEffectChain effectChain;
+    PcmRingBuffer analysisTap;
 };
 
-FFmpegPlayer::FFmpegPlayer(QObject *parent) : QObject(parent), d(new Private) {}
+FFmpegPlayer::FFmpegPlayer(QObject *parent) : QObject(parent), d(new Private) {
+    d->analysisTap.setSampleRate(d->sampleRate);
+}
 
 FFmpegPlayer::~FFmpegPlayer() {
     delete d;
@@ -45,7 +63,7 @@ void FFmpegPlayer::stop() {
 void FFmpegPlayer::seek(qint64 positionMs) {
     qDebug() << "Seek to:" << positionMs;
     d->currentPosition = positionMs;
-    emit positionChanged(positionMs);
+    emit positionChanged(position());
 }
 
 qint64 FFmpegPlayer::duration() const {
@@ -53,5 +71,82 @@ qint64 FFmpegPlayer::duration() const {
 }
 
 qint64 FFmpegPlayer::position() const {
-    return d->currentPosition;
+    return qMax<qint64>(d->currentPosition - outputLatency(), 0);
+}
+
+qint64 FFmpegPlayer::outputLatency() const {
+    if (d->sampleRate <= 0) return 0;
+    return qint64(d->effectChain.latency()) * 1000 / d->sampleRate;
+}
+
+void FFmpegPlayer::setReplayGainMode(ReplayGainMode mode) {
+    d->replayGainMode = mode;
+    updateReplayGain();
+}
+
+FFmpegPlayer::ReplayGainMode FFmpegPlayer::replayGainMode() const {
+    return d->replayGainMode;
+}
+
+void FFmpegPlayer::setPreampDb(double db) {
+    d->preampDb = db;
+    updateReplayGain();
+}
+
+void FFmpegPlayer::setLoudness(const LoudnessInfo &track, const LoudnessInfo &album) {
+    d->trackLoudness = track;
+    d->albumLoudness = album;
+    updateReplayGain();
+}
+
+float FFmpegPlayer::replayGainScale() const {
+    return d->targetGain.load(std::memory_order_relaxed);
+}
+
+void FFmpegPlayer::updateReplayGain() {
+    // 专辑模式下缺少专辑响度时退回单曲响度
+    const LoudnessInfo &info = (d->replayGainMode == ReplayGainAlbum && d->albumLoudness.valid)
+                               ? d->albumLoudness : d->trackLoudness;
+    double gain = 1.0;
+    if (d->replayGainMode != ReplayGainOff && info.valid) {
+        gain = std::pow(10.0, (info.gainDb() + d->preampDb) / 20.0);
+        // 防削波：增益后的真峰值不超过 0 dBTP
+        double peak = info.truePeakLinear();
+        if (peak > 0.0 && gain * peak > 1.0) gain = 1.0 / peak;
+    }
+    d->targetGain.store(static_cast<float>(gain), std::memory_order_relaxed);
+}
+
+AudioEffectChain *FFmpegPlayer::effectChain() const {
+    return &d->effectChain;
+}
+
+const PcmRingBuffer *FFmpegPlayer::analysisTap() const {
+    return &d->analysisTap;
+}
+
+void FFmpegPlayer::processPcm(float *interleaved, int frames, int channels) {
+    if (!interleaved || frames <= 0 || channels <= 0) return;
+    const float target = d->targetGain.load(std::memory_order_relaxed);
+    float gain = d->currentGain;
+    
+    if (gain == target) {
+        if (gain != 1.0f) {
+            const int count = frames * channels;
+            for (int i = 0; i < count; ++i) interleaved[i] *= gain;
+        }
+    } else {
+        // 增益变化时在一个缓冲区内线性过渡，避免咔嗒声
+        const float step = (target - gain) / frames;
+        for (int i = 0; i < frames; ++i) {
+            gain += step;
+            float *frame = interleaved + i * channels;
+            for (int ch = 0; ch < channels; ++ch) frame[ch] *= gain;
+        }
+        d->currentGain = target;
+    }
+    
+    // 参数更新经无锁队列在块首生效
+    d->effectChain.processAudio(interleaved, frames, channels, d->sampleRate);
+    d->analysisTap.write(interleaved, frames, channels);
 }
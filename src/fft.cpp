@@ -0,0 +1,353 @@
+#include "../include/fft.h"
+#include <QtMath>
+#include <QMap>
+#include <QMutex>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFT_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FFT_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(ENABLE_FFTW)
+#include <fftw3.h>
+#endif
+
+struct RealFFT::Tables {
+    QVector<int> swaps;            // 位反转置换中需交换的下标对 (i, j)，i < j，依次存放
+    bool radix2First = false;      // log2(N/2) 为奇数时先做一级基 2
+    // 各基 4 级依次存放，子变换长度为 m 的一级占 6m 个：cos/sin(θ)、cos/sin(2θ)、cos/sin(3θ)，θ = 2πj/(4m)
+    QVector<float> twiddles;
+    QVector<float> splitCos;       // 拆分后处理的旋转因子 cos(2πk/N)，k <= N/2
+    QVector<float> splitSin;
+#if defined(ENABLE_FFTW)
+    fftwf_plan forwardPlan = nullptr;
+    fftwf_plan inversePlan = nullptr;
+
+    ~Tables() {
+        if (forwardPlan) fftwf_destroy_plan(forwardPlan);
+        if (inversePlan) fftwf_destroy_plan(inversePlan);
+    }
+#endif
+};
+
+namespace {
+struct ScalarOps {
+    typedef float Reg;
+    static const int Width = 1;
+
+    static Reg load(const float *p) { return *p; }
+    static void store(float *p, Reg a) { *p = a; }
+    static Reg add(Reg a, Reg b) { return a + b; }
+    static Reg sub(Reg a, Reg b) { return a - b; }
+    static Reg mul(Reg a, Reg b) { return a * b; }
+};
+
+#if defined(FFT_HAVE_SSE2)
+struct Sse2Ops {
+    typedef __m128 Reg;
+    static const int Width = 4;
+
+    static Reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Reg a) { _mm_storeu_ps(p, a); }
+    static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+};
+typedef Sse2Ops VectorOps;
+#elif defined(FFT_HAVE_NEON)
+struct NeonOps {
+    typedef float32x4_t Reg;
+    static const int Width = 4;
+
+    static Reg load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, Reg a) { vst1q_f32(p, a); }
+    static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+    static Reg sub(Reg a, Reg b) { return vsubq_f32(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+};
+typedef NeonOps VectorOps;
+#else
+typedef ScalarOps VectorOps;
+#endif
+
+template <typename Ops, bool Inverse>
+struct Butterflies {
+    typedef typename Ops::Reg Reg;
+
+    // x *= e^{∓iθ}（正变换取负号）
+    static void rotate(Reg &re, Reg &im, Reg c, Reg s) {
+        const Reg r = re;
+        if (Inverse) {
+            re = Ops::sub(Ops::mul(r, c), Ops::mul(im, s));
+            im = Ops::add(Ops::mul(im, c), Ops::mul(r, s));
+        } else {
+            re = Ops::add(Ops::mul(r, c), Ops::mul(im, s));
+            im = Ops::sub(Ops::mul(im, c), Ops::mul(r, s));
+        }
+    }
+
+    // 由四个长度为 m 的子变换合成长度 4m：位反转顺序下四段依次为 F0、F2、F1、F3，
+    // X[j + qm] = F0 + (-i)^q w^j F1 + (-1)^q w^2j F2 + i^q w^3j F3（逆变换取共轭）
+    static void radix4Pass(float *re, float *im, int n, int m, const float *twiddles) {
+        const float *c1 = twiddles, *s1 = c1 + m;
+        const float *c2 = s1 + m, *s2 = c2 + m;
+        const float *c3 = s2 + m, *s3 = c3 + m;
+        for (int start = 0; start < n; start += 4 * m) {
+            float *r0 = re + start, *r1 = r0 + m, *r2 = r1 + m, *r3 = r2 + m;
+            float *i0 = im + start, *i1 = i0 + m, *i2 = i1 + m, *i3 = i2 + m;
+            for (int j = 0; j < m; j += Ops::Width) {
+                const Reg ar = Ops::load(r0 + j), ai = Ops::load(i0 + j);
+                Reg br = Ops::load(r1 + j), bi = Ops::load(i1 + j);
+                Reg cr = Ops::load(r2 + j), ci = Ops::load(i2 + j);
+                Reg dr = Ops::load(r3 + j), di = Ops::load(i3 + j);
+                rotate(br, bi, Ops::load(c2 + j), Ops::load(s2 + j));
+                rotate(cr, ci, Ops::load(c1 + j), Ops::load(s1 + j));
+                rotate(dr, di, Ops::load(c3 + j), Ops::load(s3 + j));
+
+                const Reg sumR = Ops::add(ar, br), sumI = Ops::add(ai, bi);
+                const Reg diffR = Ops::sub(ar, br), diffI = Ops::sub(ai, bi);
+                const Reg oddR = Ops::add(cr, dr), oddI = Ops::add(ci, di);
+                // (c - d) 乘以 -i（逆变换为 +i）
+                const Reg rotR = Inverse ? Ops::sub(di, ci) : Ops::sub(ci, di);
+                const Reg rotI = Inverse ? Ops::sub(cr, dr) : Ops::sub(dr, cr);
+
+                Ops::store(r0 + j, Ops::add(sumR, oddR));
+                Ops::store(i0 + j, Ops::add(sumI, oddI));
+                Ops::store(r2 + j, Ops::sub(sumR, oddR));
+                Ops::store(i2 + j, Ops::sub(sumI, oddI));
+                Ops::store(r1 + j, Ops::add(diffR, rotR));
+                Ops::store(i1 + j, Ops::add(diffI, rotI));
+                Ops::store(r3 + j, Ops::sub(diffR, rotR));
+                Ops::store(i3 + j, Ops::sub(diffI, rotI));
+            }
+        }
+    }
+};
+
+template <bool Inverse>
+void radix4Pass(float *re, float *im, int n, int m, const float *twiddles) {
+    if (m >= VectorOps::Width) {
+        Butterflies<VectorOps, Inverse>::radix4Pass(re, im, n, m, twiddles);
+    } else {
+        Butterflies<ScalarOps, Inverse>::radix4Pass(re, im, n, m, twiddles);
+    }
+}
+}
+
+RealFFT::RealFFT(int size)
+    : m_size(0)
+    , m_backend(systemBackendAvailable() ? System : Builtin)
+{
+    if (size > 0) setSize(size);
+}
+
+int RealFFT::nextPowerOfTwo(int n) {
+    int size = 1;
+    while (size < n) size <<= 1;
+    return size;
+}
+
+bool RealFFT::systemBackendAvailable() {
+#if defined(ENABLE_FFTW)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void RealFFT::setBackend(Backend backend) {
+    m_backend = backend == System && systemBackendAvailable() ? System : Builtin;
+}
+
+bool RealFFT::useSystemBackend() const {
+#if defined(ENABLE_FFTW)
+    return m_backend == System && m_tables && m_tables->forwardPlan && m_tables->inversePlan;
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<const RealFFT::Tables> RealFFT::tablesForSize(int size) {
+    static QMutex mutex;
+    static QMap<int, std::shared_ptr<const Tables>> cache;
+    QMutexLocker locker(&mutex);
+    if (const std::shared_ptr<const Tables> cached = cache.value(size)) return cached;
+
+    auto tables = std::make_shared<Tables>();
+    const int half = size / 2;
+    int bits = 0;
+    while ((1 << bits) < half) ++bits;
+    for (int i = 0; i < half; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+        }
+        if (i < reversed) {
+            tables->swaps.append(i);
+            tables->swaps.append(reversed);
+        }
+    }
+
+    // 旋转因子用双精度计算后再取单精度，避免大尺寸时的累积误差
+    tables->radix2First = bits % 2 == 1;
+    for (int m = tables->radix2First ? 2 : 1; m < half; m *= 4) {
+        const int offset = tables->twiddles.size();
+        tables->twiddles.resize(offset + 6 * m);
+        float *t = tables->twiddles.data() + offset;
+        for (int j = 0; j < m; ++j) {
+            const double phase = 2.0 * M_PI * j / (4 * m);
+            for (int k = 1; k <= 3; ++k) {
+                t[(2 * k - 2) * m + j] = float(std::cos(k * phase));
+                t[(2 * k - 1) * m + j] = float(std::sin(k * phase));
+            }
+        }
+    }
+    tables->splitCos.resize(half + 1);
+    tables->splitSin.resize(half + 1);
+    for (int k = 0; k <= half; ++k) {
+        const double phase = 2.0 * M_PI * k / size;
+        tables->splitCos[k] = float(std::cos(phase));
+        tables->splitSin[k] = float(std::sin(phase));
+    }
+
+#if defined(ENABLE_FFTW)
+    // FFTW 的计划创建不是线程安全的，放在同一把锁内；分离实部虚部的 guru 接口与本类的频谱布局一致，
+    // 执行时传入的缓冲区不一定与规划时同样对齐，因此加 FFTW_UNALIGNED
+    float *in = fftwf_alloc_real(size);
+    float *re = fftwf_alloc_real(half + 1);
+    float *im = fftwf_alloc_real(half + 1);
+    fftwf_iodim dim;
+    dim.n = size;
+    dim.is = 1;
+    dim.os = 1;
+    const unsigned flags = FFTW_MEASURE | FFTW_UNALIGNED;
+    tables->forwardPlan = fftwf_plan_guru_split_dft_r2c(1, &dim, 0, nullptr, in, re, im, flags);
+    tables->inversePlan = fftwf_plan_guru_split_dft_c2r(1, &dim, 0, nullptr, re, im, in, flags);
+    fftwf_free(in);
+    fftwf_free(re);
+    fftwf_free(im);
+#endif
+
+    cache.insert(size, tables);
+    return tables;
+}
+
+void RealFFT::setSize(int size) {
+    if (!isPowerOfTwo(size) || size < 4) size = qMax(4, nextPowerOfTwo(size));
+    if (size == m_size) return;
+    m_size = size;
+    m_tables = tablesForSize(size);
+    m_workRe.fill(0.0f, size / 2 + 1);
+    m_workIm.fill(0.0f, size / 2 + 1);
+}
+
+void RealFFT::complexTransform(float *re, float *im, bool inverse) {
+    const int n = m_size / 2;
+    const int *swaps = m_tables->swaps.constData();
+    const int swapCount = m_tables->swaps.size();
+    for (int k = 0; k < swapCount; k += 2) {
+        std::swap(re[swaps[k]], re[swaps[k + 1]]);
+        std::swap(im[swaps[k]], im[swaps[k + 1]]);
+    }
+
+    int m = 1;
+    if (m_tables->radix2First) {
+        for (int start = 0; start < n; start += 2) {
+            const float r = re[start + 1], i = im[start + 1];
+            re[start + 1] = re[start] - r;
+            im[start + 1] = im[start] - i;
+            re[start] += r;
+            im[start] += i;
+        }
+        m = 2;
+    }
+    const float *twiddles = m_tables->twiddles.constData();
+    for (; m < n; m *= 4) {
+        if (inverse) {
+            radix4Pass<true>(re, im, n, m, twiddles);
+        } else {
+            radix4Pass<false>(re, im, n, m, twiddles);
+        }
+        twiddles += 6 * m;
+    }
+}
+
+void RealFFT::forward(const float *input, float *re, float *im) {
+#if defined(ENABLE_FFTW)
+    if (useSystemBackend()) {
+        fftwf_execute_split_dft_r2c(m_tables->forwardPlan, const_cast<float*>(input), re, im);
+        return;
+    }
+#endif
+    const int half = m_size / 2;
+    float *zr = m_workRe.data();
+    float *zi = m_workIm.data();
+    // 偶数样本作实部、奇数样本作虚部，做一次 N/2 点复数 FFT
+    for (int n = 0; n < half; ++n) {
+        zr[n] = input[2 * n];
+        zi[n] = input[2 * n + 1];
+    }
+    complexTransform(zr, zi, false);
+
+    // 拆分：X[k] = E[k] + W^k O[k]，E/O 分别为偶、奇样本的频谱
+    const float *wc = m_tables->splitCos.constData();
+    const float *ws = m_tables->splitSin.constData();
+    for (int k = 0; k <= half; ++k) {
+        const int i = k == half ? 0 : k;
+        const int j = k == 0 ? 0 : half - k;
+        const float er = 0.5f * (zr[i] + zr[j]);
+        const float ei = 0.5f * (zi[i] - zi[j]);
+        const float orr = 0.5f * (zi[i] + zi[j]);
+        const float oi = 0.5f * (zr[j] - zr[i]);
+        re[k] = er + wc[k] * orr + ws[k] * oi;
+        im[k] = ei + wc[k] * oi - ws[k] * orr;
+    }
+}
+
+void RealFFT::inverse(const float *re, const float *im, float *output) {
+    const int half = m_size / 2;
+    float *zr = m_workRe.data();
+    float *zi = m_workIm.data();
+#if defined(ENABLE_FFTW)
+    if (useSystemBackend()) {
+        // c2r 会覆盖输入，先复制到工作区；FFTW 不归一化
+        std::copy(re, re + half + 1, zr);
+        std::copy(im, im + half + 1, zi);
+        fftwf_execute_split_dft_c2r(m_tables->inversePlan, zr, zi, output);
+        const float scale = 1.0f / m_size;
+        for (int n = 0; n < m_size; ++n) output[n] *= scale;
+        return;
+    }
+#endif
+    const float *wc = m_tables->splitCos.constData();
+    const float *ws = m_tables->splitSin.constData();
+
+    // 由 X[k] 与 X[N/2-k] 还原 Z[k] = E[k] + i O[k]
+    for (int k = 0; k < half; ++k) {
+        const float xr = re[k], xi = im[k];
+        const float yr = re[half - k], yi = im[half - k];
+        const float er = 0.5f * (xr + yr);
+        const float ei = 0.5f * (xi - yi);
+        const float dr = 0.5f * (xr - yr);
+        const float di = 0.5f * (xi + yi);
+        const float orr = dr * wc[k] - di * ws[k];
+        const float oi = dr * ws[k] + di * wc[k];
+        zr[k] = er - oi;
+        zi[k] = ei + orr;
+    }
+    complexTransform(zr, zi, true);
+
+    const float scale = 1.0f / half;
+    for (int n = 0; n < half; ++n) {
+        output[2 * n] = zr[n] * scale;
+        output[2 * n + 1] = zi[n] * scale;
+    }
+}
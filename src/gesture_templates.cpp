@@ -0,0 +1,279 @@
+#include "../include/gesture_templates.h"
+#include <QHash>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GESTURES_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GESTURES_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+const float kDefaultMaxRotation = float(M_PI / 4.0);
+const float kMaxRotationLimit = 1.5f;      // 闭式解的边界判断要求 θ < π/2
+
+int roundUp4(int n) {
+    return (n + 3) & ~3;
+}
+
+double distance(double dx, double dy) {
+    return std::sqrt(dx * dx + dy * dy);
+}
+}
+
+const int GestureTemplateIndex::kPoints;
+const int GestureTemplateIndex::kDimensions;
+
+GestureTemplateIndex::GestureTemplateIndex(bool orientationSensitive)
+    : m_orientationSensitive(orientationSensitive)
+{
+    setMaxRotation(kDefaultMaxRotation);
+}
+
+void GestureTemplateIndex::setMaxRotation(float radians) {
+    m_maxRotation = qBound(0.0f, radians, kMaxRotationLimit);
+    m_cosMax = std::cos(m_maxRotation);
+    m_sinMax = std::sin(m_maxRotation);
+    m_tanMax = std::tan(m_maxRotation);
+}
+
+bool GestureTemplateIndex::normalize(const QPointF *points, int count, float *out) {
+    if (count < 2) return false;
+    double length = 0.0;
+    for (int i = 1; i < count; ++i) {
+        length += distance(points[i].x() - points[i - 1].x(), points[i].y() - points[i - 1].y());
+    }
+    if (length <= 0.0) return false;
+
+    // 重采样：沿路径每隔 length / (kPoints - 1) 取一点，直接写入 out
+    const double interval = length / (kPoints - 1);
+    double px = points[0].x();
+    double py = points[0].y();
+    out[0] = float(px);
+    out[1] = float(py);
+    int k = 1;
+    double carried = 0.0;
+    for (int i = 1; i < count && k < kPoints; ++i) {
+        const double cx = points[i].x();
+        const double cy = points[i].y();
+        double d = distance(cx - px, cy - py);
+        while (carried + d >= interval && k < kPoints && d > 0.0) {
+            const double t = (interval - carried) / d;
+            px += t * (cx - px);
+            py += t * (cy - py);
+            out[2 * k] = float(px);
+            out[2 * k + 1] = float(py);
+            ++k;
+            d = distance(cx - px, cy - py);
+            carried = 0.0;
+        }
+        carried += d;
+        px = cx;
+        py = cy;
+    }
+    // 舍入误差可能少一个点，用终点补齐
+    for (; k < kPoints; ++k) {
+        out[2 * k] = float(points[count - 1].x());
+        out[2 * k + 1] = float(points[count - 1].y());
+    }
+
+    // 平移到质心，再缩放为单位向量
+    double mx = 0.0;
+    double my = 0.0;
+    for (int j = 0; j < kPoints; ++j) {
+        mx += out[2 * j];
+        my += out[2 * j + 1];
+    }
+    mx /= kPoints;
+    my /= kPoints;
+    double normSq = 0.0;
+    for (int j = 0; j < kPoints; ++j) {
+        out[2 * j] = float(out[2 * j] - mx);
+        out[2 * j + 1] = float(out[2 * j + 1] - my);
+        normSq += double(out[2 * j]) * out[2 * j] + double(out[2 * j + 1]) * out[2 * j + 1];
+    }
+    if (normSq <= 0.0) return false;
+    const float scale = float(1.0 / std::sqrt(normSq));
+    for (int d = 0; d < kDimensions; ++d) out[d] *= scale;
+    return true;
+}
+
+bool GestureTemplateIndex::add(const QString &name, const QVector<QPointF> &path) {
+    float vector[kDimensions];
+    if (name.isEmpty() || !normalize(path.constData(), path.size(), vector)) return false;
+    const int slot = m_names.size();
+    // 按组扩容，空位补零，扫描时不需要处理尾部
+    if ((slot & 3) == 0) m_blocks.resize(m_blocks.size() + kDimensions * 4);
+    for (int d = 0; d < kDimensions; ++d) component(slot, d) = vector[d];
+    m_names.append(name);
+    return true;
+}
+
+int GestureTemplateIndex::remove(const QString &name) {
+    int removed = 0;
+    for (int slot = m_names.size() - 1; slot >= 0; --slot) {
+        if (m_names[slot] != name) continue;
+        // 末尾样本移入空位
+        const int last = m_names.size() - 1;
+        for (int d = 0; d < kDimensions; ++d) {
+            component(slot, d) = component(last, d);
+            component(last, d) = 0.0f;
+        }
+        m_names[slot] = m_names[last];
+        m_names.removeLast();
+        if ((last & 3) == 0) m_blocks.resize(m_blocks.size() - kDimensions * 4);
+        ++removed;
+    }
+    return removed;
+}
+
+void GestureTemplateIndex::clear() {
+    m_blocks.clear();
+    m_names.clear();
+}
+
+QStringList GestureTemplateIndex::names() const {
+    QStringList result;
+    for (const QString &name : m_names) {
+        if (!result.contains(name)) result.append(name);
+    }
+    return result;
+}
+
+void GestureTemplateIndex::scoreAll(const float *g, float *out) const {
+    // w 为 g 逐点旋转 90°：t·w = Σ(tx·gy − ty·gx) = b
+    float w[kDimensions];
+    for (int j = 0; j < kPoints; ++j) {
+        w[2 * j] = g[2 * j + 1];
+        w[2 * j + 1] = -g[2 * j];
+    }
+#if defined(GESTURES_HAVE_SSE2)
+    // 广播只做一次，所有组共用
+    __m128 gv[kDimensions];
+    __m128 wv[kDimensions];
+    for (int d = 0; d < kDimensions; ++d) {
+        gv[d] = _mm_set1_ps(g[d]);
+        wv[d] = _mm_set1_ps(w[d]);
+    }
+#endif
+
+    const int used = roundUp4(m_names.size());
+    for (int i = 0; i < used; i += 4) {
+        const float *block = m_blocks.constData() + (i >> 2) * kDimensions * 4;
+        float a[4];
+        float b[4];
+        // x、y 分量各用一组累加器，拆开加法的依赖链
+#if defined(GESTURES_HAVE_SSE2)
+        __m128 accAx = _mm_setzero_ps();
+        __m128 accAy = _mm_setzero_ps();
+        __m128 accBx = _mm_setzero_ps();
+        __m128 accBy = _mm_setzero_ps();
+        for (int d = 0; d < kDimensions; d += 2) {
+            const __m128 tx = _mm_loadu_ps(block + d * 4);
+            const __m128 ty = _mm_loadu_ps(block + d * 4 + 4);
+            accAx = _mm_add_ps(accAx, _mm_mul_ps(tx, gv[d]));
+            accAy = _mm_add_ps(accAy, _mm_mul_ps(ty, gv[d + 1]));
+            accBx = _mm_add_ps(accBx, _mm_mul_ps(tx, wv[d]));
+            accBy = _mm_add_ps(accBy, _mm_mul_ps(ty, wv[d + 1]));
+        }
+        _mm_storeu_ps(a, _mm_add_ps(accAx, accAy));
+        _mm_storeu_ps(b, _mm_add_ps(accBx, accBy));
+#elif defined(GESTURES_HAVE_NEON)
+        float32x4_t accAx = vdupq_n_f32(0.0f);
+        float32x4_t accAy = vdupq_n_f32(0.0f);
+        float32x4_t accBx = vdupq_n_f32(0.0f);
+        float32x4_t accBy = vdupq_n_f32(0.0f);
+        for (int d = 0; d < kDimensions; d += 2) {
+            const float32x4_t tx = vld1q_f32(block + d * 4);
+            const float32x4_t ty = vld1q_f32(block + d * 4 + 4);
+            accAx = vmlaq_n_f32(accAx, tx, g[d]);
+            accAy = vmlaq_n_f32(accAy, ty, g[d + 1]);
+            accBx = vmlaq_n_f32(accBx, tx, w[d]);
+            accBy = vmlaq_n_f32(accBy, ty, w[d + 1]);
+        }
+        vst1q_f32(a, vaddq_f32(accAx, accAy));
+        vst1q_f32(b, vaddq_f32(accBx, accBy));
+#else
+        std::fill(a, a + 4, 0.0f);
+        std::fill(b, b + 4, 0.0f);
+        for (int d = 0; d < kDimensions; ++d) {
+            const float *t = block + d * 4;
+            for (int j = 0; j < 4; ++j) {
+                a[j] += t[j] * g[d];
+                b[j] += t[j] * w[d];
+            }
+        }
+#endif
+        // 最优旋转 θ0 = atan2(b, a) 时相似度为 √(a² + b²)；θ0 超出允许范围时取边界 ±maxRotation
+        for (int j = 0; j < 4 && i + j < m_names.size(); ++j) {
+            const float r = std::sqrt(a[j] * a[j] + b[j] * b[j]);
+            if (!m_orientationSensitive || (a[j] > 0.0f && std::abs(b[j]) <= a[j] * m_tanMax)) {
+                out[i + j] = r;
+            } else {
+                out[i + j] = a[j] * m_cosMax + std::abs(b[j]) * m_sinMax;
+            }
+        }
+    }
+}
+
+GestureTemplateIndex::Match GestureTemplateIndex::best(const QVector<QPointF> &path, float minScore) const {
+    Match result;
+    float vector[kDimensions];
+    if (m_names.isEmpty() || !normalize(path.constData(), path.size(), vector)) return result;
+    QVector<float> scores(roundUp4(m_names.size()));
+    scoreAll(vector, scores.data());
+    for (int i = 0; i < m_names.size(); ++i) {
+        if (scores[i] > result.score) {
+            result.score = scores[i];
+            result.name = m_names[i];
+        }
+    }
+    if (result.score < minScore) result.name.clear();
+    return result;
+}
+
+QVector<GestureTemplateIndex::Match> GestureTemplateIndex::match(const QVector<QPointF> &path, int k) const {
+    QVector<Match> result;
+    float vector[kDimensions];
+    if (k <= 0 || m_names.isEmpty() || !normalize(path.constData(), path.size(), vector)) return result;
+    QVector<float> scores(roundUp4(m_names.size()));
+    scoreAll(vector, scores.data());
+
+    QHash<QString, float> bestByName;
+    for (int i = 0; i < m_names.size(); ++i) {
+        auto it = bestByName.find(m_names[i]);
+        if (it == bestByName.end()) {
+            bestByName.insert(m_names[i], scores[i]);
+        } else if (scores[i] > it.value()) {
+            it.value() = scores[i];
+        }
+    }
+    for (auto it = bestByName.constBegin(); it != bestByName.constEnd(); ++it) {
+        Match m;
+        m.name = it.key();
+        m.score = it.value();
+        result.append(m);
+    }
+    std::sort(result.begin(), result.end(), [](const Match &x, const Match &y) { return x.score > y.score; });
+    if (result.size() > k) result.resize(k);
+    return result;
+}
+
+float GestureTemplateIndex::score(const QVector<QPointF> &path, const QString &name) const {
+    if (!m_names.contains(name)) return -1.0f;
+    float vector[kDimensions];
+    if (!normalize(path.constData(), path.size(), vector)) return -1.0f;
+    QVector<float> scores(roundUp4(m_names.size()));
+    scoreAll(vector, scores.data());
+    float best = -1.0f;
+    for (int i = 0; i < m_names.size(); ++i) {
+        if (m_names[i] == name) best = qMax(best, scores[i]);
+    }
+    return best;
+}
@@ -0,0 +1,353 @@
+#include "../include/hrtf.h"
+#include "../include/impulse_response.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const int kNeighbourCount = 3;
+
+void setError(QString *errorMessage, const QString &message) {
+    if (errorMessage) *errorMessage = message;
+}
+
+QVector<float> toFloatVector(const QJsonArray &array) {
+    QVector<float> values(array.size());
+    for (int i = 0; i < array.size(); ++i) {
+        values[i] = float(array.at(i).toDouble());
+    }
+    return values;
+}
+
+// 渲染器坐标系（x 向右、y 向上、z 向前）下的单位向量，方位角向右为正
+void directionVector(float azimuth, float elevation, float *v) {
+    const float a = qDegreesToRadians(azimuth);
+    const float e = qDegreesToRadians(elevation);
+    v[0] = std::cos(e) * std::sin(a);
+    v[1] = std::sin(e);
+    v[2] = std::cos(e) * std::cos(a);
+}
+}
+
+int HrtfDataset::irLength() const {
+    int length = 0;
+    for (const Measurement &measurement : measurements) {
+        length = qMax(length, qMax(measurement.left.size(), measurement.right.size()));
+    }
+    return length;
+}
+
+HrtfDataset HrtfDataset::loadSofaJson(const QString &filePath, QString *errorMessage) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorMessage, QString("无法打开 HRTF 文件: %1").arg(filePath));
+        return HrtfDataset();
+    }
+    return fromSofaJson(file.readAll(), errorMessage);
+}
+
+HrtfDataset HrtfDataset::fromSofaJson(const QByteArray &data, QString *errorMessage) {
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        setError(errorMessage, "不是有效的 SOFA JSON 文件");
+        return HrtfDataset();
+    }
+    const QJsonObject root = document.object();
+
+    // Data.SamplingRate 在 SOFA 中是长度为 1 的数组，导出时可能被展开为标量
+    const QJsonValue rateValue = root.value("Data.SamplingRate");
+    const int sampleRate = rateValue.isArray() ? rateValue.toArray().at(0).toInt()
+                                               : rateValue.toInt();
+    const QJsonArray positions = root.value("SourcePosition").toArray();
+    const QJsonArray impulses = root.value("Data.IR").toArray();
+    if (sampleRate <= 0 || positions.isEmpty() || positions.size() != impulses.size()) {
+        setError(errorMessage, "SOFA 数据缺少采样率、声源方向或 HRIR，或两者数量不一致");
+        return HrtfDataset();
+    }
+    const bool cartesian = root.value("SourcePosition_Type").toString().compare("cartesian", Qt::CaseInsensitive) == 0;
+
+    HrtfDataset dataset;
+    dataset.sampleRate = sampleRate;
+    dataset.measurements.reserve(positions.size());
+    for (int m = 0; m < positions.size(); ++m) {
+        const QJsonArray position = positions.at(m).toArray();
+        const QJsonArray receivers = impulses.at(m).toArray();
+        if (position.size() < 2 || receivers.size() < 2) {
+            setError(errorMessage, QString("第 %1 个测量点格式不正确（需要两个接收点）").arg(m));
+            return HrtfDataset();
+        }
+
+        Measurement measurement;
+        if (cartesian) {
+            // SOFA 直角坐标：x 向前、y 向左、z 向上
+            const double x = position.at(0).toDouble();
+            const double y = position.at(1).toDouble();
+            const double z = position.size() > 2 ? position.at(2).toDouble() : 0.0;
+            measurement.azimuth = float(qRadiansToDegrees(std::atan2(y, x)));
+            measurement.elevation = float(qRadiansToDegrees(std::atan2(z, std::sqrt(x * x + y * y))));
+        } else {
+            measurement.azimuth = float(position.at(0).toDouble());
+            measurement.elevation = float(position.at(1).toDouble());
+        }
+        measurement.left = toFloatVector(receivers.at(0).toArray());
+        measurement.right = toFloatVector(receivers.at(1).toArray());
+        dataset.measurements.append(measurement);
+    }
+
+    if (dataset.irLength() == 0) {
+        setError(errorMessage, "HRIR 长度为零");
+        return HrtfDataset();
+    }
+    return dataset;
+}
+
+HrtfDataset HrtfDataset::resampled(int targetRate) const {
+    if (isEmpty() || targetRate <= 0 || targetRate == sampleRate) return *this;
+
+    HrtfDataset dataset;
+    dataset.sampleRate = targetRate;
+    dataset.measurements.reserve(measurements.size());
+    for (const Measurement &measurement : measurements) {
+        ImpulseResponse response;
+        response.sampleRate = sampleRate;
+        response.channels << measurement.left << measurement.right;
+        response = response.resampled(targetRate);
+
+        Measurement target = measurement;
+        target.left = response.channels[0];
+        target.right = response.channels[1];
+        dataset.measurements.append(target);
+    }
+    return dataset;
+}
+
+HrtfRenderer::HrtfRenderer()
+    : m_partitionSize(0)
+    , m_partitionCount(0)
+    , m_binCount(0)
+    , m_directionCount(0)
+    , m_activeFilter(0)
+    , m_hasFilter(false)
+    , m_targetAzimuth(0.0f)
+    , m_targetElevation(0.0f)
+    , m_filterAzimuth(0.0f)
+    , m_filterElevation(0.0f)
+    , m_delayLinePos(0)
+    , m_fifoPos(0)
+{
+}
+
+void HrtfRenderer::setDataset(const HrtfDataset &dataset, int partitionSize) {
+    const int length = dataset.irLength();
+    m_partitionSize = RealFFT::nextPowerOfTwo(qMax(partitionSize, 2));
+    m_partitionCount = length > 0 ? (length + m_partitionSize - 1) / m_partitionSize : 0;
+    m_binCount = m_partitionSize + 1;
+    m_directionCount = m_partitionCount > 0 ? dataset.measurements.size() : 0;
+
+    const int fftSize = 2 * m_partitionSize;
+    const int spectrumSize = 2 * m_binCount;
+    const int filterSize = 2 * m_partitionCount * spectrumSize;
+    m_fft.setSize(fftSize);
+
+    // SOFA 方位角向左为正，渲染器向右为正
+    m_directions.resize(m_directionCount * 3);
+    m_spectra.fill(0.0f, m_directionCount * filterSize);
+    QVector<float> padded(fftSize, 0.0f);
+    for (int d = 0; d < m_directionCount; ++d) {
+        const HrtfDataset::Measurement &measurement = dataset.measurements[d];
+        directionVector(-measurement.azimuth, measurement.elevation, m_directions.data() + d * 3);
+        const QVector<float> *ears[2] = {&measurement.left, &measurement.right};
+        for (int ear = 0; ear < 2; ++ear) {
+            const QVector<float> &impulse = *ears[ear];
+            for (int p = 0; p < m_partitionCount; ++p) {
+                const int offset = p * m_partitionSize;
+                const int count = qBound(0, impulse.size() - offset, m_partitionSize);
+                padded.fill(0.0f);
+                if (count > 0) std::memcpy(padded.data(), impulse.constData() + offset, sizeof(float) * count);
+                float *spectrum = m_spectra.data() + d * filterSize + (ear * m_partitionCount + p) * spectrumSize;
+                m_fft.forward(padded.constData(), spectrum, spectrum + m_binCount);
+            }
+        }
+    }
+
+    m_filters[0].fill(0.0f, filterSize);
+    m_filters[1].fill(0.0f, filterSize);
+    m_activeFilter = 0;
+    m_hasFilter = false;
+    m_delayLine.fill(0.0f, m_partitionCount * spectrumSize);
+    m_inputWindow.fill(0.0f, fftSize);
+    m_outputBlock.fill(0.0f, 2 * m_partitionSize);
+    m_fadeBlock.fill(0.0f, 2 * m_partitionSize);
+    m_accumRe.fill(0.0f, m_binCount);
+    m_accumIm.fill(0.0f, m_binCount);
+    m_timeScratch.fill(0.0f, fftSize);
+    m_delayLinePos = 0;
+    m_fifoPos = 0;
+}
+
+void HrtfRenderer::reset() {
+    m_delayLine.fill(0.0f);
+    m_inputWindow.fill(0.0f);
+    m_outputBlock.fill(0.0f);
+    m_delayLinePos = 0;
+    m_fifoPos = 0;
+}
+
+void HrtfRenderer::setDirection(float azimuth, float elevation) {
+    m_targetAzimuth = azimuth;
+    m_targetElevation = elevation;
+}
+
+void HrtfRenderer::process(const float *input, float *left, float *right, int frames) {
+    if (m_directionCount == 0) {
+        std::memset(left, 0, sizeof(float) * frames);
+        std::memset(right, 0, sizeof(float) * frames);
+        return;
+    }
+
+    const int size = m_partitionSize;
+    float *window = m_inputWindow.data();
+    const float *delayed = m_outputBlock.constData();
+    int done = 0;
+    while (done < frames) {
+        const int count = qMin(frames - done, size - m_fifoPos);
+        // 先取输入再写输出，允许就地处理
+        std::memcpy(window + size + m_fifoPos, input + done, sizeof(float) * count);
+        std::memcpy(left + done, delayed + m_fifoPos, sizeof(float) * count);
+        std::memcpy(right + done, delayed + size + m_fifoPos, sizeof(float) * count);
+        m_fifoPos += count;
+        done += count;
+        if (m_fifoPos == size) {
+            processPartition();
+            m_fifoPos = 0;
+        }
+    }
+}
+
+void HrtfRenderer::interpolateFilter(float azimuth, float elevation, float *filter) const {
+    float target[3];
+    directionVector(azimuth, elevation, target);
+
+    // 线性扫描找余弦最大的三个测量点；只在方向变化时执行，M 个点各一次点积
+    int nearest[kNeighbourCount];
+    float cosines[kNeighbourCount];
+    const int neighbours = qMin(kNeighbourCount, m_directionCount);
+    for (int n = 0; n < neighbours; ++n) {
+        nearest[n] = -1;
+        cosines[n] = -2.0f;
+    }
+    for (int d = 0; d < m_directionCount; ++d) {
+        const float *v = m_directions.constData() + d * 3;
+        float cosine = v[0] * target[0] + v[1] * target[1] + v[2] * target[2];
+        int index = d;
+        for (int n = 0; n < neighbours; ++n) {
+            if (cosine > cosines[n]) {
+                qSwap(cosine, cosines[n]);
+                qSwap(index, nearest[n]);
+            }
+        }
+    }
+
+    // 按角距离反比加权；与最近点几乎重合时直接取该点
+    float weights[kNeighbourCount];
+    float total = 0.0f;
+    for (int n = 0; n < neighbours; ++n) {
+        const float angle = std::acos(qBound(-1.0f, cosines[n], 1.0f));
+        if (angle < 1e-3f) {
+            for (int k = 0; k < neighbours; ++k) weights[k] = k == n ? 1.0f : 0.0f;
+            total = 1.0f;
+            break;
+        }
+        weights[n] = 1.0f / angle;
+        total += weights[n];
+    }
+
+    const int filterSize = 2 * m_partitionCount * 2 * m_binCount;
+    const float *first = m_spectra.constData() + nearest[0] * filterSize;
+    const float w0 = weights[0] / total;
+    for (int i = 0; i < filterSize; ++i) filter[i] = first[i] * w0;
+    for (int n = 1; n < neighbours; ++n) {
+        const float w = weights[n] / total;
+        if (w == 0.0f) continue;
+        const float *spectrum = m_spectra.constData() + nearest[n] * filterSize;
+        for (int i = 0; i < filterSize; ++i) filter[i] += spectrum[i] * w;
+    }
+}
+
+void HrtfRenderer::convolve(const float *filter, float *output) {
+    const int size = m_partitionSize;
+    const int bins = m_binCount;
+    const int spectrumSize = 2 * bins;
+    float *accRe = m_accumRe.data();
+    float *accIm = m_accumIm.data();
+
+    for (int ear = 0; ear < 2; ++ear) {
+        // Y = Σ X[i - p] · H[p]
+        std::memset(accRe, 0, sizeof(float) * bins);
+        std::memset(accIm, 0, sizeof(float) * bins);
+        int slotIndex = m_delayLinePos;
+        for (int p = 0; p < m_partitionCount; ++p) {
+            const float *xr = m_delayLine.constData() + slotIndex * spectrumSize;
+            const float *xi = xr + bins;
+            const float *hr = filter + (ear * m_partitionCount + p) * spectrumSize;
+            const float *hi = hr + bins;
+            for (int k = 0; k < bins; ++k) {
+                accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+            }
+            if (--slotIndex < 0) slotIndex = m_partitionCount - 1;
+        }
+        m_fft.inverse(accRe, accIm, m_timeScratch.data());
+        std::memcpy(output + ear * size, m_timeScratch.constData() + size, sizeof(float) * size);
+    }
+}
+
+void HrtfRenderer::processPartition() {
+    const int size = m_partitionSize;
+    const int bins = m_binCount;
+    float *window = m_inputWindow.data();
+
+    float *slot = m_delayLine.data() + m_delayLinePos * 2 * bins;
+    m_fft.forward(window, slot, slot + bins);
+
+    const bool moved = !m_hasFilter || m_targetAzimuth != m_filterAzimuth || m_targetElevation != m_filterElevation;
+    if (moved) {
+        float *next = m_filters[1 - m_activeFilter].data();
+        interpolateFilter(m_targetAzimuth, m_targetElevation, next);
+        m_filterAzimuth = m_targetAzimuth;
+        m_filterElevation = m_targetElevation;
+    }
+
+    float *output = m_outputBlock.data();
+    if (!m_hasFilter) {
+        // 首个分区没有旧滤波器可淡出
+        m_activeFilter = 1 - m_activeFilter;
+        m_hasFilter = true;
+        convolve(m_filters[m_activeFilter].constData(), output);
+    } else if (moved) {
+        // 新旧滤波器共用同一条输入延迟线，在本分区内从旧输出线性过渡到新输出
+        float *faded = m_fadeBlock.data();
+        convolve(m_filters[m_activeFilter].constData(), output);
+        convolve(m_filters[1 - m_activeFilter].constData(), faded);
+        const float step = 1.0f / size;
+        for (int ear = 0; ear < 2; ++ear) {
+            float *out = output + ear * size;
+            const float *in = faded + ear * size;
+            for (int i = 0; i < size; ++i) {
+                const float gain = (i + 0.5f) * step;
+                out[i] += (in[i] - out[i]) * gain;
+            }
+        }
+        m_activeFilter = 1 - m_activeFilter;
+    } else {
+        convolve(m_filters[m_activeFilter].constData(), output);
+    }
+
+    std::memcpy(window, window + size, sizeof(float) * size);
+    if (++m_delayLinePos >= m_partitionCount) m_delayLinePos = 0;
+}
@@ -0,0 +1,356 @@
+#include "../include/http_cache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+const qint64 kMemoryBytes = 8 * 1024 * 1024;
+const qint64 kMemoryEntryBytes = 512 * 1024;    // 更大的条目只留在磁盘上
+const qint64 kHeaderOverhead = 256;             // 估算每个文件的头部与文件系统开销
+const qint64 kTouchIntervalMs = 3600 * 1000;    // 命中时至多每小时更新一次文件修改时间
+
+QJsonObject headerFor(const HttpCache::Entry &entry) {
+    QJsonObject header;
+    header["etag"] = QString::fromLatin1(entry.etag);
+    header["lastModified"] = QString::fromLatin1(entry.lastModified);
+    header["contentType"] = QString::fromLatin1(entry.contentType);
+    header["status"] = entry.status;
+    header["stored"] = double(entry.storedAt);
+    header["expires"] = double(entry.expiresAt);
+    return header;
+}
+
+void applyHeader(const QJsonObject &header, HttpCache::Entry *entry) {
+    entry->etag = header["etag"].toString().toLatin1();
+    entry->lastModified = header["lastModified"].toString().toLatin1();
+    entry->contentType = header["contentType"].toString().toLatin1();
+    entry->status = header["status"].toInt(200);
+    entry->storedAt = qint64(header["stored"].toDouble());
+    entry->expiresAt = qint64(header["expires"].toDouble());
+}
+}
+
+class HttpCache::WriteTask : public QRunnable {
+public:
+    WriteTask(HttpCache *cache, const QString &fileName, quint64 generation)
+        : m_cache(cache), m_fileName(fileName), m_generation(generation) {}
+
+    void run() override { m_cache->writePending(m_fileName, m_generation); }
+
+private:
+    HttpCache *m_cache;
+    QString m_fileName;
+    quint64 m_generation;
+};
+
+HttpCache::HttpCache(qint64 maxBytes)
+    : m_maxBytes(qMax<qint64>(1024 * 1024, maxBytes))
+    , m_totalBytes(0)
+    , m_memoryBytes(0)
+    , m_nextGeneration(0)
+{
+    m_writer.setMaxThreadCount(1);
+}
+
+HttpCache::~HttpCache() {
+    // 已入队的写入全部落盘，下次启动仍能命中
+    m_writer.waitForDone();
+}
+
+bool HttpCache::open(const QString &directory) {
+    // 先让旧目录的写入收尾，再切换目录
+    m_writer.waitForDone();
+    QMutexLocker locker(&m_mutex);
+    m_directory.clear();
+    m_index.clear();
+    m_memory.clear();
+    m_memoryOrder.clear();
+    m_pendingWrites.clear();
+    m_totalBytes = 0;
+    m_memoryBytes = 0;
+
+    QDir dir(directory);
+    if (!dir.mkpath(".")) {
+        qWarning() << "Failed to create HTTP cache directory:" << directory;
+        return false;
+    }
+    m_directory = dir.absolutePath();
+
+    // 文件名即键的哈希；修改时间作为跨进程的最近使用时间
+    const QFileInfoList files = dir.entryInfoList(QDir::Files);
+    for (const QFileInfo &info : files) {
+        if (info.fileName().size() != 40) continue;
+        IndexEntry index;
+        index.bytes = info.size() + kHeaderOverhead;
+        index.lastUsed = info.lastModified().toMSecsSinceEpoch();
+        index.onDisk = index.lastUsed;
+        m_index.insert(info.fileName(), index);
+        m_totalBytes += index.bytes;
+    }
+    evictLocked();
+    return true;
+}
+
+bool HttpCache::isOpen() const {
+    QMutexLocker locker(&m_mutex);
+    return !m_directory.isEmpty();
+}
+
+QString HttpCache::directory() const {
+    QMutexLocker locker(&m_mutex);
+    return m_directory;
+}
+
+QString HttpCache::pathFor(const QString &fileName) const {
+    return m_directory + "/" + fileName;
+}
+
+QString HttpCache::fileNameFor(const QString &key) {
+    return QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+bool HttpCache::readEntry(const QString &path, Entry *entry) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray headerLine = file.readLine();
+    const QJsonObject header = QJsonDocument::fromJson(headerLine).object();
+    if (header.isEmpty()) return false;
+    applyHeader(header, entry);
+    entry->body = file.readAll();
+    return true;
+}
+
+bool HttpCache::writeEntry(const QString &path, const Entry &entry) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(headerFor(entry)).toJson(QJsonDocument::Compact) + '\n');
+    file.write(entry.body);
+    return file.commit();
+}
+
+void HttpCache::touchMemory(const QString &fileName, const Entry &entry) {
+    if (entry.body.size() > kMemoryEntryBytes) return;
+    auto it = m_memory.find(fileName);
+    if (it != m_memory.end()) {
+        m_memoryBytes -= it.value().body.size();
+        m_memoryOrder.removeOne(fileName);
+    }
+    m_memory.insert(fileName, entry);
+    m_memoryOrder.append(fileName);
+    m_memoryBytes += entry.body.size();
+    while (m_memoryBytes > kMemoryBytes && !m_memoryOrder.isEmpty()) {
+        const QString oldest = m_memoryOrder.takeFirst();
+        m_memoryBytes -= m_memory.take(oldest).body.size();
+    }
+}
+
+bool HttpCache::cachedLocked(const QString &fileName, Entry *entry) const {
+    // 待写表里的比内存副本新
+    auto pending = m_pendingWrites.constFind(fileName);
+    if (pending != m_pendingWrites.constEnd()) {
+        *entry = pending.value().entry;
+        return true;
+    }
+    auto cached = m_memory.constFind(fileName);
+    if (cached != m_memory.constEnd()) {
+        *entry = cached.value();
+        return true;
+    }
+    return false;
+}
+
+QString HttpCache::markUsedLocked(const QString &fileName, IndexEntry &index) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    index.lastUsed = now;
+    // 待写的条目落盘时修改时间自然更新
+    if (now - index.onDisk < kTouchIntervalMs || m_pendingWrites.contains(fileName)) return QString();
+    index.onDisk = now;
+    return pathFor(fileName);
+}
+
+void HttpCache::touchFile(const QString &path) {
+    // 只读打开，文件已被删除时不会重新创建
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+}
+
+bool HttpCache::load(const QString &fileName, Entry *entry) {
+    QString path;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto index = m_index.find(fileName);
+        if (m_directory.isEmpty() || index == m_index.end()) return false;
+        if (cachedLocked(fileName, entry)) {
+            touchMemory(fileName, *entry);
+            path = markUsedLocked(fileName, index.value());
+            locker.unlock();
+            if (!path.isEmpty()) touchFile(path);
+            return true;
+        }
+        path = pathFor(fileName);
+    }
+
+    // 读盘不持锁，大封面不会挡住其他线程的查询
+    const bool read = readEntry(path, entry);
+
+    QMutexLocker locker(&m_mutex);
+    auto index = m_index.find(fileName);
+    if (index == m_index.end()) return false;       // 读盘期间被删除或淘汰
+    if (!cachedLocked(fileName, entry) && !read) {  // 期间有新写入时以新内容为准
+        // 文件被外部删除或损坏
+        removeLocked(fileName);
+        return false;
+    }
+    touchMemory(fileName, *entry);
+    const QString touchPath = markUsedLocked(fileName, index.value());
+    locker.unlock();
+    if (!touchPath.isEmpty()) touchFile(touchPath);
+    return true;
+}
+
+bool HttpCache::lookup(const QString &key, Entry *entry) {
+    return load(fileNameFor(key), entry);
+}
+
+void HttpCache::queueWriteLocked(const QString &fileName, const Entry &entry) {
+    PendingWrite &pending = m_pendingWrites[fileName];
+    pending.entry = entry;
+    pending.generation = ++m_nextGeneration;
+    m_writer.start(new WriteTask(this, fileName, pending.generation));
+}
+
+void HttpCache::writePending(const QString &fileName, quint64 generation) {
+    Entry entry;
+    QString path;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto pending = m_pendingWrites.constFind(fileName);
+        // 已被更新的写入取代（由后面的任务负责），或条目已删除
+        if (pending == m_pendingWrites.constEnd() || pending.value().generation != generation) return;
+        entry = pending.value().entry;
+        path = pathFor(fileName);
+    }
+
+    const bool written = writeEntry(path, entry);
+
+    QMutexLocker locker(&m_mutex);
+    auto pending = m_pendingWrites.find(fileName);
+    const bool current = pending != m_pendingWrites.end() && pending.value().generation == generation;
+    if (current) m_pendingWrites.erase(pending);
+    if (!written) {
+        qWarning() << "Failed to write HTTP cache entry:" << path;
+        if (current) removeLocked(fileName);
+    } else if (!m_index.contains(fileName)) {
+        // 写盘期间条目被删除或淘汰：刚写出的文件不能留下
+        QFile::remove(path);
+    } else {
+        m_index[fileName].onDisk = QDateTime::currentMSecsSinceEpoch();
+    }
+}
+
+void HttpCache::insert(const QString &key, const Entry &entry) {
+    QMutexLocker locker(&m_mutex);
+    if (m_directory.isEmpty()) return;
+    const QString fileName = fileNameFor(key);
+    IndexEntry &index = m_index[fileName];
+    m_totalBytes -= index.bytes;
+    index.bytes = entry.body.size() + kHeaderOverhead;
+    index.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    m_totalBytes += index.bytes;
+    touchMemory(fileName, entry);
+    queueWriteLocked(fileName, entry);
+    evictLocked();
+}
+
+bool HttpCache::refresh(const QString &key, qint64 expiresAt, const QByteArray &etag) {
+    const QString fileName = fileNameFor(key);
+    Entry entry;
+    if (!load(fileName, &entry)) return false;
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_index.contains(fileName)) return false;
+    entry.expiresAt = expiresAt;
+    if (!etag.isEmpty()) entry.etag = etag;
+    m_index[fileName].lastUsed = QDateTime::currentMSecsSinceEpoch();
+    touchMemory(fileName, entry);
+    queueWriteLocked(fileName, entry);
+    return true;
+}
+
+void HttpCache::remove(const QString &key) {
+    QMutexLocker locker(&m_mutex);
+    if (m_directory.isEmpty()) return;
+    removeLocked(fileNameFor(key));
+}
+
+void HttpCache::removeLocked(const QString &fileName) {
+    auto index = m_index.find(fileName);
+    if (index != m_index.end()) {
+        m_totalBytes -= index.value().bytes;
+        m_index.erase(index);
+    }
+    auto cached = m_memory.find(fileName);
+    if (cached != m_memory.end()) {
+        m_memoryBytes -= cached.value().body.size();
+        m_memory.erase(cached);
+        m_memoryOrder.removeOne(fileName);
+    }
+    m_pendingWrites.remove(fileName);
+    QFile::remove(pathFor(fileName));
+}
+
+void HttpCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    if (m_directory.isEmpty()) return;
+    const QStringList fileNames = m_index.keys();
+    for (const QString &fileName : fileNames) QFile::remove(pathFor(fileName));
+    m_index.clear();
+    m_memory.clear();
+    m_memoryOrder.clear();
+    m_pendingWrites.clear();
+    m_totalBytes = 0;
+    m_memoryBytes = 0;
+}
+
+int HttpCache::size() const {
+    QMutexLocker locker(&m_mutex);
+    return m_index.size();
+}
+
+qint64 HttpCache::totalBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
+
+void HttpCache::setMaxBytes(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    m_maxBytes = qMax<qint64>(1024 * 1024, bytes);
+    evictLocked();
+}
+
+void HttpCache::evictLocked() {
+    if (m_totalBytes <= m_maxBytes) return;
+    // 一次淘汰到上限的 90%，避免每次插入都排序
+    QVector<QPair<qint64, QString>> byAge;
+    byAge.reserve(m_index.size());
+    for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+        byAge.append(qMakePair(it.value().lastUsed, it.key()));
+    }
+    std::sort(byAge.begin(), byAge.end());
+    const qint64 target = m_maxBytes / 10 * 9;
+    for (const auto &item : byAge) {
+        if (m_totalBytes <= target) break;
+        removeLocked(item.second);
+    }
+}
@@ -0,0 +1,173 @@
+#include "../include/impulse_response.h"
+#include <QFile>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const quint16 kWaveFormatPcm = 1;
+const quint16 kWaveFormatFloat = 3;
+const quint16 kWaveFormatExtensible = 0xFFFE;
+
+void setError(QString *errorMessage, const QString &message) {
+    if (errorMessage) *errorMessage = message;
+}
+
+float readSample(const uchar *p, quint16 format, int bits) {
+    if (format == kWaveFormatFloat) {
+        return bits == 32 ? qFromLittleEndian<float>(p) : float(qFromLittleEndian<double>(p));
+    }
+    switch (bits) {
+    case 8:
+        return (int(p[0]) - 128) / 128.0f;
+    case 16:
+        return qFromLittleEndian<qint16>(p) / 32768.0f;
+    case 24: {
+        const qint32 value = qint32(p[0]) | (qint32(p[1]) << 8) | (qint32(qint8(p[2])) << 16);
+        return value / 8388608.0f;
+    }
+    case 32:
+        return float(qFromLittleEndian<qint32>(p) / 2147483648.0);
+    }
+    return 0.0f;
+}
+}
+
+ImpulseResponse ImpulseResponse::loadWav(const QString &filePath, QString *errorMessage) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorMessage, QString("无法打开脉冲响应文件: %1").arg(filePath));
+        return ImpulseResponse();
+    }
+    return fromWavData(file.readAll(), errorMessage);
+}
+
+ImpulseResponse ImpulseResponse::fromWavData(const QByteArray &data, QString *errorMessage) {
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const int size = data.size();
+    if (size < 12 || std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) {
+        setError(errorMessage, "不是有效的 WAV 文件");
+        return ImpulseResponse();
+    }
+
+    quint16 format = 0;
+    int channels = 0;
+    int sampleRate = 0;
+    int bits = 0;
+    const uchar *samples = nullptr;
+    qint64 sampleBytes = 0;
+
+    // 逐个遍历 RIFF 子块，块长度为奇数时有一个填充字节
+    qint64 pos = 12;
+    while (pos + 8 <= size) {
+        const uchar *chunk = bytes + pos;
+        const qint64 chunkSize = qFromLittleEndian<quint32>(chunk + 4);
+        const qint64 available = qMin(chunkSize, size - pos - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            format = qFromLittleEndian<quint16>(chunk + 8);
+            channels = qFromLittleEndian<quint16>(chunk + 10);
+            sampleRate = int(qFromLittleEndian<quint32>(chunk + 12));
+            bits = qFromLittleEndian<quint16>(chunk + 22);
+            if (format == kWaveFormatExtensible && available >= 26) {
+                // 扩展格式的子格式 GUID 前两个字节即实际格式码
+                format = qFromLittleEndian<quint16>(chunk + 32);
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            sampleBytes = available;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    const bool supported = (format == kWaveFormatPcm && (bits == 8 || bits == 16 || bits == 24 || bits == 32))
+                        || (format == kWaveFormatFloat && (bits == 32 || bits == 64));
+    if (!supported || channels <= 0 || sampleRate <= 0) {
+        setError(errorMessage, QString("不支持的 WAV 格式（格式 %1，%2 位）").arg(format).arg(bits));
+        return ImpulseResponse();
+    }
+    if (!samples || sampleBytes <= 0) {
+        setError(errorMessage, "WAV 文件缺少音频数据");
+        return ImpulseResponse();
+    }
+
+    const int bytesPerSample = bits / 8;
+    const int frames = int(sampleBytes / (bytesPerSample * channels));
+    ImpulseResponse response;
+    response.sampleRate = sampleRate;
+    response.channels.resize(channels);
+    for (int ch = 0; ch < channels; ++ch) {
+        response.channels[ch].resize(frames);
+    }
+    for (int i = 0; i < frames; ++i) {
+        const uchar *frame = samples + qint64(i) * bytesPerSample * channels;
+        for (int ch = 0; ch < channels; ++ch) {
+            response.channels[ch][i] = readSample(frame + ch * bytesPerSample, format, bits);
+        }
+    }
+    return response;
+}
+
+ImpulseResponse ImpulseResponse::resampled(int targetRate) const {
+    if (isEmpty() || targetRate <= 0 || targetRate == sampleRate) return *this;
+
+    const double ratio = double(sampleRate) / targetRate;
+    const int sourceLength = length();
+    const int targetLength = qMax(1, int(std::ceil(sourceLength / ratio)));
+    // 降采样时按比例缩放以保持湿信号能量（每个样本代表更长的时间）
+    const float gain = float(ratio);
+
+    ImpulseResponse response;
+    response.sampleRate = targetRate;
+    response.channels.resize(channels.size());
+    for (int ch = 0; ch < channels.size(); ++ch) {
+        const float *source = channels[ch].constData();
+        QVector<float> &target = response.channels[ch];
+        target.resize(targetLength);
+        for (int i = 0; i < targetLength; ++i) {
+            const double position = i * ratio;
+            const int index = int(position);
+            const float frac = float(position - index);
+            const float a = index < sourceLength ? source[index] : 0.0f;
+            const float b = index + 1 < sourceLength ? source[index + 1] : 0.0f;
+            target[i] = (a + (b - a) * frac) * gain;
+        }
+    }
+    return response;
+}
+
+void ImpulseResponse::trimTail(float thresholdDb) {
+    float peak = 0.0f;
+    for (const QVector<float> &channel : channels) {
+        for (float v : channel) peak = qMax(peak, std::abs(v));
+    }
+    if (peak <= 0.0f) return;
+
+    const float threshold = peak * std::pow(10.0f, thresholdDb / 20.0f);
+    int end = 0;
+    for (const QVector<float> &channel : channels) {
+        for (int i = channel.size() - 1; i >= end; --i) {
+            if (std::abs(channel[i]) > threshold) {
+                end = i + 1;
+                break;
+            }
+        }
+    }
+    for (QVector<float> &channel : channels) {
+        channel.resize(qMax(end, 1));
+    }
+}
+
+void ImpulseResponse::normalizeEnergy() {
+    double maxEnergy = 0.0;
+    for (const QVector<float> &channel : channels) {
+        double energy = 0.0;
+        for (float v : channel) energy += double(v) * v;
+        maxEnergy = qMax(maxEnergy, energy);
+    }
+    if (maxEnergy <= 0.0) return;
+
+    const float scale = float(1.0 / std::sqrt(maxEnergy));
+    for (QVector<float> &channel : channels) {
+        for (float &v : channel) v *= scale;
+    }
+}
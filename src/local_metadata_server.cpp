@@ -0,0 +1,289 @@
+#include "../include/local_metadata_server.h"
+#include <QCryptographicHash>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+
+namespace {
+const int kMaxRequestBytes = 64 * 1024;
+
+QByteArray reasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    default: return "Error";
+    }
+}
+
+QByteArray jsonBody(const QJsonObject &obj) {
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+QJsonObject tracksObject(const QVector<QJsonObject> &tracks) {
+    QJsonArray array;
+    for (const QJsonObject &track : tracks) array.append(track);
+    QJsonObject obj;
+    obj["tracks"] = array;
+    return obj;
+}
+}
+
+LocalMetadataServer::LocalMetadataServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+    , m_notModified(0)
+    , m_peakActive(0)
+    , m_maxAgeSeconds(60)
+    , m_responseDelayMs(0)
+    , m_rateLimited(0)
+    , m_retryAfterSeconds(1)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &LocalMetadataServer::onNewConnection);
+}
+
+LocalMetadataServer::~LocalMetadataServer() {
+    close();
+}
+
+bool LocalMetadataServer::listen(quint16 port) {
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+void LocalMetadataServer::close() {
+    m_server->close();
+    for (QTcpSocket *socket : m_buffers.keys()) socket->abort();
+    m_buffers.clear();
+    m_active.clear();
+}
+
+quint16 LocalMetadataServer::port() const {
+    return m_server->serverPort();
+}
+
+QUrl LocalMetadataServer::baseUrl() const {
+    return QUrl(QString("http://127.0.0.1:%1").arg(port()));
+}
+
+QString LocalMetadataServer::key(const QString &first, const QString &second) {
+    return first.toLower() + '\n' + second.toLower();
+}
+
+void LocalMetadataServer::addTrack(const QJsonObject &track) {
+    m_tracks.append(track);
+}
+
+void LocalMetadataServer::setLyrics(const QString &artist, const QString &title, const QString &lyrics) {
+    m_lyrics.insert(key(artist, title), lyrics);
+}
+
+void LocalMetadataServer::setAlbumArt(const QString &artist, const QString &album, const QByteArray &image,
+                                      int size, const QByteArray &contentType) {
+    Image entry;
+    entry.data = image;
+    entry.contentType = contentType;
+    entry.size = size;
+    m_images.append(entry);
+    m_albumArt.insert(key(artist, album), m_images.size() - 1);
+}
+
+void LocalMetadataServer::setRateLimited(int count, int retryAfterSeconds) {
+    m_rateLimited = qMax(0, count);
+    m_retryAfterSeconds = qMax(0, retryAfterSeconds);
+}
+
+void LocalMetadataServer::clear() {
+    m_tracks.clear();
+    m_lyrics.clear();
+    m_albumArt.clear();
+    m_images.clear();
+}
+
+int LocalMetadataServer::requestCount(const QString &path) const {
+    if (!path.isEmpty()) return m_requestCounts.value(path);
+    int total = 0;
+    for (int count : m_requestCounts) total += count;
+    return total;
+}
+
+void LocalMetadataServer::resetCounters() {
+    m_requestCounts.clear();
+    m_notModified = 0;
+    m_peakActive = m_active.size();
+}
+
+void LocalMetadataServer::onNewConnection() {
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, &LocalMetadataServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_buffers.remove(socket);
+            m_active.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void LocalMetadataServer::onReadyRead() {
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || !m_buffers.contains(socket)) return;
+    QByteArray &buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    const int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (buffer.size() > kMaxRequestBytes) socket->abort();
+        return;
+    }
+
+    // 只处理 GET，忽略请求体；每个连接一个请求，响应后关闭
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    buffer.clear();
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    QByteArray ifNoneMatch;
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray line = lines[i].trimmed();
+        const int colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).toLower() == "if-none-match") ifNoneMatch = line.mid(colon + 1).trimmed();
+    }
+
+    Response response;
+    if (requestLine.size() < 2 || requestLine[0] != "GET") {
+        response.status = 400;
+    } else {
+        const QUrl url(QString("http://127.0.0.1") + QString::fromUtf8(requestLine[1]));
+        const QString path = url.path().startsWith("/image/") ? QString("/image") : url.path();
+        m_requestCounts[path] += 1;
+        if (m_rateLimited > 0) {
+            --m_rateLimited;
+            response.status = 429;
+            response.retryAfter = m_retryAfterSeconds;
+        } else {
+            response = route(url);
+        }
+    }
+    m_active.insert(socket);
+    m_peakActive = qMax(m_peakActive, m_active.size());
+
+    QTimer::singleShot(m_responseDelayMs, socket, [this, socket, response, ifNoneMatch]() {
+        respond(socket, response, ifNoneMatch);
+    });
+}
+
+QVector<QJsonObject> LocalMetadataServer::matchTracks(const QUrl &url) const {
+    const QUrlQuery query(url);
+    const QString path = url.path();
+    const int limit = query.hasQueryItem("limit") ? query.queryItemValue("limit").toInt() : 20;
+
+    QStringList seeds;
+    if (path == "/recommendations") {
+        for (const QString &seed : query.queryItemValue("seeds", QUrl::FullyDecoded).split('\n')) {
+            seeds.append(seed.trimmed().toLower());
+        }
+    }
+
+    QVector<QJsonObject> result;
+    for (const QJsonObject &track : m_tracks) {
+        if (result.size() >= limit) break;
+        const QString title = track["title"].toString();
+        const QString artist = track["artist"].toString();
+        const QString album = track["album"].toString();
+        bool matched = true;
+        if (path == "/search") {
+            if (query.hasQueryItem("artist")) {
+                matched = artist.compare(query.queryItemValue("artist", QUrl::FullyDecoded), Qt::CaseInsensitive) == 0;
+            } else if (query.hasQueryItem("album")) {
+                matched = album.contains(query.queryItemValue("album", QUrl::FullyDecoded), Qt::CaseInsensitive);
+            } else {
+                const QString text = query.queryItemValue("q", QUrl::FullyDecoded);
+                matched = title.contains(text, Qt::CaseInsensitive) || artist.contains(text, Qt::CaseInsensitive);
+            }
+        } else if (path == "/trending") {
+            const QString genre = query.queryItemValue("genre", QUrl::FullyDecoded);
+            matched = genre.isEmpty() || track["genre"].toString().compare(genre, Qt::CaseInsensitive) == 0;
+        } else if (path == "/recommendations") {
+            matched = !seeds.contains((artist + " - " + title).toLower());
+        }
+        if (matched) result.append(track);
+    }
+    return result;
+}
+
+LocalMetadataServer::Response LocalMetadataServer::route(const QUrl &url) const {
+    const QUrlQuery query(url);
+    const QString path = url.path();
+    Response response;
+
+    if (path == "/search" || path == "/trending" || path == "/recommendations") {
+        response.body = jsonBody(tracksObject(matchTracks(url)));
+    } else if (path == "/lyrics") {
+        const auto it = m_lyrics.constFind(key(query.queryItemValue("artist", QUrl::FullyDecoded),
+                                               query.queryItemValue("title", QUrl::FullyDecoded)));
+        if (it == m_lyrics.constEnd()) {
+            response.status = 404;
+        } else {
+            QJsonObject obj;
+            obj["lyrics"] = it.value();
+            response.body = jsonBody(obj);
+        }
+    } else if (path == "/album") {
+        const auto it = m_albumArt.constFind(key(query.queryItemValue("artist", QUrl::FullyDecoded),
+                                                 query.queryItemValue("album", QUrl::FullyDecoded)));
+        if (it == m_albumArt.constEnd()) {
+            response.status = 404;
+        } else {
+            QJsonObject image;
+            image["url"] = QString("/image/%1").arg(it.value());
+            image["size"] = m_images[it.value()].size;
+            QJsonObject obj;
+            obj["images"] = QJsonArray{image};
+            response.body = jsonBody(obj);
+        }
+    } else if (path.startsWith("/image/")) {
+        bool ok = false;
+        const int index = path.mid(7).toInt(&ok);
+        if (!ok || index < 0 || index >= m_images.size()) {
+            response.status = 404;
+        } else {
+            response.body = m_images[index].data;
+            response.contentType = m_images[index].contentType;
+        }
+    } else {
+        response.status = 404;
+    }
+    return response;
+}
+
+void LocalMetadataServer::respond(QTcpSocket *socket, const Response &response, const QByteArray &ifNoneMatch) {
+    m_active.remove(socket);
+    if (!m_buffers.contains(socket)) return;
+
+    const QByteArray etag = '"' + QCryptographicHash::hash(response.body, QCryptographicHash::Sha1).toHex().left(16) + '"';
+    int status = response.status;
+    QByteArray body = response.body;
+    if (status == 200 && !ifNoneMatch.isEmpty() && ifNoneMatch == etag) {
+        status = 304;
+        body.clear();
+        ++m_notModified;
+    }
+
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n";
+    if (status == 200 || status == 304) {
+        head += "ETag: " + etag + "\r\n";
+        head += "Cache-Control: max-age=" + QByteArray::number(m_maxAgeSeconds) + "\r\n";
+    }
+    if (status == 200) head += "Content-Type: " + response.contentType + "\r\n";
+    if (status == 429) head += "Retry-After: " + QByteArray::number(response.retryAfter) + "\r\n";
+    head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    head += "Connection: close\r\n\r\n";
+
+    socket->write(head);
+    socket->write(body);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,242 @@
+#include "../include/loudness_analyzer.h"
+#include <QtMath>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+const double kAbsoluteGateLufs = -70.0;
+const double kRelativeGateLu = -10.0;
+const int kPeakTapsPerPhase = 12;
+
+inline double energyToLufs(double energy) {
+    return -0.691 + 10.0 * std::log10(energy);
+}
+
+inline double lufsToEnergy(double lufs) {
+    return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+}
+
+// LoudnessInfo Implementation
+double LoudnessInfo::gainDb(double referenceLufs) const {
+    return valid ? referenceLufs - integratedLufs : 0.0;
+}
+
+double LoudnessInfo::truePeakLinear() const {
+    return std::pow(10.0, truePeakDb / 20.0);
+}
+
+QJsonObject LoudnessInfo::toJson() const {
+    QJsonObject obj;
+    if (!valid) return obj;
+    obj["integratedLufs"] = integratedLufs;
+    obj["truePeakDb"] = truePeakDb;
+    obj["durationSec"] = durationSec;
+    return obj;
+}
+
+LoudnessInfo LoudnessInfo::fromJson(const QJsonObject &obj) {
+    LoudnessInfo info;
+    if (!obj.contains("integratedLufs")) return info;
+    info.valid = true;
+    info.integratedLufs = obj["integratedLufs"].toDouble();
+    info.truePeakDb = obj["truePeakDb"].toDouble(-120.0);
+    info.durationSec = obj["durationSec"].toDouble();
+    return info;
+}
+
+LoudnessInfo LoudnessInfo::combine(const QVector<LoudnessInfo> &tracks) {
+    LoudnessInfo album;
+    double weightedEnergy = 0.0;
+    double totalDuration = 0.0;
+    for (const LoudnessInfo &t : tracks) {
+        if (!t.valid) continue;
+        // 时长未知时按等权处理
+        double weight = t.durationSec > 0.0 ? t.durationSec : 1.0;
+        weightedEnergy += weight * lufsToEnergy(t.integratedLufs);
+        totalDuration += weight;
+        album.truePeakDb = std::max(album.truePeakDb, t.truePeakDb);
+        album.durationSec += t.durationSec;
+    }
+    if (totalDuration > 0.0) {
+        album.valid = true;
+        album.integratedLufs = energyToLufs(weightedEnergy / totalDuration);
+    }
+    return album;
+}
+
+// LoudnessAnalyzer Implementation
+LoudnessAnalyzer::LoudnessAnalyzer(int sampleRate, int channels)
+    : m_sampleRate(std::max(sampleRate, 8000))
+    , m_channels(std::max(channels, 1))
+    , m_stepFrames(std::max(m_sampleRate / 10, 1))
+    , m_stepPos(0)
+    , m_stepEnergy(0.0)
+    , m_stepRing{0.0, 0.0, 0.0, 0.0}
+    , m_stepCount(0)
+    , m_oversample(1)
+    , m_peakTaps(kPeakTapsPerPhase)
+    , m_peak(0.0f)
+    , m_frames(0)
+{
+    m_state.resize(m_channels);
+    for (int ch = 0; ch < m_channels; ++ch) {
+        // 5.1 布局 (L R C LFE Ls Rs)：LFE 不计入，环绕声道 +1.5dB
+        if (m_channels == 6 && ch == 3) m_state[ch].weight = 0.0;
+        else if (m_channels >= 5 && ch >= m_channels - 2) m_state[ch].weight = 1.41;
+    }
+    setupKWeighting();
+    setupTruePeakFilter();
+}
+
+void LoudnessAnalyzer::setupKWeighting() {
+    // BS.1770 K 加权滤波器，按实际采样率重新推导系数
+    const double fs = m_sampleRate;
+
+    double f0 = 1681.974450955533;
+    double G = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = std::tan(M_PI * f0 / fs);
+    double Vh = std::pow(10.0, G / 20.0);
+    double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    m_shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+    m_shelf.b1 = 2.0 * (K * K - Vh) / a0;
+    m_shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+    m_shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+    m_shelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = std::tan(M_PI * f0 / fs);
+    a0 = 1.0 + K / Q + K * K;
+    m_highPass.b0 = 1.0;
+    m_highPass.b1 = -2.0;
+    m_highPass.b2 = 1.0;
+    m_highPass.a1 = 2.0 * (K * K - 1.0) / a0;
+    m_highPass.a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+void LoudnessAnalyzer::setupTruePeakFilter() {
+    // 过采样到 >= 176.4kHz 后取峰值 (BS.1770-4 Annex 2)
+    if (m_sampleRate < 96000) m_oversample = 4;
+    else if (m_sampleRate < 176400) m_oversample = 2;
+    else m_oversample = 1;
+
+    for (ChannelState &state : m_state) {
+        state.peakHistory.fill(0.0f, 2 * m_peakTaps);
+        state.peakPos = 0;
+    }
+    if (m_oversample == 1) return;
+
+    // Hann 窗 sinc 低通，截止于原始奈奎斯特频率，按相位拆分
+    const int length = m_oversample * m_peakTaps;
+    const double center = (length - 1) / 2.0;
+    m_peakCoeffs.fill(0.0f, length);
+    for (int phase = 0; phase < m_oversample; ++phase) {
+        double sum = 0.0;
+        QVector<double> taps(m_peakTaps);
+        for (int k = 0; k < m_peakTaps; ++k) {
+            int n = k * m_oversample + phase;
+            double x = (n - center) / m_oversample;
+            double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            double window = 0.5 - 0.5 * std::cos(2.0 * M_PI * (n + 0.5) / length);
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+        // 每个相位单独归一化为单位直流增益
+        for (int k = 0; k < m_peakTaps; ++k) {
+            m_peakCoeffs[phase * m_peakTaps + k] = static_cast<float>(taps[k] / sum);
+        }
+    }
+}
+
+void LoudnessAnalyzer::process(const float *interleaved, int frames) {
+    if (!interleaved || frames <= 0) return;
+
+    const Biquad s = m_shelf;
+    const Biquad h = m_highPass;
+    const float *coeffs = m_peakCoeffs.constData();
+    ChannelState *states = m_state.data();
+    float peak = m_peak;
+
+    for (int i = 0; i < frames; ++i) {
+        const float *frame = interleaved + i * m_channels;
+        double frameEnergy = 0.0;
+        for (int ch = 0; ch < m_channels; ++ch) {
+            ChannelState &st = states[ch];
+            const float x = frame[ch];
+
+            // K 加权（两级转置直接 II 型）
+            double y = s.b0 * x + st.z1;
+            st.z1 = s.b1 * x - s.a1 * y + st.z2;
+            st.z2 = s.b2 * x - s.a2 * y;
+            double k = h.b0 * y + st.r1;
+            st.r1 = h.b1 * y - h.a1 * k + st.r2;
+            st.r2 = h.b2 * y - h.a2 * k;
+            frameEnergy += st.weight * k * k;
+
+            // 真峰值
+            peak = std::max(peak, std::abs(x));
+            if (m_oversample > 1) {
+                float *hist = st.peakHistory.data();
+                st.peakPos = (st.peakPos == 0 ? m_peakTaps : st.peakPos) - 1;
+                hist[st.peakPos] = x;
+                hist[st.peakPos + m_peakTaps] = x;
+                const float *window = hist + st.peakPos;
+                for (int phase = 0; phase < m_oversample; ++phase) {
+                    const float *c = coeffs + phase * m_peakTaps;
+                    float acc = 0.0f;
+                    for (int t = 0; t < m_peakTaps; ++t) acc += c[t] * window[t];
+                    peak = std::max(peak, std::abs(acc));
+                }
+            }
+        }
+
+        m_stepEnergy += frameEnergy;
+        if (++m_stepPos == m_stepFrames) finishStep();
+    }
+
+    m_peak = peak;
+    m_frames += frames;
+}
+
+void LoudnessAnalyzer::finishStep() {
+    m_stepRing[m_stepCount % 4] = m_stepEnergy;
+    ++m_stepCount;
+    m_stepEnergy = 0.0;
+    m_stepPos = 0;
+
+    if (m_stepCount < 4) return;
+    double blockEnergy = (m_stepRing[0] + m_stepRing[1] + m_stepRing[2] + m_stepRing[3])
+                         / (4.0 * m_stepFrames);
+    // 绝对门限之下的块直接丢弃
+    if (blockEnergy > 0.0 && energyToLufs(blockEnergy) > kAbsoluteGateLufs) {
+        m_blockEnergies.append(blockEnergy);
+    }
+}
+
+LoudnessInfo LoudnessAnalyzer::result() const {
+    LoudnessInfo info;
+    info.durationSec = double(m_frames) / m_sampleRate;
+    info.truePeakDb = m_peak > 0.0f ? 20.0 * std::log10(m_peak) : -120.0;
+    if (m_blockEnergies.isEmpty()) return info;
+
+    double sum = 0.0;
+    for (double e : m_blockEnergies) sum += e;
+    const double relativeGate = lufsToEnergy(energyToLufs(sum / m_blockEnergies.size()) + kRelativeGateLu);
+
+    double gatedSum = 0.0;
+    int gatedCount = 0;
+    for (double e : m_blockEnergies) {
+        if (e > relativeGate) {
+            gatedSum += e;
+            ++gatedCount;
+        }
+    }
+    if (gatedCount == 0) return info;
+
+    info.valid = true;
+    info.integratedLufs = energyToLufs(gatedSum / gatedCount);
+    return info;
+}
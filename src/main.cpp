@@ -9,6 +9,10 @@
 #include <QDebug>
 #include "../include/playerwindow.h"
 #include "../include/playlistmanager.h"
+#include "../include/self_test.h"
+#ifdef ENABLE_ONLINE_METADATA
+#include "../include/online_music_service.h"
+#endif
 
 QPixmap createSplashScreen() {
     QPixmap splash(400, 300);
@@ -30,6 +34,15 @@ QPixmap createSplashScreen() {
 }
 
 int main(int argc, char *argv[]) {
+    // 自检不创建窗口；封面解码需要 QGuiApplication，默认用 offscreen 平台，无显示环境也能运行
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--self-test") == 0) {
+            if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+            QGuiApplication app(argc, argv);
+            return runSelfTests(i + 1 < argc ? QString::fromLocal8Bit(argv[i + 1]) : QString());
+        }
+    }
+
     QApplication app(argc, argv);
     
     // 设置应用信息
@@ -51,6 +64,7 @@ int main(int argc, char *argv[]) {
         qDebug() << "选项:";
         qDebug() << "  --help     显示此帮助信息";
         qDebug() << "  --test     运行测试模式";
+        qDebug() << "  --self-test [套件]  运行计算组件自检，不指定套件时全部运行";
         qDebug() << "  --version  显示版本信息";
         return 0;
     }
@@ -62,11 +76,12 @@ int main(int argc, char *argv[]) {
     
     if (app.arguments().contains("--test")) {
         qDebug() << "运行测试模式...";
+        const int failures = runSelfTests();
         // 简单的测试：创建播放器窗口但不显示
         PlayerWindow *window = new PlayerWindow();
         Q_UNUSED(window)
         qDebug() << "测试完成 - 播放器窗口创建成功";
-        return 0;
+        return failures == 0 ? 0 : 1;
     }
     
     QSplashScreen *splash = nullptr;
@@ -95,6 +110,18 @@ int main(int argc, char *argv[]) {
     // 扫描音乐文件
     manager.scanMusicFolders(musicDir, appMusicDir);
     manager.loadPlaylists(appMusicDir);
+    window->setLibrary(&manager);
+#ifdef ENABLE_ONLINE_METADATA
+    // 配置了 Last.fm 密钥才接入在线封面与预取
+    const QString lastFmKey = QString::fromLocal8Bit(qgetenv("MUSICPLAYER_LASTFM_API_KEY"));
+    if (!lastFmKey.isEmpty()) {
+        OnlineMusicService *onlineService = new OnlineMusicService(window);
+        onlineService->configureService(OnlineMusicService::LastFM, lastFmKey);
+        window->setOnlineService(onlineService);
+    }
+#endif
+    // 后台补算响度，不阻塞启动
+    manager.updateLoudness(appMusicDir);
     
     if (isHeadless) {
         // CI环境：立即显示窗口（但可能不可见）
@@ -0,0 +1,65 @@
+#include "../include/metadata_prefetcher.h"
+#include "../include/online_music_service.h"
+
+namespace {
+const int kSettleMs = 500;      // 连续切歌时只提交最后一次
+}
+
+MetadataPrefetcher::MetadataPrefetcher(OnlineMusicService *service)
+    : QObject(service)
+    , m_service(service)
+    , m_settleTimer(new QTimer(this))
+    , m_generation(0)
+    , m_lookahead(3)
+    , m_artSize(300, 300)
+    , m_lyricsEnabled(true)
+    , m_albumArtEnabled(true)
+{
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(kSettleMs);
+    connect(m_settleTimer, &QTimer::timeout, this, &MetadataPrefetcher::submit);
+}
+
+QString MetadataPrefetcher::signature(const QVector<Track> &tracks) {
+    QString result;
+    for (const Track &track : tracks) {
+        result += track.artist + '\t' + track.title + '\t' + track.album + '\n';
+    }
+    return result;
+}
+
+void MetadataPrefetcher::update(const QVector<Track> &queue, const PlayOrder &order, int current) {
+    QVector<Track> upcoming;
+    for (int index : order.upcoming(current, m_lookahead)) {
+        if (index < queue.size()) upcoming.append(queue[index]);
+    }
+    m_upcoming = upcoming;
+    if (signature(upcoming) == m_submittedSignature) {
+        m_settleTimer->stop();
+        return;
+    }
+    m_settleTimer->start();
+}
+
+void MetadataPrefetcher::cancel() {
+    m_settleTimer->stop();
+    m_upcoming.clear();
+    m_submittedSignature.clear();
+    ++m_generation;
+    m_service->cancelPrefetches(-1);
+}
+
+void MetadataPrefetcher::submit() {
+    // 先以新批次号提交，再撤销旧批次：两批都有的曲目保留进行中的请求
+    ++m_generation;
+    for (const Track &track : m_upcoming) {
+        if (m_lyricsEnabled && !track.title.isEmpty()) {
+            m_service->prefetchLyrics(track.artist, track.title, m_generation);
+        }
+        if (m_albumArtEnabled && !track.album.isEmpty()) {
+            m_service->prefetchAlbumArt(track.artist, track.album, m_artSize, m_generation);
+        }
+    }
+    m_service->cancelPrefetches(m_generation);
+    m_submittedSignature = signature(m_upcoming);
+}
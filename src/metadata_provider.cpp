@@ -0,0 +1,250 @@
+#include "../include/metadata_provider.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QUrlQuery>
+
+namespace {
+const qint64 kHourMs = 3600 * 1000;
+const qint64 kDayMs = 24 * kHourMs;
+const char *const kLastFmEndpoint = "https://ws.audioscrobbler.com/2.0/";
+
+QByteArray userAgent() {
+    return QString("MusicPlayer/%1").arg(QCoreApplication::applicationVersion()).toUtf8();
+}
+
+// Last.fm 只有一项结果时返回对象而不是数组
+QJsonArray asArray(const QJsonValue &value) {
+    if (value.isArray()) return value.toArray();
+    QJsonArray array;
+    if (value.isObject()) array.append(value);
+    return array;
+}
+
+QString lastFmArtist(const QJsonValue &value) {
+    return value.isObject() ? value.toObject()["name"].toString() : value.toString();
+}
+
+// Last.fm 图片尺寸名对应的像素边长
+int lastFmImageSize(const QString &name) {
+    if (name == "small") return 34;
+    if (name == "medium") return 64;
+    if (name == "large") return 174;
+    if (name == "extralarge") return 300;
+    if (name == "mega") return 600;
+    return 0;
+}
+
+// 不小于目标边长的最小一张；都不够大时取最大的一张
+QUrl closestImage(const QVector<QPair<int, QString>> &images, const QSize &size) {
+    const int wanted = qMax(size.width(), size.height());
+    int bestSize = -1;
+    QString bestUrl;
+    for (const auto &image : images) {
+        if (image.second.isEmpty()) continue;
+        const bool better = bestSize < 0
+            || (image.first >= wanted ? (bestSize < wanted || image.first < bestSize) : (bestSize < wanted && image.first > bestSize));
+        if (better) {
+            bestSize = image.first;
+            bestUrl = image.second;
+        }
+    }
+    return bestUrl.isEmpty() ? QUrl() : QUrl(bestUrl);
+}
+
+QVector<QPair<int, QString>> lastFmImages(const QJsonValue &value) {
+    QVector<QPair<int, QString>> images;
+    for (const QJsonValue &image : asArray(value)) {
+        const QJsonObject obj = image.toObject();
+        images.append(qMakePair(lastFmImageSize(obj["size"].toString()), obj["#text"].toString()));
+    }
+    return images;
+}
+}
+
+QVector<QJsonObject> MetadataProvider::parseTracks(const QByteArray &) const {
+    return QVector<QJsonObject>();
+}
+
+QString MetadataProvider::parseLyrics(const QByteArray &) const {
+    return QString();
+}
+
+QUrl MetadataProvider::parseImageUrl(const QByteArray &, const QSize &) const {
+    return QUrl();
+}
+
+qint64 MetadataProvider::minimumTtlMs(RequestKind kind) const {
+    switch (kind) {
+    case Search:
+    case Trending:
+        return kHourMs;
+    case Recommendations:
+        return 6 * kHourMs;
+    case Lyrics:
+    case AlbumArt:
+        return 30 * kDayMs;
+    case Image:
+        return 90 * kDayMs;
+    }
+    return 0;
+}
+
+LastFmProvider::LastFmProvider(const QString &apiKey)
+    : m_apiKey(apiKey)
+{
+}
+
+bool LastFmProvider::supports(RequestKind kind) const {
+    return kind != Lyrics;
+}
+
+QNetworkRequest LastFmProvider::buildRequest(const Query &query) const {
+    if (query.kind == Image) {
+        QNetworkRequest request(QUrl(query.params.value("url")));
+        request.setRawHeader("User-Agent", userAgent());
+        return request;
+    }
+    QUrlQuery params;
+    const QString limit = query.params.value("limit", "20");
+    switch (query.kind) {
+    case Search:
+        if (query.params.contains("artist")) {
+            params.addQueryItem("method", "artist.gettoptracks");
+            params.addQueryItem("artist", query.params.value("artist"));
+        } else if (query.params.contains("album")) {
+            params.addQueryItem("method", "album.search");
+            params.addQueryItem("album", query.params.value("album"));
+        } else {
+            params.addQueryItem("method", "track.search");
+            params.addQueryItem("track", query.params.value("q"));
+        }
+        params.addQueryItem("limit", limit);
+        break;
+    case Recommendations: {
+        // 种子形如 "歌手 - 标题"，Last.fm 只接受一首，取第一首
+        const QString seed = query.params.value("seeds").section('\n', 0, 0);
+        params.addQueryItem("method", "track.getsimilar");
+        params.addQueryItem("artist", seed.section(" - ", 0, 0).trimmed());
+        params.addQueryItem("track", seed.section(" - ", 1).trimmed());
+        params.addQueryItem("limit", limit);
+        break;
+    }
+    case Trending:
+        if (query.params.value("genre").isEmpty()) {
+            params.addQueryItem("method", "chart.gettoptracks");
+        } else {
+            params.addQueryItem("method", "tag.gettoptracks");
+            params.addQueryItem("tag", query.params.value("genre"));
+        }
+        params.addQueryItem("limit", limit);
+        break;
+    case AlbumArt:
+        params.addQueryItem("method", "album.getinfo");
+        params.addQueryItem("artist", query.params.value("artist"));
+        params.addQueryItem("album", query.params.value("album"));
+        params.addQueryItem("autocorrect", "1");
+        break;
+    case Lyrics:
+    case Image:
+        break;
+    }
+    params.addQueryItem("api_key", m_apiKey);
+    params.addQueryItem("format", "json");
+
+    QUrl url(kLastFmEndpoint);
+    url.setQuery(params);
+    QNetworkRequest request(url);
+    request.setRawHeader("User-Agent", userAgent());
+    return request;
+}
+
+QVector<QJsonObject> LastFmProvider::parseTracks(const QByteArray &body) const {
+    const QJsonObject root = QJsonDocument::fromJson(body).object();
+    const QJsonObject results = root["results"].toObject();
+
+    // 不同方法的结果放在不同的容器里，专辑搜索的结果也按“曲目”返回，标题即专辑名
+    QJsonArray items;
+    bool albums = false;
+    if (results.contains("trackmatches")) {
+        items = asArray(results["trackmatches"].toObject()["track"]);
+    } else if (results.contains("albummatches")) {
+        items = asArray(results["albummatches"].toObject()["album"]);
+        albums = true;
+    } else if (root.contains("toptracks")) {
+        items = asArray(root["toptracks"].toObject()["track"]);
+    } else if (root.contains("similartracks")) {
+        items = asArray(root["similartracks"].toObject()["track"]);
+    } else if (root.contains("tracks")) {
+        items = asArray(root["tracks"].toObject()["track"]);
+    }
+
+    QVector<QJsonObject> tracks;
+    tracks.reserve(items.size());
+    for (const QJsonValue &value : items) {
+        const QJsonObject item = value.toObject();
+        QJsonObject track;
+        const QString mbid = item["mbid"].toString();
+        track["id"] = mbid.isEmpty() ? item["url"].toString() : mbid;
+        track["title"] = item["name"].toString();
+        track["artist"] = lastFmArtist(item["artist"]);
+        track["album"] = albums ? item["name"].toString() : QString();
+        // 时长有的是字符串，有的是数字，单位为秒
+        const QJsonValue duration = item["duration"];
+        const int seconds = duration.isString() ? duration.toString().toInt() : duration.toInt();
+        track["duration_ms"] = seconds * 1000;
+        track["albumArtUrl"] = closestImage(lastFmImages(item["image"]), QSize(300, 300)).toString();
+        track["previewUrl"] = QString();
+        track["isPlayable"] = false;
+        tracks.append(track);
+    }
+    return tracks;
+}
+
+QUrl LastFmProvider::parseImageUrl(const QByteArray &body, const QSize &size) const {
+    const QJsonObject album = QJsonDocument::fromJson(body).object()["album"].toObject();
+    return closestImage(lastFmImages(album["image"]), size);
+}
+
+LocalMetadataProvider::LocalMetadataProvider(const QUrl &baseUrl, int maxConcurrent, double requestsPerSecond)
+    : m_baseUrl(baseUrl)
+    , m_maxConcurrent(qMax(1, maxConcurrent))
+    , m_requestsPerSecond(requestsPerSecond)
+{
+}
+
+QNetworkRequest LocalMetadataProvider::buildRequest(const Query &query) const {
+    static const char *const kPaths[] = {"/search", "/recommendations", "/trending", "/lyrics", "/album"};
+    if (query.kind == Image) return QNetworkRequest(QUrl(query.params.value("url")));
+    QUrl url(m_baseUrl);
+    url.setPath(kPaths[query.kind]);
+    QUrlQuery params;
+    for (auto it = query.params.constBegin(); it != query.params.constEnd(); ++it) {
+        params.addQueryItem(it.key(), it.value());
+    }
+    url.setQuery(params);
+    return QNetworkRequest(url);
+}
+
+QVector<QJsonObject> LocalMetadataProvider::parseTracks(const QByteArray &body) const {
+    QVector<QJsonObject> tracks;
+    const QJsonArray items = QJsonDocument::fromJson(body).object()["tracks"].toArray();
+    tracks.reserve(items.size());
+    for (const QJsonValue &item : items) tracks.append(item.toObject());
+    return tracks;
+}
+
+QString LocalMetadataProvider::parseLyrics(const QByteArray &body) const {
+    return QJsonDocument::fromJson(body).object()["lyrics"].toString();
+}
+
+QUrl LocalMetadataProvider::parseImageUrl(const QByteArray &body, const QSize &size) const {
+    QVector<QPair<int, QString>> images;
+    for (const QJsonValue &value : QJsonDocument::fromJson(body).object()["images"].toArray()) {
+        const QJsonObject image = value.toObject();
+        images.append(qMakePair(image["size"].toInt(), image["url"].toString()));
+    }
+    // 相对地址按服务地址解析
+    const QUrl url = closestImage(images, size);
+    return url.isEmpty() ? url : m_baseUrl.resolved(url);
+}
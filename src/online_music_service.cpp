@@ -0,0 +1,514 @@
+#include "../include/online_music_service.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QStandardPaths>
+#include <QUrl>
+#include <algorithm>
+#include <cmath>
+
+QJsonObject OnlineMusicService::OnlineTrack::toJson() const {
+    QJsonObject obj;
+    obj["id"] = id;
+    obj["title"] = title;
+    obj["artist"] = artist;
+    obj["album"] = album;
+    obj["previewUrl"] = previewUrl;
+    obj["albumArtUrl"] = albumArtUrl;
+    obj["duration_ms"] = duration_ms;
+    obj["isPlayable"] = isPlayable;
+    return obj;
+}
+
+OnlineMusicService::OnlineTrack OnlineMusicService::OnlineTrack::fromJson(const QJsonObject &obj) {
+    OnlineTrack track;
+    track.id = obj["id"].toString();
+    track.title = obj["title"].toString();
+    track.artist = obj["artist"].toString();
+    track.album = obj["album"].toString();
+    track.previewUrl = obj["previewUrl"].toString();
+    track.albumArtUrl = obj["albumArtUrl"].toString();
+    track.duration_ms = obj["duration_ms"].toInt();
+    track.isPlayable = obj["isPlayable"].toBool(!track.previewUrl.isEmpty());
+    return track;
+}
+
+OnlineMusicService::OnlineMusicService(QObject *parent)
+    : QObject(parent)
+    , m_networkManager(new QNetworkAccessManager(this))
+    , m_pumpTimer(new QTimer(this))
+    , m_prefetchBytesPerSecond(128 * 1024)
+    , m_prefetchBudget(0.0)
+    , m_budgetRefilledAt(QDateTime::currentMSecsSinceEpoch())
+{
+    m_pumpTimer->setSingleShot(true);
+    connect(m_pumpTimer, &QTimer::timeout, this, &OnlineMusicService::pumpQueues);
+    setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/online");
+}
+
+OnlineMusicService::~OnlineMusicService() {
+    // 回复由 m_networkManager 析构时一并释放，先断开避免回调到已析构的对象
+    for (QNetworkReply *reply : m_pendingRequests.keys()) {
+        reply->disconnect(this);
+        reply->abort();
+    }
+    for (const ProviderState &state : m_providers) delete state.provider;
+}
+
+void OnlineMusicService::configureService(ServiceType type, const QString &apiKey, const QString &secret) {
+    m_apiKeys[type] = apiKey;
+    m_apiSecrets[type] = secret;
+    if (type == LastFM) {
+        addProvider(new LastFmProvider(apiKey));
+    } else {
+        qWarning() << "No metadata provider for service type" << type;
+    }
+}
+
+void OnlineMusicService::addProvider(MetadataProvider *provider) {
+    if (!provider) return;
+    for (ProviderState &state : m_providers) {
+        if (state.provider->name() == provider->name()) {
+            // 排队与进行中的请求按序号引用提供方，原地替换即可
+            delete state.provider;
+            state.provider = provider;
+            return;
+        }
+    }
+    ProviderState state;
+    state.provider = provider;
+    state.tokens = qMax(1.0, provider->requestsPerSecond());
+    state.refilledAt = QDateTime::currentMSecsSinceEpoch();
+    m_providers.append(state);
+}
+
+void OnlineMusicService::setCacheDirectory(const QString &directory) {
+    if (!m_cache.open(directory)) {
+        qWarning() << "Online metadata cache disabled:" << directory;
+    }
+}
+
+void OnlineMusicService::searchTracks(const QString &query, int limit) {
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Search;
+    q.params["q"] = query;
+    q.params["limit"] = QString::number(limit);
+    request(q, Waiter());
+}
+
+void OnlineMusicService::searchArtist(const QString &artist) {
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Search;
+    q.params["artist"] = artist;
+    request(q, Waiter());
+}
+
+void OnlineMusicService::searchAlbum(const QString &album) {
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Search;
+    q.params["album"] = album;
+    request(q, Waiter());
+}
+
+void OnlineMusicService::getRecommendations(const QStringList &seedTracks, int limit) {
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Recommendations;
+    q.params["seeds"] = seedTracks.join('\n');
+    q.params["limit"] = QString::number(limit);
+    request(q, Waiter());
+}
+
+void OnlineMusicService::getTrendingTracks(const QString &genre, int limit) {
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Trending;
+    q.params["genre"] = genre;
+    q.params["limit"] = QString::number(limit);
+    request(q, Waiter());
+}
+
+void OnlineMusicService::getLyrics(const QString &artist, const QString &title) {
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Lyrics;
+    q.params["artist"] = artist;
+    q.params["title"] = title;
+    Waiter waiter;
+    waiter.artist = artist;
+    waiter.title = title;
+    request(q, waiter);
+}
+
+void OnlineMusicService::getAlbumArt(const QString &artist, const QString &album, const QSize &size) {
+    // 尺寸不进入请求：不同尺寸共用一次专辑信息查询，按各自尺寸挑选图片地址
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::AlbumArt;
+    q.params["artist"] = artist;
+    q.params["album"] = album;
+    Waiter waiter;
+    waiter.artist = artist;
+    waiter.album = album;
+    waiter.size = size;
+    request(q, waiter);
+}
+
+void OnlineMusicService::prefetchLyrics(const QString &artist, const QString &title, int generation) {
+    if (generation < 0 || providerFor(MetadataProvider::Lyrics) < 0) return;
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::Lyrics;
+    q.params["artist"] = artist;
+    q.params["title"] = title;
+    Waiter waiter;
+    waiter.artist = artist;
+    waiter.title = title;
+    waiter.prefetch = generation;
+    request(q, waiter);
+}
+
+void OnlineMusicService::prefetchAlbumArt(const QString &artist, const QString &album, const QSize &size, int generation) {
+    if (generation < 0 || providerFor(MetadataProvider::AlbumArt) < 0) return;
+    MetadataProvider::Query q;
+    q.kind = MetadataProvider::AlbumArt;
+    q.params["artist"] = artist;
+    q.params["album"] = album;
+    Waiter waiter;
+    waiter.artist = artist;
+    waiter.album = album;
+    waiter.size = size;
+    waiter.prefetch = generation;
+    request(q, waiter);
+}
+
+void OnlineMusicService::cancelPrefetches(int keepGeneration) {
+    const QStringList keys = m_fetches.keys();
+    for (const QString &key : keys) {
+        Fetch &fetch = m_fetches[key];
+        for (int i = fetch.waiters.size() - 1; i >= 0; --i) {
+            const Waiter &waiter = fetch.waiters[i];
+            if (waiter.isPrefetch() && waiter.prefetch != keepGeneration) fetch.waiters.removeAt(i);
+        }
+        if (!fetch.waiters.isEmpty()) continue;
+
+        if (fetch.reply) {
+            QNetworkReply *reply = fetch.reply;
+            m_pendingRequests.remove(reply);
+            release(fetch);
+            reply->disconnect(this);
+            reply->abort();
+            reply->deleteLater();
+        } else {
+            ProviderState &state = m_providers[fetch.provider];
+            state.background.removeAll(key);
+            state.waiting.removeAll(key);
+        }
+        m_fetches.remove(key);
+    }
+    pumpQueues();
+}
+
+void OnlineMusicService::setPrefetchBandwidth(qint64 bytesPerSecond) {
+    m_prefetchBytesPerSecond = qMax<qint64>(0, bytesPerSecond);
+    m_prefetchBudget = qMin(m_prefetchBudget, double(m_prefetchBytesPerSecond));
+    pumpQueues();
+}
+
+bool OnlineMusicService::Fetch::hasForegroundWaiter() const {
+    for (const Waiter &waiter : waiters) {
+        if (!waiter.isPrefetch()) return true;
+    }
+    return false;
+}
+
+int OnlineMusicService::providerFor(MetadataProvider::RequestKind kind) const {
+    for (int i = 0; i < m_providers.size(); ++i) {
+        if (m_providers[i].provider->supports(kind)) return i;
+    }
+    return -1;
+}
+
+void OnlineMusicService::request(const MetadataProvider::Query &query, const Waiter &waiter) {
+    const int provider = providerFor(query.kind);
+    if (provider < 0) {
+        emit errorOccurred("没有可用的在线服务");
+        return;
+    }
+    const QNetworkRequest networkRequest = m_providers[provider].provider->buildRequest(query);
+    const QString key = m_providers[provider].provider->name() + ' ' + networkRequest.url().toString();
+
+    // 相同请求已在排队或进行中：只登记回调；前台请求赶上排队中的预取时把它移到前台队列
+    auto inFlight = m_fetches.find(key);
+    if (inFlight != m_fetches.end()) {
+        Fetch &fetch = inFlight.value();
+        if (!fetch.waiters.contains(waiter)) fetch.waiters.append(waiter);
+        if (!waiter.isPrefetch() && fetch.background && !fetch.reply) {
+            ProviderState &state = m_providers[provider];
+            state.background.removeAll(key);
+            state.waiting.enqueue(key);
+            fetch.background = false;
+            pumpQueues();
+        }
+        return;
+    }
+
+    Fetch fetch;
+    fetch.key = key;
+    fetch.provider = provider;
+    fetch.query = query;
+    fetch.request = networkRequest;
+    fetch.waiters.append(waiter);
+
+    HttpCache::Entry entry;
+    if (m_cache.lookup(key, &entry)) {
+        if (entry.isFresh(QDateTime::currentMSecsSinceEpoch())) {
+            // 预取命中缓存即已完成；封面还要确认第二步的图片也在缓存里
+            if (!waiter.isPrefetch()) {
+                QMetaObject::invokeMethod(this, [this, fetch, entry]() { deliver(fetch, entry); }, Qt::QueuedConnection);
+            } else if (query.kind == MetadataProvider::AlbumArt) {
+                deliver(fetch, entry);
+            }
+            return;
+        }
+        fetch.stale = entry;
+        fetch.hasStale = true;
+    }
+
+    fetch.background = waiter.isPrefetch();
+    m_fetches.insert(key, fetch);
+    if (fetch.background) {
+        m_providers[provider].background.enqueue(key);
+    } else {
+        m_providers[provider].waiting.enqueue(key);
+    }
+    pumpQueues();
+}
+
+bool OnlineMusicService::takeToken(ProviderState &state, qint64 nowMs, qint64 *waitMs) {
+    if (nowMs < state.blockedUntil) {
+        *waitMs = state.blockedUntil - nowMs;
+        return false;
+    }
+    const double rate = state.provider->requestsPerSecond();
+    if (rate <= 0.0) return true;
+    // 令牌桶容量为一秒的配额，允许短暂突发
+    state.tokens = qMin(qMax(1.0, rate), state.tokens + double(nowMs - state.refilledAt) * rate / 1000.0);
+    state.refilledAt = nowMs;
+    if (state.tokens >= 1.0) {
+        state.tokens -= 1.0;
+        return true;
+    }
+    *waitMs = qint64(std::ceil((1.0 - state.tokens) * 1000.0 / rate));
+    return false;
+}
+
+bool OnlineMusicService::takePrefetchBudget(qint64 nowMs, qint64 *waitMs) {
+    if (m_prefetchBytesPerSecond <= 0) return true;
+    // 预算最多积攒一秒的量；为正即可发出，实际字节数在完成后扣除
+    const double rate = double(m_prefetchBytesPerSecond);
+    m_prefetchBudget = qMin(rate, m_prefetchBudget + double(nowMs - m_budgetRefilledAt) * rate / 1000.0);
+    m_budgetRefilledAt = nowMs;
+    if (m_prefetchBudget > 0.0) return true;
+    *waitMs = qint64(std::ceil(-m_prefetchBudget * 1000.0 / rate)) + 1;
+    return false;
+}
+
+void OnlineMusicService::pumpQueues() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 nextPump = -1;
+    auto wakeAfter = [&nextPump](qint64 waitMs) { nextPump = nextPump < 0 ? waitMs : qMin(nextPump, waitMs); };
+    for (ProviderState &state : m_providers) {
+        const int maxConcurrent = state.provider->maxConcurrentRequests();
+        while (!state.waiting.isEmpty() && state.active < maxConcurrent) {
+            qint64 waitMs = 0;
+            if (!takeToken(state, now, &waitMs)) {
+                wakeAfter(waitMs);
+                break;
+            }
+            auto it = m_fetches.find(state.waiting.dequeue());
+            if (it != m_fetches.end()) start(it.value());
+        }
+        // 预取只在前台队列清空后发出，并给前台留一个连接
+        const int backgroundSlots = qMax(1, maxConcurrent - 1);
+        while (state.waiting.isEmpty() && !state.background.isEmpty()
+               && state.active < maxConcurrent && state.activeBackground < backgroundSlots) {
+            qint64 waitMs = 0;
+            if (!takePrefetchBudget(now, &waitMs) || !takeToken(state, now, &waitMs)) {
+                wakeAfter(waitMs);
+                break;
+            }
+            auto it = m_fetches.find(state.background.dequeue());
+            if (it != m_fetches.end()) start(it.value());
+        }
+    }
+    if (nextPump >= 0 && (!m_pumpTimer->isActive() || m_pumpTimer->remainingTime() > nextPump)) {
+        m_pumpTimer->start(int(qMax<qint64>(1, nextPump)));
+    }
+}
+
+void OnlineMusicService::start(Fetch &fetch) {
+    QNetworkRequest networkRequest = fetch.request;
+    if (fetch.hasStale && fetch.stale.status == 200) {
+        if (!fetch.stale.etag.isEmpty()) networkRequest.setRawHeader("If-None-Match", fetch.stale.etag);
+        if (!fetch.stale.lastModified.isEmpty()) networkRequest.setRawHeader("If-Modified-Since", fetch.stale.lastModified);
+    }
+    // 图片常放在 CDN 上，地址可能跳转
+    networkRequest.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    networkRequest.setTransferTimeout(15000);
+#endif
+    QNetworkReply *reply = m_networkManager->get(networkRequest);
+    fetch.reply = reply;
+    m_pendingRequests.insert(reply, fetch.key);
+    connect(reply, &QNetworkReply::finished, this, &OnlineMusicService::onNetworkReply);
+    ProviderState &state = m_providers[fetch.provider];
+    ++state.active;
+    if (fetch.background) ++state.activeBackground;
+}
+
+void OnlineMusicService::release(Fetch &fetch) {
+    ProviderState &state = m_providers[fetch.provider];
+    --state.active;
+    if (fetch.background) --state.activeBackground;
+    fetch.reply = nullptr;
+}
+
+qint64 OnlineMusicService::expiryFor(QNetworkReply *reply, const Fetch &fetch, int status, qint64 nowMs) const {
+    const QByteArray cacheControl = reply->rawHeader("Cache-Control").toLower();
+    if (cacheControl.contains("no-store")) return -1;
+
+    qint64 ttl = 0;
+    const int maxAge = cacheControl.indexOf("max-age=");
+    if (maxAge >= 0) {
+        QByteArray digits;
+        for (int i = maxAge + 8; i < cacheControl.size() && std::isdigit(uchar(cacheControl[i])); ++i) digits += cacheControl[i];
+        ttl = digits.toLongLong() * 1000;
+    } else if (reply->hasRawHeader("Expires")) {
+        const QDateTime expires = QDateTime::fromString(QString::fromLatin1(reply->rawHeader("Expires")), Qt::RFC2822Date);
+        if (expires.isValid()) ttl = expires.toMSecsSinceEpoch() - nowMs;
+    }
+
+    // 服务器给的有效期偏短时按提供方的下限；查无结果最多记一天，之后再查一次
+    ttl = qMax(ttl, m_providers[fetch.provider].provider->minimumTtlMs(fetch.query.kind));
+    if (status == 404) ttl = qMin<qint64>(ttl, 24 * 3600 * 1000);
+    return nowMs + ttl;
+}
+
+void OnlineMusicService::onNetworkReply() {
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply) return;
+    reply->deleteLater();
+    const QString key = m_pendingRequests.take(reply);
+    auto it = m_fetches.find(key);
+    if (it == m_fetches.end()) return;
+    ProviderState &state = m_providers[it.value().provider];
+    const bool background = it.value().background;
+    release(it.value());
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // 限流或服务暂不可用：暂停该提供方，请求放回队首重试
+    if ((status == 429 || status == 503) && it.value().retries < 2) {
+        bool ok = false;
+        const int retryAfter = reply->rawHeader("Retry-After").toInt(&ok);
+        state.blockedUntil = now + (ok ? qBound(1, retryAfter, 300) : 5) * 1000;
+        ++it.value().retries;
+        (background ? state.background : state.waiting).prepend(key);
+        pumpQueues();
+        return;
+    }
+
+    const Fetch fetch = it.value();
+    m_fetches.erase(it);
+
+    if (status == 304 && fetch.hasStale) {
+        const qint64 expires = expiryFor(reply, fetch, fetch.stale.status, now);
+        if (expires >= 0) m_cache.refresh(key, expires, reply->rawHeader("ETag"));
+        deliver(fetch, fetch.stale);
+    } else if (status == 200 || status == 404) {
+        HttpCache::Entry entry;
+        entry.status = status;
+        entry.body = reply->readAll();
+        entry.etag = reply->rawHeader("ETag");
+        entry.lastModified = reply->rawHeader("Last-Modified");
+        entry.contentType = reply->rawHeader("Content-Type");
+        entry.storedAt = now;
+        entry.expiresAt = expiryFor(reply, fetch, status, now);
+        if (background && m_prefetchBytesPerSecond > 0) m_prefetchBudget -= double(entry.body.size());
+        if (entry.expiresAt >= 0) {
+            m_cache.insert(key, entry);
+        } else {
+            m_cache.remove(key);
+        }
+        deliver(fetch, entry);
+    } else if (fetch.hasStale) {
+        // 网络错误或服务端故障时用过期内容兜底
+        deliver(fetch, fetch.stale);
+    } else if (fetch.hasForegroundWaiter()) {
+        emit errorOccurred(QString("在线请求失败: %1").arg(reply->errorString()));
+    }
+    pumpQueues();
+}
+
+void OnlineMusicService::deliver(const Fetch &fetch, const HttpCache::Entry &entry) {
+    if (fetch.provider >= m_providers.size()) return;
+    const MetadataProvider *provider = m_providers[fetch.provider].provider;
+    const bool found = entry.status == 200;
+
+    switch (fetch.query.kind) {
+    case MetadataProvider::Search:
+    case MetadataProvider::Recommendations:
+    case MetadataProvider::Trending: {
+        QVector<OnlineTrack> tracks;
+        if (found) {
+            for (const QJsonObject &obj : provider->parseTracks(entry.body)) tracks.append(OnlineTrack::fromJson(obj));
+        }
+        if (fetch.query.kind == MetadataProvider::Recommendations) {
+            emit recommendationsReady(tracks);
+        } else {
+            emit searchCompleted(tracks);
+        }
+        break;
+    }
+    case MetadataProvider::Lyrics: {
+        const QString lyrics = found ? provider->parseLyrics(entry.body) : QString();
+        for (const Waiter &waiter : fetch.waiters) {
+            if (waiter.isPrefetch()) continue;
+            if (lyrics.isEmpty()) {
+                emit errorOccurred(QString("未找到歌词: %1 - %2").arg(waiter.artist, waiter.title));
+            } else {
+                emit lyricsReceived(waiter.artist, waiter.title, lyrics);
+            }
+        }
+        break;
+    }
+    case MetadataProvider::AlbumArt:
+        // 第二步：按各自尺寸取图片地址再下载，相同地址的下载同样会被合并
+        for (const Waiter &waiter : fetch.waiters) {
+            const QUrl url = found ? provider->parseImageUrl(entry.body, waiter.size) : QUrl();
+            if (!url.isValid() || url.isEmpty()) {
+                if (!waiter.isPrefetch()) emit errorOccurred(QString("未找到专辑封面: %1 - %2").arg(waiter.artist, waiter.album));
+                continue;
+            }
+            MetadataProvider::Query image;
+            image.kind = MetadataProvider::Image;
+            image.params["url"] = url.toString();
+            request(image, waiter);
+        }
+        break;
+    case MetadataProvider::Image: {
+        // 只有预取在等时不必解码
+        if (!fetch.hasForegroundWaiter()) break;
+        QPixmap pixmap;
+        if (!found || !pixmap.loadFromData(entry.body)) {
+            for (const Waiter &waiter : fetch.waiters) {
+                if (!waiter.isPrefetch()) emit errorOccurred(QString("专辑封面无法解码: %1 - %2").arg(waiter.artist, waiter.album));
+            }
+            break;
+        }
+        for (const Waiter &waiter : fetch.waiters) {
+            if (waiter.isPrefetch()) continue;
+            const bool resize = waiter.size.isValid() && pixmap.size() != waiter.size;
+            emit albumArtReceived(waiter.artist, waiter.album,
+                                  resize ? pixmap.scaled(waiter.size, Qt::KeepAspectRatio, Qt::SmoothTransformation) : pixmap);
+        }
+        break;
+    }
+    }
+}
@@ -0,0 +1,110 @@
+#include "../include/onset_detector.h"
+#include "../include/fast_math.h"
+#include <QtMath>
+#include <cmath>
+
+namespace {
+const float kCompression = 1e4f;       // γ：-40 dB 以下的功率变化几乎不计入通量
+const double kHistorySeconds = 1.0;
+const double kRefractorySeconds = 0.1;  // 两次起音的最小间隔
+const float kMinFlux = 0.05f;           // 绝对下限，静音与底噪中的起伏不触发
+}
+
+OnsetDetector::OnsetDetector()
+    : m_binCount(0)
+    , m_hasPrevious(false)
+    , m_historyPos(0)
+    , m_historyFill(0)
+    , m_sum(0.0)
+    , m_sumSquares(0.0)
+    , m_beforeCandidate(0.0f)
+    , m_candidate(0.0f)
+    , m_current(0.0f)
+    , m_refractoryFrames(1)
+    , m_framesSinceOnset(0)
+    , m_sensitivity(0.0f)
+    , m_thresholdSigma(0.0f)
+{
+    setSensitivity(0.5f);
+}
+
+void OnsetDetector::configure(int binCount, double frameRate) {
+    m_binCount = qMax(0, binCount);
+    m_previous.fill(0.0f, m_binCount);
+    m_history.fill(0.0f, qMax(8, int(std::lround(kHistorySeconds * frameRate))));
+    m_refractoryFrames = qMax(1, int(std::lround(kRefractorySeconds * frameRate)));
+    reset();
+}
+
+void OnsetDetector::reset() {
+    m_hasPrevious = false;
+    m_historyPos = 0;
+    m_historyFill = 0;
+    m_sum = 0.0;
+    m_sumSquares = 0.0;
+    m_beforeCandidate = 0.0f;
+    m_candidate = 0.0f;
+    m_current = 0.0f;
+    m_framesSinceOnset = m_refractoryFrames;
+}
+
+void OnsetDetector::setSensitivity(float sensitivity) {
+    m_sensitivity = qBound(0.0f, sensitivity, 1.0f);
+    m_thresholdSigma = 3.0f - 2.5f * m_sensitivity;
+}
+
+bool OnsetDetector::process(const float *power, float *intensity) {
+    if (m_binCount == 0 || m_history.isEmpty()) return false;
+
+    // 半波整流的压缩谱差分
+    float *previous = m_previous.data();
+    float flux = 0.0f;
+    for (int k = 0; k < m_binCount; ++k) {
+        const float compressed = FastMath::log2(1.0f + kCompression * power[k]);
+        flux += qMax(compressed - previous[k], 0.0f);
+        previous[k] = compressed;
+    }
+    flux = m_hasPrevious ? flux / m_binCount : 0.0f;
+    m_hasPrevious = true;
+
+    m_beforeCandidate = m_candidate;
+    m_candidate = m_current;
+    m_current = flux;
+    ++m_framesSinceOnset;
+
+    // 候选帧与历史统计比较（历史尚不含候选之后的帧）
+    bool onset = false;
+    if (m_historyFill >= m_history.size() / 4) {
+        const double mean = m_sum / m_historyFill;
+        const double variance = qMax(0.0, m_sumSquares / m_historyFill - mean * mean);
+        const float threshold = float(mean + m_thresholdSigma * std::sqrt(variance));
+        if (m_candidate > threshold && m_candidate > kMinFlux && m_candidate >= m_beforeCandidate
+            && m_candidate > m_current && m_framesSinceOnset > m_refractoryFrames) {
+            onset = true;
+            m_framesSinceOnset = 1;   // 候选帧在一帧之前
+            if (intensity) *intensity = qBound(0.0f, 1.0f - qMax(threshold, kMinFlux) / m_candidate, 1.0f);
+        }
+    }
+
+    // 写入环形历史：替换最旧的值，增量更新和与平方和；每绕一圈重算一次，避免累积误差
+    float &slot = m_history[m_historyPos];
+    if (m_historyFill == m_history.size()) {
+        m_sum -= slot;
+        m_sumSquares -= double(slot) * slot;
+    } else {
+        ++m_historyFill;
+    }
+    slot = m_candidate;
+    m_sum += slot;
+    m_sumSquares += double(slot) * slot;
+    if (++m_historyPos == m_history.size()) {
+        m_historyPos = 0;
+        m_sum = 0.0;
+        m_sumSquares = 0.0;
+        for (int i = 0; i < m_historyFill; ++i) {
+            m_sum += m_history[i];
+            m_sumSquares += double(m_history[i]) * m_history[i];
+        }
+    }
+    return onset;
+}
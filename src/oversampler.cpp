@@ -0,0 +1,210 @@
+#include "../include/oversampler.h"
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OVERSAMPLER_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OVERSAMPLER_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+// 各级半带滤波器的非零抽头对数 K（滤波器长 4K-1）；Kaiser β = 8 约 80dB 阻带衰减
+const int kStageTaps[3] = {16, 8, 6};
+const double kKaiserBeta = 8.0;
+
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// y[n] = Σ g[j] · (x[n + 1 + j - K] + x[n - K - j])，x 之前需有 2K-1 个历史样本
+void symmetricFir(const float *x, float *y, int frames, const float *g, int taps) {
+    int n = 0;
+#if defined(OVERSAMPLER_HAVE_SSE2)
+    for (; n + 4 <= frames; n += 4) {
+        __m128 acc = _mm_setzero_ps();
+        const float *newer = x + n + 1 - taps;
+        const float *older = x + n - taps;
+        for (int j = 0; j < taps; ++j) {
+            const __m128 pair = _mm_add_ps(_mm_loadu_ps(newer + j), _mm_loadu_ps(older - j));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(g[j]), pair));
+        }
+        _mm_storeu_ps(y + n, acc);
+    }
+#elif defined(OVERSAMPLER_HAVE_NEON)
+    for (; n + 4 <= frames; n += 4) {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        const float *newer = x + n + 1 - taps;
+        const float *older = x + n - taps;
+        for (int j = 0; j < taps; ++j) {
+            const float32x4_t pair = vaddq_f32(vld1q_f32(newer + j), vld1q_f32(older - j));
+            acc = vmlaq_n_f32(acc, pair, g[j]);
+        }
+        vst1q_f32(y + n, acc);
+    }
+#endif
+    for (; n < frames; ++n) {
+        float acc = 0.0f;
+        for (int j = 0; j < taps; ++j) {
+            acc += g[j] * (x[n + 1 + j - taps] + x[n - taps - j]);
+        }
+        y[n] = acc;
+    }
+}
+}
+
+Oversampler::Oversampler()
+    : m_factor(1)
+    , m_stageCount(0)
+    , m_channels(0)
+{
+    for (int i = 0; i < 3; ++i) {
+        designStage(m_stages[i], kStageTaps[i]);
+        m_stages[i].maxFrames = 0;
+    }
+}
+
+void Oversampler::designStage(Stage &stage, int taps) {
+    // 理想半带低通 h[d] = sin(πd/2) / (πd)，非零的奇数 d = 2j+1 处为 (-1)^j / (π(2j+1))
+    stage.taps = taps;
+    stage.coeffs.resize(taps);
+    const double halfWidth = 2.0 * taps;
+    double sum = 0.0;
+    for (int j = 0; j < taps; ++j) {
+        const double d = 2.0 * j + 1.0;
+        const double ratio = d / halfWidth;
+        const double window = besselI0(kKaiserBeta * std::sqrt(1.0 - ratio * ratio)) / besselI0(kKaiserBeta);
+        const double value = ((j % 2) ? -1.0 : 1.0) / (M_PI * d) * window;
+        stage.coeffs[j] = float(value);
+        sum += value;
+    }
+    // 直流增益归一：0.5 + 2·Σg = 1
+    const float scale = float(0.25 / sum);
+    for (float &g : stage.coeffs) g *= scale;
+}
+
+void Oversampler::setup(int channels, int maxBlockFrames) {
+    m_channels = qMax(channels, 0);
+    int frames = qMax(maxBlockFrames, 1);
+    for (Stage &stage : m_stages) {
+        const int history = 2 * stage.taps - 1;
+        stage.maxFrames = frames;
+        stage.upHistory.fill(0.0f, m_channels * (history + frames));
+        stage.downEven.fill(0.0f, m_channels * (history + frames));
+        stage.downOdd.fill(0.0f, m_channels * (stage.taps + frames));
+        frames *= 2;
+    }
+    m_buffers[0].setSize(m_channels, qMax(maxBlockFrames, 1) * MaxFactor);
+    m_buffers[1].setSize(m_channels, qMax(maxBlockFrames, 1) * MaxFactor);
+    m_scratch.fill(0.0f, qMax(maxBlockFrames, 1) * MaxFactor / 2);
+}
+
+void Oversampler::setFactor(int factor) {
+    int stages = 0;
+    if (factor >= 6) stages = 3;
+    else if (factor >= 3) stages = 2;
+    else if (factor >= 2) stages = 1;
+    if (stages == m_stageCount) return;
+    m_stageCount = stages;
+    m_factor = 1 << stages;
+    reset();
+}
+
+int Oversampler::latencyFor(int factor) {
+    // 第 i 级两个方向各延迟 2K-1 个高采样率样本，折算到原采样率
+    double samples = 0.0;
+    for (int i = 0, f = 2; f <= qMin(factor, int(MaxFactor)); ++i, f *= 2) {
+        samples += 2.0 * (2 * kStageTaps[i] - 1) / f;
+    }
+    return qRound(samples);
+}
+
+void Oversampler::reset() {
+    for (Stage &stage : m_stages) {
+        stage.upHistory.fill(0.0f);
+        stage.downEven.fill(0.0f);
+        stage.downOdd.fill(0.0f);
+    }
+}
+
+void Oversampler::upsampleStage(Stage &stage, int ch, const float *input, float *output, int frames) {
+    const int taps = stage.taps;
+    const int history = 2 * taps - 1;
+    float *x = stage.upHistory.data() + ch * (history + stage.maxFrames);
+    std::memcpy(x + history, input, sizeof(float) * frames);
+
+    const float *current = x + history;
+    float *even = m_scratch.data();
+    symmetricFir(current, even, frames, stage.coeffs.constData(), taps);
+    // 补零后的信号只有一半样本非零，偶数相乘 2 补回增益；奇数相只剩中心抽头 0.5 × 2
+    for (int n = 0; n < frames; ++n) {
+        output[2 * n] = 2.0f * even[n];
+        output[2 * n + 1] = current[n + 1 - taps];
+    }
+    std::memmove(x, x + frames, sizeof(float) * history);
+}
+
+void Oversampler::downsampleStage(Stage &stage, int ch, const float *input, float *output, int frames) {
+    const int taps = stage.taps;
+    const int history = 2 * taps - 1;
+    float *even = stage.downEven.data() + ch * (history + stage.maxFrames);
+    float *odd = stage.downOdd.data() + ch * (taps + stage.maxFrames);
+    for (int n = 0; n < frames; ++n) {
+        even[history + n] = input[2 * n];
+        odd[taps + n] = input[2 * n + 1];
+    }
+
+    symmetricFir(even + history, output, frames, stage.coeffs.constData(), taps);
+    for (int n = 0; n < frames; ++n) {
+        output[n] += 0.5f * odd[n];
+    }
+    std::memmove(even, even + frames, sizeof(float) * history);
+    std::memmove(odd, odd + frames, sizeof(float) * taps);
+}
+
+AudioBlock Oversampler::upsample(const AudioBlock &block) {
+    if (m_stageCount == 0) return block;
+
+    const int channels = qMin(block.channelCount, m_channels);
+    for (int ch = 0; ch < channels; ++ch) {
+        const float *source = block.channel(ch);
+        int frames = block.frameCount;
+        for (int i = 0; i < m_stageCount; ++i) {
+            float *target = m_buffers[i % 2].channel(ch);
+            upsampleStage(m_stages[i], ch, source, target, frames);
+            source = target;
+            frames *= 2;
+        }
+    }
+    AudioBlock result = m_buffers[(m_stageCount - 1) % 2].block(block.frameCount * m_factor);
+    result.channelCount = channels;
+    return result;
+}
+
+void Oversampler::downsample(const AudioBlock &block) {
+    if (m_stageCount == 0) return;
+
+    const int channels = qMin(block.channelCount, m_channels);
+    for (int ch = 0; ch < channels; ++ch) {
+        const float *source = m_buffers[(m_stageCount - 1) % 2].channel(ch);
+        int frames = block.frameCount * m_factor;
+        for (int i = m_stageCount - 1; i >= 0; --i) {
+            frames /= 2;
+            float *target = i == 0 ? block.channel(ch) : m_buffers[(i - 1) % 2].channel(ch);
+            downsampleStage(m_stages[i], ch, source, target, frames);
+            source = target;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include "../include/partitioned_convolver.h"
+#include <cstring>
+
+PartitionedConvolver::PartitionedConvolver()
+    : m_partitionSize(0)
+    , m_partitionCount(0)
+    , m_binCount(0)
+    , m_delayLinePos(0)
+    , m_fifoPos(0)
+{
+}
+
+void PartitionedConvolver::setImpulseResponse(const float *impulse, int length, int partitionSize) {
+    m_partitionSize = RealFFT::nextPowerOfTwo(qMax(partitionSize, 2));
+    m_partitionCount = impulse && length > 0 ? (length + m_partitionSize - 1) / m_partitionSize : 0;
+    m_binCount = m_partitionSize + 1;
+
+    const int fftSize = 2 * m_partitionSize;
+    const int spectrumSize = 2 * m_binCount;
+    m_fft.setSize(fftSize);
+
+    // 每个分区补零到 2B 后变换
+    m_impulseSpectra.fill(0.0f, m_partitionCount * spectrumSize);
+    QVector<float> padded(fftSize, 0.0f);
+    for (int p = 0; p < m_partitionCount; ++p) {
+        const int offset = p * m_partitionSize;
+        const int count = qMin(m_partitionSize, length - offset);
+        padded.fill(0.0f);
+        std::memcpy(padded.data(), impulse + offset, sizeof(float) * count);
+        float *spectrum = m_impulseSpectra.data() + p * spectrumSize;
+        m_fft.forward(padded.constData(), spectrum, spectrum + m_binCount);
+    }
+
+    m_delayLine.fill(0.0f, m_partitionCount * spectrumSize);
+    m_inputWindow.fill(0.0f, fftSize);
+    m_outputBlock.fill(0.0f, m_partitionSize);
+    m_accumRe.fill(0.0f, m_binCount);
+    m_accumIm.fill(0.0f, m_binCount);
+    m_timeScratch.fill(0.0f, fftSize);
+    m_delayLinePos = 0;
+    m_fifoPos = 0;
+}
+
+void PartitionedConvolver::reset() {
+    m_delayLine.fill(0.0f);
+    m_inputWindow.fill(0.0f);
+    m_outputBlock.fill(0.0f);
+    m_delayLinePos = 0;
+    m_fifoPos = 0;
+}
+
+void PartitionedConvolver::process(const float *input, float *output, int frames) {
+    if (m_partitionCount == 0) {
+        std::memset(output, 0, sizeof(float) * frames);
+        return;
+    }
+
+    const int size = m_partitionSize;
+    float *window = m_inputWindow.data();
+    const float *delayed = m_outputBlock.constData();
+    int done = 0;
+    while (done < frames) {
+        const int count = qMin(frames - done, size - m_fifoPos);
+        // 先取输入再写输出，允许就地处理
+        std::memcpy(window + size + m_fifoPos, input + done, sizeof(float) * count);
+        std::memcpy(output + done, delayed + m_fifoPos, sizeof(float) * count);
+        m_fifoPos += count;
+        done += count;
+        if (m_fifoPos == size) {
+            processPartition();
+            m_fifoPos = 0;
+        }
+    }
+}
+
+void PartitionedConvolver::processPartition() {
+    const int size = m_partitionSize;
+    const int bins = m_binCount;
+    const int spectrumSize = 2 * bins;
+    float *window = m_inputWindow.data();
+
+    // 当前 2B 窗口的频谱写入延迟线的当前槽位
+    float *slot = m_delayLine.data() + m_delayLinePos * spectrumSize;
+    m_fft.forward(window, slot, slot + bins);
+
+    // Y = Σ X[i - p] · H[p]，分离的实部虚部数组便于编译器向量化
+    float *accRe = m_accumRe.data();
+    float *accIm = m_accumIm.data();
+    std::memset(accRe, 0, sizeof(float) * bins);
+    std::memset(accIm, 0, sizeof(float) * bins);
+    int slotIndex = m_delayLinePos;
+    for (int p = 0; p < m_partitionCount; ++p) {
+        const float *xr = m_delayLine.constData() + slotIndex * spectrumSize;
+        const float *xi = xr + bins;
+        const float *hr = m_impulseSpectra.constData() + p * spectrumSize;
+        const float *hi = hr + bins;
+        for (int k = 0; k < bins; ++k) {
+            accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+            accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+        }
+        if (--slotIndex < 0) slotIndex = m_partitionCount - 1;
+    }
+
+    // 重叠保留：循环卷积的后半段即为线性卷积结果
+    m_fft.inverse(accRe, accIm, m_timeScratch.data());
+    std::memcpy(m_outputBlock.data(), m_timeScratch.constData() + size, sizeof(float) * size);
+
+    std::memcpy(window, window + size, sizeof(float) * size);
+    if (++m_delayLinePos >= m_partitionCount) m_delayLinePos = 0;
+}
@@ -0,0 +1,100 @@
+#include "../include/play_log.h"
+#include <QJsonDocument>
+#include <QDebug>
+
+namespace {
+QString rotatedPath(const QString &filePath) {
+    return filePath + ".1";
+}
+
+// 逐行解析，返回完整行数；不完整的末行不计入，validLength 为有效内容的长度
+int forEachLine(const QByteArray &data, const std::function<void(const QJsonObject &)> &visitor, int *validLength) {
+    int lines = 0;
+    int lineStart = 0;
+    while (lineStart < data.size()) {
+        const int lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd < 0) break;
+        if (visitor) {
+            const QJsonObject record = QJsonDocument::fromJson(data.mid(lineStart, lineEnd - lineStart)).object();
+            if (!record.isEmpty()) visitor(record);
+        }
+        lineStart = lineEnd + 1;
+        ++lines;
+    }
+    if (validLength) *validLength = lineStart;
+    return lines;
+}
+}
+
+PlayLog::PlayLog(int maxRecords)
+    : m_maxRecords(qMax(1, maxRecords))
+    , m_records(0)
+{
+}
+
+PlayLog::~PlayLog() {
+    close();
+}
+
+bool PlayLog::open(const QString &filePath) {
+    close();
+    m_filePath = filePath;
+    m_records = 0;
+    m_file.setFileName(filePath);
+
+    if (m_file.open(QIODevice::ReadOnly)) {
+        const QByteArray data = m_file.readAll();
+        m_file.close();
+        int validLength = 0;
+        m_records = forEachLine(data, nullptr, &validLength);
+        // 上次写到一半的末行直接截掉
+        if (validLength < data.size() && !m_file.resize(validLength)) {
+            qWarning() << "Failed to truncate play log:" << filePath;
+        }
+    }
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open play log:" << filePath << m_file.errorString();
+        return false;
+    }
+    if (m_records >= m_maxRecords) rotate();
+    return true;
+}
+
+void PlayLog::close() {
+    if (m_file.isOpen()) m_file.close();
+}
+
+void PlayLog::append(const QJsonObject &record) {
+    if (!m_file.isOpen()) return;
+    const QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+    if (m_file.write(line) != line.size()) {
+        qWarning() << "Failed to write play log:" << m_file.errorString();
+    }
+    m_file.flush();
+    if (++m_records >= m_maxRecords) rotate();
+}
+
+void PlayLog::replay(const std::function<void(const QJsonObject &)> &visitor) const {
+    if (m_filePath.isEmpty() || !visitor) return;
+    const QString paths[2] = {rotatedPath(m_filePath), m_filePath};
+    for (const QString &path : paths) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) continue;
+        forEachLine(file.readAll(), visitor, nullptr);
+    }
+}
+
+void PlayLog::rotate() {
+    m_file.close();
+    const QString older = rotatedPath(m_filePath);
+    QFile::remove(older);
+    if (!QFile::rename(m_filePath, older)) {
+        qWarning() << "Failed to rotate play log:" << m_filePath;
+        QFile::remove(m_filePath);
+    }
+    m_records = 0;
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to reopen play log:" << m_filePath << m_file.errorString();
+    }
+}
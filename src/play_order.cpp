@@ -0,0 +1,60 @@
+#include "../include/play_order.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+PlayOrder::PlayOrder()
+    : m_mode(PlayMode::Sequential)
+    , m_count(0)
+{
+}
+
+void PlayOrder::reset(int count, PlayMode mode, int current) {
+    m_mode = mode;
+    m_count = qMax(0, count);
+    m_order.clear();
+    m_position.clear();
+    if (m_mode != PlayMode::Random || m_count == 0) return;
+
+    m_order.resize(m_count);
+    std::iota(m_order.begin(), m_order.end(), 0);
+    int first = 0;
+    if (current >= 0 && current < m_count) {
+        std::swap(m_order[0], m_order[current]);
+        first = 1;
+    }
+    std::mt19937 rng(std::random_device{}());
+    std::shuffle(m_order.begin() + first, m_order.end(), rng);
+
+    m_position.resize(m_count);
+    for (int i = 0; i < m_count; ++i) m_position[m_order[i]] = i;
+}
+
+int PlayOrder::positionOf(int index) const {
+    if (index < 0 || index >= m_count) return -1;
+    return m_mode == PlayMode::Random ? m_position[index] : index;
+}
+
+int PlayOrder::next(int current) const {
+    // 还没有播放过：从顺序的第一首开始
+    if (current < 0) return m_count > 0 ? (m_mode == PlayMode::Random ? m_order[0] : 0) : -1;
+    const int position = positionOf(current);
+    if (position < 0 || position + 1 >= m_count) return -1;
+    return m_mode == PlayMode::Random ? m_order[position + 1] : position + 1;
+}
+
+int PlayOrder::previous(int current) const {
+    const int position = positionOf(current);
+    if (position <= 0) return -1;
+    return m_mode == PlayMode::Random ? m_order[position - 1] : position - 1;
+}
+
+QVector<int> PlayOrder::upcoming(int current, int n) const {
+    QVector<int> result;
+    const int position = positionOf(current);
+    if (position < 0) return result;
+    const int end = qMin(m_count, position + 1 + qMax(0, n));
+    result.reserve(end - position - 1);
+    for (int p = position + 1; p < end; ++p) result.append(m_mode == PlayMode::Random ? m_order[p] : p);
+    return result;
+}
@@ -1,4 +1,5 @@
 #include "../include/playerwindow.h"
+#include "../include/audio_effects.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
@@ -33,7 +34,12 @@
 #include <QListWidgetItem>
 #include "../include/ffmpeg_waveform.h"
 #include "../include/taglib_utils.h"
+#include "../include/playlistmanager.h"
 #include "../include/materialui_components.h"
+#ifdef ENABLE_ONLINE_METADATA
+#include "../include/online_music_service.h"
+#include "../include/metadata_prefetcher.h"
+#endif
 
 PlayerWindow::PlayerWindow(QWidget *parent) 
     : QMainWindow(parent)
@@ -62,11 +68,15 @@ PlayerWindow::PlayerWindow(QWidget *parent)
     , totalTimeLabel(nullptr)
     , volumeFrame(nullptr)
     , equalizerWindow(nullptr)
+    , equalizer(nullptr)
     , player(nullptr)
     , progressTimer(nullptr)
     , currentPlayMode(PlayMode::Sequential)
     , isDarkTheme(false)
     , currentTrackIndex(-1)
+    , library(nullptr)
+    , onlineService(nullptr)
+    , prefetcher(nullptr)
     , totalDuration(0)
     , volumeAnimation(nullptr)
     , shadowEffect(nullptr)
@@ -695,15 +705,17 @@ void PlayerWindow::playPause() {
 }
 
 void PlayerWindow::previousTrack() {
-    if (currentTrackIndex > 0) {
-        currentTrackIndex--;
+    const int index = playOrder.previous(currentTrackIndex);
+    if (index >= 0) {
+        currentTrackIndex = index;
         loadSong(playlist[currentTrackIndex]);
     }
 }
 
 void PlayerWindow::nextTrack() {
-    if (currentTrackIndex < playlist.size() - 1) {
-        currentTrackIndex++;
+    const int index = playOrder.next(currentTrackIndex);
+    if (index >= 0) {
+        currentTrackIndex = index;
         loadSong(playlist[currentTrackIndex]);
     }
 }
@@ -729,7 +741,10 @@ void PlayerWindow::changePlayMode() {
             currentPlayMode = PlayMode::Sequential;
             break;
     }
+    // 切到随机时从当前曲目开始重新洗牌
+    playOrder.setMode(currentPlayMode, currentTrackIndex);
     updatePlayModeIcon();
+    updatePrefetch();
 }
 
 void PlayerWindow::updateProgress() {
@@ -754,6 +769,8 @@ void PlayerWindow::onPlaylistItemClicked() {
     int index = playlistWidget->currentRow();
     if (index >= 0 && index < playlist.size()) {
         currentTrackIndex = index;
+        // 随机模式下手动点选后以这首为起点重新洗牌，否则下一首会沿旧排列跳到点选前的位置
+        if (currentPlayMode == PlayMode::Random) playOrder.reset(playlist.size(), currentPlayMode, index);
         loadSong(playlist[index]);
     }
 }
@@ -1097,21 +1114,39 @@ void PlayerWindow::loadSong(const QString &audioPath) {
     artistLabel->setText(songInfo.artist.isEmpty() ? "未知艺术家" : songInfo.artist);
     albumLabel->setText(songInfo.album.isEmpty() ? "未知专辑" : songInfo.album);
     
-    // 设置专辑封面
+    // 设置专辑封面；没有内嵌封面时向在线服务要，预取过的直接命中缓存
+    pendingArtArtist.clear();
+    pendingArtAlbum.clear();
     if (!songInfo.cover.isNull()) {
         QPixmap pixmap = QPixmap::fromImage(songInfo.cover);
         albumCoverLabel->setPixmap(pixmap.scaled(120, 120, Qt::KeepAspectRatio, Qt::SmoothTransformation));
     } else {
         albumCoverLabel->setPixmap(createDefaultAlbumCover());
+#ifdef ENABLE_ONLINE_METADATA
+        if (onlineService && !songInfo.album.isEmpty()) {
+            pendingArtArtist = songInfo.artist;
+            pendingArtAlbum = songInfo.album;
+            onlineService->getAlbumArt(songInfo.artist, songInfo.album);
+        }
+#endif
     }
     
     // 加载歌词
     QString lrcPath = QFileInfo(audioPath).absolutePath() + "/" + QFileInfo(audioPath).completeBaseName() + ".lrc";
     lyricsVisualWidget->loadLrc(lrcPath);
     
-    // 生成波形数据
-    QVector<float> waveform = extractWaveformFFmpeg(audioPath, 256);
-    lyricsVisualWidget->setAudioWaveform(waveform);
+    // 波形与响度优先取曲库扫描时保存的结果（含专辑响度）；不在曲库中或保存的结果不完整
+    // （例如旧版播放列表没有波形）时才现场解码
+    const SongInfo *stored = library ? library->findSong(audioPath) : nullptr;
+    if (stored && stored->trackLoudness.valid && !stored->waveform.isEmpty()) {
+        lyricsVisualWidget->setAudioWaveform(stored->waveform);
+        player->setLoudness(stored->trackLoudness, stored->albumLoudness);
+    } else {
+        LoudnessInfo loudness;
+        QVector<float> waveform = extractWaveformFFmpeg(audioPath, 256, &loudness);
+        lyricsVisualWidget->setAudioWaveform(waveform);
+        player->setLoudness(loudness);
+    }
     
     // 更新进度条和时间
     totalTimeLabel->setText(formatTime(songInfo.durationMs));
@@ -1122,6 +1157,41 @@ void PlayerWindow::loadSong(const QString &audioPath) {
     // 开始播放
     player->play();
     progressTimer->start();
+    updatePrefetch();
+}
+
+void PlayerWindow::setOnlineService(OnlineMusicService *service) {
+#ifdef ENABLE_ONLINE_METADATA
+    if (onlineService || !service) return;
+    onlineService = service;
+    prefetcher = new MetadataPrefetcher(service);
+    // 歌词仍只读本地 .lrc，只预取界面会用到的封面
+    prefetcher->setLyricsEnabled(false);
+    connect(service, &OnlineMusicService::albumArtReceived, this,
+            [this](const QString &artist, const QString &album, const QPixmap &art) {
+        if (art.isNull() || artist != pendingArtArtist || album != pendingArtAlbum) return;
+        albumCoverLabel->setPixmap(art.scaled(120, 120, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    });
+    updatePrefetch();
+#else
+    Q_UNUSED(service)
+#endif
+}
+
+void PlayerWindow::updatePrefetch() {
+#ifdef ENABLE_ONLINE_METADATA
+    if (!prefetcher) return;
+    // 只有即将播放的几首需要标签，曲库里有的直接取，不在曲库的才读文件
+    QVector<MetadataPrefetcher::Track> queue(playlist.size());
+    for (int index : playOrder.upcoming(currentTrackIndex, prefetcher->lookahead())) {
+        const SongInfo *stored = library ? library->findSong(playlist[index]) : nullptr;
+        const SongInfo info = stored ? *stored : readAudioMeta(playlist[index]);
+        queue[index].artist = info.artist;
+        queue[index].title = info.title;
+        queue[index].album = info.album;
+    }
+    prefetcher->update(queue, playOrder, currentTrackIndex);
+#endif
 }
 
 void PlayerWindow::updatePlayModeIcon() {
@@ -1173,6 +1243,8 @@ void PlayerWindow::addFilesToPlaylist(const QStringList &files) {
         playlistWidget->addItem(item);
         playlist << file;
     }
+    playOrder.reset(playlist.size(), currentPlayMode, currentTrackIndex);
+    updatePrefetch();
 }
 
 void PlayerWindow::showVolumeSlider(bool show) {
@@ -1405,6 +1477,10 @@ void PlayerWindow::setupEqualizer() {
     layout->setContentsMargins(20, 20, 20, 20);
     layout->setSpacing(15);
     
+    // 均衡器效果器加入播放器音效链，10 个标准频段与滑块一一对应
+    equalizer = new MultibandEqualizer();
+    player->effectChain()->addEffect(equalizer);
+    
     // 均衡器标题
     QLabel *titleLabel = new QLabel("10频段均衡器");
     titleLabel->setAlignment(Qt::AlignCenter);
@@ -1439,8 +1515,10 @@ void PlayerWindow::setupEqualizer() {
         valueLabel->setStyleSheet("font-size: 10px; color: #333;");
         
         // 连接滑块值变化信号
-        connect(eqSliders[i], &QSlider::valueChanged, [valueLabel](int value) {
+        connect(eqSliders[i], &QSlider::valueChanged, [this, i, valueLabel](int value) {
             valueLabel->setText(QString("%1dB").arg(value));
+            // 经无锁队列投递到音频线程，拖动时系数平滑过渡
+            equalizer->setParameter(MultibandEqualizer::bandParameter(i, MultibandEqualizer::BandGain), value);
         });
         
         sliderLayout->addWidget(freqLabel);
@@ -2,6 +2,26 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QByteArray>
+#include <cmath>
+
+namespace {
+// 波形只用于显示，每点量化为一个字节后以 base64 存放，256 点约 350 字符
+QString encodeWaveform(const QVector<float> &waveform) {
+    QByteArray bytes(waveform.size(), '\0');
+    for (int i = 0; i < waveform.size(); ++i) {
+        bytes[i] = char(quint8(std::lround(qBound(0.0f, waveform[i], 1.0f) * 255.0f)));
+    }
+    return QString::fromLatin1(bytes.toBase64());
+}
+
+QVector<float> decodeWaveform(const QString &text) {
+    const QByteArray bytes = QByteArray::fromBase64(text.toLatin1());
+    QVector<float> waveform(bytes.size());
+    for (int i = 0; i < bytes.size(); ++i) waveform[i] = quint8(bytes[i]) / 255.0f;
+    return waveform;
+}
+}
 
 QJsonObject Playlist::toJson() const {
     QJsonObject obj;
@@ -15,6 +35,10 @@ QJsonObject Playlist::toJson() const {
         so["album"] = s.album;
         so["durationMs"] = QString::number(s.durationMs);
         so["lyrics"] = s.lyrics;
+        so["lastModified"] = QString::number(s.lastModified);
+        so["loudness"] = s.trackLoudness.toJson();
+        so["albumLoudness"] = s.albumLoudness.toJson();
+        if (!s.waveform.isEmpty()) so["waveform"] = encodeWaveform(s.waveform);
         arr.append(so);
     }
     obj["songs"] = arr;
@@ -33,6 +57,10 @@ Playlist Playlist::fromJson(const QJsonObject& obj) {
         s.album = so["album"].toString();
         s.durationMs = so["durationMs"].toString().toLongLong();
         s.lyrics = so["lyrics"].toString();
+        s.lastModified = so["lastModified"].toString().toLongLong();
+        s.trackLoudness = LoudnessInfo::fromJson(so["loudness"].toObject());
+        s.albumLoudness = LoudnessInfo::fromJson(so["albumLoudness"].toObject());
+        s.waveform = decodeWaveform(so["waveform"].toString());
         pl.songs.append(s);
     }
     return pl;
@@ -3,7 +3,97 @@
 #include "../include/ffmpeg_waveform.h"
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QJsonDocument>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMetaObject>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace {
+// 单首歌曲分析任务：一次解码同时得到波形与响度
+class SongAnalysisTask : public QRunnable {
+public:
+    SongAnalysisTask(SongInfo *song, bool readMeta) : m_song(song), m_readMeta(readMeta) {}
+
+    void run() override {
+        const QString path = m_song->filePath;
+        if (m_readMeta) {
+            *m_song = readAudioMeta(path);
+        }
+        m_song->waveform = extractWaveformFFmpeg(path, 256, &m_song->trackLoudness);
+        m_song->lastModified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    }
+
+private:
+    SongInfo *m_song;
+    bool m_readMeta;
+};
+
+// 在线程池中并行分析，返回前等待全部完成
+void analyzeSongs(const QVector<SongInfo*> &songs, bool readMeta) {
+    if (songs.isEmpty()) return;
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    for (SongInfo *song : songs) {
+        pool.start(new SongAnalysisTask(song, readMeta));
+    }
+    pool.waitForDone();
+}
+
+// 后台批次中的单首歌曲：分析副本，全部完成后由最后一个任务投递合并
+class LoudnessUpdateTask : public QRunnable {
+public:
+    LoudnessUpdateTask(SongInfo *song, std::atomic<int> *remaining, std::function<void()> finished)
+        : m_song(song), m_remaining(remaining), m_finished(std::move(finished)) {}
+
+    void run() override {
+        SongAnalysisTask(m_song, false).run();
+        if (m_remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) m_finished();
+    }
+
+private:
+    SongInfo *m_song;
+    std::atomic<int> *m_remaining;
+    std::function<void()> m_finished;
+};
+
+// 文件改过，或者保存的结果不完整（旧版播放列表不含波形）
+bool needsAnalysis(const SongInfo &song) {
+    QFileInfo info(song.filePath);
+    if (!info.exists()) return false;
+    return info.lastModified().toMSecsSinceEpoch() != song.lastModified
+        || song.waveform.isEmpty();
+}
+
+// 按专辑标签分组合成专辑响度，无专辑标签的歌曲以所在播放列表为一组
+void updateAlbumLoudness(Playlist &pl) {
+    QMap<QString, QVector<LoudnessInfo>> albums;
+    for (const SongInfo &s : pl.songs) {
+        albums[s.album.isEmpty() ? pl.name : s.album].append(s.trackLoudness);
+    }
+    QMap<QString, LoudnessInfo> combined;
+    for (const QString &album : albums.keys()) {
+        combined[album] = LoudnessInfo::combine(albums.value(album));
+    }
+    for (SongInfo &s : pl.songs) {
+        s.albumLoudness = combined.value(s.album.isEmpty() ? pl.name : s.album);
+    }
+}
+
+void savePlaylist(const Playlist &pl, const QString &myMusicDir) {
+    QFile f(myMusicDir + "/" + pl.name + ".json");
+    if (f.open(QIODevice::WriteOnly)) {
+        QJsonDocument doc(pl.toJson());
+        f.write(doc.toJson());
+        f.close();
+    }
+}
+}
 
 void PlaylistManager::scanMusicFolders(const QString& musicRootDir, const QString& myMusicDir) {
     QDir musicDir(musicRootDir);
@@ -21,23 +111,74 @@ void PlaylistManager::scanMusicFolders(const QString& musicRootDir, const QStrin
         QStringList filters = {"*.mp3", "*.flac", "*.wav", "*.ape", "*.aac", "*.ogg", "*.m4a"};
         
         for (const QString& musicFile : fdir.entryList(filters, QDir::Files)) {
-            QString fullPath = fdir.absoluteFilePath(musicFile);
-            SongInfo s = readAudioMeta(fullPath);
-            s.waveform = extractWaveformFFmpeg(fullPath, 256);
+            SongInfo s;
+            s.filePath = fdir.absoluteFilePath(musicFile);
             pl.songs.append(s);
         }
         
-        playlists.append(pl);
+        QVector<SongInfo*> pending;
+        for (SongInfo& s : pl.songs) pending.append(&s);
+        analyzeSongs(pending, true);
+        updateAlbumLoudness(pl);
         
-        QFile f(playlistJsonPath);
-        if (f.open(QIODevice::WriteOnly)) {
-            QJsonDocument doc(pl.toJson());
-            f.write(doc.toJson());
-            f.close();
+        playlists.append(pl);
+        savePlaylist(pl, myMusicDir);
+    }
+}
+
+struct PlaylistManager::LoudnessBatch {
+    QString playlistName;
+    QString myMusicDir;
+    QVector<SongInfo> songs;        // 待分析歌曲的副本，只在后台任务中修改
+    std::atomic<int> remaining;
+};
+
+void PlaylistManager::updateLoudness(const QString& myMusicDir) {
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+    for (const Playlist& pl : playlists) {
+        auto batch = std::make_shared<LoudnessBatch>();
+        batch->playlistName = pl.name;
+        batch->myMusicDir = myMusicDir;
+        for (const SongInfo& s : pl.songs) {
+            if (needsAnalysis(s)) batch->songs.append(s);
+        }
+        if (batch->songs.isEmpty()) continue;
+
+        batch->remaining.store(batch->songs.size(), std::memory_order_relaxed);
+        auto finished = [this, batch]() {
+            QMetaObject::invokeMethod(&m_context, [this, batch]() { applyLoudness(*batch); }, Qt::QueuedConnection);
+        };
+        for (SongInfo& s : batch->songs) {
+            m_pool.start(new LoudnessUpdateTask(&s, &batch->remaining, finished));
+        }
+    }
+}
+
+void PlaylistManager::applyLoudness(const LoudnessBatch &batch) {
+    for (Playlist& pl : playlists) {
+        if (pl.name != batch.playlistName) continue;
+        for (const SongInfo& analyzed : batch.songs) {
+            for (SongInfo& s : pl.songs) {
+                if (s.filePath != analyzed.filePath) continue;
+                s.waveform = analyzed.waveform;
+                s.trackLoudness = analyzed.trackLoudness;
+                s.lastModified = analyzed.lastModified;
+            }
         }
+        updateAlbumLoudness(pl);
+        savePlaylist(pl, batch.myMusicDir);
     }
 }
 
+const SongInfo *PlaylistManager::findSong(const QString& filePath) const {
+    for (const Playlist& pl : playlists) {
+        for (const SongInfo& s : pl.songs) {
+            if (s.filePath == filePath) return &s;
+        }
+    }
+    return nullptr;
+}
+
 void PlaylistManager::loadPlaylists(const QString& myMusicDir) {
     // Implement loading playlists logic
     QDir dir(myMusicDir);
@@ -63,12 +204,6 @@ void PlaylistManager::savePlaylists(const QString& myMusicDir) {
     
     // Save all playlists
     for (const Playlist& pl : playlists) {
-        QString filePath = myMusicDir + "/" + pl.name + ".json";
-        QFile f(filePath);
-        if (f.open(QIODevice::WriteOnly)) {
-            QJsonDocument doc(pl.toJson());
-            f.write(doc.toJson());
-            f.close();
-        }
+        savePlaylist(pl, myMusicDir);
     }
 }
@@ -0,0 +1,178 @@
+#include "../include/preference_model.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QVector>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double kMsPerDay = 86400000.0;
+const double kMaxExponent = 30.0;       // e^30 ≈ 1e13，远未到双精度的上限
+const double kPruneEpsilon = 1e-6;
+const char *const kDimensionNames[PreferenceModel::DimensionCount] = {"artists", "genres", "moods"};
+}
+
+PreferenceModel::PreferenceModel(double halfLifeDays, int maxKeys)
+    : m_halfLifeDays(0.0)
+    , m_lambda(0.0)
+    , m_maxKeys(qMax(16, maxKeys))
+    , m_epoch(0)
+{
+    setHalfLifeDays(halfLifeDays);
+    clear();
+}
+
+void PreferenceModel::setHalfLifeDays(double days) {
+    // 已有权重按旧的衰减率换到当前时刻，之后按新的衰减率继续
+    if (m_epoch != 0) rebase(QDateTime::currentMSecsSinceEpoch());
+    m_halfLifeDays = qMax(days, 0.01);
+    m_lambda = std::log(2.0) / (m_halfLifeDays * kMsPerDay);
+}
+
+void PreferenceModel::clear() {
+    for (QHash<QString, double> &weights : m_weights) weights.clear();
+    std::fill(m_hours, m_hours + 24, 0.0);
+    m_energySum = 0.0;
+    m_valenceSum = 0.0;
+    m_targetWeight = 0.0;
+    m_epoch = 0;
+}
+
+bool PreferenceModel::isEmpty() const {
+    for (const QHash<QString, double> &weights : m_weights) {
+        if (!weights.isEmpty()) return false;
+    }
+    return m_targetWeight == 0.0 && std::all_of(m_hours, m_hours + 24, [](double h) { return h == 0.0; });
+}
+
+double PreferenceModel::scaleAt(qint64 timestampMs) {
+    if (m_epoch == 0) m_epoch = timestampMs;
+    if (m_lambda * double(timestampMs - m_epoch) > kMaxExponent) rebase(timestampMs);
+    return std::exp(m_lambda * double(timestampMs - m_epoch));
+}
+
+double PreferenceModel::decayAt(qint64 nowMs) const {
+    return m_epoch == 0 ? 1.0 : std::exp(-m_lambda * double(nowMs - m_epoch));
+}
+
+void PreferenceModel::rebase(qint64 timestampMs) {
+    const double factor = std::exp(-m_lambda * double(timestampMs - m_epoch));
+    for (QHash<QString, double> &weights : m_weights) {
+        for (auto it = weights.begin(); it != weights.end();) {
+            it.value() *= factor;
+            if (std::abs(it.value()) < kPruneEpsilon) it = weights.erase(it);
+            else ++it;
+        }
+    }
+    for (double &h : m_hours) h *= factor;
+    m_energySum *= factor;
+    m_valenceSum *= factor;
+    m_targetWeight *= factor;
+    m_epoch = timestampMs;
+}
+
+void PreferenceModel::prune(QHash<QString, double> &weights) {
+    // 去掉绝对值最小的四分之一；阈值由部分排序得到
+    QVector<double> magnitudes;
+    magnitudes.reserve(weights.size());
+    for (auto it = weights.constBegin(); it != weights.constEnd(); ++it) magnitudes.append(std::abs(it.value()));
+    const int cut = weights.size() / 4;
+    std::nth_element(magnitudes.begin(), magnitudes.begin() + cut, magnitudes.end());
+    const double threshold = magnitudes[cut];
+    int removed = 0;
+    for (auto it = weights.begin(); it != weights.end() && removed < cut;) {
+        if (std::abs(it.value()) <= threshold) {
+            it = weights.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PreferenceModel::add(Dimension dimension, const QString &key, double reward, qint64 timestampMs) {
+    if (key.isEmpty() || dimension < 0 || dimension >= DimensionCount || reward == 0.0) return;
+    QHash<QString, double> &weights = m_weights[dimension];
+    const double scaled = reward * scaleAt(timestampMs);
+    auto it = weights.find(key);
+    if (it != weights.end()) {
+        it.value() += scaled;
+        return;
+    }
+    if (weights.size() >= m_maxKeys) prune(weights);
+    weights.insert(key, scaled);
+}
+
+void PreferenceModel::addHour(int hour, double reward, qint64 timestampMs) {
+    if (hour < 0 || hour >= 24) return;
+    m_hours[hour] += reward * scaleAt(timestampMs);
+}
+
+void PreferenceModel::addTarget(double energy, double valence, double reward, qint64 timestampMs) {
+    if (reward <= 0.0) return;
+    const double scaled = reward * scaleAt(timestampMs);
+    m_energySum += scaled * energy;
+    m_valenceSum += scaled * valence;
+    m_targetWeight += scaled;
+}
+
+double PreferenceModel::weight(Dimension dimension, const QString &key, qint64 nowMs) const {
+    if (dimension < 0 || dimension >= DimensionCount) return 0.0;
+    return m_weights[dimension].value(key) * decayAt(nowMs);
+}
+
+QMap<QString, double> PreferenceModel::weights(Dimension dimension, qint64 nowMs) const {
+    QMap<QString, double> result;
+    if (dimension < 0 || dimension >= DimensionCount) return result;
+    const double decay = decayAt(nowMs);
+    const QHash<QString, double> &weights = m_weights[dimension];
+    for (auto it = weights.constBegin(); it != weights.constEnd(); ++it) result.insert(it.key(), it.value() * decay);
+    return result;
+}
+
+double PreferenceModel::hourWeight(int hour, qint64 nowMs) const {
+    return hour >= 0 && hour < 24 ? m_hours[hour] * decayAt(nowMs) : 0.0;
+}
+
+double PreferenceModel::energyPreference() const {
+    return m_targetWeight > 0.0 ? m_energySum / m_targetWeight : 0.5;
+}
+
+double PreferenceModel::valencePreference() const {
+    return m_targetWeight > 0.0 ? m_valenceSum / m_targetWeight : 0.5;
+}
+
+QJsonObject PreferenceModel::toJson() const {
+    // 保存换基后的存储值与基准时间，读回后继续衰减
+    QJsonObject obj;
+    obj["halfLifeDays"] = m_halfLifeDays;
+    obj["epoch"] = double(m_epoch);
+    for (int d = 0; d < DimensionCount; ++d) {
+        QJsonObject weights;
+        for (auto it = m_weights[d].constBegin(); it != m_weights[d].constEnd(); ++it) weights[it.key()] = it.value();
+        obj[kDimensionNames[d]] = weights;
+    }
+    QJsonArray hours;
+    for (double h : m_hours) hours.append(h);
+    obj["hours"] = hours;
+    obj["energySum"] = m_energySum;
+    obj["valenceSum"] = m_valenceSum;
+    obj["targetWeight"] = m_targetWeight;
+    return obj;
+}
+
+void PreferenceModel::fromJson(const QJsonObject &obj) {
+    clear();
+    setHalfLifeDays(obj["halfLifeDays"].toDouble(m_halfLifeDays));
+    m_epoch = qint64(obj["epoch"].toDouble());
+    for (int d = 0; d < DimensionCount; ++d) {
+        const QJsonObject weights = obj[kDimensionNames[d]].toObject();
+        for (const QString &key : weights.keys()) m_weights[d].insert(key, weights[key].toDouble());
+    }
+    const QJsonArray hours = obj["hours"].toArray();
+    for (int h = 0; h < 24 && h < hours.size(); ++h) m_hours[h] = hours[h].toDouble();
+    m_energySum = obj["energySum"].toDouble();
+    m_valenceSum = obj["valenceSum"].toDouble();
+    m_targetWeight = obj["targetWeight"].toDouble();
+}
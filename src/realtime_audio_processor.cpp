@@ -0,0 +1,350 @@
+#include "../include/realtime_audio_processor.h"
+#include "../include/fast_math.h"
+#include <QTimer>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const int kMinFFTSize = 64;
+const int kMaxFFTSize = 16384;
+const int kDefaultUpdateRate = 60;
+const int kDecodeChunkFrames = 1024;       // 推送方式每解码这么多帧写入一次分析环
+const float kSpectrumFloorDb = -90.0f;     // 显示电平 0 对应的功率
+const float kPowerDbPerLog2 = 3.01029996f; // 10 / log2(10)
+const float kOnsetMaxFreq = 11000.0f;      // 起音检测只看这以下的频点，高频噪声对通量贡献大而信息少
+
+inline float decodeSample(const uchar *p, int sampleSize) {
+    switch (sampleSize) {
+    case 8:
+        return (int(p[0]) - 128) * (1.0f / 128.0f);
+    case 16: {
+        qint16 v;
+        std::memcpy(&v, p, sizeof(v));
+        return v * (1.0f / 32768.0f);
+    }
+    case 24: {
+        const qint32 v = qint32(quint32(p[0]) << 8 | quint32(p[1]) << 16 | quint32(p[2]) << 24) >> 8;
+        return v * (1.0f / 8388608.0f);
+    }
+    case 32: {
+        float v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    default:
+        return 0.0f;
+    }
+}
+}
+
+RealTimeAudioProcessor::RealTimeAudioProcessor(QObject *parent)
+    : QObject(parent)
+    , m_sampleRate(44100)
+    , m_channels(2)
+    , m_sampleSize(16)
+    , m_fftSize(0)
+    , m_windowType(0)
+    , m_minFreq(20)
+    , m_maxFreq(20000)
+    , m_minBin(0)
+    , m_maxBin(0)
+    , m_hopSize(0)
+    , m_autoHop(true)
+    , m_updateRate(kDefaultUpdateRate)
+    , m_bandCount(0)
+    , m_bandScale(SpectrumBandMapper::Mel)
+    , m_onsetBins(0)
+    , m_beatDetection(true)
+    , m_source(nullptr)
+    , m_pollTimer(new QTimer(this))
+    , m_nextFramePos(0)
+    , m_nextEmitPos(0)
+    , m_currentRMS(0.0f)
+    , m_currentPeak(0.0f)
+    , m_zeroCrossingRate(0.0f)
+    , m_spectralCentroid(0.0f)
+    , m_initialized(false)
+{
+    m_decodeBuffer.resize(kDecodeChunkFrames);
+    m_pollTimer->setTimerType(Qt::PreciseTimer);
+    m_pollTimer->setInterval(1000 / m_updateRate);
+    connect(m_pollTimer, &QTimer::timeout, this, &RealTimeAudioProcessor::pollSource);
+    setFFTSize(2048);
+}
+
+RealTimeAudioProcessor::~RealTimeAudioProcessor() = default;
+
+void RealTimeAudioProcessor::setAudioFormat(int sampleRate, int channels, int sampleSize) {
+    // 拉取方式下采样率以输入源为准
+    if (!m_source) m_sampleRate = qMax(1, sampleRate);
+    m_channels = qMax(1, channels);
+    m_sampleSize = sampleSize;
+    updateBinRange();
+    resetStream();
+}
+
+void RealTimeAudioProcessor::setSource(const PcmRingBuffer *source) {
+    m_source = source;
+    if (source) {
+        m_sampleRate = qMax(1, source->sampleRate());
+        updateBinRange();
+        m_pollTimer->start();
+    } else {
+        m_pollTimer->stop();
+    }
+    resetStream();
+}
+
+void RealTimeAudioProcessor::setHopSize(int samples) {
+    m_autoHop = samples <= 0;
+    m_hopSize = m_autoHop ? m_fftSize / 4 : qBound(1, samples, m_fftSize);
+    resetStream();
+}
+
+void RealTimeAudioProcessor::setUpdateRate(int hz) {
+    m_updateRate = qBound(1, hz, 1000);
+    m_pollTimer->setInterval(qMax(1, 1000 / m_updateRate));
+}
+
+void RealTimeAudioProcessor::resetStream() {
+    const quint64 end = activeRing().writePosition();
+    const quint64 frameSize = quint64(m_fftSize);
+    m_nextFramePos = end > frameSize ? end - frameSize : 0;
+    m_nextEmitPos = m_nextFramePos + frameSize;
+
+    m_onsetBins = qMin(m_fftSize / 2, int(kOnsetMaxFreq * m_fftSize / m_sampleRate)) + 1;
+    m_onsetDetector.configure(m_onsetBins, double(m_sampleRate) / m_hopSize);
+}
+
+void RealTimeAudioProcessor::setBeatDetectionEnabled(bool enabled) {
+    if (enabled && !m_beatDetection) m_onsetDetector.reset();
+    m_beatDetection = enabled;
+}
+
+void RealTimeAudioProcessor::setBeatSensitivity(float sensitivity) {
+    m_onsetDetector.setSensitivity(sensitivity);
+}
+
+void RealTimeAudioProcessor::setFFTSize(int size) {
+    size = qBound(kMinFFTSize, RealFFT::nextPowerOfTwo(size), kMaxFFTSize);
+    if (size == m_fftSize) return;
+    m_fftSize = size;
+    m_hopSize = m_autoHop ? size / 4 : qMin(m_hopSize, size);
+    m_fft.setSize(size);
+    m_windowedBuffer.fill(0.0f, size);
+    m_waveform.fill(0.0f, size);
+    m_fftRe.fill(0.0f, m_fft.binCount());
+    m_fftIm.fill(0.0f, m_fft.binCount());
+    m_power.fill(0.0f, m_fft.binCount());
+    rebuildWindow();
+    updateBinRange();
+    resetStream();
+    m_initialized = true;
+}
+
+void RealTimeAudioProcessor::setWindowFunction(int type) {
+    type = qBound(0, type, 2);
+    if (type == m_windowType) return;
+    m_windowType = type;
+    rebuildWindow();
+}
+
+void RealTimeAudioProcessor::setFrequencyRange(int minFreq, int maxFreq) {
+    m_minFreq = qMax(0, qMin(minFreq, maxFreq));
+    m_maxFreq = qMax(minFreq, maxFreq);
+    updateBinRange();
+}
+
+void RealTimeAudioProcessor::setBandCount(int count) {
+    m_bandCount = qMax(0, count);
+    updateBinRange();
+}
+
+void RealTimeAudioProcessor::setBandScale(SpectrumBandMapper::Scale scale) {
+    m_bandScale = scale;
+    updateBinRange();
+}
+
+void RealTimeAudioProcessor::updateBinRange() {
+    const int lastBin = m_fftSize / 2;
+    const double binsPerHz = double(m_fftSize) / m_sampleRate;
+    m_minBin = qBound(0, int(std::ceil(m_minFreq * binsPerHz)), lastBin);
+    m_maxBin = qBound(m_minBin, int(std::floor(m_maxFreq * binsPerHz)), lastBin);
+    m_bandMapper.configure(m_fftSize, m_sampleRate, m_minFreq, m_maxFreq, m_bandCount, m_bandScale);
+    const int outputs = m_bandCount > 0 ? m_bandCount : m_maxBin - m_minBin + 1;
+    if (m_spectrum.size() != outputs) m_spectrum.fill(0.0f, outputs);
+    if (m_bandPower.size() != m_bandCount) m_bandPower.fill(0.0f, m_bandCount);
+}
+
+void RealTimeAudioProcessor::rebuildWindow() {
+    const int n = m_fftSize;
+    m_windowFunction.resize(n);
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        // 周期窗（分母取 N），与 FFT 的周期假设一致
+        const double phase = 2.0 * M_PI * i / n;
+        double w;
+        switch (m_windowType) {
+        case 1:
+            w = 0.54 - 0.46 * std::cos(phase);
+            break;
+        case 2:
+            w = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+            break;
+        default:
+            w = 0.5 - 0.5 * std::cos(phase);
+            break;
+        }
+        m_windowFunction[i] = float(w);
+        sum += w;
+    }
+    // 单边谱幅度 = A·Σw/2，归一化后振幅为 A 的正弦读数为 A
+    const float scale = sum > 0.0 ? float(2.0 / sum) : 1.0f;
+    for (float &w : m_windowFunction) w *= scale;
+}
+
+void RealTimeAudioProcessor::applyWindowFunction(const PcmRingBuffer::Span &frame) {
+    // 直接从分析环读取，环绕处分两段
+    const float *window = m_windowFunction.constData();
+    float *output = m_windowedBuffer.data();
+    for (int i = 0; i < frame.firstCount; ++i) output[i] = frame.first[i] * window[i];
+    window += frame.firstCount;
+    output += frame.firstCount;
+    for (int i = 0; i < frame.secondCount; ++i) output[i] = frame.second[i] * window[i];
+}
+
+void RealTimeAudioProcessor::processAudioData(const QByteArray &data) {
+    if (!m_initialized || m_source) return;
+    const int bytesPerSample = m_sampleSize / 8;
+    const int frameBytes = bytesPerSample * m_channels;
+    if (frameBytes <= 0) return;
+
+    // 解码并混为单声道，分段写入分析环；每段之后立即分帧，环不会在处理前被覆盖
+    const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+    const int frames = data.size() / frameBytes;
+    const float channelScale = 1.0f / m_channels;
+    float *decoded = m_decodeBuffer.data();
+    for (int done = 0; done < frames; ) {
+        const int count = qMin(kDecodeChunkFrames, frames - done);
+        for (int i = 0; i < count; ++i) {
+            const uchar *frame = bytes + qint64(done + i) * frameBytes;
+            float sum = 0.0f;
+            for (int ch = 0; ch < m_channels; ++ch) sum += decodeSample(frame + ch * bytesPerSample, m_sampleSize);
+            decoded[i] = sum * channelScale;
+        }
+        m_inputRing.writeMono(decoded, count);
+        analyze(m_inputRing);
+        done += count;
+    }
+}
+
+void RealTimeAudioProcessor::pollSource() {
+    if (!m_source) return;
+    const int sampleRate = m_source->sampleRate();
+    if (sampleRate > 0 && sampleRate != m_sampleRate) {
+        m_sampleRate = sampleRate;
+        updateBinRange();
+        resetStream();
+    }
+    analyze(*m_source);
+}
+
+void RealTimeAudioProcessor::analyze(const PcmRingBuffer &ring) {
+    const quint64 end = ring.writePosition();
+    const quint64 frameSize = quint64(m_fftSize);
+    const quint64 capacity = quint64(ring.capacity());
+    // 落后超过环容量时（例如分析线程被长时间阻塞）跳到最新的完整帧
+    if (end > capacity && m_nextFramePos < end - capacity) {
+        m_nextFramePos = end - frameSize;
+        m_nextEmitPos = end;
+    }
+
+    const quint64 emitInterval = quint64(qMax(1, m_sampleRate / m_updateRate));
+    while (m_nextFramePos + frameSize <= end) {
+        const quint64 position = m_nextFramePos;
+        const quint64 frameEnd = position + frameSize;
+        m_nextFramePos += quint64(m_hopSize);
+
+        const bool display = frameEnd >= m_nextEmitPos;
+        const PcmRingBuffer::Span frame = ring.read(position, m_fftSize);
+        applyWindowFunction(frame);
+        if (display) extractFeatures(frame);
+        // 读取期间被写入端覆盖的帧丢弃
+        if (!ring.isIntact(position)) continue;
+        // 既不显示也不检测起音的帧不必做变换
+        if (!display && !m_beatDetection) continue;
+        performFFT(display);
+        float intensity = 0.0f;
+        if (m_beatDetection && m_onsetDetector.process(m_power.constData(), &intensity)) {
+            emit beatDetected(intensity);
+        }
+        if (!display) continue;
+
+        // 按音频时间保持发出节拍；落后超过一个间隔时从本帧重新计时，不连续补发
+        m_nextEmitPos += emitInterval;
+        if (m_nextEmitPos <= frameEnd) m_nextEmitPos = frameEnd + emitInterval;
+        emit spectrumReady(m_spectrum);
+        emit waveformReady(m_waveform);
+        emit audioFeaturesReady(m_currentRMS, m_currentPeak, m_zeroCrossingRate, m_spectralCentroid);
+    }
+}
+
+void RealTimeAudioProcessor::performFFT(bool display) {
+    m_fft.forward(m_windowedBuffer.constData(), m_fftRe.data(), m_fftIm.data());
+
+    // 每帧只算起音检测所需的低频功率；其余频点与显示数据只在发出帧上计算，按需汇总成频段
+    const float *re = m_fftRe.constData();
+    const float *im = m_fftIm.constData();
+    float *power = m_power.data();
+    const int binCount = m_fft.binCount();
+    const int hopBins = m_beatDetection ? qMin(m_onsetBins, binCount) : 0;
+    for (int k = 0; k < hopBins; ++k) power[k] = re[k] * re[k] + im[k] * im[k];
+    if (!display) return;
+    for (int k = hopBins; k < binCount; ++k) power[k] = re[k] * re[k] + im[k] * im[k];
+
+    const float *levels = power + m_minBin;
+    if (!m_bandMapper.isEmpty()) {
+        m_bandMapper.apply(power, m_bandPower.data());
+        levels = m_bandPower.constData();
+    }
+    // 功率换算为 dB 后线性映射到 [0, 1]：kSpectrumFloorDb -> 0，0 dBFS -> 1
+    float *spectrum = m_spectrum.data();
+    const int outputs = m_spectrum.size();
+    const float scale = 1.0f / -kSpectrumFloorDb;
+    for (int i = 0; i < outputs; ++i) {
+        const float db = kPowerDbPerLog2 * FastMath::log2(qMax(levels[i], FastMath::MinLevel));
+        spectrum[i] = qBound(0.0f, (db - kSpectrumFloorDb) * scale, 1.0f);
+    }
+
+    // 频谱质心（按幅度加权的平均频率，Hz）
+    double weighted = 0.0;
+    double total = 0.0;
+    for (int k = 1; k < binCount; ++k) {
+        const float magnitude = std::sqrt(power[k]);
+        weighted += double(magnitude) * k;
+        total += magnitude;
+    }
+    m_spectralCentroid = total > 0.0 ? float(weighted / total * m_sampleRate / m_fftSize) : 0.0f;
+}
+
+void RealTimeAudioProcessor::extractFeatures(const PcmRingBuffer::Span &frame) {
+    float *samples = m_waveform.data();
+    std::copy(frame.first, frame.first + frame.firstCount, samples);
+    std::copy(frame.second, frame.second + frame.secondCount, samples + frame.firstCount);
+
+    const int n = m_fftSize;
+    double energy = 0.0;
+    float peak = 0.0f;
+    int crossings = 0;
+    for (int i = 0; i < n; ++i) {
+        const float s = samples[i];
+        energy += double(s) * s;
+        peak = qMax(peak, std::fabs(s));
+        if (i > 0 && (s >= 0.0f) != (samples[i - 1] >= 0.0f)) ++crossings;
+    }
+    m_currentRMS = float(std::sqrt(energy / n));
+    m_currentPeak = peak;
+    m_zeroCrossingRate = float(crossings) / (n - 1);
+}
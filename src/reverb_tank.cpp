@@ -0,0 +1,185 @@
+#include "../include/reverb_tank.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REVERB_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define REVERB_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+int delayLineSize(int delay) {
+    int size = 1;
+    while (size < delay) size <<= 1;
+    return size;
+}
+
+// 8 个梳状滤波器以两个 4 通道寄存器承载
+#if defined(REVERB_HAVE_SSE2)
+struct CombOps {
+    typedef __m128 Reg;
+    static Reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Reg a) { _mm_storeu_ps(p, a); }
+    static Reg set1(float v) { return _mm_set1_ps(v); }
+    static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static float sum(Reg a) {
+        const Reg pairs = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+    }
+};
+#elif defined(REVERB_HAVE_NEON)
+struct CombOps {
+    typedef float32x4_t Reg;
+    static Reg load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, Reg a) { vst1q_f32(p, a); }
+    static Reg set1(float v) { return vdupq_n_f32(v); }
+    static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+    static Reg madd(Reg a, Reg b, Reg c) { return vmlaq_f32(c, a, b); }
+    static float sum(Reg a) {
+        const float32x2_t pairs = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+        return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+    }
+};
+#else
+struct CombOps {
+    struct Reg { float v[4]; };
+    static Reg load(const float *p) { Reg r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    static void store(float *p, Reg a) { std::memcpy(p, a.v, sizeof(a.v)); }
+    static Reg set1(float v) { Reg r = {{v, v, v, v}}; return r; }
+    static Reg add(Reg a, Reg b) {
+        for (int i = 0; i < 4; ++i) a.v[i] += b.v[i];
+        return a;
+    }
+    static Reg mul(Reg a, Reg b) {
+        for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i];
+        return a;
+    }
+    static Reg madd(Reg a, Reg b, Reg c) {
+        for (int i = 0; i < 4; ++i) c.v[i] += a.v[i] * b.v[i];
+        return c;
+    }
+    static float sum(Reg a) { return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]); }
+};
+#endif
+}
+
+ReverbTank::ReverbTank()
+    : m_combMask(0)
+    , m_combPos(0)
+    , m_damp1(0.0f)
+    , m_damp2(1.0f)
+{
+    for (int i = 0; i < CombCount; ++i) {
+        m_combDelays[i] = 1;
+        m_combFeedback[i] = 0.0f;
+        m_combFilterState[i] = 0.0f;
+    }
+    for (AllPass &line : m_allPasses) {
+        line.mask = 0;
+        line.pos = 0;
+        line.delay = 1;
+    }
+}
+
+void ReverbTank::setDelays(const int *combDelays, const int *allPassDelays) {
+    int longest = 1;
+    for (int i = 0; i < CombCount; ++i) {
+        m_combDelays[i] = qMax(1, combDelays[i]);
+        longest = qMax(longest, m_combDelays[i]);
+    }
+    // 读位置 pos - delay 在写入前读取，delay 等于缓冲区长度时仍然正确
+    const int combSize = delayLineSize(longest);
+    m_combBuffer.fill(0.0f, combSize * CombCount);
+    m_combMask = combSize - 1;
+
+    for (int i = 0; i < AllPassCount; ++i) {
+        AllPass &line = m_allPasses[i];
+        line.delay = qMax(1, allPassDelays[i]);
+        const int size = delayLineSize(line.delay);
+        line.buffer.fill(0.0f, size);
+        line.mask = size - 1;
+    }
+    reset();
+}
+
+void ReverbTank::setDamping(float damping) {
+    m_damp1 = damping * 0.4f;
+    m_damp2 = 1.0f - m_damp1;
+}
+
+void ReverbTank::reset() {
+    m_combBuffer.fill(0.0f);
+    m_combPos = 0;
+    for (int i = 0; i < CombCount; ++i) m_combFilterState[i] = 0.0f;
+    for (AllPass &line : m_allPasses) {
+        line.buffer.fill(0.0f);
+        line.pos = 0;
+    }
+}
+
+void ReverbTank::process(const float *input, float *output, int frames) {
+    processCombs(input, output, frames);
+    processAllPasses(output, frames);
+}
+
+void ReverbTank::processCombs(const float *input, float *output, int frames) {
+    typedef CombOps::Reg Reg;
+    float *buffer = m_combBuffer.data();
+    const int mask = m_combMask;
+    int pos = m_combPos;
+
+    const Reg damp1 = CombOps::set1(m_damp1);
+    const Reg damp2 = CombOps::set1(m_damp2);
+    const Reg feedbackLo = CombOps::load(m_combFeedback);
+    const Reg feedbackHi = CombOps::load(m_combFeedback + 4);
+    Reg stateLo = CombOps::load(m_combFilterState);
+    Reg stateHi = CombOps::load(m_combFilterState + 4);
+    float delayed[CombCount];
+
+    for (int i = 0; i < frames; ++i) {
+        // 各梳状滤波器的延迟不同，读取是一次按通道的聚集
+        for (int lane = 0; lane < CombCount; ++lane) {
+            delayed[lane] = buffer[((pos - m_combDelays[lane]) & mask) * CombCount + lane];
+        }
+        const Reg yLo = CombOps::load(delayed);
+        const Reg yHi = CombOps::load(delayed + 4);
+        stateLo = CombOps::madd(yLo, damp2, CombOps::mul(stateLo, damp1));
+        stateHi = CombOps::madd(yHi, damp2, CombOps::mul(stateHi, damp1));
+
+        const Reg in = CombOps::set1(input[i]);
+        float *slot = buffer + pos * CombCount;
+        CombOps::store(slot, CombOps::madd(stateLo, feedbackLo, in));
+        CombOps::store(slot + 4, CombOps::madd(stateHi, feedbackHi, in));
+        output[i] = CombOps::sum(CombOps::add(yLo, yHi));
+        pos = (pos + 1) & mask;
+    }
+
+    CombOps::store(m_combFilterState, stateLo);
+    CombOps::store(m_combFilterState + 4, stateHi);
+    m_combPos = pos;
+}
+
+void ReverbTank::processAllPasses(float *samples, int frames) {
+    // 串联滤波器逐级处理整块，与逐样本穿过四级等价
+    for (AllPass &line : m_allPasses) {
+        float *buffer = line.buffer.data();
+        const int mask = line.mask;
+        const int delay = line.delay;
+        int pos = line.pos;
+        for (int i = 0; i < frames; ++i) {
+            const float input = samples[i];
+            const float delayed = buffer[(pos - delay) & mask];
+            buffer[pos] = input + delayed * 0.5f;
+            samples[i] = delayed - input;
+            pos = (pos + 1) & mask;
+        }
+        line.pos = pos;
+    }
+}
@@ -0,0 +1,1184 @@
+#include "../include/self_test.h"
+#include "../include/loudness_analyzer.h"
+#include "../include/partitioned_convolver.h"
+#include "../include/hrtf.h"
+#include "../include/dsp_graph.h"
+#include "../include/audio_effects.h"
+#include "../include/fft.h"
+#include "../include/ffmpegplayer.h"
+#include "../include/pcm_ring_buffer.h"
+#include "../include/realtime_audio_processor.h"
+#include "../include/onset_detector.h"
+#include "../include/feature_index.h"
+#include "../include/preference_model.h"
+#include "../include/play_log.h"
+#include "../include/smart_playlist.h"
+#include "../include/play_order.h"
+#include "../include/gesture_templates.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QPointF>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+#ifdef ENABLE_ONLINE_METADATA
+#include "../include/online_music_service.h"
+#include "../include/local_metadata_server.h"
+#include "../include/metadata_provider.h"
+#include "../include/metadata_prefetcher.h"
+#include <QBuffer>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+#include <QStringList>
+#endif
+
+namespace {
+const double kPi = 3.14159265358979323846;
+
+// 一个套件内的检查结果；失败时打印检查项与实际值
+struct Checker {
+    const char *suite;
+    int failures = 0;
+
+    void check(bool ok, const char *what, double value = 0.0) {
+        if (ok) return;
+        qWarning() << suite << "FAILED:" << what << value;
+        ++failures;
+    }
+};
+
+QVector<float> sine(int sampleRate, int channels, double frequency, double amplitude, double seconds) {
+    const int frames = int(sampleRate * seconds);
+    QVector<float> samples(frames * channels);
+    for (int i = 0; i < frames; ++i) {
+        const float value = float(amplitude * std::sin(2.0 * kPi * frequency * i / sampleRate));
+        for (int c = 0; c < channels; ++c) samples[i * channels + c] = value;
+    }
+    return samples;
+}
+
+LoudnessInfo measure(const QVector<float> &samples, int sampleRate, int channels) {
+    LoudnessAnalyzer analyzer(sampleRate, channels);
+    // 分成不整齐的块送入，覆盖流式处理的边界
+    const int frames = samples.size() / channels;
+    for (int pos = 0, block = 1; pos < frames; pos += block, block = block * 3 % 4093 + 1) {
+        analyzer.process(samples.constData() + pos * channels, qMin(block, frames - pos));
+    }
+    return analyzer.result();
+}
+
+// 处理事件直到条件成立或超时；间隔休眠，不空转
+bool waitFor(const std::function<bool()> &done, int timeoutMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (!done() && timer.elapsed() < timeoutMs) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        QThread::msleep(5);
+    }
+    return done();
+}
+
+int testLoudness() {
+    Checker c{"loudness"};
+    // BS.1770 校准：两声道各一路 -20 dBFS、1 kHz 正弦，整体响度 -20 LUFS，真峰值 -20 dBTP
+    const LoudnessInfo quiet = measure(sine(48000, 2, 1000.0, 0.1, 5.0), 48000, 2);
+    c.check(quiet.valid, "sine result valid");
+    c.check(std::abs(quiet.integratedLufs + 20.0) < 0.5, "integrated loudness of -20 dBFS sine", quiet.integratedLufs);
+    c.check(std::abs(quiet.truePeakDb + 20.0) < 0.5, "true peak of -20 dBFS sine", quiet.truePeakDb);
+    c.check(std::abs(quiet.durationSec - 5.0) < 0.01, "analyzed duration", quiet.durationSec);
+
+    // 幅度加倍响度升高 6.02 dB；44.1 kHz 下同样成立
+    const LoudnessInfo loud = measure(sine(44100, 2, 1000.0, 0.2, 5.0), 44100, 2);
+    c.check(std::abs(loud.integratedLufs - quiet.integratedLufs - 6.02) < 0.1,
+            "doubling amplitude adds 6 dB", loud.integratedLufs - quiet.integratedLufs);
+
+    // 真峰值要找到采样点之间的峰：fs/4 正弦相位偏 45° 时采样值只有峰值的 0.707
+    QVector<float> offset(48000 * 2);
+    for (int i = 0; i < offset.size() / 2; ++i) {
+        offset[2 * i] = offset[2 * i + 1] = float(0.5 * std::sin(kPi / 2.0 * i + kPi / 4.0));
+    }
+    const LoudnessInfo intersample = measure(offset, 48000, 2);
+    c.check(std::abs(intersample.truePeakDb - 20.0 * std::log10(0.5)) < 0.5,
+            "inter-sample peak detected", intersample.truePeakDb);
+
+    // 专辑响度：相同曲目合成后不变，时长相加
+    const LoudnessInfo album = LoudnessInfo::combine({quiet, quiet});
+    c.check(std::abs(album.integratedLufs - quiet.integratedLufs) < 0.01, "album of identical tracks", album.integratedLufs);
+    c.check(std::abs(album.durationSec - 10.0) < 0.02, "album duration", album.durationSec);
+    const LoudnessInfo mixed = LoudnessInfo::combine({quiet, loud});
+    c.check(mixed.integratedLufs > quiet.integratedLufs && mixed.integratedLufs < loud.integratedLufs,
+            "album loudness between tracks", mixed.integratedLufs);
+    c.check(mixed.truePeakDb == loud.truePeakDb, "album peak is the maximum", mixed.truePeakDb);
+
+    const LoudnessInfo restored = LoudnessInfo::fromJson(quiet.toJson());
+    c.check(restored.valid && restored.integratedLufs == quiet.integratedLufs, "JSON round trip");
+    return c.failures;
+}
+
+int testConvolver() {
+    Checker c{"convolver"};
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    QVector<float> impulse(1000);
+    for (int i = 0; i < impulse.size(); ++i) impulse[i] = uniform(rng) * std::exp(-i / 200.0f);
+    QVector<float> input(6000);
+    for (float &x : input) x = uniform(rng);
+
+    PartitionedConvolver convolver;
+    convolver.setImpulseResponse(impulse.constData(), impulse.size(), 100);
+    c.check(convolver.partitionSize() == 128, "partition size rounded up", convolver.partitionSize());
+    c.check(convolver.partitionCount() == 8, "partition count", convolver.partitionCount());
+
+    // 任意块长、原地处理；输出相对直接卷积延迟 latency() 个样本
+    QVector<float> output = input;
+    for (int pos = 0, block = 1; pos < output.size(); pos += block, block = block * 7 % 301 + 1) {
+        const int frames = qMin(block, output.size() - pos);
+        convolver.process(output.data() + pos, output.data() + pos, frames);
+    }
+    const int latency = convolver.latency();
+    double maxError = 0.0;
+    for (int n = 0; n < output.size(); ++n) {
+        double expected = 0.0;
+        const int t = n - latency;
+        for (int k = 0; k < impulse.size() && k <= t; ++k) expected += double(impulse[k]) * input[t - k];
+        maxError = qMax(maxError, std::abs(expected - output[n]));
+    }
+    c.check(maxError < 1e-3, "matches direct convolution", maxError);
+
+    // reset() 后从静音开始，同样的输入得到同样的输出
+    convolver.reset();
+    QVector<float> again(input.size());
+    convolver.process(input.constData(), again.data(), input.size());
+    double resetError = 0.0;
+    for (int n = 0; n < again.size(); ++n) resetError = qMax(resetError, double(std::abs(again[n] - output[n])));
+    c.check(resetError < 1e-4, "reset restarts from silence", resetError);
+    return c.failures;
+}
+
+// 直接卷积，作为分区卷积结果的参照
+QVector<double> directConvolution(const QVector<float> &input, const QVector<float> &impulse) {
+    QVector<double> output(input.size(), 0.0);
+    for (int n = 0; n < input.size(); ++n) {
+        for (int k = 0; k < impulse.size() && k <= n; ++k) output[n] += double(impulse[k]) * input[n - k];
+    }
+    return output;
+}
+
+int testHrtf() {
+    Checker c{"hrtf"};
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    auto randomImpulse = [&](int length) {
+        QVector<float> impulse(length);
+        for (int i = 0; i < length; ++i) impulse[i] = uniform(rng) * std::exp(-i / 80.0f);
+        return impulse;
+    };
+
+    // 前、右、上、后、左五个方向（SOFA 方位角向左为正），每个方向左右耳各一条随机 HRIR
+    const float positions[][2] = {{0, 0}, {-90, 0}, {0, 90}, {180, 0}, {90, 0}};
+    enum { Front, Right, Up };
+    HrtfDataset dataset;
+    dataset.sampleRate = 48000;
+    for (const auto &position : positions) {
+        dataset.measurements.append({position[0], position[1], randomImpulse(300), randomImpulse(280)});
+    }
+    c.check(dataset.irLength() == 300, "IR length", dataset.irLength());
+    const HrtfDataset doubled = dataset.resampled(96000);
+    c.check(doubled.sampleRate == 96000 && std::abs(doubled.irLength() - 600) <= 2,
+            "resampled IR length", doubled.irLength());
+
+    HrtfRenderer renderer;
+    renderer.setDataset(dataset, 50);
+    c.check(renderer.partitionSize() == 64 && renderer.latency() == 64, "partition size", renderer.partitionSize());
+
+    QVector<float> input(4096);
+    for (float &x : input) x = uniform(rng);
+    const int partition = renderer.partitionSize();
+    const int latency = renderer.latency();
+    auto expected = [&](int direction, int ear) {
+        const HrtfDataset::Measurement &m = dataset.measurements[direction];
+        return directConvolution(input, ear == 0 ? m.left : m.right);
+    };
+    const QVector<double> expectedFront[2] = {expected(Front, 0), expected(Front, 1)};
+    const QVector<double> expectedRight[2] = {expected(Right, 0), expected(Right, 1)};
+    const QVector<double> expectedUp[2] = {expected(Up, 0), expected(Up, 1)};
+
+    // 固定方向、任意块长、输入与左耳同一块内存；方位角向右为正，+90° 取 SOFA 的 -90° 测量点。
+    // reset() 保留当前滤波器，换方向后的首个分区仍会从旧方向淡入，所以每次用新的渲染器
+    auto render = [&](float azimuth, float elevation, QVector<float> *left, QVector<float> *right) {
+        HrtfRenderer renderer;
+        renderer.setDataset(dataset, partition);
+        renderer.setDirection(azimuth, elevation);
+        *left = input;
+        right->resize(input.size());
+        for (int pos = 0, block = 1; pos < input.size(); pos += block, block = block * 5 % 173 + 1) {
+            const int frames = qMin(block, input.size() - pos);
+            renderer.process(left->constData() + pos, left->data() + pos, right->data() + pos, frames);
+        }
+    };
+    auto maxError = [&](const QVector<float> &output, const QVector<double> &reference,
+                        const QVector<double> *second = nullptr, double secondWeight = 0.0,
+                        const QVector<double> *third = nullptr, double thirdWeight = 0.0) {
+        double error = 0.0;
+        const double firstWeight = 1.0 - secondWeight - thirdWeight;
+        for (int n = latency; n < output.size(); ++n) {
+            const int m = n - latency;
+            double value = firstWeight * reference[m];
+            if (second) value += secondWeight * (*second)[m];
+            if (third) value += thirdWeight * (*third)[m];
+            error = qMax(error, std::abs(value - output[n]));
+        }
+        return error;
+    };
+    QVector<float> left, right;
+    render(90.0f, 0.0f, &left, &right);
+    c.check(maxError(left, expectedRight[0]) < 1e-3 && maxError(right, expectedRight[1]) < 1e-3,
+            "measured direction matches direct convolution", maxError(left, expectedRight[0]));
+    bool silentLatency = true;
+    for (int n = 0; n < latency; ++n) silentLatency = silentLatency && left[n] == 0.0f && right[n] == 0.0f;
+    c.check(silentLatency, "output delayed by one partition");
+
+    // 前与右之间 45°：前、右各距 45°，上方 90°，按角距离反比加权 0.4 : 0.4 : 0.2
+    render(45.0f, 0.0f, &left, &right);
+    const double interpolationError = qMax(maxError(left, expectedFront[0], &expectedRight[0], 0.4, &expectedUp[0], 0.2),
+                                           maxError(right, expectedFront[1], &expectedRight[1], 0.4, &expectedUp[1], 0.2));
+    c.check(interpolationError < 1e-3, "inverse-distance interpolation of three neighbours", interpolationError);
+
+    // 按分区送入，第 switchAt 个分区开始前换方向：该分区输出从前方线性过渡到右方，之后完全是右方
+    renderer.setDirection(0.0f, 0.0f);
+    const int switchAt = 20;
+    left.resize(input.size());
+    right.resize(input.size());
+    for (int block = 0; block * partition < input.size(); ++block) {
+        if (block == switchAt) renderer.setDirection(90.0f, 0.0f);
+        const int pos = block * partition;
+        renderer.process(input.constData() + pos, left.data() + pos, right.data() + pos,
+                         qMin(partition, input.size() - pos));
+    }
+    double fadeError = 0.0;
+    for (int n = latency; n < input.size(); ++n) {
+        const int m = n - latency;
+        const double gain = qBound(0.0, (m - switchAt * partition + 0.5) / partition, 1.0);
+        for (int ear = 0; ear < 2; ++ear) {
+            const double value = expectedFront[ear][m] + (expectedRight[ear][m] - expectedFront[ear][m]) * gain;
+            fadeError = qMax(fadeError, std::abs(value - (ear == 0 ? left : right)[n]));
+        }
+    }
+    c.check(fadeError < 1e-3, "direction change cross-fades within one partition", fadeError);
+    return c.failures;
+}
+
+// 记录执行次数与全局执行序号的空效果器；delayMs 用来制造超出截止时间的周期
+class ProbeEffect : public AudioEffect {
+public:
+    explicit ProbeEffect(std::atomic<quint64> *clock) : AudioEffect(Equalizer), m_clock(clock) {}
+
+    void reset() override {}
+    void applyParameter(int, float) override {}
+    void processBlock(const AudioBlock &) override {
+        sequence.store(m_clock->fetch_add(1) + 1);
+        runs.fetch_add(1);
+        const int delay = delayMs.load();
+        if (delay > 0) QThread::msleep(delay);
+    }
+
+    std::atomic<int> runs{0};
+    std::atomic<quint64> sequence{0};
+    std::atomic<int> delayMs{0};
+
+private:
+    std::atomic<quint64> *m_clock;
+};
+
+int testDspGraph() {
+    Checker c{"dsp_graph"};
+    // A、B 为源；A 扇出到 C、D，D 同时汇入 A 与 B，C、D 再汇入 E（菱形）；F 与其他节点无关
+    enum { A, B, C, D, E, F, NodeCount };
+    const int edges[][2] = {{A, C}, {A, D}, {B, D}, {C, E}, {D, E}};
+    std::atomic<quint64> clock(0);
+    AudioEffectChain chains[NodeCount];
+    ProbeEffect *probes[NodeCount];
+    DspGraph graph(3);
+    int ids[NodeCount];
+    for (int i = 0; i < NodeCount; ++i) {
+        probes[i] = new ProbeEffect(&clock);
+        chains[i].addEffect(probes[i]);
+        ids[i] = graph.addNode(&chains[i]);
+    }
+    bool connected = true;
+    for (const auto &edge : edges) connected = graph.connect(ids[edge[0]], ids[edge[1]]) && connected;
+    c.check(connected, "edges accepted");
+    c.check(!graph.connect(ids[E], ids[A]), "cycle rejected");
+    graph.commit();
+
+    // 100 ms 的周期、80 ms 的截止时间，正常周期远在截止之内；F 在三个周期里睡 120 ms
+    const int frames = 4800;
+    graph.prepare(48000, 1, frames);
+    graph.setDeadlineBudget(0.8);
+    const int periods = 200;
+    int slowPeriods = 0;
+    bool onceEach = true;
+    bool ordered = true;
+    bool summed = true;
+    for (int period = 0; period < periods; ++period) {
+        const bool slow = period % 70 == 50;
+        slowPeriods += slow ? 1 : 0;
+        probes[F]->delayMs.store(slow ? 120 : 0);
+        const AudioBlock a = graph.nodeBlock(ids[A], frames);
+        const AudioBlock b = graph.nodeBlock(ids[B], frames);
+        std::fill(a.channel(0), a.channel(0) + frames, float(period));
+        std::fill(b.channel(0), b.channel(0) + frames, 1000.0f);
+        graph.process(frames);
+
+        for (int i = 0; i < NodeCount; ++i) onceEach = onceEach && probes[i]->runs.load() == period + 1;
+        for (const auto &edge : edges) {
+            ordered = ordered && probes[edge[0]]->sequence.load() < probes[edge[1]]->sequence.load();
+        }
+        // 效果器不改数据：D = A + B，E = C + D = 2A + B
+        const float *d = graph.nodeBlock(ids[D], frames).channel(0);
+        const float *e = graph.nodeBlock(ids[E], frames).channel(0);
+        summed = summed && d[0] == period + 1000.0f && d[frames - 1] == d[0]
+                 && e[0] == 2.0f * period + 1000.0f && e[frames - 1] == e[0];
+    }
+    c.check(onceEach, "every node runs exactly once per period");
+    c.check(ordered, "nodes run after all of their predecessors");
+    c.check(summed, "fan-in nodes sum their inputs");
+    c.check(graph.periodCount() == quint64(periods), "period count", double(graph.periodCount()));
+    c.check(graph.deadlineMisses() == quint64(slowPeriods), "deadline misses", double(graph.deadlineMisses()));
+    return c.failures;
+}
+
+int testFft() {
+    Checker c{"fft"};
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    RealFFT fft;
+    fft.setBackend(RealFFT::Builtin);
+    for (int size = 4; size <= 4096; size *= 2) {
+        fft.setSize(size);
+        QVector<float> input(size), re(fft.binCount()), im(fft.binCount()), output(size);
+        for (float &x : input) x = uniform(rng);
+        fft.forward(input.constData(), re.data(), im.data());
+
+        // 小尺寸与直接 DFT 比较（基 2 与基 4 两种首级都覆盖到）
+        if (size <= 512) {
+            double maxError = 0.0;
+            for (int k = 0; k < fft.binCount(); ++k) {
+                double sumRe = 0.0, sumIm = 0.0;
+                for (int n = 0; n < size; ++n) {
+                    const double phase = -2.0 * kPi * double(k) * n / size;
+                    sumRe += input[n] * std::cos(phase);
+                    sumIm += input[n] * std::sin(phase);
+                }
+                maxError = qMax(maxError, qMax(std::abs(sumRe - re[k]), std::abs(sumIm - im[k])));
+            }
+            c.check(maxError < 1e-4 * size, "forward matches direct DFT", maxError);
+        }
+
+        fft.inverse(re.constData(), im.constData(), output.data());
+        double roundTrip = 0.0;
+        for (int n = 0; n < size; ++n) roundTrip = qMax(roundTrip, double(std::abs(output[n] - input[n])));
+        c.check(roundTrip < 1e-5, "inverse(forward(x)) == x", roundTrip);
+    }
+
+    if (RealFFT::systemBackendAvailable()) {
+        RealFFT system(1024);
+        system.setBackend(RealFFT::System);
+        fft.setSize(1024);
+        QVector<float> input(1024), re1(513), im1(513), re2(513), im2(513);
+        for (float &x : input) x = uniform(rng);
+        fft.forward(input.constData(), re1.data(), im1.data());
+        system.forward(input.constData(), re2.data(), im2.data());
+        double maxError = 0.0;
+        for (int k = 0; k < 513; ++k) {
+            maxError = qMax(maxError, double(qMax(std::abs(re1[k] - re2[k]), std::abs(im1[k] - im2[k]))));
+        }
+        c.check(maxError < 1e-3, "system backend matches builtin", maxError);
+    }
+    c.check(RealFFT::nextPowerOfTwo(1000) == 1024 && RealFFT::nextPowerOfTwo(1024) == 1024, "nextPowerOfTwo");
+    return c.failures;
+}
+
+int testAnalysisTap() {
+    Checker c{"analysis_tap"};
+    FFmpegPlayer player;
+    const PcmRingBuffer *tap = player.analysisTap();
+    c.check(tap->sampleRate() == 44100 && tap->writePosition() == 0, "tap starts empty");
+
+    // 单曲响度 -24 LUFS，参考 -18：增益 +6 dB；真峰值足够低，不触发防削波
+    LoudnessInfo track;
+    track.valid = true;
+    track.integratedLufs = -24.0;
+    track.truePeakDb = -20.0;
+    player.setLoudness(track);
+    const float gain = float(std::pow(10.0, 6.0 / 20.0));
+    c.check(std::abs(player.replayGainScale() - gain) < 1e-5f, "replay gain scale", player.replayGainScale());
+
+    // 左右声道不同的常数：输出按增益缩放，分析环里是两声道的平均
+    const int frames = 512;
+    QVector<float> block(frames * 2);
+    auto process = [&]() {
+        for (int i = 0; i < frames; ++i) {
+            block[2 * i] = 0.25f;
+            block[2 * i + 1] = 0.05f;
+        }
+        player.processPcm(block.data(), frames, 2);
+    };
+    process();
+    c.check(tap->writePosition() == quint64(frames), "one block written", double(tap->writePosition()));
+    PcmRingBuffer::Span span = tap->read(0, frames);
+    bool rising = true;
+    for (int i = 1; i < frames; ++i) rising = rising && span.at(i) > span.at(i - 1);
+    c.check(rising && span.at(0) < 0.15f * 1.01f && std::abs(span.at(frames - 1) - 0.15f * gain) < 1e-4f,
+            "gain ramps within the first block", span.at(0));
+
+    process();
+    span = tap->read(frames, frames);
+    float maxError = 0.0f;
+    for (int i = 0; i < frames; ++i) maxError = qMax(maxError, std::abs(span.at(i) - 0.15f * gain));
+    c.check(maxError < 1e-5f, "steady gain mixed to mono", maxError);
+    c.check(std::abs(block[0] - 0.25f * gain) < 1e-5f && std::abs(block[1] - 0.05f * gain) < 1e-5f,
+            "output scaled in place", block[0]);
+
+    // 关闭归一化：下一块过渡回单位增益
+    player.setReplayGainMode(FFmpegPlayer::ReplayGainOff);
+    process();
+    span = tap->read(2 * frames, frames);
+    c.check(std::abs(span.at(frames - 1) - 0.15f) < 1e-5f && span.at(0) > 0.15f, "gain ramps back to unity",
+            span.at(frames - 1));
+    c.check(tap->writePosition() == quint64(3 * frames), "write position counts frames",
+            double(tap->writePosition()));
+
+    // 拉取方式：实时分析直接读取播放器的分析环
+    QVector<float> tone = sine(44100, 2, 1000.0, 0.5, 0.2);
+    for (int pos = 0; pos + frames <= tone.size() / 2; pos += frames) {
+        player.processPcm(tone.data() + pos * 2, frames, 2);
+    }
+    RealTimeAudioProcessor processor;
+    processor.setFFTSize(2048);
+    float rms = -1.0f;
+    float peak = -1.0f;
+    float centroid = -1.0f;
+    QObject::connect(&processor, &RealTimeAudioProcessor::audioFeaturesReady, &processor,
+                     [&](float r, float p, float, float sc) { rms = r; peak = p; centroid = sc; });
+    processor.setSource(tap);
+    c.check(waitFor([&]() { return peak >= 0.0f; }, 2000), "features from the tap");
+    c.check(std::abs(peak - 0.5f) < 0.01f && std::abs(rms - 0.5f / std::sqrt(2.0f)) < 0.01f, "tap level", peak);
+    c.check(std::abs(centroid - 1000.0f) < 50.0f, "tap spectrum centroid", centroid);
+    processor.setSource(nullptr);
+    return c.failures;
+}
+
+int testOnset() {
+    Checker c{"onset"};
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> jitter(0.5f, 1.5f);
+    const int bins = 64;
+    const double frameRate = 44100.0 / 512;   // 不应期约 9 帧，历史约 86 帧
+
+    // -60 dB 的起伏底噪上叠加单帧的宽带瞬态；403 与 400 相隔不到不应期
+    const QVector<int> clicks = {100, 150, 200, 250, 300, 350, 400, 403, 450, 500};
+    OnsetDetector detector;
+    detector.configure(bins, frameRate);
+    QVector<float> power(bins);
+    QVector<int> detected;
+    bool intensityInRange = true;
+    for (int frame = 0; frame < 600; ++frame) {
+        const bool click = clicks.contains(frame);
+        for (float &p : power) p = click ? 1.0f : 1e-6f * jitter(rng);
+        float intensity = -1.0f;
+        if (detector.process(power.constData(), &intensity)) {
+            detected.append(frame);
+            intensityInRange = intensityInRange && intensity > 0.0f && intensity <= 1.0f;
+        }
+    }
+    // 局部极大需要后一帧确认，起音在瞬态之后一帧报告
+    QVector<int> expected;
+    for (int click : clicks) {
+        if (click != 403) expected.append(click + 1);
+    }
+    c.check(detected == expected, "onsets one hop after each transient, none inside the refractory period",
+            detected.size());
+    c.check(intensityInRange, "intensity within (0, 1]");
+
+    // 静音不产生通量，也不触发
+    detector.reset();
+    power.fill(0.0f);
+    int silentOnsets = 0;
+    for (int frame = 0; frame < 200; ++frame) silentOnsets += detector.process(power.constData(), nullptr) ? 1 : 0;
+    c.check(silentOnsets == 0 && detector.lastFlux() == 0.0f, "silence never triggers", silentOnsets);
+
+    detector.setSensitivity(2.0f);
+    c.check(detector.sensitivity() == 1.0f, "sensitivity clamped", detector.sensitivity());
+    return c.failures;
+}
+
+int testFeatureIndex() {
+    Checker c{"feature_index"};
+    const int dims = 11;
+    const int count = 3000;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    QVector<float> data(count * dims);
+    for (float &x : data) x = uniform(rng);
+    QVector<QString> ids(count);
+    QSet<int> removed;
+
+    FeatureIndex index(dims);
+    index.setApproximateThreshold(0);
+    for (int i = 0; i < count; ++i) {
+        ids[i] = QString("track%1").arg(i);
+        index.upsert(ids[i], data.constData() + i * dims);
+    }
+    for (int i = 0; i < count; i += 7) {
+        index.remove(ids[i]);
+        removed.insert(i);
+    }
+    // 更新已有条目（改写向量而不新增），删掉的条目再插入
+    for (int i = 1; i < count; i += 11) {
+        for (int d = 0; d < dims; ++d) data[i * dims + d] = uniform(rng);
+        index.upsert(ids[i], data.constData() + i * dims);
+        removed.remove(i);
+    }
+    c.check(index.size() == count - removed.size(), "size after remove", index.size());
+    c.check(!index.contains(ids[0]) && index.contains(ids[1]), "contains");
+    float stored[dims];
+    c.check(index.vectorFor(ids[12], stored) && stored[3] == data[12 * dims + 3], "vectorFor");
+
+    auto bruteForce = [&](const float *query, int k, int exclude) {
+        QVector<QPair<float, int>> all;
+        for (int i = 0; i < count; ++i) {
+            if (removed.contains(i) || i == exclude) continue;
+            float distance = 0.0f;
+            for (int d = 0; d < dims; ++d) {
+                const float diff = query[d] - data[i * dims + d];
+                distance += diff * diff;
+            }
+            all.append(qMakePair(distance, i));
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        all.resize(k);
+        return all;
+    };
+    auto agrees = [&](const char *what) {
+        int mismatches = 0;
+        for (int q = 2; q < count; q += 97) {
+            const QVector<FeatureIndex::Match> matches = index.nearest(data.constData() + q * dims, 10, ids[q]);
+            const auto expected = bruteForce(data.constData() + q * dims, 10, q);
+            if (matches.size() != expected.size()) {
+                ++mismatches;
+                continue;
+            }
+            for (int i = 0; i < matches.size(); ++i) {
+                if (std::abs(matches[i].distance - expected[i].first) > 1e-4f) ++mismatches;
+            }
+        }
+        c.check(mismatches == 0, what, mismatches);
+    };
+    agrees("exact scan matches brute force");
+    c.check(index.needsRebuild(), "tombstones request a rebuild");
+    index.rebuild();
+    agrees("compacted index matches brute force");
+
+    // IVF：探测全部列表时结果与精确扫描一致
+    index.setApproximateThreshold(1000);
+    index.setProbeCount(count);
+    index.rebuild();
+    c.check(index.isApproximate(), "IVF trained above threshold");
+    agrees("IVF probing every list matches brute force");
+
+    // 加权全量扫描：墓碑为无穷大
+    index.remove(ids[2]);
+    QVector<float> weights(dims, 1.0f), distances(index.slotCount());
+    index.weightedDistances(data.constData() + 3 * dims, weights.constData(), distances.data());
+    bool weightedOk = true;
+    for (int slot = 0; slot < index.slotCount(); ++slot) {
+        const int i = index.idAt(slot).mid(5).toInt();
+        if (i == 2) {
+            weightedOk = weightedOk && std::isinf(distances[slot]);
+        } else if (i == 3) {
+            weightedOk = weightedOk && distances[slot] < 1e-6f;
+        }
+    }
+    c.check(weightedOk, "weightedDistances");
+    return c.failures;
+}
+
+int testPreferences() {
+    Checker c{"preferences"};
+    const qint64 day = 86400000;
+    const qint64 t0 = 1700000000000LL;
+
+    // 半衰期 30 天：同一键的多次奖励按各自的时间衰减后相加
+    PreferenceModel model(30.0);
+    c.check(model.isEmpty() && model.energyPreference() == 0.5, "empty model");
+    model.add(PreferenceModel::Artist, "a", 1.0, t0);
+    model.add(PreferenceModel::Artist, "b", -1.0, t0);
+    c.check(std::abs(model.weight(PreferenceModel::Artist, "a", t0) - 1.0) < 1e-9, "weight at the event");
+    c.check(std::abs(model.weight(PreferenceModel::Artist, "a", t0 + 30 * day) - 0.5) < 1e-9,
+            "halved after one half-life", model.weight(PreferenceModel::Artist, "a", t0 + 30 * day));
+    c.check(std::abs(model.weight(PreferenceModel::Artist, "b", t0 + 60 * day) + 0.25) < 1e-9,
+            "negative rewards decay too", model.weight(PreferenceModel::Artist, "b", t0 + 60 * day));
+    model.add(PreferenceModel::Artist, "a", 1.0, t0 + 30 * day);
+    c.check(std::abs(model.weight(PreferenceModel::Artist, "a", t0 + 30 * day) - 1.5) < 1e-9,
+            "rewards add up", model.weight(PreferenceModel::Artist, "a", t0 + 30 * day));
+    model.addHour(21, 2.0, t0);
+    c.check(std::abs(model.hourWeight(21, t0 + 30 * day) - 1.0) < 1e-9, "hour weight decays");
+
+    // 只有正奖励参与能量/情感偏好的加权平均
+    model.addTarget(0.8, 0.2, 1.0, t0);
+    model.addTarget(0.0, 1.0, -1.0, t0);
+    model.addTarget(0.4, 0.6, 1.0, t0);
+    c.check(std::abs(model.energyPreference() - 0.6) < 1e-9 && std::abs(model.valencePreference() - 0.4) < 1e-9,
+            "energy and valence averaged over positive rewards", model.energyPreference());
+
+    // 五年后（约 60 个半衰期）指数超出范围而换基：新事件仍精确，旧权重衰减到可以忽略而被剔除
+    const qint64 later = t0 + 5 * 365 * day;
+    model.add(PreferenceModel::Artist, "c", 2.0, later);
+    const double recent = model.weight(PreferenceModel::Artist, "c", later);
+    const double old = model.weight(PreferenceModel::Artist, "a", later);
+    c.check(std::abs(recent - 2.0) < 1e-9, "weight exact after rebase", recent);
+    c.check(std::isfinite(old) && std::abs(old) < 1e-12, "old weights vanish after rebase", old);
+    c.check(!model.weights(PreferenceModel::Artist, later).contains("a"), "negligible weights dropped on rebase");
+
+    PreferenceModel restored;
+    restored.fromJson(model.toJson());
+    c.check(std::abs(restored.weight(PreferenceModel::Artist, "c", later + 10 * day)
+                     - model.weight(PreferenceModel::Artist, "c", later + 10 * day)) < 1e-9
+            && restored.halfLifeDays() == 30.0, "JSON round trip");
+
+    // 键数有上限：超出时剔除绝对值最小的四分之一，大权重始终保留
+    PreferenceModel bounded(30.0, 16);
+    for (int i = 0; i < 40; ++i) bounded.add(PreferenceModel::Genre, QString("g%1").arg(i), i + 1.0, t0);
+    const QMap<QString, double> genres = bounded.weights(PreferenceModel::Genre, t0);
+    bool largestKept = true;
+    for (int i = 32; i < 40; ++i) largestKept = largestKept && genres.contains(QString("g%1").arg(i));
+    c.check(genres.size() <= 16, "key count bounded", genres.size());
+    c.check(largestKept, "largest weights kept when pruning");
+
+    // 播放日志：每 5 条轮转一次，回放按时间顺序给出最近一份与当前文件；损坏的行跳过，写到一半的末行截掉
+    QTemporaryDir directory;
+    c.check(directory.isValid(), "temporary directory");
+    const QString logPath = directory.filePath("plays.jsonl");
+    QVector<int> replayed;
+    auto collect = [&replayed](const QJsonObject &record) { replayed.append(record["i"].toInt()); };
+    auto record = [](int i) {
+        QJsonObject obj;
+        obj["i"] = i;
+        return obj;
+    };
+    {
+        PlayLog log(5);
+        c.check(log.open(logPath), "open play log");
+        for (int i = 0; i < 12; ++i) log.append(record(i));
+        log.replay(collect);
+    }
+    QVector<int> expected;
+    for (int i = 5; i < 12; ++i) expected.append(i);
+    c.check(replayed == expected, "replay after rotation", replayed.size());
+    {
+        QFile file(logPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Append)) file.write("not json\n{\"i\": 12");
+    }
+    {
+        PlayLog log(5);
+        log.open(logPath);
+        log.append(record(13));
+        replayed.clear();
+        log.replay(collect);
+    }
+    expected.append(13);
+    c.check(replayed == expected, "corrupt line skipped and torn line truncated", replayed.size());
+
+    // 偏好文件丢失时从日志重放：与在线折入的偏好一致
+    const QString preferencePath = directory.filePath("preferences.json");
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    RecommendationEngine online;
+    online.loadUserPreference(preferencePath);
+    for (int i = 0; i < 20; ++i) {
+        RecommendationEngine::PlayHistory play;
+        play.songId = QString("song%1").arg(i);
+        play.timestamp = now - (20 - i) * day;
+        play.playDuration = 180000;
+        play.skipped = i % 3 == 0;
+        play.liked = i % 5 == 0;
+        play.completionRate = play.skipped ? 0.2 : 1.0;
+        SongInfo song;
+        song.filePath = play.songId + ".mp3";
+        song.artist = QString("artist%1").arg(i % 4);
+        online.updateUserPreference(play, song);
+    }
+    RecommendationEngine rebuilt;
+    rebuilt.loadUserPreference(preferencePath);
+    const QMap<QString, double> expectedArtists = online.getUserPreference().artistWeights;
+    const QMap<QString, double> rebuiltArtists = rebuilt.getUserPreference().artistWeights;
+    double replayError = expectedArtists.size() == 4 ? 0.0 : 1.0;
+    for (auto it = expectedArtists.constBegin(); it != expectedArtists.constEnd(); ++it) {
+        replayError = qMax(replayError, std::abs(rebuiltArtists.value(it.key()) - it.value()));
+    }
+    c.check(replayError < 1e-6 && rebuiltArtists.size() == expectedArtists.size(),
+            "preferences rebuilt from the play log", replayError);
+    c.check(rebuilt.recentPlays().size() == 20, "recent plays restored from the play log",
+            double(rebuilt.recentPlays().size()));
+    return c.failures;
+}
+
+int testSmartPlaylist() {
+    Checker c{"smart_playlist"};
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    QVector<SongInfo> library(2000);
+    QVector<MusicAnalyzer::AudioFeatures> features(library.size());
+    for (int i = 0; i < library.size(); ++i) {
+        SongInfo &song = library[i];
+        song.filePath = QString("/selftest/%1.flac").arg(i);
+        song.artist = QString("Artist %1").arg(int(rng() % 60));
+        song.durationMs = 90000 + qint64(uniform(rng) * 330000);
+        MusicAnalyzer::AudioFeatures &f = features[i];
+        f.tempo = 60.0 + uniform(rng) * 120.0;
+        f.energy = uniform(rng);
+        f.valence = uniform(rng);
+        f.danceability = uniform(rng);
+        f.acousticness = uniform(rng);
+        f.instrumentalness = uniform(rng);
+        f.speechiness = uniform(rng) * 0.3;
+        f.loudness = -30.0 + uniform(rng) * 24.0;
+        f.duration_ms = int(song.durationMs);
+    }
+
+    // 特征经分析器的完成信号进入引擎的索引，与后台分析的路径相同
+    MusicAnalyzer analyzer;
+    RecommendationEngine engine;
+    engine.setMusicAnalyzer(&analyzer);
+    engine.setMusicLibrary(library);
+    for (int i = 0; i < library.size(); ++i) emit analyzer.analysisCompleted(library[i].filePath, features[i]);
+    QHash<QString, double> energy;
+    double meanEnergy = 0.0;
+    for (int i = 0; i < library.size(); ++i) {
+        energy.insert(library[i].filePath, features[i].energy);
+        meanEnergy += features[i].energy / library.size();
+    }
+
+    const struct { const char *mood; const char *activity; int minutes; } cases[] = {
+        {"energetic", "workout", 60}, {"calm", "", 17}, {"", "focus", 180}, {"sad", "sleep", 5},
+    };
+    for (const auto &test : cases) {
+        const QVector<SongInfo> playlist = engine.generateSmartPlaylist(test.mood, test.activity, test.minutes);
+        qint64 total = 0;
+        int gapViolations = 0;
+        QSet<QString> seen;
+        for (int i = 0; i < playlist.size(); ++i) {
+            total += playlist[i].durationMs;
+            seen.insert(playlist[i].filePath);
+            for (int j = qMax(0, i - 3); j < i; ++j) {
+                if (playlist[j].artist == playlist[i].artist) ++gapViolations;
+            }
+        }
+        c.check(std::abs(total - qint64(test.minutes) * 60000) <= 30000, "total within 30 s of budget", total / 1000.0);
+        c.check(gapViolations == 0, "same artist at least 3 songs apart", gapViolations);
+        c.check(seen.size() == playlist.size(), "no song repeated", playlist.size() - seen.size());
+        if (std::strcmp(test.activity, "workout") == 0) {
+            double selected = 0.0;
+            for (const SongInfo &song : playlist) selected += energy.value(song.filePath) / playlist.size();
+            c.check(selected > meanEnergy + 0.2, "workout playlist favors high energy", selected);
+        }
+    }
+    return c.failures;
+}
+
+int testPlaylistUpdates() {
+    Checker c{"playlist_updates"};
+    QVector<SongInfo> library;
+    for (int i = 0; i < 20; ++i) {
+        SongInfo song;
+        song.filePath = QString("song%1.mp3").arg(i);
+        song.artist = QString("artist%1").arg(i % 5);
+        song.durationMs = 200000;
+        library.append(song);
+    }
+    RecommendationEngine engine;
+    engine.setMusicLibrary(library);
+    SmartPlaylistManager manager;
+    QHash<QString, int> updates;
+    QObject::connect(&manager, &SmartPlaylistManager::playlistUpdated, &manager,
+                     [&updates](const QString &id) { ++updates[id]; });
+    manager.setRecommendationEngine(&engine);
+
+    // 新建的列表立即计算一次；关闭自动更新的列表之后不再随输入变化；计算中被删除的列表结果直接丢弃
+    const QString similar = manager.createSmartPlaylist("similar", RecommendationEngine::SimilarSongs);
+    const QString manual = manager.createSmartPlaylist("manual", RecommendationEngine::SimilarSongs);
+    manager.setAutoUpdate(manual, false);
+    const QString deleted = manager.createSmartPlaylist("deleted", RecommendationEngine::SimilarSongs);
+    manager.deletePlaylist(deleted);
+    c.check(waitFor([&]() { return updates.value(similar) == 1 && updates.value(manual) == 1; }, 5000),
+            "new playlists computed once");
+
+    // 曲库连续变化一秒：变化期间不重算，最后一次变化安静 2 秒后只重算一次
+    QElapsedTimer sinceChange;
+    for (int i = 0; i < 10; ++i) {
+        engine.setMusicLibrary(library);
+        sinceChange.start();
+        waitFor([]() { return false; }, 100);
+    }
+    c.check(updates.value(similar) == 1, "no update while the library keeps changing", updates.value(similar));
+    c.check(waitFor([&]() { return updates.value(similar) == 2; }, 5000), "update after the library settles");
+    c.check(sinceChange.elapsed() >= 1900, "waited for the settle period", double(sinceChange.elapsed()));
+    waitFor([]() { return false; }, 500);
+    c.check(updates.value(similar) == 2, "a burst of changes recomputes once", updates.value(similar));
+    c.check(updates.value(manual) == 1, "playlists without auto update stay put", updates.value(manual));
+    c.check(updates.value(deleted) == 0, "results for deleted playlists discarded", updates.value(deleted));
+
+    // 计算期间再次请求只排队一次：连续三次请求共计算两次
+    manager.updatePlaylist(similar);
+    manager.updatePlaylist(similar);
+    manager.updatePlaylist(similar);
+    c.check(waitFor([&]() { return updates.value(similar) == 4; }, 5000), "queued request runs after the current one");
+    waitFor([]() { return false; }, 300);
+    c.check(updates.value(similar) == 4, "requests during a run coalesce", updates.value(similar));
+    return c.failures;
+}
+
+#ifdef ENABLE_ONLINE_METADATA
+// 有效期完全按服务器的 max-age，便于让条目立即过期以验证条件请求
+class ServerTtlProvider : public LocalMetadataProvider {
+public:
+    ServerTtlProvider(const QUrl &baseUrl, int maxConcurrent) : LocalMetadataProvider(baseUrl, maxConcurrent, 1000.0) {}
+    qint64 minimumTtlMs(RequestKind) const override { return 0; }
+};
+
+int testOnline() {
+    Checker c{"online"};
+    LocalMetadataServer server;
+    c.check(server.listen(), "local server listening");
+    QImage image(8, 8, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    server.setAlbumArt("Artist", "Album", png, 300);
+    server.setLyrics("Artist", "Song", "la la la");
+
+    QTemporaryDir cacheDirectory;
+    OnlineMusicService service;
+    service.setCacheDirectory(cacheDirectory.path());
+    service.addProvider(new ServerTtlProvider(server.baseUrl(), 2));
+    QVector<QSize> arts;
+    QStringList lyrics;
+    QObject::connect(&service, &OnlineMusicService::albumArtReceived, &service,
+                     [&arts](const QString &, const QString &, const QPixmap &art) { arts.append(art.size()); });
+    QObject::connect(&service, &OnlineMusicService::lyricsReceived, &service,
+                     [&lyrics](const QString &, const QString &, const QString &text) { lyrics.append(text); });
+    QObject::connect(&service, &OnlineMusicService::errorOccurred, &service,
+                     [](const QString &error) { qWarning() << "online:" << error; });
+
+    // 同一封面连续请求三次（两次完全相同、一次换尺寸）：专辑信息与图片各只下载一次，每个尺寸通知一次
+    service.getAlbumArt("Artist", "Album", QSize(300, 300));
+    service.getAlbumArt("Artist", "Album", QSize(300, 300));
+    service.getAlbumArt("Artist", "Album", QSize(100, 100));
+    c.check(service.pendingRequestCount() == 1, "duplicate requests coalesced", service.pendingRequestCount());
+    c.check(waitFor([&]() { return arts.size() == 2; }, 5000), "album art delivered", arts.size());
+    waitFor([]() { return false; }, 200);
+    c.check(arts.size() == 2 && arts.contains(QSize(100, 100)), "one notification per size", arts.size());
+    c.check(server.requestCount("/album") == 1 && server.requestCount("/image") == 1,
+            "album and image fetched once", server.requestCount());
+
+    // 再次请求同一封面：两步都命中缓存，不再访问服务器，结果仍异步送达
+    server.resetCounters();
+    service.getAlbumArt("Artist", "Album", QSize(300, 300));
+    c.check(arts.size() == 2, "cache hits are delivered asynchronously");
+    c.check(waitFor([&]() { return arts.size() == 3; }, 5000), "repeated album art delivered from cache");
+    c.check(server.requestCount() == 0 && server.notModifiedCount() == 0, "repeated request served from cache",
+            server.requestCount());
+
+    // max-age=0：第二次请求带 If-None-Match 重新验证，304 时沿用缓存内容
+    server.resetCounters();
+    server.setMaxAge(0);
+    service.getLyrics("Artist", "Song");
+    c.check(waitFor([&]() { return lyrics.size() == 1; }, 5000), "lyrics delivered");
+    service.getLyrics("Artist", "Song");
+    c.check(waitFor([&]() { return lyrics.size() == 2; }, 5000), "revalidated lyrics delivered");
+    c.check(lyrics.value(1) == "la la la", "304 reuses the cached body");
+    c.check(server.requestCount("/lyrics") == 2 && server.notModifiedCount() == 1, "conditional request answered with 304",
+            server.notModifiedCount());
+    server.setMaxAge(60);
+
+    // 429 + Retry-After: 1：暂停一秒后重试成功
+    server.resetCounters();
+    server.setRateLimited(1, 1);
+    server.setLyrics("Artist", "Retry", "again");
+    QElapsedTimer retryTimer;
+    retryTimer.start();
+    service.getLyrics("Artist", "Retry");
+    c.check(waitFor([&]() { return lyrics.size() == 3; }, 5000), "request retried after 429");
+    c.check(retryTimer.elapsed() >= 900, "waited for Retry-After", double(retryTimer.elapsed()));
+    c.check(server.requestCount("/lyrics") == 2, "one retry after 429", server.requestCount("/lyrics"));
+
+    // 并发上限 2：六个不同的请求排队发出，服务器上同时处理的不超过两个
+    server.resetCounters();
+    server.setResponseDelay(150);
+    for (int i = 0; i < 6; ++i) {
+        const QString title = QString("Track %1").arg(i);
+        server.setLyrics("Artist", title, title);
+        service.getLyrics("Artist", title);
+    }
+    c.check(waitFor([&]() { return lyrics.size() == 9; }, 10000), "queued requests delivered", lyrics.size());
+    c.check(server.requestCount("/lyrics") == 6, "each queued request sent once", server.requestCount("/lyrics"));
+    c.check(server.peakConcurrentRequests() == 2, "concurrency capped per provider", server.peakConcurrentRequests());
+
+    // 预取当前曲目之后的两首：只填缓存、不发信号，只占一个连接；连续切歌时只提交最后一批
+    server.resetCounters();
+    server.setResponseDelay(100);
+    service.setPrefetchBandwidth(0);
+    QVector<MetadataPrefetcher::Track> queue;
+    for (int i = 0; i < 5; ++i) {
+        const QString title = QString("Next %1").arg(i);
+        server.setLyrics("Artist", title, title);
+        queue.append({"Artist", title, QString()});
+    }
+    PlayOrder order;
+    order.reset(queue.size(), PlayMode::Sequential);
+    MetadataPrefetcher *prefetcher = new MetadataPrefetcher(&service);
+    prefetcher->setLookahead(2);
+    prefetcher->setAlbumArtEnabled(false);
+    prefetcher->update(queue, order, 0);
+    prefetcher->update(queue, order, 1);
+    c.check(waitFor([&]() { return server.requestCount("/lyrics") == 2 && service.pendingRequestCount() == 0; }, 5000),
+            "upcoming lyrics prefetched", server.requestCount("/lyrics"));
+    waitFor([]() { return false; }, 200);
+    c.check(lyrics.size() == 9, "prefetch emits no signals", lyrics.size());
+    c.check(server.peakConcurrentRequests() == 1, "prefetch leaves a connection free", server.peakConcurrentRequests());
+    service.getLyrics("Artist", "Next 2");
+    service.getLyrics("Artist", "Next 3");
+    c.check(waitFor([&]() { return lyrics.size() == 11; }, 5000), "prefetched lyrics delivered");
+    c.check(server.requestCount("/lyrics") == 2, "prefetched lyrics served from cache", server.requestCount("/lyrics"));
+    service.getLyrics("Artist", "Next 1");
+    c.check(waitFor([&]() { return lyrics.size() == 12; }, 5000), "superseded track delivered");
+    c.check(server.requestCount("/lyrics") == 3, "superseded batch never submitted", server.requestCount("/lyrics"));
+    return c.failures;
+}
+#endif
+
+int testPlayOrder() {
+    Checker c{"play_order"};
+    PlayOrder order;
+    c.check(order.next(-1) == -1 && order.upcoming(0, 3).isEmpty(), "empty queue has no next track");
+
+    order.reset(5, PlayMode::Sequential);
+    c.check(order.next(-1) == 0 && order.next(2) == 3 && order.next(4) == -1, "sequential next");
+    c.check(order.previous(0) == -1 && order.previous(3) == 2, "sequential previous");
+    c.check(order.upcoming(1, 2) == QVector<int>({2, 3}) && order.upcoming(3, 5) == QVector<int>({4}),
+            "sequential upcoming stops at the end");
+    // 单曲循环的重复由播放器处理，手动切歌按顺序走
+    order.setMode(PlayMode::SingleLoop, 2);
+    c.check(order.next(2) == 3 && order.previous(2) == 1, "single loop steps sequentially");
+
+    // 随机：从当前曲目沿 next() 走完一遍，每首恰好一次；previous() 原路返回；upcoming() 与 next() 一致
+    const int count = 50;
+    bool currentFirst = true;
+    bool everyTrackOnce = true;
+    bool previousRetraces = true;
+    bool upcomingMatches = true;
+    for (int round = 0; round < 20; ++round) {
+        const int current = (round * 7) % count;
+        order.reset(count, PlayMode::Random, current);
+        currentFirst = currentFirst && order.next(-1) == current && order.previous(current) == -1;
+        QVector<int> walk{current};
+        for (int index = order.next(current); index >= 0 && walk.size() <= count; index = order.next(index)) {
+            previousRetraces = previousRetraces && order.previous(index) == walk.last();
+            walk.append(index);
+        }
+        QSet<int> seen;
+        for (int index : walk) seen.insert(index);
+        everyTrackOnce = everyTrackOnce && walk.size() == count && seen.size() == count;
+        upcomingMatches = upcomingMatches && order.upcoming(current, 4) == walk.mid(1, 4)
+            && order.upcoming(walk[count - 3], 5) == walk.mid(count - 2) && order.upcoming(walk.last(), 3).isEmpty();
+    }
+    c.check(currentFirst, "current track starts the shuffle");
+    c.check(everyTrackOnce, "shuffle plays every track exactly once");
+    c.check(previousRetraces, "previous retraces the shuffle");
+    c.check(upcomingMatches, "upcoming follows the shuffle");
+
+    order.reset(count, PlayMode::Random, 0);
+    const QVector<int> first = order.upcoming(0, count);
+    order.reset(count, PlayMode::Random, 0);
+    c.check(order.upcoming(0, count) != first, "each reset reshuffles");
+
+    // 当前曲目无效时整个队列都参与洗牌
+    order.reset(5, PlayMode::Random, 9);
+    QSet<int> all;
+    for (int index = order.next(-1); index >= 0 && all.size() < 6; index = order.next(index)) all.insert(index);
+    c.check(all.size() == 5, "invalid current shuffles the whole queue", all.size());
+    order.setMode(PlayMode::Sequential, 3);
+    c.check(order.next(3) == 4 && order.upcoming(0, 2) == QVector<int>({1, 2}), "switching back to sequential");
+    return c.failures;
+}
+
+// 模板形状：折线按顶点给出，每段插值若干点，段间点距不同，模拟不匀速的笔画
+QVector<QPointF> polyline(const QVector<QPointF> &vertices) {
+    QVector<QPointF> path;
+    for (int i = 1; i < vertices.size(); ++i) {
+        const int steps = 6 + 5 * (i % 3);
+        for (int s = 0; s < steps; ++s) {
+            const qreal t = qreal(s) / steps;
+            path.append(vertices[i - 1] + (vertices[i] - vertices[i - 1]) * t);
+        }
+    }
+    path.append(vertices.last());
+    return path;
+}
+
+QVector<QPointF> arc(qreal startAngle, qreal sweep, int points) {
+    QVector<QPointF> path;
+    for (int i = 0; i < points; ++i) {
+        const qreal a = startAngle + sweep * i / (points - 1);
+        path.append(QPointF(std::cos(a), std::sin(a)));
+    }
+    return path;
+}
+
+// 绕原点旋转、缩放、平移，再加少量抖动
+QVector<QPointF> transformed(const QVector<QPointF> &path, qreal angle, qreal scale, const QPointF &offset,
+                             std::mt19937 &rng) {
+    std::uniform_real_distribution<qreal> jitter(-0.01, 0.01);
+    QVector<QPointF> result;
+    const qreal c = std::cos(angle);
+    const qreal s = std::sin(angle);
+    for (const QPointF &p : path) {
+        const qreal x = p.x() + jitter(rng);
+        const qreal y = p.y() + jitter(rng);
+        result.append(QPointF(scale * (c * x - s * y), scale * (s * x + c * y)) + offset);
+    }
+    return result;
+}
+
+int testGestures() {
+    Checker c{"gesture"};
+    std::mt19937 rng(11);
+    QVector<QPair<QString, QVector<QPointF>>> shapes;
+    shapes.append({"circle", arc(0.0, 2.0 * kPi, 48)});
+    shapes.append({"check", polyline({QPointF(0, 0.5), QPointF(0.3, 1), QPointF(1, -0.5)})});
+    shapes.append({"zigzag", polyline({QPointF(0, 0), QPointF(0.5, 1), QPointF(1, 0), QPointF(1.5, 1), QPointF(2, 0)})});
+    shapes.append({"triangle", polyline({QPointF(0, 0), QPointF(1, 0), QPointF(0.5, 0.9), QPointF(0, 0)})});
+    shapes.append({"corner", polyline({QPointF(0, 1), QPointF(0, 0), QPointF(0.6, 0)})});
+    shapes.append({"arch", arc(kPi, -kPi, 30)});
+    shapes.append({"spiral", [] {
+        QVector<QPointF> path;
+        for (int i = 0; i < 60; ++i) path.append(QPointF(i * std::cos(i * 0.2), i * std::sin(i * 0.2)) / 60.0);
+        return path;
+    }()});
+    shapes.append({"star", polyline({QPointF(0, 1), QPointF(0.59, -0.81), QPointF(-0.95, 0.31), QPointF(0.95, 0.31),
+                                     QPointF(-0.59, -0.81), QPointF(0, 1)})});
+    shapes.append({"wave", [] {
+        QVector<QPointF> path;
+        for (int i = 0; i < 50; ++i) path.append(QPointF(i / 10.0, 0.4 * std::sin(i * 0.4)));
+        return path;
+    }()});
+
+    GestureTemplateIndex index;
+    for (const auto &shape : shapes) index.add(shape.first, shape.second);
+    c.check(index.size() == shapes.size() && index.names().size() == shapes.size(), "templates added", index.size());
+    c.check(!index.add("dot", {QPointF(3, 3)}) && !index.add("still", {QPointF(1, 1), QPointF(1, 1)}),
+            "degenerate paths rejected");
+
+    // 旋转 ±20°、缩放、平移并加抖动后仍识别为原形状，且超过识别阈值
+    bool allRecognized = true;
+    float worst = 1.0f;
+    for (const auto &shape : shapes) {
+        for (qreal angle : {-0.35, 0.35}) {
+            const QVector<QPointF> query = transformed(shape.second, angle, 3.7, QPointF(120, -45), rng);
+            const GestureTemplateIndex::Match match = index.best(query, 0.85f);
+            if (match.name != shape.first) {
+                allRecognized = false;
+                qWarning() << "gesture:" << shape.first << "recognized as" << match.name << match.score;
+            }
+            worst = qMin(worst, match.score);
+        }
+    }
+    c.check(allRecognized, "rotated and scaled templates recognized");
+    c.check(worst > 0.95f, "recognition score", worst);
+
+    // 区分朝向时旋转 90° 的勾得分受限；不区分朝向时仍接近 1
+    const QVector<QPointF> turned = transformed(shapes[1].second, kPi / 2, 2.0, QPointF(), rng);
+    const float sensitive = index.score(turned, "check");
+    index.setOrientationSensitive(false);
+    const float insensitive = index.score(turned, "check");
+    index.setOrientationSensitive(true);
+    c.check(sensitive < 0.85f, "orientation-sensitive score limited", sensitive);
+    c.check(insensitive > 0.98f, "rotation-invariant score", insensitive);
+    c.check(index.score(shapes[0].second, "missing") == -1.0f, "unknown name scores -1");
+
+    const QVector<GestureTemplateIndex::Match> ranked = index.match(transformed(shapes[2].second, 0.1, 1.0, QPointF(), rng), 3);
+    c.check(ranked.size() == 3 && ranked[0].name == "zigzag" && ranked[0].score >= ranked[1].score
+            && ranked[1].score >= ranked[2].score, "top-k ranked by score");
+
+    // 同名多个样本：得分取最好的一个，删除时一并删掉；其余模板（包括被移到空位的）照常识别
+    const QVector<QPointF> counterClockwise = arc(0.0, -2.0 * kPi, 40);
+    index.add("circle", counterClockwise);
+    c.check(index.size() == shapes.size() + 1 && index.names().size() == shapes.size(), "second sample shares a name");
+    c.check(index.best(transformed(counterClockwise, 0.2, 2.0, QPointF(5, 5), rng)).name == "circle",
+            "best sample of a name wins");
+    c.check(index.remove("circle") == 2 && index.remove("circle") == 0, "remove drops every sample of a name");
+    c.check(index.remove("check") == 1 && index.size() == shapes.size() - 2, "size after remove", index.size());
+    bool remainingRecognized = true;
+    for (const auto &shape : shapes) {
+        const GestureTemplateIndex::Match match = index.best(transformed(shape.second, 0.2, 1.5, QPointF(), rng), 0.85f);
+        const bool removed = shape.first == "circle" || shape.first == "check";
+        if (removed ? match.name == shape.first : match.name != shape.first) remainingRecognized = false;
+    }
+    c.check(remainingRecognized, "remaining templates recognized after remove");
+    c.check(index.best(shapes[0].second, 0.99f).name.isEmpty(), "below threshold returns no name");
+    index.clear();
+    c.check(index.isEmpty() && index.best(shapes[0].second).score == -1.0f, "clear");
+    return c.failures;
+}
+}
+
+int runSelfTests(const QString &suite) {
+    const struct { const char *name; int (*run)(); } suites[] = {
+        {"loudness", testLoudness},
+        {"convolver", testConvolver},
+        {"hrtf", testHrtf},
+        {"dsp_graph", testDspGraph},
+        {"fft", testFft},
+        {"analysis_tap", testAnalysisTap},
+        {"onset", testOnset},
+        {"feature_index", testFeatureIndex},
+        {"preferences", testPreferences},
+        {"smart_playlist", testSmartPlaylist},
+        {"playlist_updates", testPlaylistUpdates},
+#ifdef ENABLE_ONLINE_METADATA
+        {"online", testOnline},
+#endif
+        {"play_order", testPlayOrder},
+        {"gesture", testGestures},
+    };
+    int failures = 0;
+    bool found = false;
+    for (const auto &entry : suites) {
+        if (!suite.isEmpty() && suite != QLatin1String(entry.name)) continue;
+        found = true;
+        const int failed = entry.run();
+        qDebug() << "self-test" << entry.name << (failed == 0 ? "passed" : "failed");
+        failures += failed;
+    }
+    if (!found) {
+        qWarning() << "Unknown self-test suite:" << suite;
+        return 1;
+    }
+    return failures;
+}
@@ -0,0 +1,1548 @@
+#include "../include/smart_playlist.h"
+#include "../include/audio_feature_extractor.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QtMath>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#if defined(ENABLE_FFMPEG)
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+#include <libavutil/opt.h>
+#include <libavutil/channel_layout.h>
+}
+#endif
+
+namespace {
+const int kProgressIntervalMs = 250;
+
+// 特征库中的失败记录带分析器版本与时间：版本提高或过期后重新分析（偶发 I/O 错误等）
+const int kAnalyzerVersion = 1;
+const qint64 kFailureRetryMs = 7LL * 24 * 3600000;
+#if defined(ENABLE_FFMPEG)
+const bool kDecodingAvailable = true;
+#else
+const bool kDecodingAvailable = false;
+#endif
+
+QJsonObject failureRecord() {
+    QJsonObject record;
+    record["failed"] = true;
+    record["analyzerVersion"] = kAnalyzerVersion;
+    record["failedAt"] = double(QDateTime::currentMSecsSinceEpoch());
+    return record;
+}
+
+bool isCurrentFailure(const QJsonObject &stored) {
+    if (!stored.value("failed").toBool()) return false;
+    if (stored.value("analyzerVersion").toInt() != kAnalyzerVersion) return false;
+    const qint64 failedAt = qint64(stored.value("failedAt").toDouble());
+    return QDateTime::currentMSecsSinceEpoch() - failedAt < kFailureRetryMs;
+}
+const char *const kKeyNames[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+// 特征向量各维的权重：tempo, energy, valence, danceability, acousticness, instrumentalness,
+// speechiness, loudness, 调性五度圈 cos/sin, 调式
+const float kFeatureWeights[MusicAnalyzer::FeatureDimensions] = {
+    1.0f, 1.2f, 1.0f, 1.0f, 0.8f, 0.5f, 0.5f, 0.6f, 0.35f, 0.35f, 0.3f};
+
+inline double unit(double value) {
+    return qBound(0.0, value, 1.0);
+}
+
+// 两个特征向量间的最大平方距离：五度圈一对维度合起来最多相距 2 个权重（直径）
+float maxFeatureDistanceSq() {
+    float sum = 0.0f;
+    for (int d = 0; d < MusicAnalyzer::FeatureDimensions; ++d) {
+        const float w = kFeatureWeights[d];
+        sum += (d == 8 || d == 9 ? 2.0f * w * w : w * w);
+    }
+    return sum;
+}
+
+// 智能播放列表的选曲参数
+const qint64 kDurationToleranceMs = 30000;
+const qint64 kTypicalSongMs = 240000;
+const int kArtistGap = 3;           // 同一歌手前后至少隔 3 首
+const int kPoolFactor = 16;         // 候选数为预计曲目数的倍数
+const int kMinPool = 512;
+const int kRepairRounds = 8;
+const double kArtistBonus = 0.15;
+const double kSkipPenalty = 0.2;
+
+const float kAny = std::numeric_limits<float>::quiet_NaN();
+
+// 目标特征：速度 BPM、能量、情感、可舞性、声学性、器乐性、语音性、响度 LUFS；kAny 表示不限
+struct TargetSpec {
+    const char *name;
+    float values[8];
+};
+
+const TargetSpec kMoodTargets[] = {
+    {"happy",     {kAny,   0.70f, 0.85f, 0.60f, kAny,  kAny,  kAny,  kAny}},
+    {"energetic", {128.0f, 0.90f, 0.60f, kAny,  kAny,  kAny,  kAny,  kAny}},
+    {"intense",   {kAny,   0.85f, 0.25f, kAny,  kAny,  kAny,  kAny,  -8.0f}},
+    {"calm",      {kAny,   0.25f, 0.60f, kAny,  0.60f, kAny,  kAny,  kAny}},
+    {"romantic",  {kAny,   0.40f, 0.65f, kAny,  0.50f, kAny,  kAny,  kAny}},
+    {"sad",       {kAny,   0.30f, 0.15f, kAny,  0.50f, kAny,  kAny,  kAny}},
+};
+
+const TargetSpec kActivityTargets[] = {
+    {"workout", {130.0f, 0.90f, kAny,  0.70f, kAny,  kAny,  kAny,  kAny}},
+    {"running", {165.0f, 0.85f, kAny,  kAny,  kAny,  kAny,  kAny,  kAny}},
+    {"party",   {122.0f, 0.80f, 0.75f, 0.85f, kAny,  kAny,  kAny,  kAny}},
+    {"driving", {110.0f, 0.65f, 0.65f, kAny,  kAny,  kAny,  kAny,  kAny}},
+    {"focus",   {kAny,   0.30f, kAny,  kAny,  kAny,  0.80f, 0.05f, kAny}},
+    {"relax",   {kAny,   0.20f, kAny,  kAny,  0.70f, kAny,  kAny,  -20.0f}},
+    {"sleep",   {65.0f,  0.10f, kAny,  kAny,  0.80f, 0.60f, kAny,  -24.0f}},
+};
+
+template <int N>
+const TargetSpec *findTarget(const TargetSpec (&specs)[N], const QString &name) {
+    for (const TargetSpec &spec : specs) {
+        if (name.compare(QLatin1String(spec.name), Qt::CaseInsensitive) == 0) return &spec;
+    }
+    return nullptr;
+}
+
+// 与 MusicAnalyzer::featureVector 相同的归一化：速度按倍频程、响度 -30..-6 LUFS
+float targetComponent(int d, float value) {
+    if (d == 0) return float(unit(std::log2(value / 60.0) / 2.0)) * kFeatureWeights[d];
+    if (d == 7) return float(unit((value + 30.0) / 24.0)) * kFeatureWeights[d];
+    return float(unit(value)) * kFeatureWeights[d];
+}
+
+// 智能播放列表自动更新：各输入（曲库、特征、偏好）安静下来多久才算稳定，每次变更重新计时；
+// 批量分析一直不停时最多等到首次变更后 kMaxSettleMs 再算一次
+const qint64 kSettleMs[] = {2000, 30000, 5 * 60000};
+const qint64 kMaxSettleMs[] = {60000, 10 * 60000, 30 * 60000};
+const qint64 kHourMs = 3600000;
+const qint64 kDiscoveryRefreshMs = 7 * 24 * kHourMs;
+const int kDefaultPlaylistMinutes = 60;
+const int kDefaultPlaylistCount = 30;
+
+// 一天中各时段默认的心情与活动，用于基于时间的推荐
+struct TimeSlot {
+    int fromHour;
+    const char *mood;
+    const char *activity;
+};
+
+const TimeSlot kTimeSlots[] = {
+    {0,  "calm",      "sleep"},
+    {6,  "happy",     ""},
+    {9,  "",          "focus"},
+    {12, "happy",     ""},
+    {14, "",          "focus"},
+    {18, "energetic", "driving"},
+    {21, "calm",      "relax"},
+};
+
+const TimeSlot &timeSlotFor(int hour) {
+    int slot = 0;
+    for (int i = 0; i < int(sizeof(kTimeSlots) / sizeof(kTimeSlots[0])); ++i) {
+        if (hour >= kTimeSlots[i].fromHour) slot = i;
+    }
+    return kTimeSlots[slot];
+}
+
+const double kFamiliarArtistWeight = 0.05;  // 权重在此之下的歌手视为尚未熟悉
+const int kDiscoveryPoolFactor = 8;
+const int kMaxSongsPerArtist = 3;
+
+// 底层描述量 -> 0-1 感知特征。经验映射，只用于相似度与推荐排序，不追求与流媒体平台的数值一致
+MusicAnalyzer::AudioFeatures toAudioFeatures(const AudioFeatureExtractor::Result &r) {
+    MusicAnalyzer::AudioFeatures f;
+    f.duration_ms = int(r.durationSec * 1000.0);
+    f.tempo = r.tempo;
+    f.loudness = r.loudnessLufs;
+    if (r.keyIndex >= 0) {
+        f.key = QString::fromLatin1(kKeyNames[r.keyIndex]);
+        f.mode = r.major ? QStringLiteral("major") : QStringLiteral("minor");
+    }
+
+    const double loud = unit((r.loudnessLufs + 30.0) / 24.0);           // -30 LUFS -> 0, -6 LUFS -> 1
+    const double bright = unit((r.spectralCentroid - 300.0) / 2700.0);
+    const double noisy = unit(r.spectralFlatness * 4.0);
+    const double busy = unit(r.onsetRate / 6.0);
+    f.energy = unit(0.5 * loud + 0.25 * busy + 0.15 * bright + 0.1 * noisy);
+
+    // 节拍越清晰、速度越接近 118 BPM 越适合跳舞
+    const double octaves = r.tempo > 0.0 ? std::log2(r.tempo / 118.0) / 0.6 : 4.0;
+    const double tempoFit = std::exp(-0.5 * octaves * octaves);
+    f.danceability = unit(0.7 * r.beatStrength * tempoFit + 0.3 * unit(r.onsetRate / 4.0));
+
+    f.acousticness = unit(1.0 - 0.5 * bright - 0.3 * loud - 0.2 * noisy);
+    // 语音的音节间停顿使低能量跳比例偏高，且节拍不规则；没有人声分离，器乐性按语音性的反面近似
+    f.speechiness = unit((r.lowEnergyRatio - 0.1) / 0.4) * (1.0 - 0.5 * r.beatStrength);
+    f.instrumentalness = unit(1.0 - 1.5 * f.speechiness);
+
+    const double clarity = unit(r.keyClarity * 5.0);
+    const double modeScore = r.keyIndex < 0 ? 0.5 : (r.major ? 0.5 + 0.5 * clarity : 0.5 - 0.5 * clarity);
+    f.valence = unit(0.3 * modeScore + 0.25 * unit((r.tempo - 60.0) / 120.0) + 0.25 * f.energy + 0.2 * bright);
+    return f;
+}
+}
+
+// AudioFeatures Implementation
+QJsonObject MusicAnalyzer::AudioFeatures::toJson() const {
+    QJsonObject obj;
+    obj["tempo"] = tempo;
+    obj["energy"] = energy;
+    obj["valence"] = valence;
+    obj["danceability"] = danceability;
+    obj["acousticness"] = acousticness;
+    obj["instrumentalness"] = instrumentalness;
+    obj["loudness"] = loudness;
+    obj["speechiness"] = speechiness;
+    obj["key"] = key;
+    obj["mode"] = mode;
+    obj["duration_ms"] = duration_ms;
+    return obj;
+}
+
+MusicAnalyzer::AudioFeatures MusicAnalyzer::AudioFeatures::fromJson(const QJsonObject &obj) {
+    AudioFeatures f;
+    f.tempo = obj["tempo"].toDouble();
+    f.energy = obj["energy"].toDouble();
+    f.valence = obj["valence"].toDouble();
+    f.danceability = obj["danceability"].toDouble();
+    f.acousticness = obj["acousticness"].toDouble();
+    f.instrumentalness = obj["instrumentalness"].toDouble();
+    f.loudness = obj["loudness"].toDouble(-70.0);
+    f.speechiness = obj["speechiness"].toDouble();
+    f.key = obj["key"].toString();
+    f.mode = obj["mode"].toString();
+    f.duration_ms = obj["duration_ms"].toInt();
+    return f;
+}
+
+// 批量分析线程：循环从队列取文件直到队列为空或被取消
+class MusicAnalyzer::LibraryWorker : public QRunnable {
+public:
+    explicit LibraryWorker(MusicAnalyzer *analyzer) : m_analyzer(analyzer) {}
+    void run() override { m_analyzer->runLibraryWorker(); }
+
+private:
+    MusicAnalyzer *m_analyzer;
+};
+
+// MusicAnalyzer Implementation
+MusicAnalyzer::MusicAnalyzer(QObject *parent)
+    : QObject(parent)
+    , m_maxThreads(qMax(1, QThread::idealThreadCount() - 1))
+    , m_activeWorkers(0)
+    , m_total(0)
+    , m_done(0)
+    , m_cancelRequested(false)
+{
+    qRegisterMetaType<MusicAnalyzer::AudioFeatures>("MusicAnalyzer::AudioFeatures");
+    m_pool.setMaxThreadCount(m_maxThreads);
+}
+
+MusicAnalyzer::~MusicAnalyzer() {
+    cancelLibraryAnalysis();
+    m_pool.waitForDone();
+    m_store.flush();
+}
+
+bool MusicAnalyzer::openFeatureStore(const QString &filePath) {
+    return m_store.open(filePath);
+}
+
+MusicAnalyzer::AudioFeatures MusicAnalyzer::analyzeFile(const QString &filePath) {
+    bool fromStore = false;
+    const AudioFeatures features = lookupOrAnalyze(filePath, &fromStore);
+    if (!fromStore && features.isValid()) emit analysisCompleted(filePath, features);
+    return features;
+}
+
+bool MusicAnalyzer::cachedFeatures(const QString &filePath, AudioFeatures *features) {
+    return storedFeatures(filePath, features, true);
+}
+
+bool MusicAnalyzer::indexedFeatures(const QString &filePath, AudioFeatures *features) {
+    return storedFeatures(filePath, features, false);
+}
+
+bool MusicAnalyzer::storedFeatures(const QString &filePath, AudioFeatures *features, bool computeFingerprint) {
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        const AudioFeatures cached = m_featuresCache.value(filePath);
+        if (cached.isValid()) {
+            if (features) *features = cached;
+            return true;
+        }
+    }
+    const QFileInfo info(filePath);
+    if (!m_store.isOpen() || !info.exists()) return false;
+    QJsonObject stored;
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const QString fp = computeFingerprint ? m_store.fingerprintFor(filePath, info.size(), modified)
+                                          : m_store.cachedFingerprint(filePath, info.size(), modified);
+    if (fp.isEmpty() || !m_store.lookup(fp, &stored)) return false;
+    const AudioFeatures result = AudioFeatures::fromJson(stored);
+    if (!result.isValid()) return false;
+    QMutexLocker locker(&m_cacheMutex);
+    m_featuresCache.insert(filePath, result);
+    if (features) *features = result;
+    return true;
+}
+
+MusicAnalyzer::AudioFeatures MusicAnalyzer::lookupOrAnalyze(const QString &filePath, bool *fromStore) {
+    *fromStore = true;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        const AudioFeatures cached = m_featuresCache.value(filePath);
+        if (cached.isValid()) return cached;
+    }
+
+    // 解码失败的文件记为带版本与时间的失败记录，短期内重启不再反复尝试；
+    // 没有解码能力时什么都不记，启用解码后这些文件照常分析
+    const QFileInfo info(filePath);
+    QString fp;
+    AudioFeatures features;
+    QJsonObject stored;
+    if (m_store.isOpen() && info.exists()) {
+        fp = m_store.fingerprintFor(filePath, info.size(), info.lastModified().toMSecsSinceEpoch());
+    }
+    bool hit = false;
+    if (!fp.isEmpty() && m_store.lookup(fp, &stored)) {
+        features = AudioFeatures::fromJson(stored);
+        hit = features.isValid() || isCurrentFailure(stored);
+    }
+    if (!hit) {
+        *fromStore = false;
+        features = extractFeatures(filePath);
+        if (!fp.isEmpty() && kDecodingAvailable) {
+            m_store.insert(fp, features.isValid() ? features.toJson() : failureRecord());
+        }
+    }
+    if (features.isValid()) {
+        QMutexLocker locker(&m_cacheMutex);
+        m_featuresCache.insert(filePath, features);
+    }
+    return features;
+}
+
+double MusicAnalyzer::calculateSimilarity(const AudioFeatures &f1, const AudioFeatures &f2) {
+    float a[FeatureDimensions];
+    float b[FeatureDimensions];
+    featureVector(f1, a);
+    featureVector(f2, b);
+    float distanceSq = 0.0f;
+    for (int d = 0; d < FeatureDimensions; ++d) distanceSq += (a[d] - b[d]) * (a[d] - b[d]);
+    return unit(1.0 - std::sqrt(distanceSq / maxFeatureDistanceSq()));
+}
+
+void MusicAnalyzer::featureVector(const AudioFeatures &features, float *vector) {
+    // 60-240 BPM 按倍频程线性映射，响度 -30..-6 LUFS 映射到 0-1
+    const double tempo = features.tempo > 0.0 ? unit(std::log2(features.tempo / 60.0) / 2.0) : 0.5;
+    // 关系大小调共用调号：小调折算到其关系大调在五度圈上的位置
+    int keyIndex = -1;
+    for (int k = 0; k < 12; ++k) {
+        if (features.key == QLatin1String(kKeyNames[k])) keyIndex = k;
+    }
+    const bool minor = features.mode == QLatin1String("minor");
+    float keyCos = 0.0f, keySin = 0.0f;
+    if (keyIndex >= 0) {
+        const int fifths = ((minor ? keyIndex + 3 : keyIndex) * 7) % 12;
+        keyCos = float(std::cos(2.0 * M_PI * fifths / 12.0));
+        keySin = float(std::sin(2.0 * M_PI * fifths / 12.0));
+    }
+    const float raw[FeatureDimensions] = {
+        float(tempo),
+        float(unit(features.energy)),
+        float(unit(features.valence)),
+        float(unit(features.danceability)),
+        float(unit(features.acousticness)),
+        float(unit(features.instrumentalness)),
+        float(unit(features.speechiness)),
+        float(unit((features.loudness + 30.0) / 24.0)),
+        keyCos,
+        keySin,
+        keyIndex < 0 ? 0.5f : (minor ? 0.0f : 1.0f)};
+    for (int d = 0; d < FeatureDimensions; ++d) vector[d] = raw[d] * kFeatureWeights[d];
+}
+
+void MusicAnalyzer::analyzeLibrary(const QStringList &filePaths) {
+    QMutexLocker locker(&m_queueMutex);
+    if (m_activeWorkers == 0) {
+        m_total = 0;
+        m_done = 0;
+        m_progressTimer.start();
+    }
+    m_cancelRequested = false;
+    for (const QString &path : filePaths) {
+        if (m_pending.contains(path)) continue;
+        m_pending.insert(path);
+        m_queue.push_back(path);
+        ++m_total;
+    }
+    while (m_activeWorkers < m_maxThreads && m_activeWorkers < m_pending.size()) {
+        ++m_activeWorkers;
+        m_pool.start(new LibraryWorker(this));
+    }
+}
+
+void MusicAnalyzer::prioritize(const QStringList &filePaths) {
+    QMutexLocker locker(&m_queueMutex);
+    // 逆序压入队首，保持调用方给出的先后顺序
+    for (int i = filePaths.size() - 1; i >= 0; --i) {
+        if (m_pending.contains(filePaths[i])) m_priorityQueue.push_front(filePaths[i]);
+    }
+}
+
+void MusicAnalyzer::cancelLibraryAnalysis() {
+    QMutexLocker locker(&m_queueMutex);
+    m_cancelRequested = true;
+    m_queue.clear();
+    m_priorityQueue.clear();
+    m_pending.clear();
+}
+
+bool MusicAnalyzer::isAnalyzingLibrary() const {
+    QMutexLocker locker(&m_queueMutex);
+    return m_activeWorkers > 0;
+}
+
+void MusicAnalyzer::setMaxThreads(int count) {
+    QMutexLocker locker(&m_queueMutex);
+    m_maxThreads = qMax(1, count);
+    m_pool.setMaxThreadCount(m_maxThreads);
+}
+
+bool MusicAnalyzer::takeNextJob(QString *filePath) {
+    for (std::deque<QString> *queue : {&m_priorityQueue, &m_queue}) {
+        while (!queue->empty()) {
+            QString path = queue->front();
+            queue->pop_front();
+            if (m_pending.remove(path)) {
+                *filePath = path;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void MusicAnalyzer::runLibraryWorker() {
+    // 分析是后台任务，不与解码、输出线程争抢 CPU
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+    for (;;) {
+        QString path;
+        bool reportProgress = false;
+        bool finished = false;
+        int done = 0, total = 0;
+        {
+            QMutexLocker locker(&m_queueMutex);
+            if (m_cancelRequested || !takeNextJob(&path)) {
+                finished = --m_activeWorkers == 0;
+                done = m_done;
+                total = m_total;
+            }
+        }
+        if (path.isEmpty()) {
+            if (finished) {
+                m_store.flush();
+                emit libraryAnalysisProgress(done, total);
+                emit libraryAnalysisCompleted();
+            }
+            QThread::currentThread()->setPriority(QThread::NormalPriority);
+            return;
+        }
+
+        bool known = false;
+        {
+            QMutexLocker locker(&m_cacheMutex);
+            known = m_featuresCache.value(path).isValid();
+        }
+        bool fromStore = false;
+        const AudioFeatures features = lookupOrAnalyze(path, &fromStore);
+        // 首次按指纹载入的也通知（如移动、改名后的文件），推荐引擎的索引据此补入
+        if (!known && features.isValid()) emit analysisCompleted(path, features);
+
+        {
+            QMutexLocker locker(&m_queueMutex);
+            ++m_done;
+            if (m_progressTimer.elapsed() >= kProgressIntervalMs) {
+                m_progressTimer.restart();
+                reportProgress = true;
+                done = m_done;
+                total = m_total;
+            }
+        }
+        if (reportProgress) emit libraryAnalysisProgress(done, total);
+    }
+}
+
+MusicAnalyzer::AudioFeatures MusicAnalyzer::extractFeatures(const QString &filePath) {
+#if !defined(ENABLE_FFMPEG)
+    Q_UNUSED(filePath)
+    return AudioFeatures();
+#else
+    AudioFeatureExtractor extractor;
+    const int outRate = extractor.sampleRate();
+
+    AVFormatContext *fmt_ctx = nullptr;
+    if (avformat_open_input(&fmt_ctx, filePath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "Failed to open file:" << filePath;
+        return AudioFeatures();
+    }
+    if (avformat_find_stream_info(fmt_ctx, nullptr) < 0) {
+        qWarning() << "Failed to find stream info";
+        avformat_close_input(&fmt_ctx);
+        return AudioFeatures();
+    }
+    const int audio_stream_index = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (audio_stream_index < 0) {
+        qWarning() << "No audio stream found";
+        avformat_close_input(&fmt_ctx);
+        return AudioFeatures();
+    }
+    // 封面等其他流的包直接在解复用层丢弃
+    for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
+        if (int(i) != audio_stream_index) fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    AVCodecParameters *codecpar = fmt_ctx->streams[audio_stream_index]->codecpar;
+    const AVCodec *dec = avcodec_find_decoder(codecpar->codec_id);
+    if (!dec) { qWarning() << "Unsupported codec:" << codecpar->codec_id; avformat_close_input(&fmt_ctx); return AudioFeatures(); }
+    AVCodecContext *codec_ctx = avcodec_alloc_context3(dec);
+    if (!codec_ctx) { qWarning() << "Failed to allocate codec context"; avformat_close_input(&fmt_ctx); return AudioFeatures(); }
+    if (avcodec_parameters_to_context(codec_ctx, codecpar) < 0) { qWarning() << "Failed to copy codec parameters"; avcodec_free_context(&codec_ctx); avformat_close_input(&fmt_ctx); return AudioFeatures(); }
+    if (avcodec_open2(codec_ctx, dec, nullptr) < 0) { qWarning() << "Failed to open codec"; avcodec_free_context(&codec_ctx); avformat_close_input(&fmt_ctx); return AudioFeatures(); }
+    SwrContext *swr_ctx = swr_alloc();
+    if (!swr_ctx) { qWarning() << "Failed to allocate resampler"; avcodec_free_context(&codec_ctx); avformat_close_input(&fmt_ctx); return AudioFeatures(); }
+    // 下混与降采样在重采样器中一步完成，后续只处理单声道低采样率数据
+    const int channels = codec_ctx->ch_layout.nb_channels > 0 ? codec_ctx->ch_layout.nb_channels : 2;
+    AVChannelLayout in_ch_layout;
+    AVChannelLayout out_ch_layout;
+    av_channel_layout_default(&in_ch_layout, channels);
+    av_channel_layout_default(&out_ch_layout, 1);
+    av_opt_set_chlayout(swr_ctx, "in_chlayout", &in_ch_layout, 0);
+    av_opt_set_chlayout(swr_ctx, "out_chlayout", &out_ch_layout, 0);
+    av_opt_set_int(swr_ctx, "in_sample_rate", codec_ctx->sample_rate, 0);
+    av_opt_set_int(swr_ctx, "out_sample_rate", outRate, 0);
+    av_opt_set_sample_fmt(swr_ctx, "in_sample_fmt", codec_ctx->sample_fmt, 0);
+    av_opt_set_sample_fmt(swr_ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);
+    if (swr_init(swr_ctx) < 0) { qWarning() << "Failed to initialize resampler"; swr_free(&swr_ctx); avcodec_free_context(&codec_ctx); avformat_close_input(&fmt_ctx); return AudioFeatures(); }
+
+    AVPacket *pkt = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    QVector<float> buffer;
+    // 输入为空时冲洗重采样器内部延迟的样本
+    auto convert = [&](const AVFrame *in) {
+        const int inSamples = in ? in->nb_samples : 0;
+        const int capacity = swr_get_out_samples(swr_ctx, inSamples);
+        if (capacity <= 0) return;
+        if (buffer.size() < capacity) buffer.resize(capacity);
+        uint8_t *out = reinterpret_cast<uint8_t *>(buffer.data());
+        const int converted = swr_convert(swr_ctx, &out, capacity,
+                                          in ? const_cast<const uint8_t **>(in->extended_data) : nullptr, inSamples);
+        if (converted > 0) extractor.process(buffer.constData(), converted);
+    };
+    auto drain = [&]() {
+        while (avcodec_receive_frame(codec_ctx, frame) == 0) {
+            convert(frame);
+            av_frame_unref(frame);
+        }
+    };
+    if (pkt && frame) {
+        while (av_read_frame(fmt_ctx, pkt) >= 0) {
+            if (pkt->stream_index == audio_stream_index && avcodec_send_packet(codec_ctx, pkt) == 0) drain();
+            av_packet_unref(pkt);
+        }
+        avcodec_send_packet(codec_ctx, nullptr);
+        drain();
+        convert(nullptr);
+    } else {
+        qWarning() << "Failed to allocate packet or frame";
+    }
+
+    if (frame) av_frame_free(&frame);
+    if (pkt) av_packet_free(&pkt);
+    swr_free(&swr_ctx);
+    avcodec_free_context(&codec_ctx);
+    avformat_close_input(&fmt_ctx);
+
+    const AudioFeatureExtractor::Result descriptors = extractor.finish();
+    return descriptors.valid ? toAudioFeatures(descriptors) : AudioFeatures();
+#endif
+}
+
+// RecommendationEngine Implementation
+RecommendationEngine::RecommendationEngine(QObject *parent)
+    : QObject(parent)
+    , m_analyzer(nullptr)
+    , m_featureIndex(MusicAnalyzer::FeatureDimensions)
+{
+}
+
+void RecommendationEngine::setMusicAnalyzer(MusicAnalyzer *analyzer) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_analyzer) disconnect(m_analyzer, nullptr, this, nullptr);
+        m_analyzer = analyzer;
+        if (m_analyzer) {
+            connect(m_analyzer, &MusicAnalyzer::analysisCompleted, this, &RecommendationEngine::onFeaturesAnalyzed);
+        }
+        rebuildFeatureIndex();
+    }
+    emit featuresUpdated();
+}
+
+void RecommendationEngine::setMusicLibrary(const QVector<SongInfo> &songs) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_musicLibrary = songs;
+        m_libraryRows.clear();
+        m_libraryRows.reserve(songs.size());
+        for (int i = 0; i < songs.size(); ++i) m_libraryRows.insert(songs[i].filePath, i);
+        rebuildFeatureIndex();
+    }
+    emit libraryUpdated();
+}
+
+void RecommendationEngine::rebuildFeatureIndex() {
+    m_featureIndex.clear();
+    if (!m_analyzer) return;
+    // 在调用方（界面）线程持锁执行：只用已记录的路径指纹，不读文件内容；
+    // 其余文件由后台分析计算指纹后经 onFeaturesAnalyzed() 补入
+    float vector[MusicAnalyzer::FeatureDimensions];
+    for (const SongInfo &song : m_musicLibrary) {
+        MusicAnalyzer::AudioFeatures features;
+        if (!m_analyzer->indexedFeatures(song.filePath, &features)) continue;
+        MusicAnalyzer::featureVector(features, vector);
+        m_featureIndex.upsert(song.filePath, vector);
+    }
+    m_featureIndex.rebuild();
+}
+
+void RecommendationEngine::onFeaturesAnalyzed(const QString &filePath, const MusicAnalyzer::AudioFeatures &features) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_libraryRows.contains(filePath)) return;
+        float vector[MusicAnalyzer::FeatureDimensions];
+        MusicAnalyzer::featureVector(features, vector);
+        m_featureIndex.upsert(filePath, vector);
+    }
+    emit featuresUpdated();
+}
+
+RecommendationEngine::FeatureTarget RecommendationEngine::targetFor(const QString &mood, const QString &activity) const {
+    FeatureTarget result;
+    auto apply = [&result](const TargetSpec *spec) {
+        if (!spec) return false;
+        for (int d = 0; d < 8; ++d) {
+            if (std::isnan(spec->values[d])) continue;
+            // 心情与活动都指定的维度取两者平均
+            const float value = targetComponent(d, spec->values[d]);
+            result.target[d] = (result.target[d] * result.weights[d] + value) / (result.weights[d] + 1.0f);
+            result.weights[d] += 1.0f;
+        }
+        return true;
+    };
+    const bool matched = apply(findTarget(kMoodTargets, mood)) | apply(findTarget(kActivityTargets, activity));
+    if (!matched) {
+        // 未知或未指定时按用户的能量/情感偏好
+        result.target[1] = targetComponent(1, float(m_preferences.energyPreference()));
+        result.target[2] = targetComponent(2, float(m_preferences.valencePreference()));
+        result.weights[1] = result.weights[2] = 1.0f;
+    }
+    for (int d = 0; d < MusicAnalyzer::FeatureDimensions; ++d) {
+        result.maxDistance += result.weights[d] * kFeatureWeights[d] * kFeatureWeights[d];
+    }
+    return result;
+}
+
+QVector<RecommendationEngine::Candidate> RecommendationEngine::scoreLibrary(const FeatureTarget &target, int limit) {
+    QVector<Candidate> result;
+    if (m_featureIndex.needsRebuild()) m_featureIndex.rebuild();
+    const int slotCount = m_featureIndex.slotCount();
+    if (slotCount == 0 || limit <= 0) return result;
+
+    // 一次扫描整个特征矩阵，再部分选择出距离最小的 limit 个；只有这些条目才查曲库与偏好
+    QVector<float> distances(slotCount);
+    m_featureIndex.weightedDistances(target.target, target.weights, distances.data());
+    QVector<int> order(slotCount);
+    std::iota(order.begin(), order.end(), 0);
+    const int poolSize = qMin(limit, slotCount);
+    std::nth_element(order.begin(), order.begin() + (poolSize - 1), order.end(),
+                     [&distances](int a, int b) { return distances[a] < distances[b]; });
+
+    // 播放记录的 songId 即文件路径
+    QSet<QString> skipped;
+    for (const PlayHistory &history : m_playHistory) {
+        if (history.skipped) skipped.insert(history.songId);
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QHash<QString, int> artistIds;
+    QHash<QString, double> artistBonus;
+    result.reserve(poolSize);
+    for (int i = 0; i < poolSize; ++i) {
+        const int slot = order[i];
+        if (std::isinf(distances[slot])) continue;
+        const int row = m_libraryRows.value(m_featureIndex.idAt(slot), -1);
+        if (row < 0) continue;
+        const SongInfo &song = m_musicLibrary[row];
+
+        double score = target.maxDistance > 0.0f
+            ? 1.0 - std::sqrt(qMax(0.0, double(distances[slot]) / target.maxDistance))
+            : 1.0;
+        int artist = -1;
+        if (!song.artist.isEmpty()) {
+            auto it = artistIds.find(song.artist);
+            if (it == artistIds.end()) {
+                it = artistIds.insert(song.artist, artistIds.size());
+                artistBonus.insert(song.artist, kArtistBonus * std::tanh(
+                    m_preferences.weight(PreferenceModel::Artist, song.artist, now) / 2.0));
+            }
+            artist = it.value();
+            score += artistBonus.value(song.artist);
+        }
+        if (skipped.contains(song.filePath)) score -= kSkipPenalty;
+        result.append(Candidate{row, score, song.durationMs, artist});
+    }
+    std::sort(result.begin(), result.end(), [](const Candidate &a, const Candidate &b) {
+        return a.score > b.score;
+    });
+    return result;
+}
+
+double RecommendationEngine::targetFit(const SongInfo &song, const FeatureTarget &target) {
+    float vector[MusicAnalyzer::FeatureDimensions];
+    if (!m_featureIndex.vectorFor(song.filePath, vector)) {
+        MusicAnalyzer::AudioFeatures features;
+        if (!m_analyzer || !m_analyzer->cachedFeatures(song.filePath, &features)) return 0.0;
+        MusicAnalyzer::featureVector(features, vector);
+    }
+    float distance = 0.0f;
+    for (int d = 0; d < MusicAnalyzer::FeatureDimensions; ++d) {
+        const float diff = vector[d] - target.target[d];
+        distance += target.weights[d] * diff * diff;
+    }
+    return target.maxDistance > 0.0f ? unit(1.0 - std::sqrt(distance / target.maxDistance)) : 1.0;
+}
+
+QVector<SongInfo> RecommendationEngine::generateSmartPlaylist(const QString &mood,
+                                                              const QString &activity,
+                                                              int duration_minutes) {
+    QMutexLocker locker(&m_mutex);
+    QVector<SongInfo> result;
+    const qint64 budget = qint64(qMax(1, duration_minutes)) * 60000;
+    const qint64 lower = budget - kDurationToleranceMs;
+    const qint64 upper = budget + kDurationToleranceMs;
+    const int expected = int(budget / kTypicalSongMs) + 1;
+    const QVector<Candidate> pool = scoreLibrary(targetFor(mood, activity), qMax(kMinPool, expected * kPoolFactor));
+    if (pool.isEmpty()) return result;
+    const int artistCap = qMax(2, expected / 4);
+
+    QVector<int> chosen;                // pool 下标，按播放顺序
+    QVector<bool> used(pool.size(), false);
+    QHash<int, int> artistCount;
+    qint64 total = 0;
+
+    // 把 artist 放在 position 处是否与前后 kArtistGap 首冲突；replacing 为被替换掉的位置
+    auto separated = [&](int artist, int position, int replacing) {
+        if (artist < 0) return true;
+        const int from = qMax(0, position - kArtistGap);
+        const int to = qMin(chosen.size() - 1, position + kArtistGap);
+        for (int p = from; p <= to; ++p) {
+            if (p != replacing && pool[chosen[p]].artist == artist) return false;
+        }
+        return true;
+    };
+    auto capped = [&](int artist) {
+        return artist >= 0 && artistCount.value(artist) >= artistCap;
+    };
+    // 贪心：按得分依次追加能装下且满足歌手间隔的歌曲，直到进入预算窗口
+    auto fill = [&]() {
+        while (total < lower) {
+            int pick = -1;
+            for (int i = 0; i < pool.size() && pick < 0; ++i) {
+                const Candidate &c = pool[i];
+                if (used[i] || c.durationMs <= 0 || total + c.durationMs > upper) continue;
+                if (capped(c.artist) || !separated(c.artist, chosen.size(), -1)) continue;
+                pick = i;
+            }
+            if (pick < 0) return;
+            used[pick] = true;
+            chosen.append(pick);
+            total += pool[pick].durationMs;
+            if (pool[pick].artist >= 0) ++artistCount[pool[pick].artist];
+        }
+    };
+
+    fill();
+    // 修补：贪心卡在预算以下时，找一次交换使总时长最接近预算（窗口内视为同等），同等时损失得分最少
+    for (int round = 0; round < kRepairRounds && total < lower && !chosen.isEmpty(); ++round) {
+        qint64 bestGap = budget - total;
+        double bestLoss = 0.0;
+        int bestPosition = -1;
+        int bestCandidate = -1;
+        for (int p = 0; p < chosen.size(); ++p) {
+            const Candidate &out = pool[chosen[p]];
+            for (int i = 0; i < pool.size(); ++i) {
+                const Candidate &in = pool[i];
+                if (used[i] || in.durationMs <= 0) continue;
+                const qint64 newTotal = total - out.durationMs + in.durationMs;
+                if (newTotal > upper) continue;
+                qint64 gap = qAbs(budget - newTotal);
+                if (gap <= kDurationToleranceMs) gap = 0;
+                const double loss = out.score - in.score;
+                if (gap > bestGap || (gap == bestGap && (bestPosition < 0 || loss >= bestLoss))) continue;
+                if (in.artist != out.artist && capped(in.artist)) continue;
+                if (!separated(in.artist, p, p)) continue;
+                bestGap = gap;
+                bestLoss = loss;
+                bestPosition = p;
+                bestCandidate = i;
+            }
+        }
+        if (bestPosition < 0) break;
+        const Candidate &out = pool[chosen[bestPosition]];
+        const Candidate &in = pool[bestCandidate];
+        if (out.artist >= 0) --artistCount[out.artist];
+        if (in.artist >= 0) ++artistCount[in.artist];
+        total += in.durationMs - out.durationMs;
+        used[chosen[bestPosition]] = false;
+        used[bestCandidate] = true;
+        chosen[bestPosition] = bestCandidate;
+        fill();
+    }
+
+    result.reserve(chosen.size());
+    for (int index : chosen) result.append(m_musicLibrary[pool[index].row]);
+    return result;
+}
+
+QVector<SongInfo> RecommendationEngine::recommend(RecommendationType type, const SongInfo &baseSong, int count) {
+    QMutexLocker locker(&m_mutex);
+    MusicAnalyzer::AudioFeatures baseFeatures;
+    const bool haveBase = !baseSong.filePath.isEmpty() && m_analyzer
+        && m_analyzer->cachedFeatures(baseSong.filePath, &baseFeatures);
+    const TimeSlot &now = timeSlotFor(QTime::currentTime().hour());
+
+    switch (type) {
+    case SimilarSongs:
+        return recommendSimilar(baseSong, count);
+    case MoodBased: {
+        // 没有参照歌曲时取用户最常听的心情
+        QString mood = haveBase ? detectMood(baseFeatures) : QString::fromLatin1(now.mood);
+        if (!haveBase) {
+            const QMap<QString, double> moods = m_preferences.weights(PreferenceModel::Mood, QDateTime::currentMSecsSinceEpoch());
+            double best = 0.0;
+            for (auto it = moods.constBegin(); it != moods.constEnd(); ++it) {
+                if (it.value() > best) {
+                    best = it.value();
+                    mood = it.key();
+                }
+            }
+        }
+        return recommendByMood(mood, count);
+    }
+    case GenreBased:
+        // SongInfo 没有流派信息，以用户偏好的歌手代替
+        return recommendFavoriteArtists(count);
+    case TimeBased:
+        return recommendByTime(count);
+    case ActivityBased:
+        return recommendByActivity(haveBase ? detectActivity(baseFeatures) : QString::fromLatin1(now.activity), count);
+    case DiscoveryMix:
+        return recommendDiscovery(count);
+    }
+    return QVector<SongInfo>();
+}
+
+QVector<SongInfo> RecommendationEngine::recommendByTime(int count) {
+    const TimeSlot &slot = timeSlotFor(QTime::currentTime().hour());
+    QVector<SongInfo> result;
+    for (const Candidate &c : scoreLibrary(targetFor(QString::fromLatin1(slot.mood), QString::fromLatin1(slot.activity)), count)) {
+        result.append(m_musicLibrary[c.row]);
+    }
+    return result;
+}
+
+QVector<SongInfo> RecommendationEngine::recommendDiscovery(int count) {
+    // 贴合用户能量/情感偏好、但歌手还不熟悉的歌曲，每位歌手最多两首
+    QVector<SongInfo> result;
+    QSet<QString> recent;
+    for (const PlayHistory &history : m_playHistory) recent.insert(history.songId);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QHash<int, int> perArtist;
+    for (const Candidate &c : scoreLibrary(targetFor(QString(), QString()), count * kDiscoveryPoolFactor)) {
+        if (result.size() >= count) break;
+        const SongInfo &song = m_musicLibrary[c.row];
+        if (recent.contains(song.filePath)) continue;
+        if (m_preferences.weight(PreferenceModel::Artist, song.artist, now) > kFamiliarArtistWeight) continue;
+        if (c.artist >= 0 && ++perArtist[c.artist] > 2) continue;
+        result.append(song);
+    }
+    return result;
+}
+
+QVector<SongInfo> RecommendationEngine::recommendFavoriteArtists(int count) {
+    // 按歌手偏好权重排序，每位歌手最多 kMaxSongsPerArtist 首
+    const QMap<QString, double> weights = m_preferences.weights(PreferenceModel::Artist, QDateTime::currentMSecsSinceEpoch());
+    QVector<QPair<double, int>> ranked;
+    QHash<QString, int> perArtist;
+    for (int row = 0; row < m_musicLibrary.size(); ++row) {
+        const SongInfo &song = m_musicLibrary[row];
+        const double weight = weights.value(song.artist);
+        if (weight <= 0.0) continue;
+        if (++perArtist[song.artist] > kMaxSongsPerArtist) continue;
+        ranked.append(qMakePair(weight, row));
+    }
+    const int n = qMin(count, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+                      [](const QPair<double, int> &a, const QPair<double, int> &b) { return a.first > b.first; });
+    QVector<SongInfo> result;
+    result.reserve(n);
+    for (int i = 0; i < n; ++i) result.append(m_musicLibrary[ranked[i].second]);
+    return result;
+}
+
+QVector<SongInfo> RecommendationEngine::recommendByMood(const QString &mood, int count) {
+    QVector<SongInfo> result;
+    for (const Candidate &c : scoreLibrary(targetFor(mood, QString()), count)) result.append(m_musicLibrary[c.row]);
+    return result;
+}
+
+QVector<SongInfo> RecommendationEngine::recommendByActivity(const QString &activity, int count) {
+    QVector<SongInfo> result;
+    for (const Candidate &c : scoreLibrary(targetFor(QString(), activity), count)) result.append(m_musicLibrary[c.row]);
+    return result;
+}
+
+double RecommendationEngine::calculateMoodScore(const SongInfo &song, const QString &mood) {
+    return targetFit(song, targetFor(mood, QString()));
+}
+
+double RecommendationEngine::calculateActivityScore(const SongInfo &song, const QString &activity) {
+    return targetFit(song, targetFor(QString(), activity));
+}
+
+QJsonObject RecommendationEngine::UserPreference::toJson() const {
+    auto mapToJson = [](const QMap<QString, double> &weights) {
+        QJsonObject obj;
+        for (auto it = weights.constBegin(); it != weights.constEnd(); ++it) obj[it.key()] = it.value();
+        return obj;
+    };
+    QJsonObject obj;
+    obj["genreWeights"] = mapToJson(genreWeights);
+    obj["artistWeights"] = mapToJson(artistWeights);
+    obj["moodWeights"] = mapToJson(moodWeights);
+    QJsonObject hours;
+    for (auto it = timeWeights.constBegin(); it != timeWeights.constEnd(); ++it) hours[QString::number(it.key())] = it.value();
+    obj["timeWeights"] = hours;
+    obj["energyPreference"] = energyPreference;
+    obj["valencePreference"] = valencePreference;
+    return obj;
+}
+
+RecommendationEngine::UserPreference RecommendationEngine::UserPreference::fromJson(const QJsonObject &obj) {
+    auto mapFromJson = [](const QJsonObject &weights) {
+        QMap<QString, double> map;
+        for (const QString &key : weights.keys()) map.insert(key, weights[key].toDouble());
+        return map;
+    };
+    UserPreference pref;
+    pref.genreWeights = mapFromJson(obj["genreWeights"].toObject());
+    pref.artistWeights = mapFromJson(obj["artistWeights"].toObject());
+    pref.moodWeights = mapFromJson(obj["moodWeights"].toObject());
+    const QJsonObject hours = obj["timeWeights"].toObject();
+    for (const QString &key : hours.keys()) pref.timeWeights.insert(key.toInt(), hours[key].toDouble());
+    pref.energyPreference = obj["energyPreference"].toDouble(0.5);
+    pref.valencePreference = obj["valencePreference"].toDouble(0.5);
+    return pref;
+}
+
+QJsonObject RecommendationEngine::PlayHistory::toJson() const {
+    QJsonObject obj;
+    obj["songId"] = songId;
+    obj["timestamp"] = double(timestamp);
+    obj["playDuration"] = double(playDuration);
+    obj["skipped"] = skipped;
+    obj["liked"] = liked;
+    obj["completionRate"] = completionRate;
+    return obj;
+}
+
+RecommendationEngine::PlayHistory RecommendationEngine::PlayHistory::fromJson(const QJsonObject &obj) {
+    PlayHistory history;
+    history.songId = obj["songId"].toString();
+    history.timestamp = qint64(obj["timestamp"].toDouble());
+    history.playDuration = qint64(obj["playDuration"].toDouble());
+    history.skipped = obj["skipped"].toBool();
+    history.liked = obj["liked"].toBool();
+    history.completionRate = obj["completionRate"].toDouble();
+    return history;
+}
+
+void RecommendationEngine::updateUserPreference(const PlayHistory &history, const SongInfo &song) {
+    {
+        QMutexLocker locker(&m_mutex);
+        // 日志记录自带歌手、心情与能量/情感，回放时不依赖曲库与分析器
+        QJsonObject event = history.toJson();
+        event["artist"] = song.artist;
+        MusicAnalyzer::AudioFeatures features;
+        if (m_analyzer && m_analyzer->cachedFeatures(song.filePath, &features)) {
+            event["mood"] = detectMood(features);
+            event["energy"] = features.energy;
+            event["valence"] = features.valence;
+        }
+        foldPlay(event);
+        m_playLog.append(event);
+
+        m_playHistory.push_back(history);
+        if (int(m_playHistory.size()) > RecentPlayCount) m_playHistory.pop_front();
+    }
+    emit userPreferenceUpdated();
+}
+
+void RecommendationEngine::foldPlay(const QJsonObject &event) {
+    // 奖励：跳过为 完成率 - 1（越早跳过越负），听完为 完成率，喜欢额外 +1
+    const qint64 timestamp = qint64(event["timestamp"].toDouble());
+    if (timestamp <= 0) return;
+    const double completion = unit(event["completionRate"].toDouble());
+    double reward = event["skipped"].toBool() ? completion - 1.0 : completion;
+    if (event["liked"].toBool()) reward += 1.0;
+
+    m_preferences.add(PreferenceModel::Artist, event["artist"].toString(), reward, timestamp);
+    m_preferences.add(PreferenceModel::Genre, event["genre"].toString(), reward, timestamp);
+    m_preferences.add(PreferenceModel::Mood, event["mood"].toString(), reward, timestamp);
+    m_preferences.addHour(QDateTime::fromMSecsSinceEpoch(timestamp).time().hour(), reward, timestamp);
+    if (event.contains("energy")) {
+        m_preferences.addTarget(event["energy"].toDouble(), event["valence"].toDouble(), reward, timestamp);
+    }
+}
+
+void RecommendationEngine::learnFromPlaylist(const QVector<SongInfo> &playlist) {
+    // 用户手动整理的歌单视为一次温和的正反馈
+    {
+        QMutexLocker locker(&m_mutex);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (const SongInfo &song : playlist) {
+            updateArtistWeight(song.artist, 0.2);
+            MusicAnalyzer::AudioFeatures features;
+            if (m_analyzer && m_analyzer->cachedFeatures(song.filePath, &features)) {
+                m_preferences.add(PreferenceModel::Mood, detectMood(features), 0.2, now);
+            }
+        }
+    }
+    if (!playlist.isEmpty()) emit userPreferenceUpdated();
+}
+
+std::deque<RecommendationEngine::PlayHistory> RecommendationEngine::recentPlays() const {
+    QMutexLocker locker(&m_mutex);
+    return m_playHistory;
+}
+
+RecommendationEngine::UserPreference RecommendationEngine::getUserPreference() const {
+    QMutexLocker locker(&m_mutex);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    UserPreference pref;
+    pref.genreWeights = m_preferences.weights(PreferenceModel::Genre, now);
+    pref.artistWeights = m_preferences.weights(PreferenceModel::Artist, now);
+    pref.moodWeights = m_preferences.weights(PreferenceModel::Mood, now);
+    for (int hour = 0; hour < 24; ++hour) pref.timeWeights.insert(hour, m_preferences.hourWeight(hour, now));
+    pref.energyPreference = m_preferences.energyPreference();
+    pref.valencePreference = m_preferences.valencePreference();
+    return pref;
+}
+
+void RecommendationEngine::saveUserPreference(const QString &filePath) {
+    QMutexLocker locker(&m_mutex);
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save user preference:" << filePath;
+        return;
+    }
+    file.write(QJsonDocument(m_preferences.toJson()).toJson(QJsonDocument::Compact));
+    if (!file.commit()) qWarning() << "Failed to save user preference:" << filePath;
+
+    const QString logPath = QFileInfo(filePath).absolutePath() + "/play_history.jsonl";
+    if (m_playLog.filePath() != logPath) m_playLog.open(logPath);
+}
+
+void RecommendationEngine::loadUserPreference(const QString &filePath) {
+    {
+        QMutexLocker locker(&m_mutex);
+        const QString logPath = QFileInfo(filePath).absolutePath() + "/play_history.jsonl";
+        if (m_playLog.filePath() != logPath) m_playLog.open(logPath);
+
+        QFile file(filePath);
+        const bool haveModel = file.open(QIODevice::ReadOnly);
+        if (haveModel) m_preferences.fromJson(QJsonDocument::fromJson(file.readAll()).object());
+        else m_preferences.clear();
+
+        // 日志只需顺序读一遍：恢复最近的播放记录，偏好文件丢失时顺带重放重建偏好
+        m_playHistory.clear();
+        m_playLog.replay([this, haveModel](const QJsonObject &event) {
+            if (!haveModel) foldPlay(event);
+            m_playHistory.push_back(PlayHistory::fromJson(event));
+            if (int(m_playHistory.size()) > RecentPlayCount) m_playHistory.pop_front();
+        });
+    }
+    emit userPreferenceUpdated();
+}
+
+void RecommendationEngine::updateGenreWeight(const QString &genre, double weight) {
+    m_preferences.add(PreferenceModel::Genre, genre, weight, QDateTime::currentMSecsSinceEpoch());
+}
+
+void RecommendationEngine::updateArtistWeight(const QString &artist, double weight) {
+    m_preferences.add(PreferenceModel::Artist, artist, weight, QDateTime::currentMSecsSinceEpoch());
+}
+
+QString RecommendationEngine::detectMood(const MusicAnalyzer::AudioFeatures &features) {
+    // 能量 × 情感的四个象限
+    if (features.energy >= 0.5) return features.valence >= 0.5 ? "happy" : "intense";
+    return features.valence >= 0.5 ? "calm" : "sad";
+}
+
+QString RecommendationEngine::detectActivity(const MusicAnalyzer::AudioFeatures &features) {
+    // 离哪个活动的目标特征最近
+    float vector[MusicAnalyzer::FeatureDimensions];
+    MusicAnalyzer::featureVector(features, vector);
+    QString best;
+    double bestDistance = std::numeric_limits<double>::max();
+    for (const TargetSpec &spec : kActivityTargets) {
+        double distance = 0.0;
+        for (int d = 0; d < 8; ++d) {
+            if (std::isnan(spec.values[d])) continue;
+            const double diff = vector[d] - targetComponent(d, spec.values[d]);
+            distance += diff * diff;
+        }
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = QString::fromLatin1(spec.name);
+        }
+    }
+    return best;
+}
+
+QVector<SongInfo> RecommendationEngine::recommendSimilar(const SongInfo &baseSong, int count) {
+    QVector<SongInfo> result;
+    float query[MusicAnalyzer::FeatureDimensions];
+    if (!m_featureIndex.vectorFor(baseSong.filePath, query)) {
+        MusicAnalyzer::AudioFeatures features;
+        if (!m_analyzer || !m_analyzer->cachedFeatures(baseSong.filePath, &features)) return result;
+        MusicAnalyzer::featureVector(features, query);
+    }
+    // 增量更新积累的墓碑与未编入 IVF 的尾部到一定比例才整理一次
+    if (m_featureIndex.needsRebuild()) m_featureIndex.rebuild();
+
+    const QVector<FeatureIndex::Match> matches = m_featureIndex.nearest(query, count, baseSong.filePath);
+    result.reserve(matches.size());
+    for (const FeatureIndex::Match &match : matches) {
+        const int row = m_libraryRows.value(match.id, -1);
+        if (row >= 0) result.append(m_musicLibrary[row]);
+    }
+    return result;
+}
+
+// SmartPlaylistManager Implementation
+class SmartPlaylistManager::UpdateTask : public QRunnable {
+public:
+    UpdateTask(SmartPlaylistManager *manager, RecommendationEngine *engine, const SmartPlaylist &playlist,
+               const quint64 *versions)
+        : m_manager(manager)
+        , m_engine(engine)
+        , m_playlist(playlist)
+        , m_versions(versions, versions + InputCount)
+    {
+    }
+
+    void run() override {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        const QVector<SongInfo> songs = computeSongs(m_engine, m_playlist);
+        QThread::currentThread()->setPriority(QThread::NormalPriority);
+        // 结果交回管理器所在线程替换，读取方不会看到计算到一半的列表
+        SmartPlaylistManager *manager = m_manager;
+        const QString id = m_playlist.id;
+        const QVector<quint64> versions = m_versions;
+        QMetaObject::invokeMethod(manager, [manager, id, songs, versions]() {
+            manager->finishUpdate(id, songs, versions.constData());
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    SmartPlaylistManager *m_manager;
+    RecommendationEngine *m_engine;
+    SmartPlaylist m_playlist;
+    QVector<quint64> m_versions;
+};
+
+QJsonObject SmartPlaylistManager::SmartPlaylist::toJson() const {
+    QJsonObject obj;
+    obj["id"] = id;
+    obj["name"] = name;
+    obj["description"] = description;
+    obj["iconPath"] = iconPath;
+    obj["type"] = int(type);
+    QJsonObject params;
+    for (auto it = parameters.constBegin(); it != parameters.constEnd(); ++it) params[it.key()] = it.value();
+    obj["parameters"] = params;
+    QJsonArray songArray;
+    for (const SongInfo &song : songs) {
+        QJsonObject s;
+        s["filePath"] = song.filePath;
+        s["title"] = song.title;
+        s["artist"] = song.artist;
+        s["album"] = song.album;
+        s["durationMs"] = double(song.durationMs);
+        songArray.append(s);
+    }
+    obj["songs"] = songArray;
+    obj["lastUpdated"] = double(lastUpdated);
+    obj["autoUpdate"] = autoUpdate;
+    return obj;
+}
+
+SmartPlaylistManager::SmartPlaylist SmartPlaylistManager::SmartPlaylist::fromJson(const QJsonObject &obj) {
+    SmartPlaylist playlist;
+    playlist.id = obj["id"].toString();
+    playlist.name = obj["name"].toString();
+    playlist.description = obj["description"].toString();
+    playlist.iconPath = obj["iconPath"].toString();
+    playlist.type = RecommendationEngine::RecommendationType(obj["type"].toInt());
+    const QJsonObject params = obj["parameters"].toObject();
+    for (const QString &key : params.keys()) playlist.parameters.insert(key, params[key].toString());
+    const QJsonArray songArray = obj["songs"].toArray();
+    for (const QJsonValue &value : songArray) {
+        const QJsonObject s = value.toObject();
+        SongInfo song;
+        song.filePath = s["filePath"].toString();
+        song.title = s["title"].toString();
+        song.artist = s["artist"].toString();
+        song.album = s["album"].toString();
+        song.durationMs = qint64(s["durationMs"].toDouble());
+        playlist.songs.append(song);
+    }
+    playlist.lastUpdated = qint64(obj["lastUpdated"].toDouble());
+    playlist.autoUpdate = obj["autoUpdate"].toBool(true);
+    return playlist;
+}
+
+SmartPlaylistManager::SmartPlaylistManager(QObject *parent)
+    : QObject(parent)
+    , m_engine(nullptr)
+    , m_autoUpdateTimer(new QTimer(this))
+    , m_runningUpdates(0)
+{
+    std::fill(m_inputVersions, m_inputVersions + InputCount, 0);
+    std::fill(m_dirtySince, m_dirtySince + InputCount, 0);
+    std::fill(m_lastChange, m_lastChange + InputCount, 0);
+    // 一次只算一个列表，不占用多个核
+    m_pool.setMaxThreadCount(1);
+    m_autoUpdateTimer->setSingleShot(true);
+    connect(m_autoUpdateTimer, &QTimer::timeout, this, &SmartPlaylistManager::onAutoUpdateTimer);
+}
+
+SmartPlaylistManager::~SmartPlaylistManager() {
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void SmartPlaylistManager::setRecommendationEngine(RecommendationEngine *engine) {
+    if (m_engine) disconnect(m_engine, nullptr, this, nullptr);
+    m_pool.waitForDone();
+    m_engine = engine;
+    if (!m_engine) return;
+    connect(m_engine, &RecommendationEngine::libraryUpdated, this, [this]() { markDirty(LibraryInput); });
+    connect(m_engine, &RecommendationEngine::featuresUpdated, this, [this]() { markDirty(FeatureInput); });
+    connect(m_engine, &RecommendationEngine::userPreferenceUpdated, this, [this]() { markDirty(PreferenceInput); });
+    markDirty(LibraryInput);
+}
+
+QString SmartPlaylistManager::createSmartPlaylist(const QString &name,
+                                                  RecommendationEngine::RecommendationType type,
+                                                  const QMap<QString, QString> &parameters) {
+    SmartPlaylist playlist;
+    playlist.id = generatePlaylistId();
+    playlist.name = name;
+    playlist.type = type;
+    playlist.parameters = parameters;
+    playlist.lastUpdated = 0;
+    playlist.autoUpdate = true;
+    m_playlists.insert(playlist.id, playlist);
+    m_updateStates.insert(playlist.id, UpdateState());
+    emit playlistCreated(playlist.id);
+    scheduleUpdate(playlist.id);
+    return playlist.id;
+}
+
+void SmartPlaylistManager::createDefaultPlaylists() {
+    // 已有同名列表的跳过，可重复调用以恢复被删除的默认列表
+    createDiscoveryWeekly();
+    createMoodPlaylists();
+    createActivityPlaylists();
+    createTimePlaylists();
+}
+
+void SmartPlaylistManager::updatePlaylist(const QString &playlistId) {
+    scheduleUpdate(playlistId);
+}
+
+void SmartPlaylistManager::updateAllPlaylists() {
+    for (auto it = m_playlists.constBegin(); it != m_playlists.constEnd(); ++it) scheduleUpdate(it.key());
+}
+
+QVector<SmartPlaylistManager::SmartPlaylist> SmartPlaylistManager::getAllPlaylists() const {
+    QVector<SmartPlaylist> result;
+    result.reserve(m_playlists.size());
+    for (auto it = m_playlists.constBegin(); it != m_playlists.constEnd(); ++it) result.append(it.value());
+    return result;
+}
+
+SmartPlaylistManager::SmartPlaylist SmartPlaylistManager::getPlaylist(const QString &playlistId) const {
+    return m_playlists.value(playlistId);
+}
+
+void SmartPlaylistManager::deletePlaylist(const QString &playlistId) {
+    // 正在计算的结果回来时找不到列表，直接丢弃
+    if (!m_playlists.remove(playlistId)) return;
+    m_updateStates.remove(playlistId);
+    emit playlistDeleted(playlistId);
+    armTimer();
+}
+
+void SmartPlaylistManager::setAutoUpdate(const QString &playlistId, bool autoUpdate) {
+    auto it = m_playlists.find(playlistId);
+    if (it == m_playlists.end()) return;
+    it.value().autoUpdate = autoUpdate;
+    if (autoUpdate && needsUpdate(it.value(), QDateTime::currentMSecsSinceEpoch())) scheduleUpdate(playlistId);
+    armTimer();
+}
+
+void SmartPlaylistManager::savePlaylists(const QString &filePath) {
+    QJsonArray playlists;
+    for (auto it = m_playlists.constBegin(); it != m_playlists.constEnd(); ++it) playlists.append(it.value().toJson());
+    QJsonObject root;
+    root["playlists"] = playlists;
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save smart playlists:" << filePath;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson());
+    if (!file.commit()) qWarning() << "Failed to save smart playlists:" << filePath;
+}
+
+void SmartPlaylistManager::loadPlaylists(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonArray playlists = QJsonDocument::fromJson(file.readAll()).object()["playlists"].toArray();
+    m_playlists.clear();
+    m_updateStates.clear();
+    // 读回的内容视为与当前输入一致，之后的变更才触发重新计算；时间类列表仍按时段刷新
+    UpdateState state;
+    std::copy(m_inputVersions, m_inputVersions + InputCount, state.versions);
+    for (const QJsonValue &value : playlists) {
+        const SmartPlaylist playlist = SmartPlaylist::fromJson(value.toObject());
+        if (playlist.id.isEmpty()) continue;
+        m_playlists.insert(playlist.id, playlist);
+        m_updateStates.insert(playlist.id, state);
+    }
+    onAutoUpdateTimer();
+}
+
+void SmartPlaylistManager::onAutoUpdateTimer() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < InputCount; ++i) {
+        if (m_dirtySince[i] > 0 && now >= settleDeadline(i)) m_dirtySince[i] = 0;
+    }
+    for (auto it = m_playlists.constBegin(); it != m_playlists.constEnd(); ++it) {
+        if (!m_updateStates.value(it.key()).running && needsUpdate(it.value(), now)) scheduleUpdate(it.key());
+    }
+    armTimer();
+}
+
+void SmartPlaylistManager::markDirty(Input input) {
+    // 特征分析期间每首歌都会触发，这里只记版本号与时间；定时器已在等待时不重设，
+    // 到期时若期间又有变更，由 armTimer() 按推迟后的期限重新设置
+    ++m_inputVersions[input];
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_lastChange[input] = now;
+    if (m_dirtySince[input] == 0) {
+        m_dirtySince[input] = now;
+        armTimer();
+    }
+}
+
+qint64 SmartPlaylistManager::settleDeadline(int input) const {
+    return qMin(m_lastChange[input] + kSettleMs[input], m_dirtySince[input] + kMaxSettleMs[input]);
+}
+
+bool SmartPlaylistManager::needsUpdate(const SmartPlaylist &playlist, qint64 now) const {
+    if (!playlist.autoUpdate) return false;
+    bool uses[InputCount] = {true, true, false};
+    switch (playlist.type) {
+    case RecommendationEngine::SimilarSongs:
+    case RecommendationEngine::MoodBased:
+    case RecommendationEngine::ActivityBased:
+        break;
+    case RecommendationEngine::GenreBased:
+        uses[FeatureInput] = false;
+        uses[PreferenceInput] = true;
+        break;
+    case RecommendationEngine::TimeBased:
+        uses[PreferenceInput] = true;
+        if (playlist.lastUpdated / kHourMs != now / kHourMs) return true;
+        break;
+    case RecommendationEngine::DiscoveryMix:
+        uses[PreferenceInput] = true;
+        if (now - playlist.lastUpdated >= kDiscoveryRefreshMs) return true;
+        break;
+    }
+    // 只看已稳定的变更
+    const UpdateState state = m_updateStates.value(playlist.id);
+    for (int i = 0; i < InputCount; ++i) {
+        if (uses[i] && m_dirtySince[i] == 0 && state.versions[i] < m_inputVersions[i]) return true;
+    }
+    return false;
+}
+
+void SmartPlaylistManager::scheduleUpdate(const QString &playlistId) {
+    if (!m_engine || !m_playlists.contains(playlistId)) return;
+    UpdateState &state = m_updateStates[playlistId];
+    if (state.running) {
+        state.queued = true;
+        return;
+    }
+    state.running = true;
+    ++m_runningUpdates;
+    m_pool.start(new UpdateTask(this, m_engine, m_playlists.value(playlistId), m_inputVersions));
+}
+
+void SmartPlaylistManager::finishUpdate(const QString &playlistId, const QVector<SongInfo> &songs,
+                                        const quint64 *versions) {
+    --m_runningUpdates;
+    auto stateIt = m_updateStates.find(playlistId);
+    auto it = m_playlists.find(playlistId);
+    if (stateIt != m_updateStates.end() && it != m_playlists.end()) {
+        UpdateState &state = stateIt.value();
+        state.running = false;
+        std::copy(versions, versions + InputCount, state.versions);
+        it.value().songs = songs;
+        it.value().lastUpdated = QDateTime::currentMSecsSinceEpoch();
+        emit playlistUpdated(playlistId);
+        if (state.queued) {
+            state.queued = false;
+            scheduleUpdate(playlistId);
+        }
+    }
+    if (m_runningUpdates == 0) emit allPlaylistsUpdated();
+    armTimer();
+}
+
+void SmartPlaylistManager::armTimer() {
+    // 只有未稳定的变更或时段边界才需要唤醒；都没有时停止定时器，空闲时不占 CPU
+    if (!m_engine) {
+        m_autoUpdateTimer->stop();
+        return;
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 next = std::numeric_limits<qint64>::max();
+    for (int i = 0; i < InputCount; ++i) {
+        if (m_dirtySince[i] > 0) next = qMin(next, settleDeadline(i));
+    }
+    for (auto it = m_playlists.constBegin(); it != m_playlists.constEnd(); ++it) {
+        const SmartPlaylist &playlist = it.value();
+        if (!playlist.autoUpdate || m_updateStates.value(it.key()).running) continue;
+        if (playlist.type == RecommendationEngine::TimeBased) {
+            next = qMin(next, (now / kHourMs + 1) * kHourMs);
+        } else if (playlist.type == RecommendationEngine::DiscoveryMix) {
+            next = qMin(next, playlist.lastUpdated + kDiscoveryRefreshMs);
+        }
+    }
+    if (next == std::numeric_limits<qint64>::max()) {
+        m_autoUpdateTimer->stop();
+        return;
+    }
+    m_autoUpdateTimer->start(int(qBound<qint64>(0, next - now, kDiscoveryRefreshMs)));
+}
+
+QVector<SongInfo> SmartPlaylistManager::computeSongs(RecommendationEngine *engine, const SmartPlaylist &playlist) {
+    const QMap<QString, QString> &params = playlist.parameters;
+    const int count = params.value("count", QString::number(kDefaultPlaylistCount)).toInt();
+    switch (playlist.type) {
+    case RecommendationEngine::MoodBased:
+    case RecommendationEngine::ActivityBased: {
+        const int minutes = params.value("duration", QString::number(kDefaultPlaylistMinutes)).toInt();
+        return engine->generateSmartPlaylist(params.value("mood"), params.value("activity"), minutes);
+    }
+    default: {
+        SongInfo seed;
+        seed.filePath = params.value("seed");
+        return engine->recommend(playlist.type, seed, count);
+    }
+    }
+}
+
+QString SmartPlaylistManager::generatePlaylistId() {
+    const QString base = "smart_" + QString::number(QDateTime::currentMSecsSinceEpoch(), 36);
+    QString id = base;
+    for (int suffix = 1; m_playlists.contains(id); ++suffix) id = base + "_" + QString::number(suffix);
+    return id;
+}
+
+bool SmartPlaylistManager::hasPlaylistNamed(const QString &name) const {
+    for (auto it = m_playlists.constBegin(); it != m_playlists.constEnd(); ++it) {
+        if (it.value().name == name) return true;
+    }
+    return false;
+}
+
+void SmartPlaylistManager::createDiscoveryWeekly() {
+    if (hasPlaylistNamed("每周发现")) return;
+    QMap<QString, QString> params;
+    params["count"] = QString::number(kDefaultPlaylistCount);
+    const QString id = createSmartPlaylist("每周发现", RecommendationEngine::DiscoveryMix, params);
+    m_playlists[id].description = "贴合你口味的陌生歌手，每周更新";
+}
+
+void SmartPlaylistManager::createMoodPlaylists() {
+    const struct { const char *name; const char *mood; } moods[] = {
+        {"欢快", "happy"}, {"活力", "energetic"}, {"平静", "calm"}, {"忧伤", "sad"}};
+    for (const auto &mood : moods) {
+        if (hasPlaylistNamed(QString::fromUtf8(mood.name))) continue;
+        QMap<QString, QString> params;
+        params["mood"] = mood.mood;
+        params["duration"] = QString::number(kDefaultPlaylistMinutes);
+        createSmartPlaylist(QString::fromUtf8(mood.name), RecommendationEngine::MoodBased, params);
+    }
+}
+
+void SmartPlaylistManager::createActivityPlaylists() {
+    const struct { const char *name; const char *activity; int minutes; } activities[] = {
+        {"运动", "workout", 60}, {"专注", "focus", 90}, {"放松", "relax", 60}, {"派对", "party", 120}, {"助眠", "sleep", 45}};
+    for (const auto &activity : activities) {
+        if (hasPlaylistNamed(QString::fromUtf8(activity.name))) continue;
+        QMap<QString, QString> params;
+        params["activity"] = activity.activity;
+        params["duration"] = QString::number(activity.minutes);
+        createSmartPlaylist(QString::fromUtf8(activity.name), RecommendationEngine::ActivityBased, params);
+    }
+}
+
+void SmartPlaylistManager::createTimePlaylists() {
+    if (hasPlaylistNamed("此刻")) return;
+    QMap<QString, QString> params;
+    params["count"] = QString::number(kDefaultPlaylistCount);
+    const QString id = createSmartPlaylist("此刻", RecommendationEngine::TimeBased, params);
+    m_playlists[id].description = "随一天中的时段自动更新";
+}
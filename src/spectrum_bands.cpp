@@ -0,0 +1,124 @@
+#include "../include/spectrum_bands.h"
+#include <QtMath>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BANDS_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BANDS_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+double toScale(double hz, SpectrumBandMapper::Scale scale) {
+    return scale == SpectrumBandMapper::Mel ? 2595.0 * std::log10(1.0 + hz / 700.0) : std::log(hz);
+}
+
+double fromScale(double value, SpectrumBandMapper::Scale scale) {
+    return scale == SpectrumBandMapper::Mel ? 700.0 * (std::pow(10.0, value / 2595.0) - 1.0) : std::exp(value);
+}
+
+inline float dot(const float *a, const float *b, int n) {
+    int i = 0;
+    float sum = 0.0f;
+#if defined(BANDS_HAVE_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(BANDS_HAVE_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1)) + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+#endif
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+}
+
+SpectrumBandMapper::SpectrumBandMapper()
+    : m_fftSize(0)
+    , m_sampleRate(0)
+    , m_minFreq(0.0f)
+    , m_maxFreq(0.0f)
+    , m_bandCount(0)
+    , m_scale(Mel)
+    , m_firstBin(0)
+    , m_lastBin(0)
+{
+}
+
+bool SpectrumBandMapper::configure(int fftSize, int sampleRate, float minFreq, float maxFreq, int bandCount,
+                                   Scale scale) {
+    if (fftSize == m_fftSize && sampleRate == m_sampleRate && minFreq == m_minFreq && maxFreq == m_maxFreq
+        && bandCount == m_bandCount && scale == m_scale) {
+        return false;
+    }
+    m_fftSize = fftSize;
+    m_sampleRate = sampleRate;
+    m_minFreq = minFreq;
+    m_maxFreq = maxFreq;
+    m_bandCount = qMax(0, bandCount);
+    m_scale = scale;
+    m_bandStart.clear();
+    m_offsets.clear();
+    m_weights.clear();
+    m_firstBin = 0;
+    m_lastBin = 0;
+    if (m_bandCount == 0 || fftSize <= 0 || sampleRate <= 0) {
+        m_bandCount = 0;
+        return true;
+    }
+
+    const int nyquistBin = fftSize / 2;
+    const double binHz = double(sampleRate) / fftSize;
+    // 对数刻度不能从 0 Hz 开始，下限至少取一个频点间距
+    const double low = qMax(double(minFreq), scale == Logarithmic ? binHz : 0.0);
+    const double high = qBound(low + binHz, double(maxFreq), sampleRate * 0.5);
+    const double scaleLow = toScale(low, scale);
+    const double step = (toScale(high, scale) - scaleLow) / (m_bandCount + 1);
+
+    m_bandStart.resize(m_bandCount);
+    m_offsets.resize(m_bandCount + 1);
+    m_firstBin = nyquistBin;
+    for (int b = 0; b < m_bandCount; ++b) {
+        const double left = fromScale(scaleLow + step * b, scale);
+        const double center = fromScale(scaleLow + step * (b + 1), scale);
+        const double right = fromScale(scaleLow + step * (b + 2), scale);
+        m_offsets[b] = m_weights.size();
+
+        int start = qMax(0, int(std::floor(left / binHz)) + 1);
+        const int end = qMin(nyquistBin, int(std::ceil(right / binHz)) - 1);
+        if (right - left < 2.0 * binHz || end < start) {
+            const double position = qMin(center / binHz, double(nyquistBin));
+            start = qMin(int(position), nyquistBin - 1);
+            const float frac = float(position - start);
+            m_weights.append(1.0f - frac);
+            m_weights.append(frac);
+        } else {
+            for (int k = start; k <= end; ++k) {
+                const double f = k * binHz;
+                const double w = f <= center ? (f - left) / (center - left) : (right - f) / (right - center);
+                m_weights.append(float(qMax(w, 0.0)));
+            }
+        }
+        m_bandStart[b] = start;
+        m_firstBin = qMin(m_firstBin, start);
+        m_lastBin = qMax(m_lastBin, start + (m_weights.size() - m_offsets[b]) - 1);
+    }
+    m_offsets[m_bandCount] = m_weights.size();
+    return true;
+}
+
+void SpectrumBandMapper::apply(const float *power, float *bands) const {
+    const int *starts = m_bandStart.constData();
+    const int *offsets = m_offsets.constData();
+    const float *weights = m_weights.constData();
+    for (int b = 0; b < m_bandCount; ++b) {
+        bands[b] = dot(weights + offsets[b], power + starts[b], offsets[b + 1] - offsets[b]);
+    }
+}